@@ -3,10 +3,29 @@
 #include "bitrix24.h"
 #include "wifi_telegram.h"
 #include "storage.h"
+#include "wifi_ap.h"
+#include "json_stream.h"
+#include "bitrix24_batch.h"
+#include "bitrix24_scheduler.h"
+#include "bitrix24_pull.h"
+#include "bitrix24_task_index.h"
+#include "time_service.h"
+#include "bitrix24_queue.h"
+#include "http_body.h"
+#include "http_pool.h"
+#include "net_perf.h"
+#include "rest_query.h"
+#include "bitrix24_group_cache.h"
+#include "bitrix24_digest.h"
+#include "bitrix24_history.h"
+#include "bitrix24_fleet.h"
+#include "pomodoro_globals.h"
 #include <WiFi.h>
 #include <HTTPClient.h>
-#include <ArduinoJson.h>
 #include <string.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 #ifndef BITRIX_HOSTNAME
 #define BITRIX_HOSTNAME "https://npfreom.bitrix24.ru"
@@ -20,6 +39,13 @@
 static char bitrixHostname[128] = "";
 static char bitrixRestEndpoint[128] = "";
 
+// Request strings are built in fixed buffers (see rest_query.h): a whole URL (host + endpoint +
+// method + query) on the stack, one count query on the stack, and per refresh cycle the arena
+static const size_t BITRIX24_URL_MAX = 768;
+static const size_t BITRIX24_PARAMS_MAX = 384;
+static uint8_t refreshArenaBuffer[BITRIX24_ARENA_SIZE];
+static Arena refreshArena(refreshArenaBuffer, sizeof(refreshArenaBuffer));
+
 // Initialize Bitrix24 credentials from NVS or build flags
 static void initBitrix24Credentials() {
   if (strlen(bitrixHostname) == 0) {  // Only load once
@@ -60,13 +86,81 @@ static void initBitrix24Credentials() {
   }
 }
 
-// Update interval: 30 seconds (30000 ms)
-unsigned long bitrix24UpdateInterval = 30000;
-// Minimum retry delay after a failed fetch: 30 seconds (prevents infinite loop, matches normal interval)
-static const unsigned long BITRIX24_MIN_RETRY_DELAY = 30000;
-
-// Cached counts
+// Cached counts (owned by the Bitrix24 task; readers use the published snapshot below)
+// Counters are refreshed on their own cadence (see bitrix24_scheduler.h), so each
+// refresh only overwrites the fields of the counters it fetched.
 static Bitrix24Counts cachedCounts = {0, 0, 0, 0, 0, 0, 0, false, 0};
+// Counters fetched successfully at least once, and the group the GROUP fields belong to
+static uint8_t knownCounters = 0;
+static uint32_t knownGroupId = 0;
+
+// Published snapshot: double buffer guarded by a sequence counter (seqlock).
+// The Bitrix24 task is the only writer; it fills the slot that is NOT currently
+// published and then bumps the sequence, whose low bit selects the live slot.
+// Readers (UI loop, Telegram task) never block: they copy the live slot and retry if
+// anything was published meanwhile. One publication alone leaves their slot alone, but
+// the next one rewrites it while the sequence still reads one ahead, so "fewer than two
+// publications" can't be told apart from "second one in progress".
+static Bitrix24Counts publishedCounts[2] = {
+  {0, 0, 0, 0, 0, 0, 0, false, 0},
+  {0, 0, 0, 0, 0, 0, 0, false, 0}
+};
+static std::atomic<uint32_t> publishedSeq(0);
+// Watched group stats, published in the same slots as the counts
+static Bitrix24GroupStats publishedWatch[2][BITRIX24_MAX_WATCHED_GROUPS];
+static uint8_t publishedWatchCount[2] = {0, 0};
+
+// Watched group list (written by Telegram, copied by the Bitrix24 task at each refresh)
+static portMUX_TYPE watchMux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t watchedGroupIds[BITRIX24_MAX_WATCHED_GROUPS];
+static uint8_t watchedGroupCount = 0;
+// Per-group stats owned by the Bitrix24 task, in watch list order
+static Bitrix24GroupStats watchStats[BITRIX24_MAX_WATCHED_GROUPS];
+static uint8_t watchStatsCount = 0;
+
+// Counters fetched live since boot (the rest may still come from the NVS snapshot)
+static uint8_t liveCounters = 0;
+
+// Compact NVS copy of the last good counts, restored at boot for an instant dashboard
+static const uint16_t SNAPSHOT_VERSION = 1;
+struct Bitrix24Snapshot {
+  uint16_t version;
+  uint8_t watchCount;
+  uint8_t reserved;
+  uint32_t portalHash;     // Hostname + webhook, so another portal's numbers are never shown
+  uint32_t userId;
+  uint32_t savedAt;        // UTC epoch (0 if the clock was unknown)
+  uint32_t groupId;        // Group the group fields belong to
+  uint16_t unreadMessages;
+  uint16_t totalUnreadMessages;
+  uint16_t undoneTasks;
+  uint16_t expiredTasks;
+  uint16_t totalComments;
+  uint16_t groupDelayedTasks;
+  uint16_t groupComments;
+  uint16_t reserved2;
+  struct {
+    uint32_t groupId;
+    uint16_t delayed;
+    uint16_t allTasks;
+  } watch[BITRIX24_MAX_WATCHED_GROUPS];
+};
+static Bitrix24Snapshot lastSavedSnapshot;
+static unsigned long lastSnapshotSaveAt = 0;
+static bool snapshotSavedThisBoot = false;
+
+static void publishCounts(const Bitrix24Counts& counts);
+static uint32_t nowEpochSeconds();
+static void taskCountersReset();
+
+// Counters requested "now" (set by UI/Telegram/Pull, consumed by the Bitrix24 task)
+static std::atomic<uint8_t> pendingRefreshMask(0);
+// The pending refresh was asked for by the user (served ahead of background work)
+static std::atomic<bool> pendingInteractive(false);
+
+// FreeRTOS task handle for Bitrix24 polling
+static TaskHandle_t bitrix24TaskHandle = nullptr;
+
 // Previous counts for change detection
 static Bitrix24Counts previousCounts = {0, 0, 0, 0, 0, 0, 0, false, 0};
 
@@ -76,26 +170,32 @@ static uint32_t selectedGroupId = 0;
 // Current Bitrix24 user ID (determined at runtime via user.current)
 static uint32_t bitrixCurrentUserId = 0;
 
-// Cached Bitrix24 "today" date string (YYYY-MM-DD) from server.time
-static String bitrixTodayDate;
-static unsigned long bitrixTodayLastFetch = 0;
 
-// Helper: Make HTTP GET request to Bitrix24 REST API
-static String bitrix24Request(const char* method, const char* params = "") {
+// Start an HTTP request to the Bitrix24 REST API
+// GET with query string by default; POST form body when postBody is given (used by batch).
+// Returns the pooled client on HTTP 200; the JSON body is then tokenized straight from an
+// HttpBodyStream (gzip inflated on the fly, see http_body.h), so the response is never
+// buffered. Caller hands the client back with bitrix24End().
+HTTPClient* bitrix24Begin(const char* method, const char* params, const char* postBody) {
   if (WiFi.status() != WL_CONNECTED) {
     Serial.print("Bitrix24: WiFi not connected, skipping ");
     Serial.println(method);
-    return "";
+    return nullptr;
   }
 
   // Ensure credentials are loaded
   initBitrix24Credentials();
 
-  HTTPClient http;
-  String url = String(bitrixHostname) + String(bitrixRestEndpoint) + String(method);
-  if (params && strlen(params) > 0) {
-    url += "?";
-    url += params;
+  char urlBuffer[BITRIX24_URL_MAX];
+  QueryBuilder url(urlBuffer, sizeof(urlBuffer));
+  url.raw(bitrixHostname).raw(bitrixRestEndpoint).raw(method);
+  if (params && params[0] != '\0') {
+    url.raw('?').raw(params);
+  }
+  if (url.overflowed()) {
+    Serial.print("Bitrix24: URL too long, skipping ");
+    Serial.println(method);
+    return nullptr;
   }
 
   // Debug: Log URL structure for troubleshooting (mask endpoint secret)
@@ -106,42 +206,373 @@ static String bitrix24Request(const char* method, const char* params = "") {
   Serial.print(bitrixHostname);
   if (endpointLen > 15) {
     // Show first 8 chars and last 3 chars of endpoint
-    Serial.print(String(bitrixRestEndpoint).substring(0, 8) + "...[masked]");
+    Serial.write((const uint8_t*)bitrixRestEndpoint, 8);
+    Serial.print("...[masked]");
   } else {
     Serial.print("[endpoint]");
   }
   Serial.print(method);
   Serial.println();
 
-  http.begin(url);
-  http.setTimeout(5000);
+  // Wait for our turn and for the portal's rate limit (see bitrix24_queue.h)
+  if (!b24QueueAcquire(BITRIX24_QUEUE_TIMEOUT)) {
+    Serial.print("Bitrix24: Rate limit queue timeout, skipping ");
+    Serial.println(method);
+    return nullptr;
+  }
 
-  int httpCode = http.GET();
-  String payload;
+  HTTPClient* http = nullptr;
+  int httpCode = -1;
+  unsigned long calledAt = millis();
+  uint8_t attempt = 0;
+  for (; attempt < 2; attempt++) {
+    http = httpPoolBegin(url.c_str());
+    if (http == nullptr) break;
+    http->setTimeout(5000);
+    httpAcceptGzip(*http);
+
+    if (postBody != nullptr) {
+      http->addHeader("Content-Type", "application/x-www-form-urlencoded");
+      httpCode = http->POST((uint8_t*)postBody, strlen(postBody));
+    } else {
+      httpCode = http->GET();
+    }
+    // A kept-alive connection the portal closed while idle fails before any response:
+    // one more try on a fresh connection
+    if (httpCode > 0 || attempt > 0 || !httpPoolReused(http)) break;
+    httpPoolEnd(http, false);
+    http = nullptr;
+  }
+  b24QueueRelease();
+  if (http == nullptr) {
+    // No connection at all: still counts against the method
+    NetPerfSample perf;
+    netPerfBegin(&perf, method);
+    perf.ms[NET_PHASE_TOTAL] = millis() - calledAt;
+    perf.status = (int16_t)httpCode;
+    perf.retries = attempt;
+    netPerfRecord(perf);
+    return nullptr;
+  }
+  if (httpCode > 0) {
+    httpPoolResponded(http);
+  }
+  NetPerfSample* perf = httpPoolSample(http);
+  if (perf != nullptr) {
+    perf->name = method;
+    perf->status = (int16_t)httpCode;
+    perf->retries = attempt;
+    perf->bytesOut = url.length() + (postBody != nullptr ? strlen(postBody) : 0);
+  }
+
+  if (httpCode == 503) {
+    // QUERY_LIMIT_EXCEEDED: the portal's own bucket is empty
+    b24QueueOnLimitExceeded();
+  }
 
   if (httpCode == 200) {
-    payload = http.getString();
+    return http;
+  }
+  httpPoolEnd(http, false);
+
+  Serial.print("Bitrix24 API error: ");
+  Serial.print(method);
+  Serial.print(" returned HTTP ");
+  Serial.println(httpCode);
+  // Show URL structure for debugging (mask endpoint secret)
+  Serial.print("  URL format: ");
+  Serial.print(bitrixHostname);
+  if (endpointLen > 15) {
+    Serial.write((const uint8_t*)bitrixRestEndpoint, 8);
+    Serial.print("...[masked]");
   } else {
-    Serial.print("Bitrix24 API error: ");
-    Serial.print(method);
-    Serial.print(" returned HTTP ");
-    Serial.println(httpCode);
-    // Show URL structure for debugging (mask endpoint secret)
-    Serial.print("  URL format: ");
-    Serial.print(bitrixHostname);
-    if (endpointLen > 15) {
-      Serial.print(String(bitrixRestEndpoint).substring(0, 8) + "...[masked]");
-    } else {
-      Serial.print("[endpoint]");
+    Serial.print("[endpoint]");
+  }
+  Serial.print(method);
+  Serial.println();
+  Serial.print("  Expected format: https://domain.bitrix24.ru/rest/USER_ID/WEBHOOK_CODE/method");
+  Serial.println();
+  return nullptr;
+}
+
+void bitrix24End(HTTPClient* http, HttpBodyStream& response, bool parsed) {
+  bool reusable = parsed && response.drain(HTTP_POOL_DRAIN_MAX);
+  NetPerfSample* perf = httpPoolSample(http);
+  if (perf != nullptr) {
+    perf->bytesIn = response.wireBytes();
+  }
+  httpPoolEnd(http, reusable);
+}
+
+// --- Streaming response readers ---
+// Bitrix24ResultReader implementations (bitrix24_batch.h), one per kind of REST result.
+
+static bool isScalarToken(JsonToken token) {
+  return token == JSON_STRING || token == JSON_NUMBER || token == JSON_BOOL;
+}
+
+// user.current: result.ID (can be string or int)
+struct UserIdReader : Bitrix24ResultReader {
+  uint32_t id = 0;
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (isScalarToken(token) && json.matchesFrom(base, "ID")) {
+      id = (uint32_t)json.asInt();
+    }
+  }
+};
+
+// server.time: result is either a plain string like "2026-01-19T15:58:59+03:00"
+// or an object with time/TIME field
+struct ServerTimeReader : Bitrix24ResultReader {
+  char time[40] = "";
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (token != JSON_STRING) return;
+    if (json.matchesFrom(base, "") || json.matchesFrom(base, "time") || json.matchesFrom(base, "TIME")) {
+      strncpy(time, json.text(), sizeof(time) - 1);
+    }
+  }
+};
+
+// im.counters.get result object:
+// - dialogs: TYPE.DIALOG (number of dialogs with unread messages), fallback direct DIALOG field
+// - total:   TYPE.ALL (all unread messages), fallback TYPE.MESSENGER
+struct ImCountersReader : Bitrix24ResultReader {
+  bool isObject = false;
+  bool hasAll = false;
+  uint16_t typeDialog = 0;
+  uint16_t directDialog = 0;
+  uint16_t typeAll = 0;
+  uint16_t typeMessenger = 0;
+
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (token == JSON_OBJECT_START && json.matchesFrom(base, "")) {
+      isObject = true;
+    }
+    if (token != JSON_NUMBER) return;
+    if (json.matchesFrom(base, "TYPE.DIALOG")) {
+      typeDialog = (uint16_t)json.asInt();
+    } else if (json.matchesFrom(base, "TYPE.ALL")) {
+      typeAll = (uint16_t)json.asInt();
+      hasAll = true;
+    } else if (json.matchesFrom(base, "TYPE.MESSENGER")) {
+      typeMessenger = (uint16_t)json.asInt();
+    } else if (json.matchesFrom(base, "DIALOG")) {
+      directDialog = (uint16_t)json.asInt();
+    }
+  }
+
+  uint16_t dialogs() const { return typeDialog != 0 ? typeDialog : directDialog; }
+  uint16_t total() const { return hasAll ? typeAll : typeMessenger; }
+};
+
+// tasks.task.counters.get: aggregate counters of one scope (global or one group), e.g.
+// {"expired":{"counter":2,"code":"..."},"new_comments":{"counter":5,...},...}.
+// Some portals prefix the role ("my_expired") for type=view_role_responsible.
+struct TaskCountersReader : Bitrix24ResultReader {
+  bool hasExpired = false;
+  uint16_t expired = 0;
+
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (token != JSON_NUMBER) return;
+    if (json.matchesFrom(base, "expired.counter") || json.matchesFrom(base, "my_expired.counter")) {
+      expired = (uint16_t)json.asInt();
+      hasExpired = true;
+    }
+  }
+};
+
+// bizproc.task.list: count RPA tasks assigned to current user (USER_ID) with STATUS = 0
+// (undone/active). Result is the task array itself, {"tasks":[...]} or {"total":N}.
+// Tasks are counted as they stream past, so the list (20KB+ in practice) is never stored.
+struct UndoneTasksReader : Bitrix24ResultReader {
+  uint32_t userId;
+  bool hasList = false;
+  bool hasTotal = false;
+  uint16_t count = 0;
+  uint16_t total = 0;
+  // Fields of the task currently being read
+  bool taskIsUser = false;
+  int taskStatus = -1;
+
+  explicit UndoneTasksReader(uint32_t user) : userId(user) {}
+
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (token == JSON_ARRAY_START && (json.matchesFrom(base, "") || json.matchesFrom(base, "tasks"))) {
+      hasList = true;
+      return;
+    }
+    if (json.matchesFrom(base, "#") || json.matchesFrom(base, "tasks.#")) {
+      if (token == JSON_OBJECT_START) {
+        taskIsUser = false;
+        taskStatus = -1;
+      } else if (token == JSON_OBJECT_END && taskIsUser && taskStatus == 0) {
+        count++;
+      }
+      return;
+    }
+    if (!isScalarToken(token)) return;
+    // Bitrix may return USER_ID / STATUS as int OR as string; asInt() handles both
+    if (json.matchesFrom(base, "#.USER_ID") || json.matchesFrom(base, "tasks.#.USER_ID")) {
+      taskIsUser = ((uint32_t)json.asInt() == userId);
+    } else if (json.matchesFrom(base, "#.STATUS") || json.matchesFrom(base, "tasks.#.STATUS")) {
+      taskStatus = (int)json.asInt();
+    } else if (token == JSON_NUMBER && json.matchesFrom(base, "total")) {
+      total = (uint16_t)json.asInt();
+      hasTotal = true;
+    }
+  }
+
+  bool finish(uint16_t* out) const {
+    if (hasList) {
+      *out = count;
+      return true;
+    }
+    if (hasTotal) {
+      *out = total;
+      return true;
+    }
+    return false;
+  }
+};
+
+// sonet_group.get: result can be the group object or an array of groups (first match wins)
+struct GroupNameReader : Bitrix24ResultReader {
+  char name[JsonStreamReader::VALUE_LEN] = "";
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    if (token != JSON_STRING || name[0] != '\0') return;
+    if (json.matchesFrom(base, "NAME") || json.matchesFrom(base, "name") ||
+        json.matchesFrom(base, "#.NAME") || json.matchesFrom(base, "#.name")) {
+      strncpy(name, json.text(), sizeof(name) - 1);
     }
+  }
+};
+
+// Run a single REST call and stream everything under "result" into `reader`
+static bool bitrix24Fetch(const char* method, const char* params, Bitrix24ResultReader& reader) {
+  HTTPClient* http = bitrix24Begin(method, params);
+  if (http == nullptr) {
+    return false;
+  }
+
+  HttpBodyStream response(*http);
+  JsonStreamReader json(response);
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (json.level() >= 1 && strcmp(json.keyAt(0), "result") == 0) {
+      reader.feed(json, token, 1);
+    }
+  }
+  bitrix24End(http, response, token == JSON_END);
+
+  if (token == JSON_ERROR) {
+    Serial.print("Bitrix24: ");
     Serial.print(method);
-    Serial.println();
-    Serial.print("  Expected format: https://domain.bitrix24.ru/rest/USER_ID/WEBHOOK_CODE/method");
-    Serial.println();
+    Serial.println(" - JSON parse error");
+    return false;
   }
+  return true;
+}
 
-  http.end();
-  return payload;
+// Count-only list call: read the top-level `total`, then skip the rest of the body (with
+// nPageSize=1 it is just one task stub) so the connection can be kept.
+// Identical queries from other tasks share one request (e.g. Telegram group stats while
+// the Bitrix24 task refreshes the same group).
+static bool bitrix24FetchTotal(const char* method, const char* params, uint16_t* total) {
+  uint32_t key = b24RequestKey(method, params);
+  bool found = false;
+  if (b24DedupBegin(key, total, &found)) {
+    return found;
+  }
+
+  HTTPClient* http = bitrix24Begin(method, params);
+  if (http != nullptr) {
+    HttpBodyStream response(*http);
+    JsonStreamReader json(response);
+    JsonToken token;
+    while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+      if (token == JSON_NUMBER && json.matches("total")) {
+        *total = (uint16_t)json.asInt();
+        found = true;
+        break;
+      }
+    }
+    bitrix24End(http, response, token != JSON_ERROR);
+  }
+  b24DedupFinish(key, found ? *total : 0, found);
+  return found;
+}
+
+// Snapshot of the current counts (zeroed first so padding never differs between copies)
+static void buildSnapshot(Bitrix24Snapshot* snap, const Bitrix24Counts& counts) {
+  memset(snap, 0, sizeof(*snap));
+  snap->version = SNAPSHOT_VERSION;
+  snap->portalHash = b24RequestKey(bitrixHostname, bitrixRestEndpoint);
+  snap->userId = bitrixCurrentUserId;
+  snap->groupId = knownGroupId;
+  snap->unreadMessages = counts.unreadMessages;
+  snap->totalUnreadMessages = counts.totalUnreadMessages;
+  snap->undoneTasks = counts.undoneTasks;
+  snap->expiredTasks = counts.expiredTasks;
+  snap->totalComments = counts.totalComments;
+  snap->groupDelayedTasks = counts.groupDelayedTasks;
+  snap->groupComments = counts.groupComments;
+  for (uint8_t i = 0; i < watchStatsCount; i++) {
+    if (!watchStats[i].valid) continue;
+    snap->watch[snap->watchCount].groupId = watchStats[i].groupId;
+    snap->watch[snap->watchCount].delayed = watchStats[i].delayed;
+    snap->watch[snap->watchCount].allTasks = watchStats[i].allTasks;
+    snap->watchCount++;
+  }
+}
+
+// Save the last good counts: at most every BITRIX24_SNAPSHOT_INTERVAL, and only when
+// something other than the timestamp changed (flash wear)
+static void saveSnapshotIfDue(const Bitrix24Counts& counts, unsigned long now) {
+  if (snapshotSavedThisBoot && now - lastSnapshotSaveAt < BITRIX24_SNAPSHOT_INTERVAL) {
+    return;
+  }
+  Bitrix24Snapshot snap;
+  buildSnapshot(&snap, counts);
+  snap.savedAt = lastSavedSnapshot.savedAt;
+  if (memcmp(&snap, &lastSavedSnapshot, sizeof(snap)) == 0) {
+    return;
+  }
+  snap.savedAt = nowEpochSeconds();
+  saveBitrix24Snapshot(&snap, sizeof(snap));
+  lastSavedSnapshot = snap;
+  lastSnapshotSaveAt = now;
+  snapshotSavedThisBoot = true;
+}
+
+// Publish the NVS snapshot as stale counts so the B24 screen has numbers right after boot
+static void restoreBitrix24Snapshot() {
+  Bitrix24Snapshot snap;
+  if (loadBitrix24Snapshot(&snap, sizeof(snap)) != sizeof(snap) || snap.version != SNAPSHOT_VERSION ||
+      snap.portalHash != b24RequestKey(bitrixHostname, bitrixRestEndpoint)) {
+    return;
+  }
+  lastSavedSnapshot = snap;
+
+  bitrixCurrentUserId = snap.userId;
+  cachedCounts = {snap.unreadMessages, snap.totalUnreadMessages, snap.undoneTasks, snap.expiredTasks,
+                  snap.totalComments, snap.groupDelayedTasks, snap.groupComments, true, 0, true};
+  knownCounters = B24_MASK_ALL;
+  knownGroupId = snap.groupId;
+
+  watchStatsCount = 0;
+  for (uint8_t i = 0; i < snap.watchCount && i < BITRIX24_MAX_WATCHED_GROUPS; i++) {
+    watchStats[watchStatsCount++] = {snap.watch[i].groupId, snap.watch[i].delayed, snap.watch[i].allTasks, true};
+  }
+  publishCounts(cachedCounts);
+
+  Serial.print("Bitrix24: Restored counts from NVS snapshot");
+  uint32_t nowEpoch = nowEpochSeconds();
+  if (snap.savedAt != 0 && nowEpoch > snap.savedAt) {
+    Serial.print(" (");
+    Serial.print((nowEpoch - snap.savedAt) / 60);
+    Serial.print(" min old)");
+  }
+  Serial.println();
 }
 
 // Initialize Bitrix24 client
@@ -155,6 +586,28 @@ void initBitrix24() {
   cachedCounts.lastUpdate = 0;
   bitrixCurrentUserId = 0;
   selectedGroupId = 0;
+  b24GroupCacheLoad();
+  watchedGroupCount = loadBitrix24WatchedGroups(watchedGroupIds, BITRIX24_MAX_WATCHED_GROUPS);
+  if (watchedGroupCount > 0) {
+    Serial.print("Bitrix24: Watching ");
+    Serial.print(watchedGroupCount);
+    Serial.println(" groups");
+  }
+  restoreBitrix24Snapshot();
+  bitrix24FleetSetKey(b24RequestKey(bitrixHostname, bitrixRestEndpoint));
+}
+
+// Wake the Bitrix24 task and ask it to refresh `mask` counters immediately
+void bitrix24MarkCountersDue(uint8_t mask) {
+  pendingRefreshMask.fetch_or(mask);
+  if (bitrix24TaskHandle != nullptr) {
+    xTaskNotifyGive(bitrix24TaskHandle);
+  }
+}
+
+static void requestBitrix24Refresh() {
+  pendingInteractive.store(true);
+  bitrix24MarkCountersDue(B24_MASK_ALL);
 }
 
 // Reload Bitrix24 credentials from NVS
@@ -165,224 +618,240 @@ void reloadBitrix24Credentials() {
   
   // Reload from NVS
   initBitrix24Credentials();
+
+  // Group IDs and counter history belong to the old portal
+  b24GroupCacheClear();
+  b24HistoryClear();
+  taskCountersReset();
+  // Devices on the new webhook form their own fleet
+  bitrix24FleetSetKey(b24RequestKey(bitrixHostname, bitrixRestEndpoint));
   
-  // Invalidate cache to force refresh
-  cachedCounts.valid = false;
+  // Force refresh with new credentials
+  requestBitrix24Refresh();
 }
 
 void setBitrixSelectedGroupId(uint32_t groupId) {
   selectedGroupId = groupId;
-  // Force refresh on next loop
-  cachedCounts.valid = false;
+  // Name is fetched by the task before the counts, so the first redraw can show it
+  b24GroupCacheWant(groupId);
+  // Force refresh with the new group
+  requestBitrix24Refresh();
 }
 
 uint32_t getBitrixSelectedGroupId() {
   return selectedGroupId;
 }
 
-// Force immediate Bitrix24 update (invalidates cache)
-void forceBitrix24Update() {
-  cachedCounts.valid = false;
-  cachedCounts.lastUpdate = 0;  // Reset timestamp to allow immediate update
-}
-
-// Fetch current Bitrix24 user ID using user.current
-// This avoids hardcoding USER_ID (e.g. 17) and always uses the webhook's user
-static bool fetchCurrentUserId() {
-  if (bitrixCurrentUserId != 0) {
-    // Already known
-    return true;
-  }
-
-  String response = bitrix24Request("user.current", "");
-  if (response.length() == 0) {
-    Serial.println("Bitrix24: fetchCurrentUserId - empty response");
-    return false;
+void setBitrixWatchedGroups(const uint32_t* groupIds, uint8_t count) {
+  uint32_t ids[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < count && n < BITRIX24_MAX_WATCHED_GROUPS; i++) {
+    bool duplicate = false;
+    for (uint8_t j = 0; j < n; j++) {
+      if (ids[j] == groupIds[i]) duplicate = true;
+    }
+    if (groupIds[i] != 0 && !duplicate) {
+      ids[n++] = groupIds[i];
+      b24GroupCacheWant(groupIds[i]);
+    }
   }
 
-  DynamicJsonDocument doc(4096);
-  DeserializationError err = deserializeJson(doc, response);
-  response = "";
-
-  if (err) {
-    Serial.print("Bitrix24: fetchCurrentUserId - JSON parse error: ");
-    Serial.println(err.c_str());
-    return false;
-  }
+  portENTER_CRITICAL(&watchMux);
+  memcpy(watchedGroupIds, ids, sizeof(ids[0]) * n);
+  watchedGroupCount = n;
+  portEXIT_CRITICAL(&watchMux);
 
-  if (!doc["result"].is<JsonObject>()) {
-    Serial.println("Bitrix24: fetchCurrentUserId - result is not an object");
-    return false;
-  }
+  saveBitrix24WatchedGroups(ids, n);
+  bitrix24MarkCountersDue(B24_MASK(B24_COUNTER_GROUP));
+}
 
-  JsonObject result = doc["result"].as<JsonObject>();
+uint8_t getBitrixWatchedGroups(uint32_t* groupIds, uint8_t maxCount) {
+  portENTER_CRITICAL(&watchMux);
+  uint8_t n = (watchedGroupCount < maxCount) ? watchedGroupCount : maxCount;
+  memcpy(groupIds, watchedGroupIds, sizeof(groupIds[0]) * n);
+  portEXIT_CRITICAL(&watchMux);
+  return n;
+}
 
-  // ID can be string or int; handle both
-  uint32_t id = 0;
-  if (result["ID"].is<const char*>()) {
-    String idStr = result["ID"].as<const char*>();
-    id = idStr.toInt();
-  } else if (result["ID"].is<int>()) {
-    id = result["ID"].as<int>();
+// Align the task-owned stats with the current watch list (values kept for groups
+// still listed). Returns the number of watched groups.
+static uint8_t syncWatchStats() {
+  uint32_t ids[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t n = getBitrixWatchedGroups(ids, BITRIX24_MAX_WATCHED_GROUPS);
+
+  Bitrix24GroupStats next[BITRIX24_MAX_WATCHED_GROUPS];
+  for (uint8_t i = 0; i < n; i++) {
+    next[i] = {ids[i], 0, 0, false};
+    for (uint8_t j = 0; j < watchStatsCount; j++) {
+      if (watchStats[j].groupId == ids[i]) next[i] = watchStats[j];
+    }
   }
+  memcpy(watchStats, next, sizeof(next[0]) * n);
+  watchStatsCount = n;
+  return n;
+}
 
-  if (id == 0) {
-    return false;
+static int8_t findWatchStats(uint32_t groupId) {
+  for (uint8_t i = 0; i < watchStatsCount; i++) {
+    if (watchStats[i].groupId == groupId) return i;
   }
-
-  bitrixCurrentUserId = id;
-
-  return true;
+  return -1;
 }
 
-// Fetch current Bitrix24 date (YYYY-MM-DD) using server.time
-static bool fetchBitrixTodayDate(String *outDate) {
-  if (!outDate) return false;
+// Force immediate Bitrix24 update (wakes the Bitrix24 task)
+void forceBitrix24Update() {
+  requestBitrix24Refresh();
+  // Fleet follower: the leader polls, this device only re-reads its frame
+  bitrix24FleetRequestRefresh();
+}
 
-  // Refresh once per minute at most
-  unsigned long now = millis();
-  if (bitrixTodayDate.length() == 10 && (now - bitrixTodayLastFetch) < 60000UL) {
-    *outDate = bitrixTodayDate;
+// Fetch current Bitrix24 user ID using user.current
+// This avoids hardcoding USER_ID (e.g. 17) and always uses the webhook's user
+static bool fetchCurrentUserId() {
+  if (bitrixCurrentUserId != 0) {
+    // Already known
     return true;
   }
 
-  String response = bitrix24Request("server.time", "");
-  if (response.length() == 0) {
+  UserIdReader user;
+  if (!bitrix24Fetch("user.current", "", user)) {
+    Serial.println("Bitrix24: fetchCurrentUserId - request failed");
     return false;
   }
 
-  // Try to parse JSON response
-  DynamicJsonDocument doc(2048);
-  DeserializationError err = deserializeJson(doc, response);
-  response = "";
-
-  if (err) {
-    Serial.print("Bitrix24: server.time parse error: ");
-    Serial.println(err.c_str());
+  if (user.id == 0) {
+    Serial.println("Bitrix24: fetchCurrentUserId - no ID in result");
     return false;
   }
 
-  // Check different possible response structures
-  String dateStr;
+  bitrixCurrentUserId = user.id;
 
-  // Case 1: result is already a string datetime, e.g. "2026-01-19T15:58:59+03:00"
-  if (doc["result"].is<const char*>()) {
-    dateStr = doc["result"].as<const char*>();
-  }
+  return true;
+}
 
-  // Case 2: result is an object with time/TIME field
-  if (dateStr.length() == 0 && doc["result"].is<JsonObject>()) {
-    JsonObject result = doc["result"].as<JsonObject>();
-    if (result["time"].is<const char*>()) {
-      dateStr = result["time"].as<const char*>();
-    } else if (result["TIME"].is<const char*>()) {
-      dateStr = result["TIME"].as<const char*>();
+// The on-device clock keeps portal-local time (see time_service.h). server.time is only
+// called to learn the portal timezone (and as clock fallback until SNTP syncs), i.e. once
+// every few hours instead of every minute.
+static void syncBitrixClock() {
+  unsigned long now = millis();
+  if (timeNeedsServerTime(now)) {
+    ServerTimeReader time;
+    if (bitrix24Fetch("server.time", "", time)) {
+      timeApplyServerTime(time.time, now);
     }
   }
-  
-  // Case 3: direct time field at root
-  if (dateStr.length() == 0 && doc["time"].is<const char*>()) {
-    dateStr = doc["time"].as<const char*>();
-  }
-
-  if (dateStr.length() == 0) {
-    Serial.println("Bitrix24: server.time has no time field in result");
-    return false;
-  }
-
-  // Extract YYYY-MM-DD from the date string (might be "YYYY-MM-DD HH:MM:SS" or timestamp)
-  // Look for YYYY-MM-DD pattern
-  int dateStart = dateStr.indexOf("202");
-  if (dateStart < 0) dateStart = dateStr.indexOf("2025");
-  if (dateStart < 0) dateStart = dateStr.indexOf("2026");
-  
-  if (dateStart < 0 || dateStart + 10 > (int)dateStr.length()) {
-    Serial.print("Bitrix24: server.time date format not recognized: ");
-    Serial.println(dateStr);
-    return false;
-  }
+}
 
-  String dateOnly = dateStr.substring(dateStart, dateStart + 10); // YYYY-MM-DD
-  bitrixTodayDate = dateOnly;
-  bitrixTodayLastFetch = now;
+// Current portal-local date (YYYY-MM-DD)
+static bool fetchBitrixTodayDate(char* outDate) {
+  if (!outDate) return false;
+  syncBitrixClock();
+  return timeTodayString(outDate);
+}
 
-  *outDate = dateOnly;
-  return true;
+// Current portal-local time (YYYY-MM-DDTHH:MM:SS+HH:MM, 26 chars)
+static bool fetchBitrixNow(char* outNow) {
+  if (!outNow) return false;
+  syncBitrixClock();
+  return timeLocalDateTime(0, outNow);
 }
 
-static uint16_t parseTotalFromJson(const String& response) {
-  uint16_t c = 0;
-  int totalPos = response.indexOf("\"total\":");
-  if (totalPos < 0) totalPos = response.indexOf("\"TOTAL\":");
-  if (totalPos >= 0) {
-    int numStart = response.indexOf(':', totalPos);
-    if (numStart >= 0) {
-      numStart++;
-      while (numStart < (int)response.length() && response[numStart] == ' ') numStart++;
-      int numEnd = numStart;
-      while (numEnd < (int)response.length() && response[numEnd] >= '0' && response[numEnd] <= '9') numEnd++;
-      if (numEnd > numStart) c = (uint16_t)response.substring(numStart, numEnd).toInt();
-    }
+// Query string for count-only tasks.task.list: delayed tasks of current user
+// (deadline passed by `now`, RESPONSIBLE_ID = current user, not completed), optionally in one
+// group; the same cutoff tasks.task.counters.get counts expired tasks by.
+// Page size 1 keeps the response tiny; the count is read from `total`.
+static void delayedTasksParams(QueryBuilder& q, uint32_t groupId, const char* now) {
+  if (groupId != 0) {
+    q.param("filter[GROUP_ID]", groupId);
   }
-  return c;
+  q.param("filter[RESPONSIBLE_ID]", bitrixCurrentUserId)
+   .param("filter[!DEADLINE]", "")        // Has deadline (not empty)
+   .param("filter[<DEADLINE]", now)       // Deadline already passed
+   .param("filter[!STATUS]", "5")         // Exclude completed tasks
+   .param("nav_params[nPageSize]", "1")
+   .param("nav_params[iNumPage]", "1")
+   .param("select[]", "ID");
 }
 
-// Fetch global "All your tasks" count (no specific group):
-// - For current user as RESPONSIBLE ("Делаю")
-// - "All your tasks" = active tasks (statuses 1,2,3,4,6) + delayed tasks
-static bool fetchGlobalAllTasks(uint16_t* allTasks) {
-  if (!allTasks) return false;
-  *allTasks = 0;
-
-  // Ensure current user ID
-  if (!fetchCurrentUserId()) {
-    return false;
+// Query string for count-only tasks.task.list: active tasks of current user
+// statuses: 1 (new), 2 (waiting), 3 (in progress), 4 (waiting for control), 6 (postponed)
+static void activeTasksParams(QueryBuilder& q, uint32_t groupId) {
+  if (groupId != 0) {
+    q.param("filter[GROUP_ID]", groupId);
   }
+  q.param("filter[RESPONSIBLE_ID]", bitrixCurrentUserId)
+   .param("filter[STATUS][]", "1")
+   .param("filter[STATUS][]", "2")
+   .param("filter[STATUS][]", "3")
+   .param("filter[STATUS][]", "4")
+   .param("filter[STATUS][]", "6")
+   .param("nav_params[nPageSize]", "1")
+   .param("nav_params[iNumPage]", "1")
+   .param("select[]", "ID");
+}
 
-  // Get today's date for delayed filter
-  String today;
-  if (!fetchBitrixTodayDate(&today)) {
-    return false;
+// Aggregate counters of the current user's tasks (as responsible), globally or in one group
+static void taskCountersParams(QueryBuilder& q, uint32_t groupId) {
+  q.param("userId", bitrixCurrentUserId)
+   .param("type", "view_role_responsible");
+  if (groupId != 0) {
+    q.param("groupId", groupId);
   }
+}
 
-  // Delayed tasks: past deadline, responsible = current user, not completed
-  uint16_t delayed = 0;
-  {
-    String delayedParams = "filter[!DEADLINE]="
-                         + String("&filter[<DEADLINE]=") + today
-                         + "&filter[RESPONSIBLE_ID]=" + String(bitrixCurrentUserId)
-                         + "&filter[!STATUS]=5"
-                         + "&nav_params[nPageSize]=1"
-                         + "&nav_params[iNumPage]=1"
-                         + "&select[]=ID";
+// tasks.task.counters.get availability on this portal. It is given up when it fails while
+// other requests work (method missing, no scope) or twice in a row; the list queries count
+// instead until BITRIX24_TASK_COUNTERS_RETRY has passed or the credentials change.
+// Only the Bitrix24 task changes this state; other tasks read taskCountersDown and ask for a
+// reset through taskCountersResetWanted.
+bool bitrix24UseTaskCounters = BITRIX24_TASK_COUNTERS_ENABLED;
+static std::atomic<bool> taskCountersDown(false);
+static std::atomic<bool> taskCountersResetWanted(false);
+static unsigned long taskCountersDownAt = 0;
+static uint8_t taskCountersFailures = 0;
+
+// Bitrix24 task only
+static bool taskCountersUsable() {
+  if (!bitrix24UseTaskCounters) return false;
+  if (taskCountersResetWanted.exchange(false) ||
+      (taskCountersDown && millis() - taskCountersDownAt >= BITRIX24_TASK_COUNTERS_RETRY)) {
+    taskCountersDown = false;
+    taskCountersFailures = 0;
+  }
+  return !taskCountersDown;
+}
 
-    String resp = bitrix24Request("tasks.task.list", delayedParams.c_str());
-    if (resp.length() > 0) {
-      delayed = parseTotalFromJson(resp);
-    }
+// `definite`: the endpoint itself is at fault (others worked, or its answer had no counter)
+static void taskCountersFailed(bool definite) {
+  if (taskCountersFailures < 255) taskCountersFailures++;
+  if (definite || taskCountersFailures >= 2) {
+    taskCountersDown = true;
+    taskCountersDownAt = millis();
+    Serial.println("Bitrix24: tasks.task.counters.get unavailable, counting with tasks.task.list");
   }
+}
 
-  // Active (non-delayed) tasks for this user, any group:
-  // statuses: 1 (new), 2 (waiting), 3 (in progress), 4 (waiting for control), 6 (postponed)
-  uint16_t active = 0;
-  {
-    String activeParams = "filter[RESPONSIBLE_ID]=" + String(bitrixCurrentUserId)
-                        + "&filter[STATUS][]=1"
-                        + "&filter[STATUS][]=2"
-                        + "&filter[STATUS][]=3"
-                        + "&filter[STATUS][]=4"
-                        + "&filter[STATUS][]=6"
-                        + "&nav_params[nPageSize]=1"
-                        + "&nav_params[iNumPage]=1"
-                        + "&select[]=ID";
+static void taskCountersWorked() {
+  taskCountersFailures = 0;
+}
 
-    String resp = bitrix24Request("tasks.task.list", activeParams.c_str());
-    if (resp.length() > 0) {
-      active = parseTotalFromJson(resp);
-    }
-  }
+// Any task (credentials changed); applied by the Bitrix24 task before its next use
+static void taskCountersReset() {
+  taskCountersResetWanted.store(true);
+}
 
-  *allTasks = (uint16_t)(active + delayed);
+// Expired tasks of one scope with the aggregate endpoint; false when it can't be used.
+// Called from the Telegram task: a failure falls back to the list without being recorded,
+// the Bitrix24 task's own refreshes decide whether the endpoint is given up.
+static bool fetchExpiredFromCounters(uint32_t groupId, uint16_t* expired) {
+  if (!bitrix24UseTaskCounters || taskCountersDown.load()) return false;
+  char buffer[BITRIX24_PARAMS_MAX];
+  QueryBuilder params(buffer, sizeof(buffer));
+  taskCountersParams(params, groupId);
+  TaskCountersReader reader;
+  bool ok = params.ok() && bitrix24Fetch("tasks.task.counters.get", params.c_str(), reader);
+  if (!ok || !reader.hasExpired) return false;
+  *expired = reader.expired;
   return true;
 }
 
@@ -397,49 +866,34 @@ static bool fetchGroupDelayedAndComments(uint32_t groupId, uint16_t* delayed, ui
     return false;
   }
 
-  String today;
-  if (!fetchBitrixTodayDate(&today)) {
+  char now[26];
+  if (!fetchBitrixNow(now)) {
     return false;
   }
 
   // Delayed tasks in group: past deadline, RESPONSIBLE_ID = current user, not completed
-  String delayedParams = "filter[GROUP_ID]=" + String(groupId)
-                       + "&filter[!DEADLINE]="
-                       + "&filter[<DEADLINE]=" + today
-                       + "&filter[RESPONSIBLE_ID]=" + String(bitrixCurrentUserId)
-                       + "&filter[!STATUS]=5"
-                       + "&nav_params[nPageSize]=1"
-                       + "&nav_params[iNumPage]=1"
-                       + "&select[]=ID";
-
-  String resp1 = bitrix24Request("tasks.task.list", delayedParams.c_str());
-  if (resp1.length() > 0) {
-    *delayed = parseTotalFromJson(resp1);
+  char delayedBuffer[BITRIX24_PARAMS_MAX];
+  QueryBuilder delayedParams(delayedBuffer, sizeof(delayedBuffer));
+  delayedTasksParams(delayedParams, groupId, now);
+
+  if (fetchExpiredFromCounters(groupId, delayed)) {
+    Serial.println("Bitrix24 GroupStats Delayed: tasks.task.counters.get");
+  } else if (delayedParams.ok() && bitrix24FetchTotal("tasks.task.list", delayedParams.c_str(), delayed)) {
     // Compact debug: just show filters and total
     Serial.println("Bitrix24 GroupStats Delayed: tasks.task.list params:");
-    Serial.println(delayedParams);
+    Serial.println(delayedParams.c_str());
   }
 
   // "All tasks" in group: tasks where current user is RESPONSIBLE ("Делаю")
   // and status is one of: new (1), waiting (2), in progress (3), waiting for control (4), postponed (6).
   // This includes delayed tasks (past deadline) as long as they have these statuses.
   // We explicitly don't filter by deadline to include all active tasks.
-  String commentsParams = "filter[GROUP_ID]=" + String(groupId)
-                        + "&filter[RESPONSIBLE_ID]=" + String(bitrixCurrentUserId)
-                        + "&filter[STATUS][]=1"
-                        + "&filter[STATUS][]=2"
-                        + "&filter[STATUS][]=3"
-                        + "&filter[STATUS][]=4"
-                        + "&filter[STATUS][]=6"
-                        + "&nav_params[nPageSize]=1"
-                        + "&nav_params[iNumPage]=1"
-                        + "&select[]=ID";
-
-  String resp2 = bitrix24Request("tasks.task.list", commentsParams.c_str());
-  if (resp2.length() > 0) {
-    // Base count: all active tasks for this group & responsible user
-    *comments = parseTotalFromJson(resp2);
+  char commentsBuffer[BITRIX24_PARAMS_MAX];
+  QueryBuilder commentsParams(commentsBuffer, sizeof(commentsBuffer));
+  activeTasksParams(commentsParams, groupId);
 
+  // Base count: all active tasks for this group & responsible user
+  if (commentsParams.ok() && bitrix24FetchTotal("tasks.task.list", commentsParams.c_str(), comments)) {
     // The user expects "All your tasks" to be:
     //   non-delayed active tasks + delayed tasks
     // even if Bitrix doesn't include the delayed ones in the same filter.
@@ -448,39 +902,8 @@ static bool fetchGroupDelayedAndComments(uint32_t groupId, uint16_t* delayed, ui
       *comments = (uint16_t)(*comments + *delayed);
     }
 
-    // Debug: show filters + list of IDs only (more readable)
     Serial.println("Bitrix24 GroupStats AllTasks: tasks.task.list params:");
-    Serial.println(commentsParams);
-
-    DynamicJsonDocument doc2(16384);
-    DeserializationError err2 = deserializeJson(doc2, resp2);
-    resp2 = "";
-    if (!err2) {
-      JsonArray tasks;
-      if (doc2["result"].is<JsonArray>()) {
-        tasks = doc2["result"].as<JsonArray>();
-      } else if (doc2["result"].is<JsonObject>() && doc2["result"]["tasks"].is<JsonArray>()) {
-        tasks = doc2["result"]["tasks"].as<JsonArray>();
-      }
-      if (!tasks.isNull()) {
-        Serial.print("  AllTasks IDs (first 50): ");
-        uint8_t printed = 0;
-        for (JsonObject t : tasks) {
-          if (printed > 0) Serial.print(", ");
-          if (t["ID"].is<const char*>()) Serial.print(t["ID"].as<const char*>());
-          else if (t["id"].is<const char*>()) Serial.print(t["id"].as<const char*>());
-          else if (t["ID"].is<int>()) Serial.print(t["ID"].as<int>());
-          else if (t["id"].is<int>()) Serial.print(t["id"].as<int>());
-          else Serial.print("?");
-          printed++;
-          if (printed >= 50) break;
-        }
-        Serial.println();
-      }
-    } else {
-      Serial.print("Bitrix24 GroupStats AllTasks parse error: ");
-      Serial.println(err2.c_str());
-    }
+    Serial.println(commentsParams.c_str());
   }
 
   return true;
@@ -491,485 +914,840 @@ bool bitrixGetGroupStats(uint32_t groupId, uint16_t* delayed, uint16_t* comments
   return fetchGroupDelayedAndComments(groupId, delayed, comments);
 }
 
-// Best-effort helper: get group/workgroup name by ID using sonet_group.get
-String bitrixGetGroupName(uint32_t groupId) {
-  if (groupId == 0) return "";
+// Current UTC epoch for cache timestamps (0 while the clock is unknown)
+static uint32_t nowEpochSeconds() {
+  time_t now;
+  return timeNowUtc(&now) ? (uint32_t)now : 0;
+}
 
+// Fetch a group/workgroup name by ID using sonet_group.get and store it in the group cache
+static bool fetchGroupName(uint32_t groupId) {
   // Use FILTER[ID] according to sonet_group.get docs
-  String params = "FILTER[ID]=" + String(groupId);
-  String resp = bitrix24Request("sonet_group.get", params.c_str());
-  if (resp.length() == 0) return "";
+  char paramsBuffer[32];
+  QueryBuilder params(paramsBuffer, sizeof(paramsBuffer));
+  params.param("FILTER[ID]", groupId);
+  GroupNameReader group;
+  if (!bitrix24Fetch("sonet_group.get", params.c_str(), group) || group.name[0] == '\0') {
+    return false;
+  }
+  b24GroupCachePut(groupId, group.name, nowEpochSeconds());
+  return true;
+}
 
-  DynamicJsonDocument doc(4096);
-  DeserializationError err = deserializeJson(doc, resp);
-  resp = "";
-  if (err) return "";
+// Best-effort helper: group name from the cache ("" on a miss, which queues a fetch by the
+// Bitrix24 task, so only that task writes the cache)
+String bitrixGetGroupName(uint32_t groupId) {
+  if (groupId == 0) return "";
 
-  // result can be object or array[0]
-  if (doc["result"].is<JsonObject>()) {
-    JsonObject g = doc["result"].as<JsonObject>();
-    if (g["NAME"].is<const char*>()) return String(g["NAME"].as<const char*>());
-    if (g["name"].is<const char*>()) return String(g["name"].as<const char*>());
-  }
-  if (doc["result"].is<JsonArray>()) {
-    JsonArray arr = doc["result"].as<JsonArray>();
-    if (arr.size() > 0 && arr[0].is<JsonObject>()) {
-      JsonObject g = arr[0].as<JsonObject>();
-      if (g["NAME"].is<const char*>()) return String(g["NAME"].as<const char*>());
-      if (g["name"].is<const char*>()) return String(g["name"].as<const char*>());
-    }
-  }
-  return "";
+  char name[BITRIX24_GROUP_NAME_LEN];
+  if (!b24GroupCacheGet(groupId, name, sizeof(name), nowEpochSeconds())) return "";
+  return String(name);
+}
+
+// Render-safe: cache only; misses and stale names are fetched by the Bitrix24 task
+bool bitrixGetCachedGroupName(uint32_t groupId, char* out, size_t outLen) {
+  return b24GroupCacheGet(groupId, out, outLen, nowEpochSeconds());
 }
 
-// (Name-based helpers removed; we use IDs only)
+// Query string for bizproc.task.list (RPA user tasks of current user)
+static void undoneTasksParams(QueryBuilder& q) {
+  // NOTE: This corresponds to RPA user tasks you see under /rpa/ → /bizproc/userprocesses/
+  // We explicitly filter by USER_ID instead of hardcoding (e.g. 17).
+  //
+  // IMPORTANT: By default the API only returns a few fields (ENTITY, DOCUMENT_ID, ID, etc.).
+  // We must explicitly ask for USER_ID and status fields so we can find tasks that are:
+  //   - assigned to this user
+  //   - still not completed (undone)
+  //
+  // Bitrix list syntax: FILTER[FIELD]=..., SELECT[]=FIELD1, SELECT[]=FIELD2, ...
+  q.param("FILTER[USER_ID]", bitrixCurrentUserId)
+   .param("SELECT[]", "ID")
+   .param("SELECT[]", "USER_ID")
+   .param("SELECT[]", "STATUS")
+   .param("SELECT[]", "STATUS_ID")
+   .param("SELECT[]", "STATUS_NAME");
+}
 
-// Fetch unread dialogs count
-// Strategy: Use im.counters.get → TYPE.DIALOG (number of dialogs with unread messages)
-static bool fetchUnreadMessages(uint16_t* count) {
-  if (!count) return false;
+// --- Batch mode ---
+// A refresh cycle is packed into a single `batch` call: each sub-query is sent as
+// cmd[key]=method?params and the returned result map is fanned out to the readers above.
+// This replaces up to eight HTTPS round trips (each with its own TLS handshake) with one.
+bool bitrix24UseBatch = true;
+
+// Six counter sub-queries plus two per watched group (portal limit: 50 per batch)
+static const uint8_t BITRIX24_BATCH_MAX_CMDS = 6 + 2 * BITRIX24_MAX_WATCHED_GROUPS;
+static_assert(BITRIX24_MAX_WATCHED_GROUPS <= 16, "batch keys below cover 16 watched groups");
+
+// Batch command keys for watched groups (delayed / active per slot)
+static const char* const WATCH_DELAYED_KEYS[16] = {
+  "wd0", "wd1", "wd2", "wd3", "wd4", "wd5", "wd6", "wd7",
+  "wd8", "wd9", "wd10", "wd11", "wd12", "wd13", "wd14", "wd15"
+};
+static const char* const WATCH_ACTIVE_KEYS[16] = {
+  "wa0", "wa1", "wa2", "wa3", "wa4", "wa5", "wa6", "wa7",
+  "wa8", "wa9", "wa10", "wa11", "wa12", "wa13", "wa14", "wa15"
+};
+
+// Send a batch request and stream the response to the commands (see bitrix24_batch.h).
+// The form body is built in `arena`.
+static bool bitrix24Batch(Arena& arena, Bitrix24BatchCmd* cmds, uint8_t count) {
+  size_t capacity;
+  char* bodyBuffer = arena.allocRest(&capacity);
+  QueryBuilder body(bodyBuffer, capacity);
+  if (!b24BatchBuildBody(body, cmds, count)) {
+    arena.shrink(bodyBuffer, 0);
+    Serial.println("Bitrix24: batch - request arena full");
+    return false;
+  }
+  arena.shrink(bodyBuffer, body.length() + 1);
 
-  String response = bitrix24Request("im.counters.get", "");
-  if (response.length() == 0) {
-    Serial.println("Bitrix24: fetchUnreadMessages - empty response");
+  HTTPClient* http = bitrix24Begin("batch", "", body.c_str());
+  if (http == nullptr) {
     return false;
   }
 
-  DynamicJsonDocument doc(4096);
-  DeserializationError err = deserializeJson(doc, response);
-  response = "";
+  HttpBodyStream response(*http);
+  JsonStreamReader json(response);
+  bool hasResults;
+  JsonToken token = b24BatchRead(json, cmds, count, &hasResults);
+  bitrix24End(http, response, token == JSON_END);
 
-  if (err) {
-    Serial.print("Bitrix24: fetchUnreadMessages - JSON parse error: ");
-    Serial.println(err.c_str());
+  if (token == JSON_ERROR) {
+    Serial.println("Bitrix24: batch - JSON parse error");
     return false;
   }
-  
-  if (!doc["result"].is<JsonObject>()) {
-    Serial.println("Bitrix24: fetchUnreadMessages - result is not an object");
-    return false;
+  return hasResults;
+}
+
+// --- Counter registry ---
+// Each REST request a refresh can need is declared once as a source; each counter declares
+// which sources it reads and how its fields are extracted from them. A refresh cycle issues
+// every source needed by the due counters exactly once (one batch call, or one request each
+// with batch mode off) and hands the parsed responses to all counters that depend on them.
+
+// Parsed responses of one refresh cycle
+struct B24Cycle {
+  Arena& arena;                  // Sub-request queries and the batch body
+  char now[26];                  // Portal-local time for deadline filters
+  uint32_t groupId;              // Selected group (0 = none)
+  bool selectedWatched;          // Selected group is on the watch list (read from its stats)
+  bool aggregate;                // Delayed counts from tasks.task.counters.get (else list totals)
+  ImCountersReader counters;
+  UndoneTasksReader undone;
+  // Aggregate counters: global, selected group, then one per watched group
+  TaskCountersReader taskCounters[2 + BITRIX24_MAX_WATCHED_GROUPS];
+  Bitrix24BatchCmd cmds[BITRIX24_BATCH_MAX_CMDS];
+  uint8_t count;
+
+  bool arenaFull;                // A query didn't fit: the cycle must not be sent
+
+  explicit B24Cycle(Arena& scratch)
+    : arena(scratch), groupId(0), selectedWatched(false), aggregate(false), undone(0), count(0),
+      arenaFull(false) {
+    now[0] = '\0';
+    arena.reset();
   }
+  // Nothing in the arena outlives the cycle
+  ~B24Cycle() { arena.reset(); }
+};
+
+typedef void (*B24ParamsFn)(QueryBuilder& q, const B24Cycle& cycle, uint32_t groupId);
+
+// Sources that come in a list-query and an aggregate form; a cycle sends one of them
+enum B24SourceVariant : uint8_t {
+  B24_SRC_ALWAYS = 0,
+  B24_SRC_LIST,                                     // tasks.task.list count query
+  B24_SRC_AGGREGATE                                 // tasks.task.counters.get
+};
+
+static const char* const TASK_COUNTERS_METHOD = "tasks.task.counters.get";
+
+struct B24SourceDef {
+  const char* key;                                  // Batch command key (unique per cycle)
+  const char* method;
+  uint8_t counters;                                 // Counters that read this response (B24_MASK bits)
+  bool needsUser;                                   // Params use the current user / portal time
+  bool globalOnly;                                  // Only when no group is selected
+  B24SourceVariant variant;
+  B24ParamsFn params;                               // nullptr = no parameters
+  Bitrix24ResultReader* (*reader)(B24Cycle& cycle); // nullptr = count-only (result total)
+};
+
+struct B24CounterDef {
+  B24Counter counter;
+  // Fill the counter's fields from the cycle's responses; false if they are unusable
+  bool (*extract)(B24Cycle& cycle, Bitrix24Counts* out);
+};
+
+static Bitrix24BatchCmd* cycleCmd(B24Cycle& cycle, const char* key) {
+  return b24BatchFind(cycle.cmds, cycle.count, key);
+}
 
-  JsonObject result = doc["result"].as<JsonObject>();
+static uint16_t cycleTotal(B24Cycle& cycle, const char* key) {
+  return b24BatchTotal(cycle.cmds, cycle.count, key);
+}
 
-  uint16_t unreadDialogs = 0;
+static void delayedSourceParams(QueryBuilder& q, const B24Cycle& cycle, uint32_t groupId) {
+  delayedTasksParams(q, groupId, cycle.now);
+}
+static void activeSourceParams(QueryBuilder& q, const B24Cycle&, uint32_t groupId) {
+  activeTasksParams(q, groupId);
+}
+static void undoneSourceParams(QueryBuilder& q, const B24Cycle&, uint32_t) { undoneTasksParams(q); }
+static void countersSourceParams(QueryBuilder& q, const B24Cycle&, uint32_t groupId) {
+  taskCountersParams(q, groupId);
+}
 
-  // Preferred: TYPE.DIALOG
-  if (result["TYPE"].is<JsonObject>()) {
-    JsonObject type = result["TYPE"].as<JsonObject>();
-    if (type["DIALOG"].is<int>()) {
-      unreadDialogs = type["DIALOG"].as<int>();
-    }
+// Build a sub-request query in the cycle arena; "" when there is nothing to build
+static const char* cycleParams(B24Cycle& cycle, B24ParamsFn fill, uint32_t groupId) {
+  if (fill == nullptr) return "";
+  size_t capacity;
+  char* buffer = cycle.arena.allocRest(&capacity);
+  QueryBuilder q(buffer, capacity);
+  fill(q, cycle, groupId);
+  if (q.overflowed()) {
+    cycle.arena.shrink(buffer, 0);
+    cycle.arenaFull = true;
+    return "";
   }
-
-  // Fallback: direct DIALOG field
-  if (unreadDialogs == 0 && result["DIALOG"].is<int>()) {
-    unreadDialogs = result["DIALOG"].as<int>();
+  cycle.arena.shrink(buffer, q.length() + 1);
+  return buffer;
+}
+static Bitrix24ResultReader* countersReader(B24Cycle& cycle) { return &cycle.counters; }
+static Bitrix24ResultReader* undoneReader(B24Cycle& cycle) { return &cycle.undone; }
+static Bitrix24ResultReader* globalTaskCountersReader(B24Cycle& cycle) { return &cycle.taskCounters[0]; }
+
+static const B24SourceDef B24_SOURCES[] = {
+  // key        method                     counters                        user   global variant            params                reader
+  {"counters", "im.counters.get",         B24_MASK(B24_COUNTER_DIALOGS),  false, false, B24_SRC_ALWAYS,    nullptr,              countersReader},
+  {"undone",   "bizproc.task.list",       B24_MASK(B24_COUNTER_RPA),      true,  false, B24_SRC_ALWAYS,    undoneSourceParams,   undoneReader},
+  // Global expired count doubles as the "delayed" part of global "All your tasks"
+  {"expired",  "tasks.task.list",         B24_MASK(B24_COUNTER_EXPIRED),  true,  false, B24_SRC_LIST,      delayedSourceParams,  nullptr},
+  {"expired",  TASK_COUNTERS_METHOD,      B24_MASK(B24_COUNTER_EXPIRED),  true,  false, B24_SRC_AGGREGATE, countersSourceParams, globalTaskCountersReader},
+  // The aggregate endpoint has no task total, so "All your tasks" always needs this one
+  {"active",   "tasks.task.list",         B24_MASK(B24_COUNTER_EXPIRED),  true,  true,  B24_SRC_ALWAYS,    activeSourceParams,   nullptr},
+};
+
+// Delayed count of one scope: its aggregate counter, or the total of its list query
+static bool cycleDelayed(B24Cycle& cycle, const char* key, const TaskCountersReader& counters,
+                         uint16_t* delayed) {
+  if (!cycle.aggregate) {
+    *delayed = cycleTotal(cycle, key);
+    return true;
   }
+  if (!counters.hasExpired) return false;
+  *delayed = counters.expired;
+  return true;
+}
 
-  *count = unreadDialogs;
+// Unread dialogs and total unread come from the same im.counters.get response
+static bool extractDialogs(B24Cycle& cycle, Bitrix24Counts* out) {
+  if (!cycle.counters.isObject) return false;
+  out->unreadMessages = cycle.counters.dialogs();
+  out->totalUnreadMessages = cycle.counters.total();
   return true;
 }
 
-// Fetch total unread messages (all types: dialogs + chats + groups)
-// Returns TYPE.ALL or TYPE.MESSENGER
-static bool fetchTotalUnreadMessages(uint16_t* count) {
-  if (!count) return false;
+static bool extractRpa(B24Cycle& cycle, Bitrix24Counts* out) {
+  return cycle.undone.finish(&out->undoneTasks);
+}
 
-  String response = bitrix24Request("im.counters.get", "");
-  if (response.length() == 0) {
-    return false;
+static bool extractExpired(B24Cycle& cycle, Bitrix24Counts* out) {
+  if (!cycleDelayed(cycle, "expired", cycle.taskCounters[0], &out->expiredTasks)) return false;
+  if (cycle.groupId == 0) {
+    // Global "All your tasks" = active + delayed
+    out->totalComments = (uint16_t)(cycleTotal(cycle, "active") + out->expiredTasks);
   }
+  return true;
+}
 
-  DynamicJsonDocument doc(4096);
-  DeserializationError err = deserializeJson(doc, response);
-  response = "";
+// Selected group (unless watched) and every watched group: two requests each, added per
+// group by addGroupSources()
+static bool extractGroups(B24Cycle& cycle, Bitrix24Counts* out) {
+  bool ok = true;
+  for (uint8_t i = 0; i < watchStatsCount; i++) {
+    uint16_t delayed;
+    if (!cycleDelayed(cycle, WATCH_DELAYED_KEYS[i], cycle.taskCounters[2 + i], &delayed)) {
+      ok = false;
+      continue;
+    }
+    watchStats[i].delayed = delayed;
+    watchStats[i].allTasks = (uint16_t)(cycleTotal(cycle, WATCH_ACTIVE_KEYS[i]) + delayed);
+    watchStats[i].valid = true;
+  }
+  if (cycle.groupId != 0 && !cycle.selectedWatched) {
+    uint16_t delayed;
+    if (!cycleDelayed(cycle, "gdelayed", cycle.taskCounters[1], &delayed)) return false;
+    out->groupDelayedTasks = delayed;
+    // "All your tasks" in group = active + delayed (see fetchGroupDelayedAndComments)
+    out->groupComments = (uint16_t)(cycleTotal(cycle, "gactive") + delayed);
+  }
+  return ok;
+}
 
-  if (err || !doc["result"].is<JsonObject>()) {
-    return false;
+static const B24CounterDef B24_COUNTERS[] = {
+  {B24_COUNTER_DIALOGS, extractDialogs},
+  {B24_COUNTER_RPA,     extractRpa},
+  {B24_COUNTER_EXPIRED, extractExpired},
+  {B24_COUNTER_GROUP,   extractGroups},
+};
+
+// Delayed request of one group: aggregate counters or a list count query
+static void addDelayedSource(B24Cycle& cycle, const char* key, uint32_t groupId,
+                             TaskCountersReader& counters) {
+  if (cycle.aggregate) {
+    cycle.cmds[cycle.count++] = {key, TASK_COUNTERS_METHOD,
+                                 cycleParams(cycle, countersSourceParams, groupId),
+                                 &counters, B24_COUNTER_GROUP};
+  } else {
+    cycle.cmds[cycle.count++] = {key, "tasks.task.list",
+                                 cycleParams(cycle, delayedSourceParams, groupId),
+                                 nullptr, B24_COUNTER_GROUP};
   }
+}
 
-  JsonObject result = doc["result"].as<JsonObject>();
-  uint16_t totalUnread = 0;
+static void addGroupSources(B24Cycle& cycle) {
+  if (cycle.groupId != 0 && !cycle.selectedWatched) {
+    addDelayedSource(cycle, "gdelayed", cycle.groupId, cycle.taskCounters[1]);
+    cycle.cmds[cycle.count++] = {"gactive", "tasks.task.list",
+                                 cycleParams(cycle, activeSourceParams, cycle.groupId),
+                                 nullptr, B24_COUNTER_GROUP};
+  }
+  for (uint8_t i = 0; i < watchStatsCount; i++) {
+    uint32_t gid = watchStats[i].groupId;
+    addDelayedSource(cycle, WATCH_DELAYED_KEYS[i], gid, cycle.taskCounters[2 + i]);
+    cycle.cmds[cycle.count++] = {WATCH_ACTIVE_KEYS[i], "tasks.task.list",
+                                 cycleParams(cycle, activeSourceParams, gid),
+                                 nullptr, B24_COUNTER_GROUP};
+  }
+}
 
-  // Preferred: TYPE.ALL (total unread messages)
-  if (result["TYPE"].is<JsonObject>()) {
-    JsonObject type = result["TYPE"].as<JsonObject>();
-    if (type["ALL"].is<int>()) {
-      totalUnread = type["ALL"].as<int>();
-    } else if (type["MESSENGER"].is<int>()) {
-      totalUnread = type["MESSENGER"].as<int>();
+// Judge the aggregate endpoint by this cycle: one usable answer is enough; none while the
+// other requests worked (or an answer without the counter) means the portal lacks it
+static void checkTaskCounters(B24Cycle& cycle) {
+  bool used = false;
+  bool usable = false;
+  bool malformed = false;
+  bool otherWorked = false;
+  for (uint8_t i = 0; i < cycle.count; i++) {
+    const Bitrix24BatchCmd& cmd = cycle.cmds[i];
+    if (strcmp(cmd.method, TASK_COUNTERS_METHOD) != 0) {
+      otherWorked |= !cmd.failed;
+      continue;
     }
+    used = true;
+    if (cmd.failed) continue;
+    if (static_cast<TaskCountersReader*>(cmd.reader)->hasExpired) {
+      usable = true;
+    } else {
+      malformed = true;
+    }
+  }
+  if (!used) return;
+  if (usable) {
+    taskCountersWorked();
+  } else {
+    taskCountersFailed(malformed || otherWorked);
   }
+}
 
-  *count = totalUnread;
+// Current user and portal time, inputs of the task filters. Resolved once per cycle:
+// batched together when batch mode is on (server.time only provides the portal timezone,
+// see time_service.h, so it is asked for every few hours at most).
+static bool resolveTaskInputs(Arena& arena, char* portalNow) {
+  unsigned long now = millis();
+  if (bitrix24UseBatch && (bitrixCurrentUserId == 0 || timeNeedsServerTime(now))) {
+    UserIdReader user;
+    ServerTimeReader time;
+    Bitrix24BatchCmd prereq[2];
+    uint8_t n = 0;
+    if (bitrixCurrentUserId == 0) {
+      prereq[n++] = {"user", "user.current", "", &user};
+    }
+    if (timeNeedsServerTime(now)) {
+      prereq[n++] = {"time", "server.time", "", &time};
+    }
+    if (!bitrix24Batch(arena, prereq, n)) {
+      return false;
+    }
+    if (bitrixCurrentUserId == 0) {
+      bitrixCurrentUserId = user.id;
+    }
+    if (time.time[0] != '\0') {
+      timeApplyServerTime(time.time, now);
+    }
+  }
+  if (!fetchCurrentUserId() || !fetchBitrixNow(portalNow)) {
+    Serial.println("Bitrix24: user.current/server.time not available");
+    return false;
+  }
   return true;
 }
 
-// Fetch undone RPA / user process tasks count
-// Strategy: Use bizproc.task.list (RPA user processes UI is built on top of bizproc)
-static bool fetchUndoneTasks(uint16_t* count) {
-  if (!count) return false;
+// Issue every command of the cycle: one batch call, or one request per command
+static bool runCycle(B24Cycle& cycle) {
+  if (bitrix24UseBatch) {
+    return bitrix24Batch(cycle.arena, cycle.cmds, cycle.count);
+  }
+  bool any = false;
+  for (uint8_t i = 0; i < cycle.count; i++) {
+    Bitrix24BatchCmd& cmd = cycle.cmds[i];
+    bool ok = cmd.reader ? bitrix24Fetch(cmd.method, cmd.params, *cmd.reader)
+                         : bitrix24FetchTotal(cmd.method, cmd.params, &cmd.total);
+    if (!ok) {
+      Serial.print("Bitrix24: ");
+      Serial.print(cmd.method);
+      Serial.println(" - request failed");
+    }
+    cmd.failed = !ok;
+    any |= ok;
+  }
+  return any;
+}
 
-  // Ensure we know the current Bitrix24 user ID (linked to this webhook)
-  if (!fetchCurrentUserId()) {
-    return false;
+// One refresh cycle for the counters in `mask`, updating only their fields in `out`.
+// Returns the mask of counters that failed.
+static uint8_t fetchRegistryCycle(Bitrix24Counts* out, uint8_t mask) {
+  B24Cycle cycle(refreshArena);
+  cycle.groupId = selectedGroupId;
+  cycle.selectedWatched = findWatchStats(cycle.groupId) >= 0;
+  cycle.aggregate = taskCountersUsable();
+
+  bool needsUser = (mask & B24_MASK(B24_COUNTER_GROUP)) != 0;
+  for (const B24SourceDef& src : B24_SOURCES) {
+    if ((src.counters & mask) && src.needsUser) needsUser = true;
+  }
+  uint8_t failed = 0;
+  if (needsUser && !resolveTaskInputs(cycle.arena, cycle.now)) {
+    // Only counters that don't need the user can still go ahead
+    for (const B24SourceDef& src : B24_SOURCES) {
+      if (src.needsUser) failed |= (uint8_t)(src.counters & mask);
+    }
+    failed |= (uint8_t)(mask & B24_MASK(B24_COUNTER_GROUP));
+    mask &= (uint8_t)~failed;
+  }
+  cycle.undone.userId = bitrixCurrentUserId;
+
+  for (const B24SourceDef& src : B24_SOURCES) {
+    if (!(src.counters & mask) || (src.globalOnly && cycle.groupId != 0)) continue;
+    if (src.variant == (cycle.aggregate ? B24_SRC_LIST : B24_SRC_AGGREGATE)) continue;
+    Bitrix24BatchCmd& cmd = cycle.cmds[cycle.count++];
+    cmd = {src.key, src.method, cycleParams(cycle, src.params, 0),
+           src.reader ? src.reader(cycle) : nullptr, B24_COUNTER_COUNT};
+  }
+  if (mask & B24_MASK(B24_COUNTER_GROUP)) {
+    addGroupSources(cycle);
+  }
+  if (cycle.count == 0) {
+    return failed;
+  }
+  if (cycle.arenaFull) {
+    Serial.println("Bitrix24: request arena full, refresh skipped");
+    return (uint8_t)(failed | mask);
   }
 
-  // Get tasks for the correct user ID
-  // NOTE: This corresponds to RPA user tasks you see under /rpa/ → /bizproc/userprocesses/
-  // We explicitly filter by USER_ID instead of hardcoding (e.g. 17).
-  //
-  // IMPORTANT: By default the API only returns a few fields (ENTITY, DOCUMENT_ID, ID, etc.).
-  // We must explicitly ask for USER_ID and status fields so we can find tasks that are:
-  //   - assigned to this user
-  //   - still not completed (undone)
-  //
-  // Bitrix list syntax: FILTER[FIELD]=..., SELECT[]=FIELD1, SELECT[]=FIELD2, ...
-  String params = "FILTER[USER_ID]=" + String(bitrixCurrentUserId)
-                  + "&SELECT[]=ID"
-                  + "&SELECT[]=USER_ID"
-                  + "&SELECT[]=STATUS"
-                  + "&SELECT[]=STATUS_ID"
-                  + "&SELECT[]=STATUS_NAME";
-  
-  String response = bitrix24Request("bizproc.task.list", params.c_str());
-  if (response.length() == 0) {
-    return false;
+  if (!runCycle(cycle)) {
+    return (uint8_t)(failed | mask);
+  }
+  if (cycle.aggregate) {
+    checkTaskCounters(cycle);
   }
 
-  // Calculate buffer size: response length + some overhead for JSON structure
-  // Use at least 32KB to handle large responses (23KB+ seen in practice)
-  size_t bufferSize = response.length() + 8192;  // Add 8KB overhead
-  if (bufferSize < 32768) bufferSize = 32768;  // Minimum 32KB
-  if (bufferSize > 65536) bufferSize = 65536;  // Maximum 64KB (ESP32-C6 limit)
+  // A counter fails when any response it reads failed
+  for (uint8_t i = 0; i < cycle.count; i++) {
+    Bitrix24BatchCmd& cmd = cycle.cmds[i];
+    if (!cmd.failed) continue;
+    if (cmd.counter < B24_COUNTER_COUNT) {
+      failed |= B24_MASK(cmd.counter);
+    }
+    for (const B24SourceDef& src : B24_SOURCES) {
+      if (strcmp(src.key, cmd.key) == 0) failed |= (uint8_t)(src.counters & mask);
+    }
+  }
+  for (const B24CounterDef& def : B24_COUNTERS) {
+    uint8_t bit = B24_MASK(def.counter);
+    if ((mask & bit) && !(failed & bit) && !def.extract(cycle, out)) {
+      failed |= bit;
+    }
+  }
+  return failed;
+}
 
-  DynamicJsonDocument doc(bufferSize);
-  DeserializationError err = deserializeJson(doc, response);
-  response = "";  // Free memory immediately
+// Fetch the counters in `mask`, updating only their fields in `out`.
+// Returns the mask of counters that failed.
+static uint8_t fetchBitrix24CountersFromRegistry(Bitrix24Counts* out, uint8_t mask) {
+  bool aggregate = taskCountersUsable();
+  uint8_t failed = fetchRegistryCycle(out, mask);
+  // The aggregate endpoint just turned out to be missing: count with list queries right away
+  uint8_t redo = failed & (B24_MASK(B24_COUNTER_EXPIRED) | B24_MASK(B24_COUNTER_GROUP));
+  if (aggregate && redo != 0 && !taskCountersUsable()) {
+    failed = (uint8_t)((failed & ~redo) | fetchRegistryCycle(out, redo));
+  }
+  return failed;
+}
 
-  if (err) {
-    return false;
+// Feed counter changes into the Telegram digest (sent from the task loop, see flushDigest)
+static void checkAndNotifyChanges(const Bitrix24Counts& newCounts,
+                                  const Bitrix24GroupStats* watchBefore, uint8_t watchCount) {
+  // Skip if previous counts are not valid (first run)
+  if (!previousCounts.valid) {
+    previousCounts = newCounts;
+    return;
   }
 
-  uint16_t taskCount = 0;
-  JsonArray tasks;
+  unsigned long now = millis();
+  b24DigestNote(B24_DIGEST_UNREAD, 0, previousCounts.unreadMessages, newCounts.unreadMessages, now);
+  b24DigestNote(B24_DIGEST_TASKS, 0, previousCounts.undoneTasks, newCounts.undoneTasks, now);
 
-  // Try different response structures
-  if (doc["result"].is<JsonArray>()) {
-    tasks = doc["result"].as<JsonArray>();
-  } else if (doc["result"].is<JsonObject>()) {
-    JsonObject result = doc["result"].as<JsonObject>();
-    
-    // Check for "tasks" array
-    if (result["tasks"].is<JsonArray>()) {
-      tasks = result["tasks"].as<JsonArray>();
-    }
-    // Check for "total" count field
-    else if (result["total"].is<int>()) {
-      taskCount = result["total"].as<int>();
-      *count = taskCount;
-      return true;
-    } else {
-      return false;
-    }
+  // Expired tasks: per group when a group is selected, otherwise the global count
+  uint32_t currentGroupId = getBitrixSelectedGroupId();
+  if (currentGroupId != 0) {
+    b24DigestNote(B24_DIGEST_GROUP, currentGroupId,
+                  previousCounts.groupDelayedTasks, newCounts.groupDelayedTasks, now);
   } else {
-    return false;
+    b24DigestNote(B24_DIGEST_EXPIRED, 0, previousCounts.expiredTasks, newCounts.expiredTasks, now);
   }
 
-  // Count only undone tasks that are actually assigned to current user
-  // STATUS = 0 means undone/active
-  for (JsonVariant task : tasks) {
-    if (task.is<JsonObject>()) {
-      JsonObject t = task.as<JsonObject>();
-      
-      // Check USER_ID matches current user
-      bool isAssignedToUser = false;
-      if (t["USER_ID"].is<int>()) {
-        int userId = t["USER_ID"].as<int>();
-        isAssignedToUser = (userId == (int)bitrixCurrentUserId);
-      } else if (t["USER_ID"].is<const char*>()) {
-        String userIdStr = t["USER_ID"].as<const char*>();
-        uint32_t userId = userIdStr.toInt();
-        isAssignedToUser = (userId == bitrixCurrentUserId);
-      }
-      
-      // Check STATUS field: 0 = undone/active
-      // Bitrix may return it as int OR as string, so handle both.
-      bool isUndone = false;
-      int status = -1;
-      if (t["STATUS"].is<int>()) {
-        status = t["STATUS"].as<int>();
-      } else if (t["STATUS"].is<const char*>()) {
-        String statusStr = t["STATUS"].as<const char*>();
-        status = statusStr.toInt();
-      }
-      isUndone = (status == 0);  // STATUS=0 means undone/active
-      
-      // Count only if: assigned to user AND undone (STATUS=0)
-      if (isAssignedToUser && isUndone) {
-        taskCount++;
-      }
-    }
+  // Watched groups (the selected one is already covered above)
+  for (uint8_t i = 0; i < watchCount; i++) {
+    const Bitrix24GroupStats& before = watchBefore[i];
+    const Bitrix24GroupStats& after = watchStats[i];
+    if (!before.valid || !after.valid || after.groupId == currentGroupId) continue;
+    b24DigestNote(B24_DIGEST_GROUP, after.groupId, before.delayed, after.delayed, now);
   }
 
-  *count = taskCount;
+  // Update previous counts
+  previousCounts = newCounts;
+}
 
-  return true;
+// One history sample per minute from the latest live counts (held through failed fetches)
+static void recordHistory() {
+  static uint32_t minute = 0;
+  static unsigned long minuteStart = 0;
+  unsigned long now = millis();
+  if (now - minuteStart >= 60000UL) {
+    uint32_t elapsed = (now - minuteStart) / 60000UL;
+    minute += elapsed;
+    minuteStart += elapsed * 60000UL;
+  }
+  if (cachedCounts.lastUpdate == 0 || cachedCounts.stale) return;
+
+  uint16_t values[B24_SERIES_COUNT];
+  values[B24_SERIES_UNREAD] = cachedCounts.unreadMessages;
+  values[B24_SERIES_TASKS] = cachedCounts.undoneTasks;
+  values[B24_SERIES_EXPIRED] = cachedCounts.expiredTasks;
+  values[B24_SERIES_GROUP] = cachedCounts.groupDelayedTasks;
+  b24HistoryAppend(values, minute);
 }
 
-// Fetch expired (late) tasks/projects count
-// Strategy: Use tasks.task.list with tiny page size and read result.total
-// This keeps responses small and avoids NoMemory.
-static bool fetchExpiredTasks(uint16_t* count) {
-  if (!count) return false;
+// Send the pending digest once its window has passed
+static void flushDigest() {
+  unsigned long now = millis();
+  if (!b24DigestDue(now)) return;
+  String msg = b24DigestTake(now, TELEGRAM_MSG_MAX);
+  if (msg.length() > 0) {
+    sendTelegramMessage(msg, TG_PRIO_COUNTERS);
+  }
+}
 
-  // Ensure we know the current Bitrix24 user ID
-  if (!fetchCurrentUserId()) {
+// One tasks.task.list page for the task index
+static bool fetchTaskIndexPage(const char* params, uint32_t userId, int* next) {
+  *next = -1;
+  HTTPClient* http = bitrix24Begin("tasks.task.list", params);
+  if (http == nullptr) {
     return false;
   }
+  HttpBodyStream response(*http);
+  bool ok = b24TaskIndexReadPage(response, userId, next);
+  bitrix24End(http, response, ok);
+  return ok;
+}
 
-  // Get current date from Bitrix (server.time) so it's not hardcoded
-  String today;
-  if (!fetchBitrixTodayDate(&today)) {
-    *count = 0;
+// Compute the task counters in `mask` (EXPIRED / GROUP) from the local task index,
+// after one delta sync. Returns false if the index is unavailable (caller falls back
+// to count queries).
+static bool fetchTaskCountsFromIndex(Bitrix24Counts* out, uint8_t mask, uint32_t groupId) {
+  char today[11];
+  char portalNow[26];
+  // A minute back covers clock skew between device and portal (re-applying is harmless)
+  if (!fetchCurrentUserId() || !fetchBitrixTodayDate(today) || !timeLocalDateTime(-60, portalNow)) {
     return false;
   }
-
-  // Filter: past deadline, RESPONSIBLE_ID = current user, !STATUS=5 (not completed)
-  String params = "filter[RESPONSIBLE_ID]=" + String(bitrixCurrentUserId)
-                + "&filter[!DEADLINE]="          // Has deadline (not empty)
-                + "&filter[<DEADLINE]=" + today   // Deadline before today
-                + "&filter[!STATUS]=5"            // Exclude completed tasks
-                + "&nav_params[nPageSize]=1"
-                + "&nav_params[iNumPage]=1"
-                + "&select[]=ID";
-
-  String response = bitrix24Request("tasks.task.list", params.c_str());
-  if (response.length() == 0) {
-    *count = 0;
+  if (!b24TaskIndexSync(fetchTaskIndexPage, bitrixCurrentUserId, portalNow, millis())) {
     return false;
   }
 
-  // Parse `"total":` from the raw JSON (avoid ArduinoJson NoMemory)
-  uint16_t expiredCount = 0;
-  int totalPos = response.indexOf("\"total\":");
-  if (totalPos < 0) totalPos = response.indexOf("\"TOTAL\":");
-
-  if (totalPos >= 0) {
-    int numStart = response.indexOf(':', totalPos);
-    if (numStart >= 0) {
-      numStart++;
-      while (numStart < (int)response.length() && response[numStart] == ' ') numStart++;
-      int numEnd = numStart;
-      while (numEnd < (int)response.length() && response[numEnd] >= '0' && response[numEnd] <= '9') {
-        numEnd++;
-      }
-      if (numEnd > numStart) {
-        expiredCount = (uint16_t)response.substring(numStart, numEnd).toInt();
-      }
+  uint32_t todayKey = b24DateKey(today);
+  if (mask & B24_MASK(B24_COUNTER_EXPIRED)) {
+    out->expiredTasks = b24TaskIndexCountExpired(0, todayKey);
+    if (groupId == 0) {
+      // Global "All your tasks" = active + delayed (same definition as fetchGlobalAllTasks)
+      out->totalComments = (uint16_t)(b24TaskIndexCountActive(0) + out->expiredTasks);
+    }
+  }
+  if ((mask & B24_MASK(B24_COUNTER_GROUP)) && groupId != 0) {
+    out->groupDelayedTasks = b24TaskIndexCountExpired(groupId, todayKey);
+    out->groupComments = (uint16_t)(b24TaskIndexCountActive(groupId) + out->groupDelayedTasks);
+  }
+  // Watched groups cost nothing extra: all counted from the same index
+  if (mask & B24_MASK(B24_COUNTER_GROUP)) {
+    for (uint8_t i = 0; i < watchStatsCount; i++) {
+      Bitrix24GroupStats& stats = watchStats[i];
+      stats.delayed = b24TaskIndexCountExpired(stats.groupId, todayKey);
+      stats.allTasks = (uint16_t)(b24TaskIndexCountActive(stats.groupId) + stats.delayed);
+      stats.valid = true;
     }
   }
-
-  response = "";
-  *count = expiredCount;
   return true;
 }
 
-// Fetch total comments count
-// Strategy: Try to get comments count from various sources
-static bool fetchTotalComments(uint16_t* count) {
-  if (!count) return false;
+// Mask of counters whose displayed values differ between `a` and `b`
+static uint8_t changedCounters(const Bitrix24Counts& a, const Bitrix24Counts& b) {
+  uint8_t changed = 0;
+  if (a.unreadMessages != b.unreadMessages || a.totalUnreadMessages != b.totalUnreadMessages) {
+    changed |= B24_MASK(B24_COUNTER_DIALOGS);
+  }
+  if (a.undoneTasks != b.undoneTasks) {
+    changed |= B24_MASK(B24_COUNTER_RPA);
+  }
+  if (a.expiredTasks != b.expiredTasks || a.totalComments != b.totalComments) {
+    changed |= B24_MASK(B24_COUNTER_EXPIRED);
+  }
+  if (a.groupDelayedTasks != b.groupDelayedTasks || a.groupComments != b.groupComments) {
+    changed |= B24_MASK(B24_COUNTER_GROUP);
+  }
+  return changed;
+}
 
-  // Disabled heavy API calls; we derive comments from total unread instead.
-  *count = 0;
-  return true;
+// Publish for readers: fill the inactive slot, then flip the sequence
+static void publishCounts(const Bitrix24Counts& counts) {
+  uint32_t seq = publishedSeq.load(std::memory_order_relaxed);
+  uint8_t slot = (seq + 1) & 1;
+  publishedCounts[slot] = counts;
+  memcpy(publishedWatch[slot], watchStats, sizeof(watchStats[0]) * watchStatsCount);
+  publishedWatchCount[slot] = watchStatsCount;
+  publishedSeq.store(seq + 1, std::memory_order_release);
 }
 
-// Check for changes and send Telegram notifications
-static void checkAndNotifyChanges(const Bitrix24Counts& newCounts) {
-  // Skip if previous counts are not valid (first run)
-  if (!previousCounts.valid) {
-    previousCounts = newCounts;
-    return;
+// Refresh the counters in `mask`, publish the merged counts and feed the scheduler
+static bool refreshBitrix24Counts(uint8_t mask) {
+  uint32_t groupId = selectedGroupId;
+  Bitrix24Counts fetched = cachedCounts;
+
+  // Group fields belong to one group; drop them when the selection changes
+  if (groupId != knownGroupId) {
+    knownGroupId = groupId;
+    knownCounters &= (uint8_t)~B24_MASK(B24_COUNTER_GROUP);
+    fetched.groupDelayedTasks = 0;
+    fetched.groupComments = 0;
+  }
+  // Without a selected or watched group there is nothing to fetch for GROUP
+  uint8_t watchCount = syncWatchStats();
+  Bitrix24GroupStats watchBefore[BITRIX24_MAX_WATCHED_GROUPS];
+  memcpy(watchBefore, watchStats, sizeof(watchStats[0]) * watchCount);
+  uint8_t required = B24_MASK_ALL;
+  if (groupId == 0 && watchCount == 0) {
+    required &= (uint8_t)~B24_MASK(B24_COUNTER_GROUP);
   }
 
-  // Check for changes in the 3 main numbers
-  if (previousCounts.unreadMessages != newCounts.unreadMessages) {
-    String msg = "📨 <b>Unread Messages:</b> ";
-    msg += String(newCounts.unreadMessages);
-    if (newCounts.unreadMessages > previousCounts.unreadMessages) {
-      msg += " ⬆️";
-    } else {
-      msg += " ⬇️";
-    }
-    sendTelegramMessage(msg);
+  // Fleet follower: shared counters come from the leader's frame. The expired count depends
+  // on the group selection in group mode, so it is only shared without one.
+  uint8_t fetchMask = mask & required;
+  uint8_t shared = B24_FLEET_SHARED;
+  if (groupId != 0) shared &= (uint8_t)~B24_MASK(B24_COUNTER_EXPIRED);
+  uint8_t fleetMask = fetchMask & shared & bitrix24FleetCoveredMask();
+  if (fleetMask) {
+    // Counters the leader hasn't sent yet are neither fetched nor failed
+    mask &= (uint8_t)~(fleetMask & ~bitrix24FleetRead(&fetched, fleetMask));
+    fetchMask &= (uint8_t)~fleetMask;
   }
 
-  if (previousCounts.undoneTasks != newCounts.undoneTasks) {
-    String msg = "📋 <b>Undone Tasks:</b> ";
-    msg += String(newCounts.undoneTasks);
-    if (newCounts.undoneTasks > previousCounts.undoneTasks) {
-      msg += " ⬆️";
-    } else {
-      msg += " ⬇️";
-    }
-    sendTelegramMessage(msg);
+  // Task counters come from the local index when possible (one delta query for all of them)
+  uint8_t indexMask = 0;
+  if (bitrix24UseTaskIndex) {
+    indexMask = fetchMask & (B24_MASK(B24_COUNTER_EXPIRED) | B24_MASK(B24_COUNTER_GROUP));
   }
 
-  // Check for expired/delayed tasks changes
-  // If a group is selected, check groupDelayedTasks and include group name
-  // Otherwise, check expiredTasks (global)
-  uint32_t currentGroupId = getBitrixSelectedGroupId();
-  if (currentGroupId != 0) {
-    // Group mode: check for changes in groupDelayedTasks
-    if (previousCounts.groupDelayedTasks != newCounts.groupDelayedTasks) {
-      String msg = "⏰ <b>Expired Tasks:</b> ";
-      msg += String(newCounts.groupDelayedTasks);
-      if (newCounts.groupDelayedTasks > previousCounts.groupDelayedTasks) {
-        msg += " ⬆️";
-      } else {
-        msg += " ⬇️";
-      }
-      
-      // Add group name to the message
-      String groupName = bitrixGetGroupName(currentGroupId);
-      if (groupName.length() > 0) {
-        msg += "\n📁 <b>Group:</b> ";
-        msg += groupName;
-      }
-      
-      sendTelegramMessage(msg);
-    }
-  } else {
-    // Global mode: check for changes in expiredTasks (no group info)
-    if (previousCounts.expiredTasks != newCounts.expiredTasks) {
-      String msg = "⏰ <b>Expired Tasks:</b> ";
-      msg += String(newCounts.expiredTasks);
-      if (newCounts.expiredTasks > previousCounts.expiredTasks) {
-        msg += " ⬆️";
-      } else {
-        msg += " ⬇️";
-      }
-      sendTelegramMessage(msg);
+  uint8_t failed = 0;
+  if (fetchMask & ~indexMask) {
+    failed = fetchBitrix24CountersFromRegistry(&fetched, fetchMask & ~indexMask);
+  }
+  if (indexMask && !fetchTaskCountsFromIndex(&fetched, indexMask, groupId)) {
+    failed |= fetchBitrix24CountersFromRegistry(&fetched, indexMask);
+  }
+  // A watched selected group shares the watch list's numbers
+  int8_t watchSlot = findWatchStats(groupId);
+  if (groupId != 0 && watchSlot >= 0 && watchStats[watchSlot].valid) {
+    fetched.groupDelayedTasks = watchStats[watchSlot].delayed;
+    fetched.groupComments = watchStats[watchSlot].allTasks;
+  }
+  // Keep comments as total unread messages for backwards compatibility (not shown in UI in group mode)
+  if (groupId != 0) {
+    fetched.totalComments = fetched.totalUnreadMessages;
+  }
+
+  unsigned long now = millis();
+  knownCounters |= (uint8_t)(mask & required & ~failed);
+  uint8_t changed = changedCounters(cachedCounts, fetched);
+  for (uint8_t i = 0; i < watchCount; i++) {
+    if (watchBefore[i].delayed != watchStats[i].delayed || watchBefore[i].allTasks != watchStats[i].allTasks) {
+      changed |= B24_MASK(B24_COUNTER_GROUP);
     }
   }
+  b24SchedulerOnFetched(mask, failed, changed, now, esp_random());
 
-  // Update previous counts
-  previousCounts = newCounts;
-}
+  liveCounters |= (uint8_t)(mask & required & ~failed);
+  fetched.valid = (failed == 0) && (knownCounters & required) == required;
+  fetched.stale = (liveCounters & required) != required;
+  fetched.lastUpdate = now;
 
-// Fetch all notification counts from Bitrix24
-bool fetchBitrix24Counts(Bitrix24Counts* counts) {
-  if (!counts) return false;
+  // Always update cache timestamp (even on failure); the scheduler backs off failed counters
+  cachedCounts = fetched;
 
-  bool success = true;
-  uint16_t unread = 0;
-  uint16_t totalUnread = 0;
-  uint16_t undone = 0;
-  uint16_t expired = 0;
-  uint16_t comments = 0;
-  uint16_t groupDelayed = 0;
-  uint16_t groupComments = 0;
+  publishCounts(fetched);
+  bitrix24FleetPublish(fetched, liveCounters & shared);
 
-  // Fetch unread messages in dialogs
-  if (!fetchUnreadMessages(&unread)) {
-    success = false;
+  if (fetched.valid && !fetched.stale) {
+    saveSnapshotIfDue(fetched, now);
   }
 
-  // Fetch total unread messages (all types)
-  fetchTotalUnreadMessages(&totalUnread);
-
-  // Fetch undone business process tasks
-  fetchUndoneTasks(&undone);
-
-  // Fetch expired (late) tasks/projects (count-only, low-memory)
-  fetchExpiredTasks(&expired);
-
-  // Third section logic:
-  // - If a specific group is selected: use per-group stats (delayed + all your tasks)
-  // - If no group is selected: show global "All your tasks" (across all groups)
-  if (selectedGroupId != 0) {
-    // Group mode
-    fetchGroupDelayedAndComments(selectedGroupId, &groupDelayed, &groupComments);
-    // Keep comments as total unread messages for backwards compatibility (not shown in UI in group mode)
-    comments = totalUnread;
-  } else {
-    // Global mode: "All tasks" subtitle should show all active + delayed tasks for current user
-    if (!fetchGlobalAllTasks(&comments)) {
-      // Fallback: at least don't break, keep previous behavior based on unread messages
-      comments = totalUnread;
-    }
-  }
-
-  counts->unreadMessages = unread;
-  counts->totalUnreadMessages = totalUnread;
-  counts->undoneTasks = undone;
-  counts->expiredTasks = expired;
-  counts->totalComments = comments;
-  counts->groupDelayedTasks = groupDelayed;
-  counts->groupComments = groupComments;
-  counts->valid = success;
-  counts->lastUpdate = millis();
-
-  // Always update cache timestamp (even on failure) to prevent infinite retry loop
-  // The shouldUpdateBitrix24() function will enforce minimum retry delay
-  cachedCounts = *counts;
-  
   // Check for changes and send notifications
-  if (success) {
-    checkAndNotifyChanges(*counts);
+  if (fetched.valid) {
+    checkAndNotifyChanges(fetched, watchBefore, watchCount);
   }
-  
+
   // Only log detailed stats when WiFi is actually connected.
   // This prevents serial spam with zero values while WiFi is reconnecting
   // (for example, right after turning AP off and switching back to STA).
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.print("Bitrix24: Dialogs: ");
-    Serial.print(unread);
+    Serial.print("Bitrix24: Refreshed mask 0x");
+    Serial.print(mask, HEX);
+    Serial.print(", Dialogs: ");
+    Serial.print(fetched.unreadMessages);
     Serial.print(", Total: ");
-    Serial.print(totalUnread);
+    Serial.print(fetched.totalUnreadMessages);
     Serial.print(", Tasks: ");
-    Serial.print(undone);
+    Serial.print(fetched.undoneTasks);
     Serial.print(", Expired: ");
-    Serial.print(expired);
+    Serial.print(fetched.expiredTasks);
     Serial.print(", Comments: ");
-    Serial.print(comments);
+    Serial.print(fetched.totalComments);
     Serial.print(", GroupDelayed: ");
-    Serial.print(groupDelayed);
+    Serial.print(fetched.groupDelayedTasks);
     Serial.print(", All_your_group_tasks: ");
-    Serial.println(groupComments);
+    Serial.println(fetched.groupComments);
   }
 
-  return success;
+  return fetched.valid;
 }
 
-// Get cached counts
+// Get last published counts (lock-free, never blocks on network)
 Bitrix24Counts getBitrix24Counts() {
-  return cachedCounts;
+  Bitrix24Counts snapshot;
+  uint32_t before, after;
+  do {
+    before = publishedSeq.load(std::memory_order_acquire);
+    snapshot = publishedCounts[before & 1];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = publishedSeq.load(std::memory_order_relaxed);
+  } while (after != before);
+  return snapshot;
 }
 
-// Check if update is needed
-bool shouldUpdateBitrix24() {
-  // Don't update if WiFi is not connected (prevents infinite retry loop)
-  if (WiFi.status() != WL_CONNECTED) {
-    return false;
-  }
-  
-  unsigned long now = millis();
-  if (now < cachedCounts.lastUpdate) {
-    // millis() overflow, force refresh
-    return true;
-  }
-  
-  unsigned long timeSinceLastUpdate = now - cachedCounts.lastUpdate;
-  
-  // If cache is invalid, only retry after minimum delay (prevents infinite loop)
-  if (!cachedCounts.valid) {
-    return timeSinceLastUpdate >= BITRIX24_MIN_RETRY_DELAY;
+// Sequence number of the published snapshot (changes on every finished refresh)
+uint32_t getBitrix24CountsSeq() {
+  return publishedSeq.load(std::memory_order_acquire);
+}
+
+// Get last published watched group stats (same seqlock as the counts)
+uint8_t getBitrixWatchedGroupStats(Bitrix24GroupStats* out, uint8_t maxCount) {
+  uint8_t count;
+  uint32_t before, after;
+  do {
+    before = publishedSeq.load(std::memory_order_acquire);
+    count = publishedWatchCount[before & 1];
+    if (count > maxCount) count = maxCount;
+    memcpy(out, publishedWatch[before & 1], sizeof(out[0]) * count);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = publishedSeq.load(std::memory_order_relaxed);
+  } while (after != before);
+  return count;
+}
+
+// Relaxed polling while the user is focused on a work session or not looking at B24
+static bool bitrix24Relaxed() {
+  return (currentState == RUNNING && isWorkSession) || currentViewMode != VIEW_MODE_B24;
+}
+
+// Fetch one group name queued by cache readers (screen, Telegram); a failing group is
+// retried at most once a minute
+static void fetchWantedGroupName() {
+  static uint32_t failedGroupId = 0;
+  static unsigned long failedAt = 0;
+
+  uint32_t groupId = b24GroupCacheTakeWanted();
+  if (groupId == 0) return;
+  if (groupId == failedGroupId && millis() - failedAt < 60000) return;
+
+  if (fetchGroupName(groupId)) {
+    failedGroupId = 0;
+    // Republish so the UI redraws with the name
+    if (cachedCounts.valid) {
+      publishCounts(cachedCounts);
+    }
+  } else {
+    failedGroupId = groupId;
+    failedAt = millis();
   }
+}
+
+// Bitrix24 task - owns the whole refresh cycle so slow HTTP calls never block touch/display
+static void bitrix24Task(void* parameter) {
+  Serial.println("[B24 TASK] Started");
+
+  while (true) {
+    // Skip updates when AP is active OR WiFi is not connected (prevents infinite retry loop)
+    if (!isAPActive() && WiFi.status() == WL_CONNECTED) {
+      bool interactive = pendingInteractive.exchange(false);
+      uint8_t pending = pendingRefreshMask.exchange(0);
+      // Local midnight: expired counters change without any task being edited
+      if (timeDateRolledOver()) {
+        pending |= B24_MASK(B24_COUNTER_EXPIRED) | B24_MASK(B24_COUNTER_GROUP);
+      }
+      if (pending != 0) {
+        b24SchedulerMarkDue(pending);
+      }
+      b24QueueSetTaskPriority(interactive ? B24_PRIO_INTERACTIVE : B24_PRIO_BACKGROUND);
+      fetchWantedGroupName();
+      flushDigest();
+      uint8_t due = b24SchedulerDueMask(millis(), bitrix24Relaxed(), bitrix24PullCoveredMask());
+      // Counters a fleet leader covers only refresh when its frame (or the user) marks them
+      due &= (uint8_t)(~bitrix24FleetCoveredMask() | pending);
+      if (due != 0) {
+        refreshBitrix24Counts(due);
+      }
+    }
 
-  // Normal interval check for valid cache
-  return timeSinceLastUpdate >= bitrix24UpdateInterval;
+    recordHistory();
+    netPerfLogIfDue();
+
+    // Sleep until the next check or until a "refresh now" request arrives
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+  }
 }
 
+// Start Bitrix24 polling task
+void startBitrix24Task() {
+  if (bitrix24TaskHandle != nullptr) return;
+
+  xTaskCreatePinnedToCore(
+    bitrix24Task,           // Task function
+    "Bitrix24Task",         // Task name
+    8192,                   // Stack size
+    NULL,                   // Parameters
+    1,                      // Priority (same as loop; blocks on network most of the time)
+    &bitrix24TaskHandle,    // Task handle
+    0                       // Core 0
+  );
+  Serial.println("Bitrix24 task created on core 0");
+}
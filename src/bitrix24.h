@@ -5,6 +5,9 @@
 
 #include <Arduino.h>
 
+class HTTPClient;
+class HttpBodyStream;
+
 // Bitrix24 notification counts
 struct Bitrix24Counts {
   uint16_t unreadMessages;       // Unread messages in dialogs (TYPE.DIALOG)
@@ -16,37 +19,96 @@ struct Bitrix24Counts {
   uint16_t groupComments;        // Tasks with new comments in selected group (best-effort)
   bool valid;                    // Whether data is valid
   unsigned long lastUpdate;      // Last update timestamp
+  bool stale;                    // Restored from NVS at boot, not yet confirmed by a live fetch
+};
+
+// Last good counts are saved to NVS at most this often (ms) and only when they changed
+#ifndef BITRIX24_SNAPSHOT_INTERVAL
+#define BITRIX24_SNAPSHOT_INTERVAL 900000UL
+#endif
+
+// Watched workgroups: stats for all of them are refreshed together with the GROUP counter
+// (one batched request per cycle, or no request at all with the task index)
+#ifndef BITRIX24_MAX_WATCHED_GROUPS
+#define BITRIX24_MAX_WATCHED_GROUPS 8
+#endif
+
+// Scratch memory for the request strings of one refresh cycle (batch body, sub-request
+// queries). Reused every cycle, so building them never allocates on the heap. The largest
+// cycle (list counts for a selected group and 8 watched ones) takes about 12.4 KB.
+#ifndef BITRIX24_ARENA_SIZE
+#define BITRIX24_ARENA_SIZE 13312
+#endif
+
+struct Bitrix24GroupStats {
+  uint32_t groupId;
+  uint16_t delayed;   // Overdue tasks in the group
+  uint16_t allTasks;  // Active + delayed tasks in the group
+  bool valid;         // Fetched at least once since the group was added
 };
 
 // Initialize Bitrix24 client
 void initBitrix24();
 
-// Fetch all notification counts from Bitrix24
-bool fetchBitrix24Counts(Bitrix24Counts* counts);
-
-// Get cached counts (returns last fetched values)
+// Get cached counts (returns last published values; lock-free, safe from any task)
 Bitrix24Counts getBitrix24Counts();
 
+// Sequence number of the published counts (changes whenever a refresh finishes)
+uint32_t getBitrix24CountsSeq();
+
+// Start background task that polls Bitrix24 and publishes counts
+void startBitrix24Task();
+
 // Selected group mode: show counters for a single workgroup/project
 void setBitrixSelectedGroupId(uint32_t groupId);   // 0 disables group mode
 uint32_t getBitrixSelectedGroupId();
 
 // Optional helpers for selected group (used for Telegram messages)
-// - Get group name by ID (may return empty string if not available)
+// - Get group name by ID (cache only; empty on a miss, which the Bitrix24 task
+//   then fetches for the next call)
 String bitrixGetGroupName(uint32_t groupId);
+// - Cached group name only (never blocks; a miss is fetched by the Bitrix24 task and
+//   shows up with the next published counts). Returns false if not cached yet.
+bool bitrixGetCachedGroupName(uint32_t groupId, char* out, size_t outLen);
 // - Get delayed tasks and total count for a group (lightweight, count-only)
 bool bitrixGetGroupStats(uint32_t groupId, uint16_t* delayed, uint16_t* comments);
 
-// Check if update is needed (based on update interval)
-bool shouldUpdateBitrix24();
+// Watched groups (persisted to NVS; at most BITRIX24_MAX_WATCHED_GROUPS, duplicates dropped)
+void setBitrixWatchedGroups(const uint32_t* groupIds, uint8_t count);
+uint8_t getBitrixWatchedGroups(uint32_t* groupIds, uint8_t maxCount);
+// Published per-group stats, in watch list order (lock-free, same snapshot as getBitrix24Counts)
+uint8_t getBitrixWatchedGroupStats(Bitrix24GroupStats* out, uint8_t maxCount);
+
+// Mark counters (B24_MASK(...) from bitrix24_scheduler.h) due now and wake the Bitrix24 task
+// Safe from any task (used by the Pull client on push events)
+void bitrix24MarkCountersDue(uint8_t mask);
 
 // Force immediate Bitrix24 update (call when user manually requests refresh)
+// Non-blocking: wakes the Bitrix24 task, new counts arrive via getBitrix24CountsSeq()
 void forceBitrix24Update();
 
 // Reload Bitrix24 credentials from NVS (call after saving via web interface)
 void reloadBitrix24Credentials();
 
-// Update interval in milliseconds (default: 60000 = 1 minute)
-extern unsigned long bitrix24UpdateInterval;
+// Low-level REST call on a pooled connection: on success the JSON body can be streamed with
+// HttpBodyStream; nullptr on failure. Hand the client back with bitrix24End().
+HTTPClient* bitrix24Begin(const char* method, const char* params = "", const char* postBody = nullptr);
+// Finish a bitrix24Begin() call: records its telemetry (net_perf.h) and keeps the connection
+// when `parsed` (body read without errors) and the rest of the body could be skipped
+void bitrix24End(HTTPClient* http, HttpBodyStream& response, bool parsed);
+
+// Batch mode: fetch all counters of a refresh cycle with one `batch` REST call (default: on)
+extern bool bitrix24UseBatch;
+
+// Expired-task counts from the aggregate tasks.task.counters.get endpoint instead of a
+// tasks.task.list count query per scope. Portals without it fall back to the list queries.
+#ifndef BITRIX24_TASK_COUNTERS_ENABLED
+#define BITRIX24_TASK_COUNTERS_ENABLED 1
+#endif
+// After the endpoint failed, how long the list queries stay in use before it is tried again (ms)
+#ifndef BITRIX24_TASK_COUNTERS_RETRY
+#define BITRIX24_TASK_COUNTERS_RETRY (6UL * 3600UL * 1000UL)
+#endif
+extern bool bitrix24UseTaskCounters;
 
 #endif // BITRIX24_H
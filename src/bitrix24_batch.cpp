@@ -0,0 +1,67 @@
+// Bitrix24 batch body and response split implementation
+
+#include "bitrix24_batch.h"
+#include <string.h>
+
+static bool isScalarToken(JsonToken token) {
+  return token == JSON_STRING || token == JSON_NUMBER || token == JSON_BOOL;
+}
+
+Bitrix24BatchCmd* b24BatchFind(Bitrix24BatchCmd* cmds, uint8_t count, const char* key) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (strcmp(cmds[i].key, key) == 0) return &cmds[i];
+  }
+  return nullptr;
+}
+
+uint16_t b24BatchTotal(Bitrix24BatchCmd* cmds, uint8_t count, const char* key) {
+  Bitrix24BatchCmd* cmd = b24BatchFind(cmds, count, key);
+  return cmd ? cmd->total : 0;
+}
+
+bool b24BatchBuildBody(QueryBuilder& body, const Bitrix24BatchCmd* cmds, uint8_t count) {
+  body.raw("halt=0");
+  for (uint8_t i = 0; i < count; i++) {
+    body.raw("&cmd[").raw(cmds[i].key).raw("]=").encoded(cmds[i].method);
+    if (cmds[i].params[0] != '\0') {
+      body.encoded("?").encoded(cmds[i].params);
+    }
+  }
+  return body.ok();
+}
+
+JsonToken b24BatchRead(JsonStreamReader& json, Bitrix24BatchCmd* cmds, uint8_t count,
+                       bool* hasResults) {
+  *hasResults = false;
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_OBJECT_START && json.matches("result.result")) {
+      *hasResults = true;
+      continue;
+    }
+    if (json.level() < 3 || strcmp(json.keyAt(0), "result") != 0) continue;
+
+    const char* section = json.keyAt(1);
+    Bitrix24BatchCmd* cmd = b24BatchFind(cmds, count, json.keyAt(2));
+    bool isStart = (token == JSON_OBJECT_START || token == JSON_ARRAY_START);
+    if (strcmp(section, "result") == 0) {
+      if (cmd && cmd->reader) {
+        cmd->reader->feed(json, token, 3);
+      } else if (isStart) {
+        json.skipValue();
+      }
+    } else if (strcmp(section, "result_total") == 0) {
+      if (cmd && token == JSON_NUMBER && json.level() == 3) {
+        cmd->total = (uint16_t)json.asInt();
+      }
+    } else if (strcmp(section, "result_error") == 0 && json.level() == 3 &&
+               (isStart || isScalarToken(token))) {
+      // Sub-query errors don't fail the whole batch (halt=0); just report them
+      Serial.print("Bitrix24: batch - sub-query failed: ");
+      Serial.println(json.keyAt(2));
+      if (cmd) cmd->failed = true;
+      if (isStart) json.skipValue();
+    }
+  }
+  return token;
+}
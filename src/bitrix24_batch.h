@@ -0,0 +1,48 @@
+// Bitrix24 `batch` call: request body and streaming split of the response
+// A refresh cycle is packed into a single `batch` call: each sub-query is sent as
+// cmd[key]=method?params and the returned result map is fanned out to per-command readers.
+// No network here: the body goes into a QueryBuilder and the response comes from any
+// JsonStreamReader, so recorded responses can be replayed on a host.
+
+#ifndef BITRIX24_BATCH_H
+#define BITRIX24_BATCH_H
+
+#include <Arduino.h>
+#include "json_stream.h"
+#include "rest_query.h"
+
+// Each reader receives the tokens of one REST result and keeps only what it needs.
+// `base` is the path level of that result: 1 for "result" of a single call,
+// 3 for "result.result.<cmd>" inside a batch response.
+struct Bitrix24ResultReader {
+  virtual ~Bitrix24ResultReader() {}
+  virtual void feed(JsonStreamReader& json, JsonToken token, uint8_t base) = 0;
+};
+
+struct Bitrix24BatchCmd {
+  const char* key;               // Command name = key in result.result / result.result_total
+  const char* method;            // REST method
+  const char* params;            // Query string of the sub-request (in the refresh arena)
+  Bitrix24ResultReader* reader;  // Receives result.result.<key> (nullptr = count-only)
+  uint8_t counter;               // B24Counter this sub-query belongs to
+  uint16_t total;                // Filled from result.result_total.<key>
+  bool failed;                   // Listed in result.result_error
+};
+
+Bitrix24BatchCmd* b24BatchFind(Bitrix24BatchCmd* cmds, uint8_t count, const char* key);
+// result_total of command `key` (0 when there is no such command)
+uint16_t b24BatchTotal(Bitrix24BatchCmd* cmds, uint8_t count, const char* key);
+
+// Form body "halt=0&cmd[<key>]=<method>%3F<params>..." (sub-queries URL-encoded once more).
+// Returns false when it didn't fit (the builder is overflowed then).
+bool b24BatchBuildBody(QueryBuilder& body, const Bitrix24BatchCmd* cmds, uint8_t count);
+
+// Split a batch response: result.result.<key> goes to that command's reader,
+// result.result_total.<key> to its total, result.result_error.<key> marks it failed.
+// Results nobody reads (task stubs of count-only queries) are skipped without being stored.
+// Returns the last token (JSON_END when the whole body parsed); *hasResults = the
+// result.result map was present.
+JsonToken b24BatchRead(JsonStreamReader& json, Bitrix24BatchCmd* cmds, uint8_t count,
+                       bool* hasResults);
+
+#endif // BITRIX24_BATCH_H
@@ -0,0 +1,128 @@
+// Bitrix24 change digest implementation
+
+#include "bitrix24_digest.h"
+#include "bitrix24.h"
+
+// Global counters plus one line per group (the selected group may be outside the watch list)
+static const uint8_t DIGEST_SLOTS = 3 + BITRIX24_MAX_WATCHED_GROUPS + 1;
+// Group names are shortened so a full watch list still fits in one message
+static const size_t DIGEST_NAME_LEN = 40;
+
+struct DigestEntry {
+  uint32_t groupId;
+  uint16_t baseline;  // Value before the first change in this window
+  uint16_t latest;
+  B24DigestKind kind;
+  bool used;
+};
+
+static DigestEntry entries[DIGEST_SLOTS];
+static bool windowOpen = false;
+static unsigned long windowStart = 0;
+static bool sentOnce = false;
+static unsigned long lastSentAt = 0;
+
+void b24DigestNote(B24DigestKind kind, uint32_t groupId, uint16_t before, uint16_t after, unsigned long now) {
+  if (before == after) return;
+
+  int8_t slot = -1;
+  for (uint8_t i = 0; i < DIGEST_SLOTS; i++) {
+    if (entries[i].used && entries[i].kind == kind && entries[i].groupId == groupId) {
+      slot = i;
+      break;
+    }
+    if (!entries[i].used && slot < 0) slot = i;
+  }
+  if (slot < 0) {
+    Serial.println("Bitrix24: digest full, change dropped");
+    return;
+  }
+  if (!entries[slot].used) {
+    entries[slot] = {groupId, before, after, kind, true};
+  } else {
+    entries[slot].latest = after;
+  }
+  if (!windowOpen) {
+    windowOpen = true;
+    windowStart = now;
+  }
+}
+
+bool b24DigestDue(unsigned long now) {
+  if (!windowOpen || now - windowStart < BITRIX24_DIGEST_WINDOW) return false;
+  return !sentOnce || now - lastSentAt >= BITRIX24_DIGEST_MIN_INTERVAL;
+}
+
+// Cut at a UTF-8 character boundary (names are often Cyrillic)
+static void truncateUtf8(String& text, size_t maxLen) {
+  if (text.length() <= maxLen) return;
+  size_t cut = maxLen;
+  while (cut > 0 && (text[cut] & 0xC0) == 0x80) cut--;
+  text.remove(cut);
+  text += "…";
+}
+
+static String formatEntry(const DigestEntry& e) {
+  String line;
+  switch (e.kind) {
+    case B24_DIGEST_UNREAD:   line = "📨 <b>Unread Messages:</b> "; break;
+    case B24_DIGEST_TASKS:    line = "📋 <b>Undone Tasks:</b> "; break;
+    case B24_DIGEST_EXPIRED:
+    case B24_DIGEST_GROUP:    line = "⏰ <b>Expired Tasks:</b> "; break;
+  }
+  line += String(e.baseline);
+  line += " → ";
+  line += String(e.latest);
+  line += (e.latest > e.baseline) ? " ⬆️" : " ⬇️";
+
+  if (e.kind == B24_DIGEST_GROUP) {
+    String name = bitrixGetGroupName(e.groupId);
+    if (name.length() == 0) name = "#" + String(e.groupId);
+    truncateUtf8(name, DIGEST_NAME_LEN);
+    line += "\n     📁 ";
+    line += name;
+  }
+  return line;
+}
+
+String b24DigestTake(unsigned long now, size_t maxLen) {
+  // Room for the "+N more" tail
+  static const size_t TAIL_RESERVE = 16;
+
+  String msg;
+  uint8_t lines = 0;
+  uint8_t omitted = 0;
+  for (uint8_t i = 0; i < DIGEST_SLOTS; i++) {
+    DigestEntry& e = entries[i];
+    if (!e.used) continue;
+    // Back where it started: nothing to report
+    if (e.latest == e.baseline) {
+      e.used = false;
+      continue;
+    }
+
+    String line = formatEntry(e);
+    if (msg.length() + line.length() + 1 + TAIL_RESERVE > maxLen) {
+      // Kept for the next digest
+      omitted++;
+      continue;
+    }
+    e.used = false;
+    if (lines > 0) msg += "\n";
+    msg += line;
+    lines++;
+  }
+  if (omitted > 0) {
+    msg += "\n+";
+    msg += String(omitted);
+    msg += " more";
+  }
+
+  windowOpen = (omitted > 0);
+  windowStart = now;
+  if (lines > 0) {
+    sentOnce = true;
+    lastSentAt = now;
+  }
+  return msg;
+}
@@ -0,0 +1,36 @@
+// Bitrix24 change digest: counter changes are collected for a while and sent as one Telegram message
+// Only the Bitrix24 task notes changes and flushes, so no locking is needed.
+
+#ifndef BITRIX24_DIGEST_H
+#define BITRIX24_DIGEST_H
+
+#include <Arduino.h>
+
+// Changes are collected this long after the first one before the digest goes out (ms)
+#ifndef BITRIX24_DIGEST_WINDOW
+#define BITRIX24_DIGEST_WINDOW 30000UL
+#endif
+
+// At most one digest per this interval to the chat (ms); later changes wait for the next one
+#ifndef BITRIX24_DIGEST_MIN_INTERVAL
+#define BITRIX24_DIGEST_MIN_INTERVAL 60000UL
+#endif
+
+enum B24DigestKind : uint8_t {
+  B24_DIGEST_UNREAD = 0,   // Unread dialogs
+  B24_DIGEST_TASKS,        // Undone RPA tasks
+  B24_DIGEST_EXPIRED,      // Expired tasks (global)
+  B24_DIGEST_GROUP,        // Overdue tasks in one group (selected or watched)
+};
+
+// Record a counter change; the first value seen in a window is kept as the baseline
+void b24DigestNote(B24DigestKind kind, uint32_t groupId, uint16_t before, uint16_t after, unsigned long now);
+
+// True once the window has elapsed and the chat's rate limit allows another message
+bool b24DigestDue(unsigned long now);
+
+// Format the digest (baseline -> latest with a trend arrow, counters back at their baseline
+// are left out), fit it into maxLen bytes and start a new window. Empty when nothing is left.
+String b24DigestTake(unsigned long now, size_t maxLen);
+
+#endif // BITRIX24_DIGEST_H
@@ -0,0 +1,197 @@
+// Bitrix24 fleet mode implementation: multicast socket and the glue to the Bitrix24 task
+// (protocol in bitrix24_fleet_node.cpp)
+
+#include "bitrix24_fleet.h"
+#include "wifi_ap.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+bool bitrix24UseFleet = BITRIX24_FLEET_ENABLED;
+
+static portMUX_TYPE fleetMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t fleetTaskHandle = nullptr;
+
+// Shared with the Bitrix24 task (fleetMux)
+static B24FleetNode fleetNode;
+static uint32_t fleetKey = 0;
+static bool fleetJoined = false;
+
+static const char* roleName(B24FleetRole role) {
+  switch (role) {
+    case B24_FLEET_LISTEN: return "listening";
+    case B24_FLEET_CANDIDATE: return "candidate";
+    case B24_FLEET_FOLLOWER: return "follower";
+    case B24_FLEET_LEADER: return "leader";
+  }
+  return "?";
+}
+
+static uint32_t fleetNodeId() {
+  uint64_t mac = ESP.getEfuseMac();
+  uint32_t id = (uint32_t)mac ^ (uint32_t)(mac >> 32);
+  return id != 0 ? id : 1;
+}
+
+// Fleet task: multicast socket, frames in and out, and nudging the Bitrix24 task
+static void bitrix24FleetTask(void* parameter) {
+  Serial.println("[B24 FLEET] Started");
+  WiFiUDP udp;
+  IPAddress group;
+  group.fromString(BITRIX24_FLEET_GROUP);
+  const uint32_t nodeId = fleetNodeId();
+  B24FleetRole lastRole = B24_FLEET_LISTEN;
+  uint8_t frame[B24_FLEET_FRAME_LEN];
+
+  while (true) {
+    portENTER_CRITICAL(&fleetMux);
+    uint32_t key = fleetKey;
+    portEXIT_CRITICAL(&fleetMux);
+
+    if (isAPActive() || WiFi.status() != WL_CONNECTED || key == 0) {
+      if (fleetJoined) {
+        portENTER_CRITICAL(&fleetMux);
+        fleetJoined = false;
+        portEXIT_CRITICAL(&fleetMux);
+        udp.stop();
+        Serial.println("[B24 FLEET] Left the group");
+      }
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    if (!fleetJoined || fleetNode.fleetKey != key) {
+      if (!fleetJoined && !udp.beginMulticast(group, BITRIX24_FLEET_PORT)) {
+        Serial.println("[B24 FLEET] Joining the multicast group failed");
+        vTaskDelay(pdMS_TO_TICKS(5000));
+        continue;
+      }
+      // New fleet (or back on the network): listen for a leader before claiming
+      portENTER_CRITICAL(&fleetMux);
+      B24FleetCounts own = fleetNode.own;
+      bool keepOwn = fleetNode.fleetKey == key;
+      b24FleetNodeInit(fleetNode, key, nodeId, millis());
+      if (keepOwn) fleetNode.own = own;
+      fleetJoined = true;
+      portEXIT_CRITICAL(&fleetMux);
+      lastRole = B24_FLEET_LISTEN;
+      Serial.printf("[B24 FLEET] Joined %s:%u as node %08lx\n",
+                    BITRIX24_FLEET_GROUP, BITRIX24_FLEET_PORT, (unsigned long)nodeId);
+    }
+
+    int size;
+    while ((size = udp.parsePacket()) > 0) {
+      uint8_t in[B24_FLEET_FRAME_LEN + 1];
+      int n = udp.read(in, sizeof(in));
+      if (n <= 0) continue;
+      unsigned long now = millis();
+      portENTER_CRITICAL(&fleetMux);
+      b24FleetNodeReceive(fleetNode, in, (size_t)n, now);
+      portEXIT_CRITICAL(&fleetMux);
+    }
+
+    portENTER_CRITICAL(&fleetMux);
+    size_t len = b24FleetNodeTick(fleetNode, millis(), frame);
+    B24FleetRole role = fleetNode.role;
+    uint8_t sharedDue = fleetNode.sharedNew ? fleetNode.shared.mask : 0;
+    bool refresh = fleetNode.refreshWanted;
+    fleetNode.sharedNew = false;
+    fleetNode.refreshWanted = false;
+    portEXIT_CRITICAL(&fleetMux);
+
+    if (len > 0) {
+      udp.beginMulticastPacket();
+      udp.write(frame, len);
+      udp.endPacket();
+    }
+    if (role != lastRole) {
+      Serial.printf("[B24 FLEET] Now %s\n", roleName(role));
+      lastRole = role;
+    }
+    // New leader counts: let the Bitrix24 task pick them up (no REST request is made)
+    if (sharedDue != 0) bitrix24MarkCountersDue(sharedDue);
+    // A follower asked for fresh counts: poll them now as the leader
+    if (refresh) bitrix24MarkCountersDue(B24_FLEET_SHARED);
+
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
+}
+
+void startBitrix24FleetTask() {
+  if (!bitrix24UseFleet || fleetTaskHandle != nullptr) return;
+
+  xTaskCreatePinnedToCore(
+    bitrix24FleetTask,      // Task function
+    "Bitrix24Fleet",        // Task name
+    4096,                   // Stack size (UDP only)
+    NULL,                   // Parameters
+    1,                      // Priority
+    &fleetTaskHandle,       // Task handle
+    0                       // Core 0
+  );
+  Serial.println("Bitrix24 Fleet task created on core 0");
+}
+
+void bitrix24FleetSetKey(uint32_t key) {
+  portENTER_CRITICAL(&fleetMux);
+  fleetKey = key;
+  portEXIT_CRITICAL(&fleetMux);
+}
+
+uint8_t bitrix24FleetCoveredMask() {
+  if (!bitrix24UseFleet) return 0;
+  portENTER_CRITICAL(&fleetMux);
+  uint8_t mask = fleetJoined ? b24FleetNodeCovered(fleetNode) : 0;
+  portEXIT_CRITICAL(&fleetMux);
+  return mask;
+}
+
+void bitrix24FleetPublish(const Bitrix24Counts& counts, uint8_t mask) {
+  if (!bitrix24UseFleet) return;
+  B24FleetCounts own;
+  memset(&own, 0, sizeof(own));
+  own.mask = mask & B24_FLEET_SHARED;
+  if (own.mask & B24_MASK(B24_COUNTER_DIALOGS)) {
+    own.unreadMessages = counts.unreadMessages;
+    own.totalUnreadMessages = counts.totalUnreadMessages;
+  }
+  if (own.mask & B24_MASK(B24_COUNTER_RPA)) {
+    own.undoneTasks = counts.undoneTasks;
+  }
+  if (own.mask & B24_MASK(B24_COUNTER_EXPIRED)) {
+    own.expiredTasks = counts.expiredTasks;
+    own.totalComments = counts.totalComments;
+  }
+  portENTER_CRITICAL(&fleetMux);
+  b24FleetNodeSetCounts(fleetNode, own);
+  portEXIT_CRITICAL(&fleetMux);
+}
+
+uint8_t bitrix24FleetRead(Bitrix24Counts* out, uint8_t mask) {
+  portENTER_CRITICAL(&fleetMux);
+  B24FleetCounts shared = fleetNode.shared;
+  portEXIT_CRITICAL(&fleetMux);
+
+  mask &= shared.mask & B24_FLEET_SHARED;
+  if (mask & B24_MASK(B24_COUNTER_DIALOGS)) {
+    out->unreadMessages = shared.unreadMessages;
+    out->totalUnreadMessages = shared.totalUnreadMessages;
+  }
+  if (mask & B24_MASK(B24_COUNTER_RPA)) {
+    out->undoneTasks = shared.undoneTasks;
+  }
+  if (mask & B24_MASK(B24_COUNTER_EXPIRED)) {
+    out->expiredTasks = shared.expiredTasks;
+    out->totalComments = shared.totalComments;
+  }
+  return mask;
+}
+
+void bitrix24FleetRequestRefresh() {
+  if (!bitrix24UseFleet) return;
+  portENTER_CRITICAL(&fleetMux);
+  if (fleetNode.role == B24_FLEET_FOLLOWER) fleetNode.refreshAsked = true;
+  portEXIT_CRITICAL(&fleetMux);
+}
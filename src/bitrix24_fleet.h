@@ -0,0 +1,41 @@
+// Bitrix24 fleet mode: devices on the same webhook elect a leader over UDP multicast
+// Only the leader polls the counters every device shows alike and broadcasts them in a small
+// binary frame; followers render those. When the leader goes quiet a new one is elected, so
+// the portal sees one poller no matter how many devices are in the office.
+
+#ifndef BITRIX24_FLEET_H
+#define BITRIX24_FLEET_H
+
+#include <Arduino.h>
+#include "bitrix24.h"
+#include "bitrix24_fleet_node.h"
+
+// Off by default (build flag); can be toggled at runtime before the task starts
+#ifndef BITRIX24_FLEET_ENABLED
+#define BITRIX24_FLEET_ENABLED 0
+#endif
+
+// Multicast group and port (organization-local scope, stays inside the office LAN)
+#ifndef BITRIX24_FLEET_GROUP
+#define BITRIX24_FLEET_GROUP "239.255.24.24"
+#endif
+#ifndef BITRIX24_FLEET_PORT
+#define BITRIX24_FLEET_PORT 24024
+#endif
+
+extern bool bitrix24UseFleet;
+
+// Start the fleet task (no-op when fleet mode is disabled)
+void startBitrix24FleetTask();
+// Webhook changed: leave the old fleet and join the one of the new credentials
+void bitrix24FleetSetKey(uint32_t fleetKey);
+// Counters to take from the leader instead of polling (0 when fleet mode is off or leading)
+uint8_t bitrix24FleetCoveredMask();
+// After every refresh: this device's counts (`mask` = shared counters that are current)
+void bitrix24FleetPublish(const Bitrix24Counts& counts, uint8_t mask);
+// Copy the leader's counters in `mask` into `out`; returns the mask actually filled
+uint8_t bitrix24FleetRead(Bitrix24Counts* out, uint8_t mask);
+// Manual refresh on a follower: ask the leader to poll now
+void bitrix24FleetRequestRefresh();
+
+#endif // BITRIX24_FLEET_H
@@ -0,0 +1,244 @@
+// Bitrix24 fleet protocol implementation
+//
+// Frame (B24_FLEET_FRAME_LEN bytes, little-endian):
+//   0  'B' 'F'      magic
+//   2  version
+//   3  type         COUNTS (leader heartbeat), CLAIM (candidate), REFRESH (follower request)
+//   4  fleetKey     hash of the webhook, frames of other fleets are ignored
+//   8  nodeId
+//  12  rank         number of shared counters the sender has (better-informed nodes win)
+//  13  mask         counters present (COUNTS only)
+//  14  seq
+//  18  unreadMessages, totalUnreadMessages, undoneTasks, expiredTasks, totalComments
+//
+// Election: a node that hears no leader for BITRIX24_FLEET_TIMEOUT claims leadership for two
+// heartbeats and takes it unless a better claim (rank, then nodeId) or a leader shows up.
+// A running leader keeps its role against better claims, so the fleet doesn't flap; only
+// when two leaders meet (e.g. after a network split heals) the lower one steps down.
+
+#include "bitrix24_fleet_node.h"
+#include <string.h>
+
+enum : uint8_t {
+  FRAME_COUNTS = 1,
+  FRAME_CLAIM = 2,
+  FRAME_REFRESH = 3
+};
+
+static const uint8_t FRAME_VERSION = 1;
+static const unsigned long ELECTION_TIME = 2 * BITRIX24_FLEET_HEARTBEAT;
+
+struct FleetFrame {
+  uint8_t type;
+  uint32_t fleetKey;
+  uint32_t nodeId;
+  uint8_t rank;
+  B24FleetCounts counts;
+};
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  put16(p, (uint16_t)v);
+  put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint8_t rankOf(uint8_t mask) {
+  uint8_t rank = 0;
+  for (mask &= B24_FLEET_SHARED; mask; mask &= (uint8_t)(mask - 1)) rank++;
+  return rank;
+}
+
+// Higher rank wins, equal ranks are decided by the node ID
+static bool outranks(uint8_t rankA, uint32_t idA, uint8_t rankB, uint32_t idB) {
+  return rankA != rankB ? rankA > rankB : idA > idB;
+}
+
+static bool sameCounts(const B24FleetCounts& a, const B24FleetCounts& b) {
+  return a.mask == b.mask &&
+         a.unreadMessages == b.unreadMessages &&
+         a.totalUnreadMessages == b.totalUnreadMessages &&
+         a.undoneTasks == b.undoneTasks &&
+         a.expiredTasks == b.expiredTasks &&
+         a.totalComments == b.totalComments;
+}
+
+static size_t encodeFrame(const B24FleetNode& node, uint8_t type, uint8_t* out) {
+  memset(out, 0, B24_FLEET_FRAME_LEN);
+  out[0] = 'B';
+  out[1] = 'F';
+  out[2] = FRAME_VERSION;
+  out[3] = type;
+  put32(out + 4, node.fleetKey);
+  put32(out + 8, node.nodeId);
+  out[12] = rankOf(node.own.mask);
+  if (type == FRAME_COUNTS) {
+    out[13] = node.own.mask & B24_FLEET_SHARED;
+    put32(out + 14, node.own.seq);
+    put16(out + 18, node.own.unreadMessages);
+    put16(out + 20, node.own.totalUnreadMessages);
+    put16(out + 22, node.own.undoneTasks);
+    put16(out + 24, node.own.expiredTasks);
+    put16(out + 26, node.own.totalComments);
+  }
+  return B24_FLEET_FRAME_LEN;
+}
+
+static bool decodeFrame(const uint8_t* in, size_t len, FleetFrame* frame) {
+  if (len != B24_FLEET_FRAME_LEN || in[0] != 'B' || in[1] != 'F' || in[2] != FRAME_VERSION) {
+    return false;
+  }
+  frame->type = in[3];
+  if (frame->type < FRAME_COUNTS || frame->type > FRAME_REFRESH) return false;
+  frame->fleetKey = get32(in + 4);
+  frame->nodeId = get32(in + 8);
+  frame->rank = in[12];
+  frame->counts.mask = in[13] & B24_FLEET_SHARED;
+  frame->counts.seq = get32(in + 14);
+  frame->counts.unreadMessages = get16(in + 18);
+  frame->counts.totalUnreadMessages = get16(in + 20);
+  frame->counts.undoneTasks = get16(in + 22);
+  frame->counts.expiredTasks = get16(in + 24);
+  frame->counts.totalComments = get16(in + 26);
+  return true;
+}
+
+static void setRole(B24FleetNode& node, B24FleetRole role, unsigned long now) {
+  node.role = role;
+  node.roleSince = now;
+  node.sendNow = (role == B24_FLEET_CANDIDATE || role == B24_FLEET_LEADER);
+  if (role == B24_FLEET_LEADER) node.leaderId = node.nodeId;
+}
+
+static void follow(B24FleetNode& node, const FleetFrame& frame, unsigned long now) {
+  if (node.role != B24_FLEET_FOLLOWER || node.leaderId != frame.nodeId) {
+    setRole(node, B24_FLEET_FOLLOWER, now);
+    node.leaderId = frame.nodeId;
+  }
+  node.leaderRank = frame.rank;
+  node.lastLeaderFrame = now;
+  if (!sameCounts(node.shared, frame.counts)) node.sharedNew = true;
+  node.shared = frame.counts;
+}
+
+void b24FleetNodeInit(B24FleetNode& node, uint32_t fleetKey, uint32_t nodeId, unsigned long now) {
+  memset(&node, 0, sizeof(node));
+  node.fleetKey = fleetKey;
+  node.nodeId = nodeId;
+  setRole(node, B24_FLEET_LISTEN, now);
+}
+
+void b24FleetNodeReceive(B24FleetNode& node, const uint8_t* data, size_t len, unsigned long now) {
+  FleetFrame frame;
+  if (!decodeFrame(data, len, &frame) || frame.fleetKey != node.fleetKey ||
+      frame.nodeId == node.nodeId) {
+    return;
+  }
+  uint8_t rank = rankOf(node.own.mask);
+
+  switch (frame.type) {
+    case FRAME_COUNTS:
+      if (node.role == B24_FLEET_LEADER) {
+        if (!outranks(frame.rank, frame.nodeId, rank, node.nodeId)) {
+          node.sendNow = true;  // Let the other leader hear us and step down
+          return;
+        }
+      } else if (node.role == B24_FLEET_FOLLOWER && frame.nodeId != node.leaderId &&
+                 !outranks(frame.rank, frame.nodeId, node.leaderRank, node.leaderId)) {
+        return;  // Our leader is still the better one
+      }
+      follow(node, frame, now);
+      break;
+
+    case FRAME_CLAIM:
+      if (node.role == B24_FLEET_LEADER) {
+        node.sendNow = true;  // There is a leader already: tell the candidate right away
+      } else if (node.role == B24_FLEET_CANDIDATE &&
+                 outranks(frame.rank, frame.nodeId, rank, node.nodeId)) {
+        setRole(node, B24_FLEET_LISTEN, now);
+      }
+      break;
+
+    case FRAME_REFRESH:
+      if (node.role == B24_FLEET_LEADER &&
+          now - node.lastRefreshGranted >= BITRIX24_FLEET_REFRESH_MIN) {
+        node.refreshWanted = true;
+        node.lastRefreshGranted = now;
+      }
+      break;
+  }
+}
+
+size_t b24FleetNodeTick(B24FleetNode& node, unsigned long now, uint8_t* out) {
+  switch (node.role) {
+    case B24_FLEET_LISTEN:
+      if (now - node.roleSince >= BITRIX24_FLEET_TIMEOUT) {
+        setRole(node, B24_FLEET_CANDIDATE, now);
+      }
+      break;
+    case B24_FLEET_CANDIDATE:
+      if (now - node.roleSince >= ELECTION_TIME) {
+        setRole(node, B24_FLEET_LEADER, now);
+      } else if (now - node.lastSent >= BITRIX24_FLEET_HEARTBEAT) {
+        node.sendNow = true;
+      }
+      break;
+    case B24_FLEET_FOLLOWER:
+      if (now - node.lastLeaderFrame >= BITRIX24_FLEET_TIMEOUT) {
+        setRole(node, B24_FLEET_CANDIDATE, now);
+      }
+      break;
+    case B24_FLEET_LEADER:
+      if (now - node.lastSent >= BITRIX24_FLEET_HEARTBEAT) node.sendNow = true;
+      break;
+  }
+
+  uint8_t type = 0;
+  if (node.role == B24_FLEET_LEADER && node.sendNow) {
+    type = FRAME_COUNTS;
+  } else if (node.role == B24_FLEET_CANDIDATE && node.sendNow) {
+    type = FRAME_CLAIM;
+  } else if (node.role == B24_FLEET_FOLLOWER && node.refreshAsked) {
+    type = FRAME_REFRESH;
+  }
+  node.refreshAsked = false;
+  if (type == 0) return 0;
+
+  node.sendNow = false;
+  node.lastSent = now;
+  return encodeFrame(node, type, out);
+}
+
+void b24FleetNodeSetCounts(B24FleetNode& node, const B24FleetCounts& counts) {
+  if (sameCounts(node.own, counts)) return;
+  uint32_t seq = node.own.seq;
+  node.own = counts;
+  node.own.mask &= B24_FLEET_SHARED;
+  node.own.seq = seq + 1;
+  if (node.role == B24_FLEET_LEADER) node.sendNow = true;
+}
+
+uint8_t b24FleetNodeCovered(const B24FleetNode& node) {
+  switch (node.role) {
+    case B24_FLEET_FOLLOWER:
+      return node.shared.mask & B24_FLEET_SHARED;
+    case B24_FLEET_LISTEN:
+    case B24_FLEET_CANDIDATE:
+      // Hold off while the election runs: a leader is about to poll (or it is us), and
+      // a booting fleet shouldn't hit the portal from every device at once
+      return B24_FLEET_SHARED;
+    default:
+      return 0;
+  }
+}
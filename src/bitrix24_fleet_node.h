@@ -0,0 +1,80 @@
+// Bitrix24 fleet protocol: frames, leader election and counter sharing of one device
+// Pure state machine (time is passed in, frames go through buffers), so several nodes can
+// run against each other on a host; bitrix24_fleet.cpp drives it over UDP multicast.
+
+#ifndef BITRIX24_FLEET_NODE_H
+#define BITRIX24_FLEET_NODE_H
+
+#include <Arduino.h>
+#include "bitrix24_scheduler.h"
+
+// Leader frame interval and how long followers wait before electing a new leader (ms)
+#ifndef BITRIX24_FLEET_HEARTBEAT
+#define BITRIX24_FLEET_HEARTBEAT 2000UL
+#endif
+#ifndef BITRIX24_FLEET_TIMEOUT
+#define BITRIX24_FLEET_TIMEOUT 7000UL
+#endif
+
+// A follower's manual refresh makes the leader poll at most this often (ms)
+#ifndef BITRIX24_FLEET_REFRESH_MIN
+#define BITRIX24_FLEET_REFRESH_MIN 5000UL
+#endif
+
+// Counters that are the same on every device of one webhook user. Group counters depend on
+// each device's own selection and are always polled locally.
+#define B24_FLEET_SHARED \
+  (B24_MASK(B24_COUNTER_DIALOGS) | B24_MASK(B24_COUNTER_RPA) | B24_MASK(B24_COUNTER_EXPIRED))
+
+// Every frame has the same fixed size
+#define B24_FLEET_FRAME_LEN 28
+
+enum B24FleetRole : uint8_t {
+  B24_FLEET_LISTEN = 0,  // Waiting to hear a leader (boot, or a better claim was heard)
+  B24_FLEET_CANDIDATE,   // Claiming leadership
+  B24_FLEET_FOLLOWER,
+  B24_FLEET_LEADER
+};
+
+// Shared counters carried by a leader frame
+struct B24FleetCounts {
+  uint32_t seq;                  // Changes with every new set of counts
+  uint8_t mask;                  // Counters present (B24_MASK bits within B24_FLEET_SHARED)
+  uint16_t unreadMessages;
+  uint16_t totalUnreadMessages;
+  uint16_t undoneTasks;
+  uint16_t expiredTasks;
+  uint16_t totalComments;        // Global "All your tasks" (only with the EXPIRED bit)
+};
+
+// Protocol state of one device
+struct B24FleetNode {
+  uint32_t fleetKey;             // Hash of the webhook; other fleets' frames are ignored
+  uint32_t nodeId;
+  B24FleetRole role;
+  uint32_t leaderId;             // Followed leader (0 = none)
+  uint8_t leaderRank;
+  unsigned long roleSince;
+  unsigned long lastLeaderFrame;
+  unsigned long lastSent;
+  bool sendNow;                  // Send at the next tick (new counts, answer a claim)
+  B24FleetCounts own;            // This device's counts (sent while leader)
+  B24FleetCounts shared;         // Latest counts from the leader
+  bool sharedNew;                // shared changed since the device glue last looked
+  bool refreshWanted;            // Leader: a follower asked for a refresh
+  bool refreshAsked;             // Follower: send a refresh request at the next tick
+  unsigned long lastRefreshGranted;
+};
+
+void b24FleetNodeInit(B24FleetNode& node, uint32_t fleetKey, uint32_t nodeId, unsigned long now);
+// Handle one received datagram (other fleets, own echoes and garbage are ignored)
+void b24FleetNodeReceive(B24FleetNode& node, const uint8_t* frame, size_t len, unsigned long now);
+// Advance timers; writes at most one frame into `out` (B24_FLEET_FRAME_LEN bytes) and
+// returns its length, 0 when there is nothing to send
+size_t b24FleetNodeTick(B24FleetNode& node, unsigned long now, uint8_t* out);
+// This device's latest counts (sent while leader; a node sharing more counters ranks higher)
+void b24FleetNodeSetCounts(B24FleetNode& node, const B24FleetCounts& counts);
+// Counters this node leaves to the leader right now (0 = poll everything itself)
+uint8_t b24FleetNodeCovered(const B24FleetNode& node);
+
+#endif // BITRIX24_FLEET_NODE_H
@@ -0,0 +1,168 @@
+// Bitrix24 group metadata cache implementation
+// Read from the UI loop, Telegram and Bitrix24 tasks; only the Bitrix24 task writes (and saves).
+
+#include "bitrix24_group_cache.h"
+#include "storage.h"
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+
+static const uint8_t WANT_QUEUE_LEN = 4;
+
+static portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+
+static B24GroupEntry entries[BITRIX24_GROUP_CACHE_SIZE];
+// Recency for LRU eviction (RAM only; restored from lastSeen order at load)
+static uint32_t useTick[BITRIX24_GROUP_CACHE_SIZE];
+static uint32_t tickCounter = 0;
+// Name confirmed by the portal since boot (restored names are re-checked once)
+static bool confirmed[BITRIX24_GROUP_CACHE_SIZE];
+
+static uint32_t wanted[WANT_QUEUE_LEN];
+
+static int8_t findEntry(uint32_t groupId) {
+  for (uint8_t i = 0; i < BITRIX24_GROUP_CACHE_SIZE; i++) {
+    if (entries[i].id == groupId) return i;
+  }
+  return -1;
+}
+
+void b24GroupCacheLoad() {
+  B24GroupEntry loaded[BITRIX24_GROUP_CACHE_SIZE];
+  if (loadBitrix24GroupCache(loaded, sizeof(loaded)) != sizeof(loaded)) {
+    return;
+  }
+
+  uint8_t count = 0;
+  portENTER_CRITICAL(&cacheMux);
+  memcpy(entries, loaded, sizeof(entries));
+  for (uint8_t i = 0; i < BITRIX24_GROUP_CACHE_SIZE; i++) {
+    entries[i].name[BITRIX24_GROUP_NAME_LEN - 1] = '\0';
+    // Older confirmations rank as less recently used
+    uint8_t rank = 0;
+    for (uint8_t j = 0; j < BITRIX24_GROUP_CACHE_SIZE; j++) {
+      if (entries[j].lastSeen < entries[i].lastSeen) rank++;
+    }
+    useTick[i] = rank;
+    if (entries[i].id != 0) count++;
+  }
+  tickCounter = BITRIX24_GROUP_CACHE_SIZE;
+  portEXIT_CRITICAL(&cacheMux);
+
+  Serial.print("Bitrix24: Loaded ");
+  Serial.print(count);
+  Serial.println(" group names from NVS");
+}
+
+bool b24GroupCacheGet(uint32_t groupId, char* out, size_t outLen, uint32_t nowEpoch) {
+  if (groupId == 0 || outLen == 0) return false;
+
+  bool found = false;
+  bool stale = true;
+  portENTER_CRITICAL(&cacheMux);
+  int8_t i = findEntry(groupId);
+  if (i >= 0) {
+    strncpy(out, entries[i].name, outLen - 1);
+    out[outLen - 1] = '\0';
+    useTick[i] = ++tickCounter;
+    found = true;
+    stale = !confirmed[i] ||
+            (nowEpoch != 0 && entries[i].lastSeen != 0 && nowEpoch - entries[i].lastSeen > BITRIX24_GROUP_NAME_TTL);
+  }
+  portEXIT_CRITICAL(&cacheMux);
+
+  if (stale) {
+    b24GroupCacheWant(groupId);
+  }
+  return found;
+}
+
+void b24GroupCachePut(uint32_t groupId, const char* name, uint32_t nowEpoch) {
+  if (groupId == 0 || name == nullptr) return;
+
+  bool changed = false;
+  portENTER_CRITICAL(&cacheMux);
+  int8_t slot = findEntry(groupId);
+  if (slot < 0) {
+    // Empty slot first, otherwise the least recently used
+    slot = 0;
+    for (uint8_t i = 0; i < BITRIX24_GROUP_CACHE_SIZE; i++) {
+      if (entries[i].id == 0) {
+        slot = i;
+        break;
+      }
+      if (useTick[i] < useTick[slot]) slot = i;
+    }
+    entries[slot].id = groupId;
+    entries[slot].lastSeen = 0;
+    entries[slot].name[0] = '\0';
+    changed = true;
+  }
+  if (strncmp(entries[slot].name, name, BITRIX24_GROUP_NAME_LEN - 1) != 0) {
+    strncpy(entries[slot].name, name, BITRIX24_GROUP_NAME_LEN - 1);
+    entries[slot].name[BITRIX24_GROUP_NAME_LEN - 1] = '\0';
+    changed = true;
+  }
+  // A fresher confirmation date alone is saved only once the stored one has expired
+  if (nowEpoch != 0) {
+    if (entries[slot].lastSeen == 0 || nowEpoch - entries[slot].lastSeen > BITRIX24_GROUP_NAME_TTL) {
+      changed = true;
+    }
+    entries[slot].lastSeen = nowEpoch;
+  }
+  confirmed[slot] = true;
+  useTick[slot] = ++tickCounter;
+
+  B24GroupEntry snapshot[BITRIX24_GROUP_CACHE_SIZE];
+  if (changed) {
+    memcpy(snapshot, entries, sizeof(snapshot));
+  }
+  portEXIT_CRITICAL(&cacheMux);
+
+  if (changed) {
+    saveBitrix24GroupCache(snapshot, sizeof(snapshot));
+  }
+}
+
+bool b24GroupCacheWant(uint32_t groupId) {
+  if (groupId == 0) return false;
+  bool queued = false;
+  portENTER_CRITICAL(&cacheMux);
+  int8_t freeSlot = -1;
+  bool present = false;
+  for (uint8_t i = 0; i < WANT_QUEUE_LEN; i++) {
+    if (wanted[i] == groupId) present = true;
+    if (wanted[i] == 0 && freeSlot < 0) freeSlot = i;
+  }
+  if (!present && freeSlot >= 0) {
+    wanted[freeSlot] = groupId;
+    queued = true;
+  }
+  portEXIT_CRITICAL(&cacheMux);
+  return queued;
+}
+
+uint32_t b24GroupCacheTakeWanted() {
+  uint32_t groupId = 0;
+  portENTER_CRITICAL(&cacheMux);
+  for (uint8_t i = 0; i < WANT_QUEUE_LEN; i++) {
+    if (wanted[i] != 0) {
+      groupId = wanted[i];
+      wanted[i] = 0;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&cacheMux);
+  return groupId;
+}
+
+void b24GroupCacheClear() {
+  portENTER_CRITICAL(&cacheMux);
+  memset(entries, 0, sizeof(entries));
+  memset(useTick, 0, sizeof(useTick));
+  memset(confirmed, 0, sizeof(confirmed));
+  memset(wanted, 0, sizeof(wanted));
+  B24GroupEntry snapshot[BITRIX24_GROUP_CACHE_SIZE];
+  memcpy(snapshot, entries, sizeof(snapshot));
+  portEXIT_CRITICAL(&cacheMux);
+  saveBitrix24GroupCache(snapshot, sizeof(snapshot));
+}
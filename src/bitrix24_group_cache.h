@@ -0,0 +1,46 @@
+// Bitrix24 group metadata cache: small LRU in RAM, persisted to NVS
+// Readers never touch the network; missing or stale names are queued for the Bitrix24 task.
+
+#ifndef BITRIX24_GROUP_CACHE_H
+#define BITRIX24_GROUP_CACHE_H
+
+#include <Arduino.h>
+
+#ifndef BITRIX24_GROUP_CACHE_SIZE
+#define BITRIX24_GROUP_CACHE_SIZE 8
+#endif
+
+// Names are re-read from the portal after this long (seconds; renames are rare)
+#ifndef BITRIX24_GROUP_NAME_TTL
+#define BITRIX24_GROUP_NAME_TTL 86400UL
+#endif
+
+// UTF-8 bytes kept per name (Cyrillic takes 2 bytes per letter)
+#define BITRIX24_GROUP_NAME_LEN 96
+
+struct B24GroupEntry {
+  uint32_t id;                          // 0 = empty slot
+  uint32_t lastSeen;                    // UTC epoch of the last portal confirmation (0 if unknown)
+  char name[BITRIX24_GROUP_NAME_LEN];
+};
+
+// Restore entries from NVS (call once at startup)
+void b24GroupCacheLoad();
+
+// Copy the cached name (marks the entry recently used). Returns false when unknown.
+// A stale name is still returned; both cases queue a background fetch (see below).
+bool b24GroupCacheGet(uint32_t groupId, char* out, size_t outLen, uint32_t nowEpoch);
+
+// Store a name fetched from the portal; evicts the least recently used entry when full.
+// Persists to NVS only when the set of names changed.
+void b24GroupCachePut(uint32_t groupId, const char* name, uint32_t nowEpoch);
+
+// Background fetch queue: Want() returns true if the id was newly queued,
+// TakeWanted() returns the next id to fetch (0 if none)
+bool b24GroupCacheWant(uint32_t groupId);
+uint32_t b24GroupCacheTakeWanted();
+
+// Drop everything (e.g. new portal credentials)
+void b24GroupCacheClear();
+
+#endif // BITRIX24_GROUP_CACHE_H
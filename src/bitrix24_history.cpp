@@ -0,0 +1,176 @@
+// Bitrix24 counter history implementation
+// Sample n lives in block (n / BLOCK_LEN) % BLOCKS at offset n % BLOCK_LEN. Each block keeps the
+// absolute value of its first sample and the maximum of all its samples, so a reader only decodes
+// deltas for the blocks a bucket boundary cuts through.
+// Guarded by a mutex rather than a critical section: a gap fill pushes up to a full ring of
+// samples and a long read decodes many of them, too long to hold interrupts off.
+
+#include "bitrix24_history.h"
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// The current block is partial, so one block more than the hours kept
+static const uint16_t BLOCKS = BITRIX24_HISTORY_HOURS + 1;
+
+struct HistoryBlock {
+  uint16_t base[B24_SERIES_COUNT];                    // First sample of the block
+  uint16_t peak[B24_SERIES_COUNT];                    // Largest sample in the block
+  int8_t delta[B24_HISTORY_BLOCK_LEN][B24_SERIES_COUNT];  // Change from the previous sample (delta[0] unused)
+};
+
+static StaticSemaphore_t historyLockBuffer;
+
+static HistoryBlock blocks[BLOCKS];
+static uint32_t total = 0;        // Samples appended since the last clear
+static uint32_t lastMinute = 0;
+// Decoded value of the latest sample (what the next delta is taken against)
+static uint16_t lastValue[B24_SERIES_COUNT];
+
+static SemaphoreHandle_t historyLock() {
+  static SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&historyLockBuffer);
+  return lock;
+}
+
+static void lock() {
+  xSemaphoreTake(historyLock(), portMAX_DELAY);
+}
+
+static void unlock() {
+  xSemaphoreGive(historyLock());
+}
+
+// Index of the oldest sample still held (callers hold the lock)
+static uint32_t firstSample() {
+  if (total == 0) return 0;
+  uint32_t lastBlock = (total - 1) / B24_HISTORY_BLOCK_LEN;
+  if (lastBlock < BLOCKS - 1) return 0;
+  return (lastBlock - (BLOCKS - 1)) * B24_HISTORY_BLOCK_LEN;
+}
+
+static HistoryBlock& blockOf(uint32_t n) {
+  return blocks[(n / B24_HISTORY_BLOCK_LEN) % BLOCKS];
+}
+
+// Decode sample n (must be held)
+static uint16_t valueAt(B24Series series, uint32_t n) {
+  const HistoryBlock& b = blockOf(n);
+  int32_t v = b.base[series];
+  for (uint32_t off = 1; off <= n % B24_HISTORY_BLOCK_LEN; off++) {
+    v += b.delta[off][series];
+  }
+  return (uint16_t)v;
+}
+
+static void push(const uint16_t values[B24_SERIES_COUNT]) {
+  HistoryBlock& b = blockOf(total);
+  uint32_t off = total % B24_HISTORY_BLOCK_LEN;
+  for (uint8_t s = 0; s < B24_SERIES_COUNT; s++) {
+    if (off == 0) {
+      b.base[s] = values[s];
+      b.peak[s] = values[s];
+      b.delta[0][s] = 0;
+      lastValue[s] = values[s];
+      continue;
+    }
+    int32_t d = (int32_t)values[s] - lastValue[s];
+    if (d > 127) d = 127;
+    if (d < -127) d = -127;
+    b.delta[off][s] = (int8_t)d;
+    lastValue[s] = (uint16_t)(lastValue[s] + d);
+    if (lastValue[s] > b.peak[s]) b.peak[s] = lastValue[s];
+  }
+  total++;
+}
+
+void b24HistoryAppend(const uint16_t values[B24_SERIES_COUNT], uint32_t minute) {
+  lock();
+  if (total > 0) {
+    if (minute <= lastMinute) {
+      unlock();
+      return;
+    }
+    uint32_t gap = minute - lastMinute - 1;
+    if (gap >= (uint32_t)BLOCKS * B24_HISTORY_BLOCK_LEN) {
+      // Everything held would be overwritten by the repeated value anyway
+      total = 0;
+    } else {
+      uint16_t held[B24_SERIES_COUNT];
+      memcpy(held, lastValue, sizeof(held));
+      for (uint32_t i = 0; i < gap; i++) {
+        push(held);
+      }
+    }
+  }
+  push(values);
+  lastMinute = minute;
+  unlock();
+}
+
+uint32_t b24HistoryLength() {
+  lock();
+  uint32_t length = total - firstSample();
+  unlock();
+  return length;
+}
+
+uint16_t b24HistoryRead(B24Series series, uint32_t spanMinutes, uint16_t* out, uint16_t points) {
+  if (series >= B24_SERIES_COUNT || points == 0) return 0;
+
+  lock();
+  uint32_t available = total - firstSample();
+  uint32_t span = (spanMinutes < available) ? spanMinutes : available;
+  if (span == 0) {
+    unlock();
+    return 0;
+  }
+  if (points > span) points = (uint16_t)span;
+
+  uint32_t start = total - span;
+  uint32_t n = start;
+  // Value of the sample before `start` within its block, so the walk can add deltas
+  uint16_t value = (n % B24_HISTORY_BLOCK_LEN != 0) ? valueAt(series, n - 1) : 0;
+  uint16_t written = 0;
+  uint32_t bucketEnd = start + span / points;
+  uint16_t bucketPeak = 0;
+
+  while (n < total) {
+    const HistoryBlock& b = blockOf(n);
+    uint32_t off = n % B24_HISTORY_BLOCK_LEN;
+    if (off == 0 && n + B24_HISTORY_BLOCK_LEN <= bucketEnd) {
+      // Whole block inside the bucket: its peak is enough
+      if (b.peak[series] > bucketPeak) bucketPeak = b.peak[series];
+      n += B24_HISTORY_BLOCK_LEN;
+    } else {
+      value = (off == 0) ? b.base[series] : (uint16_t)(value + b.delta[off][series]);
+      if (value > bucketPeak) bucketPeak = value;
+      n++;
+    }
+    while (n >= bucketEnd && written < points) {
+      out[written++] = bucketPeak;
+      bucketPeak = 0;
+      bucketEnd = start + (uint32_t)((uint64_t)span * (written + 1) / points);
+    }
+  }
+  unlock();
+  return written;
+}
+
+bool b24HistoryAt(B24Series series, uint32_t minutesAgo, uint16_t* value) {
+  if (series >= B24_SERIES_COUNT || value == nullptr) return false;
+  bool ok = false;
+  lock();
+  if (minutesAgo < total - firstSample()) {
+    *value = valueAt(series, total - 1 - minutesAgo);
+    ok = true;
+  }
+  unlock();
+  return ok;
+}
+
+void b24HistoryClear() {
+  lock();
+  total = 0;
+  lastMinute = 0;
+  unlock();
+}
@@ -0,0 +1,42 @@
+// Bitrix24 counter history: one sample per minute in a fixed-size, delta-encoded ring
+// Appended by the Bitrix24 task; read by the UI (sparklines) and the Telegram task (/trend).
+
+#ifndef BITRIX24_HISTORY_H
+#define BITRIX24_HISTORY_H
+
+#include <Arduino.h>
+
+// Hours of history kept (RAM: 256 bytes per hour plus one partial hour)
+#ifndef BITRIX24_HISTORY_HOURS
+#define BITRIX24_HISTORY_HOURS 24
+#endif
+
+// Samples per block: one absolute value, then one signed byte per minute
+#define B24_HISTORY_BLOCK_LEN 60
+
+enum B24Series : uint8_t {
+  B24_SERIES_UNREAD = 0,   // Unread dialogs
+  B24_SERIES_TASKS,        // Undone RPA tasks
+  B24_SERIES_EXPIRED,      // Expired tasks (global)
+  B24_SERIES_GROUP,        // Overdue tasks in the selected group
+  B24_SERIES_COUNT
+};
+
+// Record the counters for `minute` (any monotonic minute number, e.g. millis() / 60000).
+// Repeated minutes are ignored; skipped minutes repeat the previous sample.
+// A jump of more than 127 in one minute is spread over the following samples.
+void b24HistoryAppend(const uint16_t values[B24_SERIES_COUNT], uint32_t minute);
+
+// Minutes of history available (capped at the ring size)
+uint32_t b24HistoryLength();
+
+// Downsample the last `spanMinutes` into up to `points` buckets (maximum of each bucket,
+// oldest first). Returns the number of points written (fewer when history is shorter).
+uint16_t b24HistoryRead(B24Series series, uint32_t spanMinutes, uint16_t* out, uint16_t points);
+
+// Value `minutesAgo` minutes before the latest sample; false when out of range
+bool b24HistoryAt(B24Series series, uint32_t minutesAgo, uint16_t* value);
+
+void b24HistoryClear();
+
+#endif // BITRIX24_HISTORY_H
@@ -0,0 +1,142 @@
+// Bitrix24 Push & Pull long-poll client implementation
+//
+// 1. pull.application.config.get (REST, via the webhook) returns the long-poll server
+//    and the user's private/shared channel IDs.
+// 2. GET <server>?CHANNEL_ID=<private>/<shared>&mid=<last message id> is held open by
+//    the server until events arrive (HTTP 200) or it times out (HTTP 304).
+// 3. The 200 body is a sequence of #!NGINXNMS!#{json}#!NGINXNME!# frames; each event's
+//    text.module_id / text.command marks the affected counters due in the Bitrix24 task.
+// While the channel is healthy, polling of the covered counters drops to a slow
+// consistency sweep; on errors the channel backs off and normal polling resumes.
+// The protocol side lives in bitrix24_pull_client.cpp; this file is the device transport.
+
+#include "bitrix24_pull.h"
+#include "bitrix24_pull_client.h"
+#include "bitrix24.h"
+#include "bitrix24_scheduler.h"
+#include "bitrix24_queue.h"
+#include "http_body.h"
+#include "http_pool.h"
+#include "wifi_ap.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+bool bitrix24UsePull = BITRIX24_PULL_ENABLED;
+
+static TaskHandle_t pullTaskHandle = nullptr;
+
+// Client state (owned by the Pull task)
+static B24PullClient pull;
+// Mirrors pull.connected for other tasks: healthy channel = last long poll was 200 or 304
+static volatile bool pullConnected = false;
+
+uint8_t bitrix24PullCoveredMask() {
+  // Only chat counters are fully event-driven; task counters also change when a
+  // deadline passes (no event), so they stay on their normal cadence
+  return pullConnected ? B24_MASK(B24_COUNTER_DIALOGS) : 0;
+}
+
+// Read one byte from the long-poll socket; -1 when the server closed the connection
+// or nothing arrived within BITRIX24_PULL_TIMEOUT
+static int readPullByte(WiFiClient& client) {
+  unsigned long start = millis();
+  while (client.available() <= 0) {
+    if (!client.connected() || millis() - start > BITRIX24_PULL_TIMEOUT) {
+      return -1;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  return client.read();
+}
+
+// The long-poll body as a Stream for b24PullClientReadEvents(): ends when the server
+// closes the connection or goes quiet for BITRIX24_PULL_TIMEOUT
+class PullSocketStream : public Stream {
+public:
+  explicit PullSocketStream(WiFiClient& c) : client(c) { setTimeout(0); }
+  int available() override { return 1; }
+  int read() override { return readPullByte(client); }
+  int peek() override { return client.peek(); }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  WiFiClient& client;
+};
+
+// pull.application.config.get over the REST webhook
+static bool fetchPullConfig(B24PullConfig* config) {
+  HTTPClient* http = bitrix24Begin("pull.application.config.get");
+  if (http == nullptr) {
+    return false;
+  }
+  HttpBodyStream response(*http);
+  bool ok = b24PullParseConfig(response, BITRIX24_PULL_URL, config);
+  bitrix24End(http, response, !response.failed());
+  return ok;
+}
+
+// One long poll on a long-poll pool slot (its TLS context is held for the whole poll)
+static int pullGet(const char* url, B24PullClient& client) {
+  HTTPClient* http = httpPoolBeginLongPoll(url);
+  if (http == nullptr) {
+    return -1;
+  }
+  // HTTP/1.0: body is the raw frame sequence until the server closes the connection
+  http->useHTTP10(true);
+  http->setTimeout(BITRIX24_PULL_TIMEOUT);
+  // No round-trip sample: the server holds the headers back until an event or its timeout
+  int httpCode = http->GET();
+  if (httpCode == 200) {
+    PullSocketStream body(http->getStream());
+    b24PullClientReadEvents(client, body);
+  }
+  httpPoolEnd(http, false);
+  return httpCode;
+}
+
+// Pull task: keeps one long-poll request open at a time
+static void bitrix24PullTask(void* parameter) {
+  Serial.println("[B24 PULL] Started");
+  b24QueueSetTaskPriority(B24_PRIO_BACKGROUND);
+  b24PullClientInit(pull);
+
+  while (true) {
+    if (isAPActive() || WiFi.status() != WL_CONNECTED) {
+      b24PullClientDisconnect(pull);
+      pullConnected = false;
+      vTaskDelay(pdMS_TO_TICKS(5000));
+      continue;
+    }
+
+    uint8_t due;
+    unsigned long wait = b24PullClientStep(pull, fetchPullConfig, pullGet, millis(),
+                                           esp_random(), &due);
+    pullConnected = pull.connected;
+    if (due != 0) {
+      Serial.print("Bitrix24 Pull: event -> counters 0x");
+      Serial.println(due, HEX);
+      bitrix24MarkCountersDue(due);
+    }
+    if (wait > 0) {
+      vTaskDelay(pdMS_TO_TICKS(wait));
+    }
+  }
+}
+
+void startBitrix24PullTask() {
+  if (!bitrix24UsePull || pullTaskHandle != nullptr) return;
+
+  xTaskCreatePinnedToCore(
+    bitrix24PullTask,       // Task function
+    "Bitrix24Pull",         // Task name
+    8192,                   // Stack size (TLS + parser)
+    NULL,                   // Parameters
+    1,                      // Priority (blocks on the long-poll socket almost all the time)
+    &pullTaskHandle,        // Task handle
+    0                       // Core 0
+  );
+  Serial.println("Bitrix24 Pull task created on core 0");
+}
@@ -0,0 +1,32 @@
+// Bitrix24 Push & Pull long-poll client (event-driven counter refresh)
+
+#ifndef BITRIX24_PULL_H
+#define BITRIX24_PULL_H
+
+#include <Arduino.h>
+
+// Enable Pull mode by default (build flag); can be toggled at runtime before the task starts
+#ifndef BITRIX24_PULL_ENABLED
+#define BITRIX24_PULL_ENABLED 0
+#endif
+
+// Optional long-poll URL override (e.g. "http://192.168.1.10:8080/sub/" for a local
+// stand-in server); empty = use the server returned by pull.application.config.get
+#ifndef BITRIX24_PULL_URL
+#define BITRIX24_PULL_URL ""
+#endif
+
+// How long the server may hold a long-poll request open (ms, fits HTTPClient's uint16_t timeout)
+#ifndef BITRIX24_PULL_TIMEOUT
+#define BITRIX24_PULL_TIMEOUT 45000
+#endif
+
+extern bool bitrix24UsePull;
+
+// Start the long-poll task (no-op when Pull mode is disabled)
+void startBitrix24PullTask();
+
+// Counters kept fresh by push events while the channel is healthy (0 = poll normally)
+uint8_t bitrix24PullCoveredMask();
+
+#endif // BITRIX24_PULL_H
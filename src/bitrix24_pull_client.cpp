@@ -0,0 +1,111 @@
+// Bitrix24 Pull client state machine implementation
+
+#include "bitrix24_pull_client.h"
+#include "bitrix24_scheduler.h"
+#include "json_stream.h"
+#include <string.h>
+
+static void copyText(char* out, size_t outLen, const char* text) {
+  strncpy(out, text, outLen - 1);
+  out[outLen - 1] = '\0';
+}
+
+void b24PullClientInit(B24PullClient& client) {
+  memset(&client, 0, sizeof(client));
+}
+
+bool b24PullParseConfig(Stream& body, const char* overrideUrl, B24PullConfig* config) {
+  char server[sizeof(config->server)] = "";
+  char serverSecure[sizeof(config->server)] = "";
+  memset(config, 0, sizeof(*config));
+
+  JsonStreamReader json(body);
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token != JSON_STRING) continue;
+    if (json.matches("result.server.long_polling")) {
+      copyText(server, sizeof(server), json.text());
+    } else if (json.matches("result.server.long_pooling_secure") ||
+               json.matches("result.server.long_polling_secure")) {
+      copyText(serverSecure, sizeof(serverSecure), json.text());
+    } else if (json.matches("result.channels.private.id")) {
+      copyText(config->channelPrivate, sizeof(config->channelPrivate), json.text());
+    } else if (json.matches("result.channels.shared.id")) {
+      copyText(config->channelShared, sizeof(config->channelShared), json.text());
+    }
+  }
+
+  const char* url = (overrideUrl != nullptr && overrideUrl[0] != '\0') ? overrideUrl
+                  : (serverSecure[0] != '\0' ? serverSecure : server);
+  copyText(config->server, sizeof(config->server), url);
+  return token == JSON_END && config->server[0] != '\0' && config->channelPrivate[0] != '\0';
+}
+
+bool b24PullClientUrl(const B24PullClient& client, QueryBuilder& url) {
+  url.raw(client.config.server).raw("?CHANNEL_ID=").raw(client.config.channelPrivate);
+  if (client.config.channelShared[0] != '\0') {
+    url.raw('/').raw(client.config.channelShared);
+  }
+  if (client.lastMid[0] != '\0') {
+    url.param("mid", client.lastMid);
+  }
+  return url.ok();
+}
+
+void b24PullClientReadEvents(B24PullClient& client, Stream& body) {
+  bool configExpired = false;
+  client.counters |= b24PullReadFrames(body, client.lastMid, &configExpired);
+  if (configExpired) {
+    client.configValid = false;
+  }
+}
+
+void b24PullClientDisconnect(B24PullClient& client) {
+  client.connected = false;
+}
+
+// Fall back to normal polling until the channel works again
+static unsigned long fail(B24PullClient& client, uint32_t rnd) {
+  client.connected = false;
+  client.configValid = false;
+  if (client.failures < 255) client.failures++;
+  return b24BackoffDelay(client.failures, rnd);
+}
+
+unsigned long b24PullClientStep(B24PullClient& client, B24PullConfigFetch fetchConfig,
+                                B24PullGet get, unsigned long now, uint32_t rnd, uint8_t* due) {
+  *due = 0;
+  if (!client.configValid || now - client.configFetchedAt > BITRIX24_PULL_CONFIG_TTL) {
+    if (!fetchConfig(&client.config)) {
+      Serial.println("Bitrix24 Pull: config not available (Pull disabled on portal?)");
+      return fail(client, rnd);
+    }
+    client.configValid = true;
+    client.configFetchedAt = now;
+    Serial.println("Bitrix24 Pull: config loaded");
+  }
+
+  char urlBuffer[384];
+  QueryBuilder url(urlBuffer, sizeof(urlBuffer));
+  if (!b24PullClientUrl(client, url)) {
+    Serial.println("Bitrix24 Pull: long-poll URL too long");
+    return fail(client, rnd);
+  }
+
+  client.counters = 0;
+  int httpCode = get(url.c_str(), client);
+  if (httpCode != 200 && httpCode != 304) {
+    Serial.print("Bitrix24 Pull: long-poll failed, HTTP ");
+    Serial.println(httpCode);
+    return fail(client, rnd);
+  }
+
+  *due = client.counters;
+  if (!client.connected) {
+    // Events may have been missed while disconnected: resync everything once
+    *due = B24_MASK_ALL;
+  }
+  client.connected = true;
+  client.failures = 0;
+  return 0;
+}
@@ -0,0 +1,62 @@
+// Bitrix24 Pull client state machine: config, long-poll URL, 200/304 handling, backoff
+// Pure: the config request and the long-poll GET are passed in, so a host test can run
+// the client against a stand-in server (the device uses REST and the HTTP pool).
+
+#ifndef BITRIX24_PULL_CLIENT_H
+#define BITRIX24_PULL_CLIENT_H
+
+#include <Arduino.h>
+#include "bitrix24_pull_events.h"
+#include "rest_query.h"
+
+// Re-read the Pull config (channel IDs expire) at least this often (ms)
+#ifndef BITRIX24_PULL_CONFIG_TTL
+#define BITRIX24_PULL_CONFIG_TTL 43200000UL
+#endif
+
+// Long-poll server and channels from pull.application.config.get
+struct B24PullConfig {
+  char server[128];          // Long-poll URL (the secure one when the portal gives both)
+  char channelPrivate[80];
+  char channelShared[80];
+};
+
+struct B24PullClient {
+  B24PullConfig config;
+  bool configValid;
+  unsigned long configFetchedAt;
+  char lastMid[B24_PULL_MID_LEN];  // Sent back as `mid` so the server resends only newer ones
+  bool connected;                  // Last long poll completed normally (200 or 304)
+  uint8_t failures;                // Consecutive failures (backoff)
+  uint8_t counters;                // Counters affected by the events of the current poll
+};
+
+// Fetch pull.application.config.get (read with b24PullParseConfig); false when unavailable
+typedef bool (*B24PullConfigFetch)(B24PullConfig* config);
+// Long-poll GET of `url`. A 200 body is read with b24PullClientReadEvents() before
+// returning. Returns the HTTP status, <= 0 when no response arrived.
+typedef int (*B24PullGet)(const char* url, B24PullClient& client);
+
+void b24PullClientInit(B24PullClient& client);
+
+// Read a pull.application.config.get response. `overrideUrl` (non-empty) replaces the
+// server the portal names. False when there is no server or private channel.
+bool b24PullParseConfig(Stream& body, const char* overrideUrl, B24PullConfig* config);
+
+// Long-poll URL for the current channels and mid; false when it didn't fit
+bool b24PullClientUrl(const B24PullClient& client, QueryBuilder& url);
+
+// Read the frames of a 200 body: moves lastMid, collects counters, and drops the config
+// when the server says the channel expired
+void b24PullClientReadEvents(B24PullClient& client, Stream& body);
+
+// One round of the Pull task: (re)fetch the config when needed, then one long poll.
+// *due = counters to mark due (all of them when the channel (re)connects, since events may
+// have been missed). Returns how long to wait before the next round (ms, 0 = at once).
+unsigned long b24PullClientStep(B24PullClient& client, B24PullConfigFetch fetchConfig,
+                                B24PullGet get, unsigned long now, uint32_t rnd, uint8_t* due);
+
+// Network went away (AP mode, Wi-Fi down): the channel is not healthy
+void b24PullClientDisconnect(B24PullClient& client);
+
+#endif // BITRIX24_PULL_CLIENT_H
@@ -0,0 +1,90 @@
+// Bitrix24 Pull event frame parsing implementation
+
+#include "bitrix24_pull_events.h"
+#include "bitrix24_scheduler.h"
+#include "json_stream.h"
+#include <string.h>
+
+uint8_t b24PullEventCounters(const char* moduleId, const char* command) {
+  if (strcmp(moduleId, "im") == 0) {
+    // Typing indicators arrive every few seconds while someone writes and change no counter
+    if (strcmp(command, "startWriting") == 0 || strcmp(command, "inputActionNotify") == 0) {
+      return 0;
+    }
+    return B24_MASK(B24_COUNTER_DIALOGS);
+  }
+  if (strcmp(moduleId, "tasks") == 0) {
+    return B24_MASK(B24_COUNTER_EXPIRED) | B24_MASK(B24_COUNTER_GROUP);
+  }
+  if (strcmp(moduleId, "bizproc") == 0 || strcmp(moduleId, "rpa") == 0) {
+    return B24_MASK(B24_COUNTER_RPA);
+  }
+  return 0;
+}
+
+// Stream view handing out one byte at a time, so JsonStreamReader stops exactly at the
+// end of a frame's JSON instead of buffering the next frame marker
+class PullFrameStream : public Stream {
+public:
+  explicit PullFrameStream(Stream& s) : body(s) { setTimeout(0); }
+  int available() override { return 1; }
+  int read() override { return body.read(); }
+  int peek() override { return body.peek(); }
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  Stream& body;
+};
+
+// Skip to just after the next "#!NGINXNMS!#" frame start marker
+static bool skipToFrameStart(Stream& body) {
+  static const char marker[] = "#!NGINXNMS!#";
+  uint8_t matched = 0;
+  while (true) {
+    int c = body.read();
+    if (c < 0) return false;
+    if (c == marker[matched]) {
+      matched++;
+      if (marker[matched] == '\0') return true;
+    } else {
+      matched = (c == marker[0]) ? 1 : 0;
+    }
+  }
+}
+
+// Parse one frame's JSON and return the counters its event affects
+static uint8_t readFrame(Stream& body, char* lastMid, bool* configExpired) {
+  PullFrameStream frame(body);
+  JsonStreamReader json(frame);
+  char moduleId[24] = "";
+  char command[32] = "";
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token != JSON_STRING) continue;
+    if (json.matches("mid")) {
+      // Taken even if the rest of the frame is broken: the server must not resend it
+      strncpy(lastMid, json.text(), B24_PULL_MID_LEN - 1);
+      lastMid[B24_PULL_MID_LEN - 1] = '\0';
+    } else if (json.matches("text.module_id")) {
+      strncpy(moduleId, json.text(), sizeof(moduleId) - 1);
+    } else if (json.matches("text.command")) {
+      strncpy(command, json.text(), sizeof(command) - 1);
+    }
+  }
+  if (token == JSON_ERROR) return 0;
+
+  // Server asks to re-read the config (channel expired / reassigned)
+  if (strcmp(moduleId, "pull") == 0 &&
+      (strcmp(command, "channel_expire") == 0 || strcmp(command, "config_expire") == 0)) {
+    *configExpired = true;
+  }
+  return b24PullEventCounters(moduleId, command);
+}
+
+uint8_t b24PullReadFrames(Stream& body, char* lastMid, bool* configExpired) {
+  uint8_t counters = 0;
+  while (skipToFrameStart(body)) {
+    counters |= readFrame(body, lastMid, configExpired);
+  }
+  return counters;
+}
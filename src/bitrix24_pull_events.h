@@ -0,0 +1,23 @@
+// Bitrix24 Pull long-poll body: event frames and the counters they affect
+// The body of a long-poll answer is a sequence of #!NGINXNMS!#{json}#!NGINXNME!# frames.
+// Parsing works on any Stream (the socket on the device, a recorded body on a host).
+
+#ifndef BITRIX24_PULL_EVENTS_H
+#define BITRIX24_PULL_EVENTS_H
+
+#include <Arduino.h>
+
+// Id of the last message received (sent back as `mid` so the server resends only newer ones)
+#define B24_PULL_MID_LEN 48
+
+// Map a Pull event (text.module_id / text.command) to the counters it affects (0 for events
+// that change no counter, e.g. typing in a chat)
+uint8_t b24PullEventCounters(const char* moduleId, const char* command);
+
+// Read frames until the body ends (read() < 0). Returns the counters affected by all events.
+// `lastMid` (B24_PULL_MID_LEN bytes) follows each frame's mid; *configExpired is set when the
+// server asked for the Pull config to be re-read (channel expired or reassigned). A frame
+// that fails to parse is skipped.
+uint8_t b24PullReadFrames(Stream& body, char* lastMid, bool* configExpired);
+
+#endif // BITRIX24_PULL_EVENTS_H
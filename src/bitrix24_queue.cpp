@@ -0,0 +1,239 @@
+// Bitrix24 request governor implementation
+// Callers from several tasks (Bitrix24, Pull, Telegram, UI loop) wait here by polling
+// a small shared table guarded by a critical section.
+
+#include "bitrix24_queue.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const uint8_t MAX_TASK_CLASSES = 6;
+static const uint8_t DEDUP_SLOTS = 4;
+// A finished count query is reused for this long (ms)
+static const unsigned long DEDUP_TTL = 2000;
+static const unsigned long POLL_MS = 20;
+
+static portMUX_TYPE queueMux = portMUX_INITIALIZER_UNLOCKED;
+
+struct B24TaskClass {
+  TaskHandle_t task;
+  B24Priority prio;
+};
+
+struct B24DedupEntry {
+  uint32_t key;
+  unsigned long finishedAt;
+  uint16_t result;
+  bool ok;
+  bool inFlight;
+  bool used;
+};
+
+static B24TokenBucket bucket = {BITRIX24_RATE_BURST * 1000UL, 0};
+static B24WaitLine line = {};
+static B24TaskClass taskClasses[MAX_TASK_CLASSES];
+static B24DedupEntry dedup[DEDUP_SLOTS];
+static bool laneBusy = false;
+
+// --- Token bucket ---
+
+void b24BucketInit(B24TokenBucket& b, unsigned long now) {
+  b.milliTokens = BITRIX24_RATE_BURST * 1000UL;
+  b.lastRefill = now;
+}
+
+static void bucketRefill(B24TokenBucket& b, unsigned long now) {
+  unsigned long elapsed = now - b.lastRefill;
+  uint32_t add = (uint32_t)(elapsed * BITRIX24_RATE_PER_SEC);  // ms * tokens/s = milli-tokens
+  b.lastRefill = now;
+  uint32_t cap = BITRIX24_RATE_BURST * 1000UL;
+  b.milliTokens = (b.milliTokens + add > cap) ? cap : b.milliTokens + add;
+}
+
+bool b24BucketTryTake(B24TokenBucket& b, B24Priority prio, unsigned long now) {
+  bucketRefill(b, now);
+  uint32_t reserve = 0;
+  if (prio == B24_PRIO_NOTIFY) reserve = BITRIX24_RATE_RESERVE_NOTIFY;
+  if (prio == B24_PRIO_BACKGROUND) reserve = BITRIX24_RATE_RESERVE_BACKGROUND;
+  if (b.milliTokens < (reserve + 1) * 1000UL) return false;
+  b.milliTokens -= 1000;
+  return true;
+}
+
+void b24BucketDrain(B24TokenBucket& b, unsigned long now) {
+  b.milliTokens = 0;
+  b.lastRefill = now;
+}
+
+// --- Per-task request class ---
+
+void b24QueueSetTaskPriority(B24Priority prio) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&queueMux);
+  int8_t freeSlot = -1;
+  for (uint8_t i = 0; i < MAX_TASK_CLASSES; i++) {
+    if (taskClasses[i].task == self) {
+      taskClasses[i].prio = prio;
+      portEXIT_CRITICAL(&queueMux);
+      return;
+    }
+    if (taskClasses[i].task == nullptr && freeSlot < 0) freeSlot = i;
+  }
+  if (freeSlot >= 0) {
+    taskClasses[freeSlot].task = self;
+    taskClasses[freeSlot].prio = prio;
+  }
+  portEXIT_CRITICAL(&queueMux);
+}
+
+B24Priority b24QueueTaskPriority() {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  B24Priority prio = B24_PRIO_BACKGROUND;
+  portENTER_CRITICAL(&queueMux);
+  for (uint8_t i = 0; i < MAX_TASK_CLASSES; i++) {
+    if (taskClasses[i].task == self) {
+      prio = taskClasses[i].prio;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&queueMux);
+  return prio;
+}
+
+// --- Admission ---
+
+int8_t b24LineJoin(B24WaitLine& l, B24Priority prio) {
+  for (uint8_t i = 0; i < B24WaitLine::MAX_WAITERS; i++) {
+    if (!l.waiters[i].used) {
+      l.waiters[i] = {l.nextTicket++, (uint8_t)prio, true};
+      return (int8_t)i;
+    }
+  }
+  return -1;
+}
+
+// No waiter of a higher class or of the same class with an older ticket
+bool b24LineIsFirst(const B24WaitLine& l, uint8_t slot) {
+  const B24WaitLine::Waiter& me = l.waiters[slot];
+  for (uint8_t i = 0; i < B24WaitLine::MAX_WAITERS; i++) {
+    if (i == slot || !l.waiters[i].used) continue;
+    if (l.waiters[i].prio < me.prio) return false;
+    if (l.waiters[i].prio == me.prio && (int32_t)(l.waiters[i].ticket - me.ticket) < 0) return false;
+  }
+  return true;
+}
+
+void b24LineLeave(B24WaitLine& l, uint8_t slot) {
+  l.waiters[slot].used = false;
+}
+
+bool b24QueueAcquire(unsigned long timeoutMs) {
+  B24Priority prio = b24QueueTaskPriority();
+  unsigned long start = millis();
+
+  int8_t slot = -1;
+  while (slot < 0) {
+    portENTER_CRITICAL(&queueMux);
+    slot = b24LineJoin(line, prio);
+    portEXIT_CRITICAL(&queueMux);
+    if (slot < 0) {
+      if (millis() - start > timeoutMs) return false;
+      vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+    }
+  }
+
+  while (true) {
+    portENTER_CRITICAL(&queueMux);
+    bool granted = !laneBusy && b24LineIsFirst(line, slot) && b24BucketTryTake(bucket, prio, millis());
+    if (granted) {
+      laneBusy = true;
+      b24LineLeave(line, slot);
+    }
+    portEXIT_CRITICAL(&queueMux);
+    if (granted) return true;
+
+    if (millis() - start > timeoutMs) {
+      portENTER_CRITICAL(&queueMux);
+      b24LineLeave(line, slot);
+      portEXIT_CRITICAL(&queueMux);
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+  }
+}
+
+void b24QueueRelease() {
+  portENTER_CRITICAL(&queueMux);
+  laneBusy = false;
+  portEXIT_CRITICAL(&queueMux);
+}
+
+void b24QueueOnLimitExceeded() {
+  portENTER_CRITICAL(&queueMux);
+  b24BucketDrain(bucket, millis());
+  portEXIT_CRITICAL(&queueMux);
+}
+
+// --- De-duplication ---
+
+bool b24DedupBegin(uint32_t key, uint16_t* result, bool* ok) {
+  unsigned long start = millis();
+  while (true) {
+    portENTER_CRITICAL(&queueMux);
+    unsigned long now = millis();
+    int8_t found = -1;
+    int8_t victim = -1;  // Free slot, else the oldest finished one
+    for (uint8_t i = 0; i < DEDUP_SLOTS; i++) {
+      if (dedup[i].used && dedup[i].key == key) found = i;
+      if (dedup[i].used && dedup[i].inFlight) continue;
+      if (victim >= 0 && !dedup[victim].used) continue;
+      if (victim < 0 || !dedup[i].used || now - dedup[i].finishedAt > now - dedup[victim].finishedAt) {
+        victim = i;
+      }
+    }
+
+    if (found >= 0 && dedup[found].inFlight && now - start < BITRIX24_QUEUE_TIMEOUT) {
+      // Identical query running in another task: wait for its result
+      portEXIT_CRITICAL(&queueMux);
+      vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+      continue;
+    }
+    if (found >= 0 && !dedup[found].inFlight && now - dedup[found].finishedAt < DEDUP_TTL) {
+      *result = dedup[found].result;
+      *ok = dedup[found].ok;
+      portEXIT_CRITICAL(&queueMux);
+      return true;
+    }
+
+    // Run it ourselves (without a slot when all are busy: no sharing, still correct)
+    int8_t slot = (found >= 0 && !dedup[found].inFlight) ? found : victim;
+    if (found < 0 && slot >= 0) {
+      dedup[slot] = {key, 0, 0, false, true, true};
+    } else if (slot == found && slot >= 0) {
+      dedup[slot].inFlight = true;
+    }
+    portEXIT_CRITICAL(&queueMux);
+    return false;
+  }
+}
+
+void b24DedupFinish(uint32_t key, uint16_t result, bool ok) {
+  portENTER_CRITICAL(&queueMux);
+  for (uint8_t i = 0; i < DEDUP_SLOTS; i++) {
+    if (dedup[i].used && dedup[i].inFlight && dedup[i].key == key) {
+      dedup[i].result = result;
+      dedup[i].ok = ok;
+      dedup[i].inFlight = false;
+      dedup[i].finishedAt = millis();
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&queueMux);
+}
+
+uint32_t b24RequestKey(const char* method, const char* params) {
+  uint32_t h = 2166136261u;
+  for (const char* p = method; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+  h = (h ^ '?') * 16777619u;
+  for (const char* p = params; *p; p++) h = (h ^ (uint8_t)*p) * 16777619u;
+  return h;
+}
@@ -0,0 +1,82 @@
+// Bitrix24 request governor: priority admission, token bucket, in-flight de-duplication
+
+#ifndef BITRIX24_QUEUE_H
+#define BITRIX24_QUEUE_H
+
+#include <Arduino.h>
+
+// Request classes, highest first
+enum B24Priority : uint8_t {
+  B24_PRIO_INTERACTIVE = 0,  // User is waiting (B24 button, screen redraw)
+  B24_PRIO_NOTIFY,           // Telegram commands and notification details
+  B24_PRIO_BACKGROUND,       // Scheduled polling, Pull config, task index sync
+  B24_PRIO_COUNT
+};
+
+// Portal rate limit (leaky bucket): refill rate and burst, overridable via build flags.
+// Bitrix24 cloud allows 2 req/s with a burst of 50 (Enterprise: 5 req/s, 250).
+#ifndef BITRIX24_RATE_PER_SEC
+#define BITRIX24_RATE_PER_SEC 2
+#endif
+#ifndef BITRIX24_RATE_BURST
+#define BITRIX24_RATE_BURST 50
+#endif
+// Tokens lower classes must leave in the bucket, so interactive requests never wait for it
+#ifndef BITRIX24_RATE_RESERVE_NOTIFY
+#define BITRIX24_RATE_RESERVE_NOTIFY 5
+#endif
+#ifndef BITRIX24_RATE_RESERVE_BACKGROUND
+#define BITRIX24_RATE_RESERVE_BACKGROUND 15
+#endif
+
+// Longest a request waits for its turn before giving up (ms)
+#ifndef BITRIX24_QUEUE_TIMEOUT
+#define BITRIX24_QUEUE_TIMEOUT 20000
+#endif
+
+// Token bucket in milli-tokens (pure: time is passed in)
+struct B24TokenBucket {
+  uint32_t milliTokens;
+  unsigned long lastRefill;
+};
+void b24BucketInit(B24TokenBucket& bucket, unsigned long now);
+bool b24BucketTryTake(B24TokenBucket& bucket, B24Priority prio, unsigned long now);
+void b24BucketDrain(B24TokenBucket& bucket, unsigned long now);
+
+// Waiting line: higher class first, FIFO (ticket order) within a class (pure)
+struct B24WaitLine {
+  static const uint8_t MAX_WAITERS = 8;
+  struct Waiter {
+    uint32_t ticket;
+    uint8_t prio;
+    bool used;
+  } waiters[MAX_WAITERS];
+  uint32_t nextTicket;
+};
+// Slot of the new waiter, -1 if the line is full
+int8_t b24LineJoin(B24WaitLine& line, B24Priority prio);
+bool b24LineIsFirst(const B24WaitLine& line, uint8_t slot);
+void b24LineLeave(B24WaitLine& line, uint8_t slot);
+
+// Class used for requests made from the calling FreeRTOS task (default: background)
+void b24QueueSetTaskPriority(B24Priority prio);
+B24Priority b24QueueTaskPriority();
+
+// Wait for this task's turn (higher class first, FIFO within a class) and a token.
+// Only one request is being sent at a time; release once the response headers arrived.
+bool b24QueueAcquire(unsigned long timeoutMs);
+void b24QueueRelease();
+
+// Portal answered QUERY_LIMIT_EXCEEDED: empty the bucket so everyone slows down
+void b24QueueOnLimitExceeded();
+
+// De-duplication of identical count-only queries: returns true (with the result) when the
+// same query finished moments ago or was in flight and completed while waiting;
+// otherwise the caller runs it and reports back with b24DedupFinish().
+bool b24DedupBegin(uint32_t key, uint16_t* result, bool* ok);
+void b24DedupFinish(uint32_t key, uint16_t result, bool ok);
+
+// FNV-1a hash of method + params
+uint32_t b24RequestKey(const char* method, const char* params);
+
+#endif // BITRIX24_QUEUE_H
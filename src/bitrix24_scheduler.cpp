@@ -0,0 +1,98 @@
+// Adaptive Bitrix24 poll scheduler implementation
+// All state is owned by the Bitrix24 task; time is passed in so the policy can be
+// driven with simulated clocks.
+
+#include "bitrix24_scheduler.h"
+
+struct B24CounterSchedule {
+  unsigned long lastFetch;    // millis() of last fetch attempt
+  unsigned long lastChange;   // millis() of last value change
+  unsigned long retryDelay;   // Backoff delay (valid while failures > 0)
+  uint8_t failures;           // Consecutive failed fetches
+  bool fetched;               // Fetched at least once since reset
+  bool changed;               // Changed at least once (lastChange valid)
+};
+
+static B24CounterSchedule schedule[B24_COUNTER_COUNT];
+static uint8_t forcedMask = B24_MASK_ALL;
+
+static const unsigned long baseIntervals[B24_COUNTER_COUNT] = {
+  BITRIX24_DIALOGS_INTERVAL,
+  BITRIX24_RPA_INTERVAL,
+  BITRIX24_EXPIRED_INTERVAL,
+  BITRIX24_GROUP_INTERVAL
+};
+
+void b24SchedulerReset() {
+  for (uint8_t i = 0; i < B24_COUNTER_COUNT; i++) {
+    schedule[i] = {0, 0, 0, 0, false, false};
+  }
+  forcedMask = B24_MASK_ALL;
+}
+
+void b24SchedulerMarkDue(uint8_t mask) {
+  forcedMask |= mask;
+}
+
+unsigned long b24PollInterval(B24Counter counter, bool recentlyChanged, bool relaxed) {
+  unsigned long interval = baseIntervals[counter];
+  if (relaxed) interval *= BITRIX24_RELAX_FACTOR;
+  if (recentlyChanged) interval /= 2;
+  return interval;
+}
+
+unsigned long b24BackoffDelay(uint8_t failures, uint32_t rnd) {
+  if (failures == 0) return 0;
+  unsigned long delay = BITRIX24_BACKOFF_BASE;
+  for (uint8_t i = 1; i < failures && delay < BITRIX24_BACKOFF_MAX; i++) {
+    delay *= 2;
+  }
+  if (delay > BITRIX24_BACKOFF_MAX) delay = BITRIX24_BACKOFF_MAX;
+  // Jitter +/-25% so several devices behind one failing portal don't retry in lockstep
+  return delay - delay / 4 + rnd % (delay / 2 + 1);
+}
+
+uint8_t b24SchedulerDueMask(unsigned long now, bool relaxed, uint8_t pushedMask) {
+  uint8_t due = forcedMask;
+  for (uint8_t i = 0; i < B24_COUNTER_COUNT; i++) {
+    const B24CounterSchedule& s = schedule[i];
+    if (!s.fetched) {
+      due |= B24_MASK(i);
+      continue;
+    }
+    unsigned long wait;
+    if (s.failures > 0) {
+      wait = s.retryDelay;
+    } else if (pushedMask & B24_MASK(i)) {
+      wait = BITRIX24_SWEEP_INTERVAL;
+    } else {
+      bool recentlyChanged = s.changed && (now - s.lastChange) < BITRIX24_CHANGE_WINDOW;
+      wait = b24PollInterval((B24Counter)i, recentlyChanged, relaxed);
+    }
+    if (now - s.lastFetch >= wait) {
+      due |= B24_MASK(i);
+    }
+  }
+  return due;
+}
+
+void b24SchedulerOnFetched(uint8_t mask, uint8_t failedMask, uint8_t changedMask,
+                           unsigned long now, uint32_t rnd) {
+  forcedMask &= (uint8_t)~mask;
+  for (uint8_t i = 0; i < B24_COUNTER_COUNT; i++) {
+    if (!(mask & B24_MASK(i))) continue;
+    B24CounterSchedule& s = schedule[i];
+    s.lastFetch = now;
+    s.fetched = true;
+    if (failedMask & B24_MASK(i)) {
+      if (s.failures < 255) s.failures++;
+      s.retryDelay = b24BackoffDelay(s.failures, rnd);
+      continue;
+    }
+    s.failures = 0;
+    if (changedMask & B24_MASK(i)) {
+      s.lastChange = now;
+      s.changed = true;
+    }
+  }
+}
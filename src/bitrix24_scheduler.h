@@ -0,0 +1,76 @@
+// Adaptive Bitrix24 poll scheduler: per-counter cadence, error backoff with jitter
+
+#ifndef BITRIX24_SCHEDULER_H
+#define BITRIX24_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Counters polled on their own cadence (bit index in a counter mask)
+enum B24Counter : uint8_t {
+  B24_COUNTER_DIALOGS = 0,  // im.counters.get: unread dialogs + total unread
+  B24_COUNTER_RPA,          // bizproc.task.list: undone RPA tasks
+  B24_COUNTER_EXPIRED,      // tasks.task.list: expired (+ active for global "All your tasks")
+  B24_COUNTER_GROUP,        // tasks.task.list: delayed + active in the selected group
+  B24_COUNTER_COUNT
+};
+
+#define B24_MASK(counter) ((uint8_t)(1u << (counter)))
+#define B24_MASK_ALL ((uint8_t)((1u << B24_COUNTER_COUNT) - 1))
+
+// Base poll interval per counter (ms); overridable via build flags
+#ifndef BITRIX24_DIALOGS_INTERVAL
+#define BITRIX24_DIALOGS_INTERVAL 30000
+#endif
+#ifndef BITRIX24_RPA_INTERVAL
+#define BITRIX24_RPA_INTERVAL 90000
+#endif
+#ifndef BITRIX24_EXPIRED_INTERVAL
+#define BITRIX24_EXPIRED_INTERVAL 180000
+#endif
+#ifndef BITRIX24_GROUP_INTERVAL
+#define BITRIX24_GROUP_INTERVAL 90000
+#endif
+
+// A counter that changed within this window is polled twice as often
+#ifndef BITRIX24_CHANGE_WINDOW
+#define BITRIX24_CHANGE_WINDOW 300000
+#endif
+
+// Consistency sweep for counters kept fresh by Pull events (see bitrix24_pull.h)
+#ifndef BITRIX24_SWEEP_INTERVAL
+#define BITRIX24_SWEEP_INTERVAL 600000
+#endif
+
+// Interval multiplier while relaxed (work session running or B24 screen hidden)
+#ifndef BITRIX24_RELAX_FACTOR
+#define BITRIX24_RELAX_FACTOR 3
+#endif
+
+// Error backoff: 30 s doubling per consecutive failure up to 10 min, +/-25% jitter
+#ifndef BITRIX24_BACKOFF_BASE
+#define BITRIX24_BACKOFF_BASE 30000
+#endif
+#ifndef BITRIX24_BACKOFF_MAX
+#define BITRIX24_BACKOFF_MAX 600000
+#endif
+
+// Forget all history: every counter becomes due immediately
+void b24SchedulerReset();
+
+// Make counters due now (manual refresh, group change, push event)
+void b24SchedulerMarkDue(uint8_t mask);
+
+// Counters due at `now` (relaxed = work session running or B24 screen hidden;
+// counters in pushedMask are updated by push events and only swept occasionally)
+uint8_t b24SchedulerDueMask(unsigned long now, bool relaxed, uint8_t pushedMask = 0);
+
+// Record a fetch of `mask`: counters in failedMask failed, counters in changedMask
+// returned a new value. `rnd` is a random value used for backoff jitter.
+void b24SchedulerOnFetched(uint8_t mask, uint8_t failedMask, uint8_t changedMask,
+                           unsigned long now, uint32_t rnd);
+
+// Policy (pure functions, no scheduler state)
+unsigned long b24PollInterval(B24Counter counter, bool recentlyChanged, bool relaxed);
+unsigned long b24BackoffDelay(uint8_t failures, uint32_t rnd);
+
+#endif // BITRIX24_SCHEDULER_H
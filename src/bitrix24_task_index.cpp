@@ -0,0 +1,217 @@
+// Local task index implementation
+// Struct-of-arrays layout: counting scans touch only the columns they need.
+
+#include "bitrix24_task_index.h"
+#include "json_stream.h"
+#include "rest_query.h"
+#include <string.h>
+
+bool bitrix24UseTaskIndex = BITRIX24_TASK_INDEX_ENABLED;
+
+static uint32_t taskId[BITRIX24_TASK_INDEX_MAX];
+static uint8_t taskStatus[BITRIX24_TASK_INDEX_MAX];
+static uint32_t taskDeadline[BITRIX24_TASK_INDEX_MAX];     // YYYYMMDD, 0 = no deadline
+static uint32_t taskGroup[BITRIX24_TASK_INDEX_MAX];
+static uint32_t taskResponsible[BITRIX24_TASK_INDEX_MAX];
+static uint16_t taskCount = 0;
+
+static bool seeded = false;
+static bool overflowed = false;
+static uint32_t seededUserId = 0;
+static unsigned long seededAt = 0;
+// Newest CHANGED_DATE seen ("2026-01-19T15:58:59+03:00"); ISO strings from one portal compare in order
+static char watermark[32] = "";
+
+// Task list page size of tasks.task.list (fixed by Bitrix24)
+static const uint8_t TASK_PAGE_SIZE = 50;
+// Safety cap on pages per sync (seed of a full index is ~6 pages)
+static const uint8_t TASK_MAX_PAGES = 12;
+
+uint32_t b24DateKey(const char* text) {
+  // YYYY-MM-DD
+  for (uint8_t i = 0; i < 10; i++) {
+    char c = text[i];
+    bool digit = (c >= '0' && c <= '9');
+    if ((i == 4 || i == 7) ? (c != '-') : !digit) return 0;
+  }
+  uint32_t y = (uint32_t)atoi(text);
+  uint32_t m = (uint32_t)atoi(text + 5);
+  uint32_t d = (uint32_t)atoi(text + 8);
+  return y * 10000 + m * 100 + d;
+}
+
+void b24TaskIndexClear() {
+  taskCount = 0;
+  seeded = false;
+  overflowed = false;
+  watermark[0] = '\0';
+}
+
+static int findTask(uint32_t id) {
+  for (uint16_t i = 0; i < taskCount; i++) {
+    if (taskId[i] == id) return i;
+  }
+  return -1;
+}
+
+bool b24TaskIndexApply(uint32_t id, uint8_t status, uint32_t deadline, uint32_t groupId,
+                       uint32_t responsibleId, uint32_t userId) {
+  int i = findTask(id);
+  // Completed (5) or no longer ours: drop (swap with last)
+  if (status == 5 || responsibleId != userId) {
+    if (i >= 0) {
+      taskCount--;
+      taskId[i] = taskId[taskCount];
+      taskStatus[i] = taskStatus[taskCount];
+      taskDeadline[i] = taskDeadline[taskCount];
+      taskGroup[i] = taskGroup[taskCount];
+      taskResponsible[i] = taskResponsible[taskCount];
+    }
+    return true;
+  }
+  if (i < 0) {
+    if (taskCount >= BITRIX24_TASK_INDEX_MAX) {
+      overflowed = true;
+      return false;
+    }
+    i = taskCount++;
+    taskId[i] = id;
+  }
+  taskStatus[i] = status;
+  taskDeadline[i] = deadline;
+  taskGroup[i] = groupId;
+  taskResponsible[i] = responsibleId;
+  return true;
+}
+
+uint16_t b24TaskIndexCountExpired(uint32_t groupId, uint32_t today) {
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < taskCount; i++) {
+    if (groupId != 0 && taskGroup[i] != groupId) continue;
+    if (taskDeadline[i] != 0 && taskDeadline[i] < today) n++;
+  }
+  return n;
+}
+
+uint16_t b24TaskIndexCountActive(uint32_t groupId) {
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < taskCount; i++) {
+    if (groupId != 0 && taskGroup[i] != groupId) continue;
+    uint8_t s = taskStatus[i];
+    if ((s >= 1 && s <= 4) || s == 6) n++;
+  }
+  return n;
+}
+
+// Common part of seed and delta queries: fields kept in the index, oldest change first
+static const char TASK_SELECT[] =
+  "&select[]=ID&select[]=STATUS&select[]=DEADLINE&select[]=GROUP_ID"
+  "&select[]=RESPONSIBLE_ID&select[]=CHANGED_DATE&order[CHANGED_DATE]=asc";
+
+// tasks.task.list answers in camelCase (result.tasks[].groupId); UPPER_CASE is accepted too.
+bool b24TaskIndexReadPage(Stream& body, uint32_t userId, int* next) {
+  *next = -1;
+  JsonStreamReader json(body);
+  uint32_t id = 0, deadline = 0, group = 0, responsible = 0;
+  uint8_t status = 0;
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (json.matches("result.tasks.#")) {
+      if (token == JSON_OBJECT_START) {
+        id = deadline = group = responsible = 0;
+        status = 0;
+      } else if (token == JSON_OBJECT_END && id != 0) {
+        if (!b24TaskIndexApply(id, status, deadline, group, responsible, userId)) {
+          return false;
+        }
+      }
+      continue;
+    }
+    if (token == JSON_NUMBER && json.matches("next")) {
+      *next = (int)json.asInt();
+      continue;
+    }
+    if (token != JSON_STRING && token != JSON_NUMBER) continue;
+    if (!json.matches("result.tasks.#.*")) continue;
+
+    const char* key = json.keyAt(3);
+    if (strcasecmp(key, "id") == 0) {
+      id = (uint32_t)json.asInt();
+    } else if (strcasecmp(key, "status") == 0) {
+      status = (uint8_t)json.asInt();
+    } else if (strcasecmp(key, "deadline") == 0) {
+      deadline = b24DateKey(json.text());
+    } else if (strcasecmp(key, "groupId") == 0 || strcasecmp(key, "GROUP_ID") == 0) {
+      group = (uint32_t)json.asInt();
+    } else if (strcasecmp(key, "responsibleId") == 0 || strcasecmp(key, "RESPONSIBLE_ID") == 0) {
+      responsible = (uint32_t)json.asInt();
+    } else if (strcasecmp(key, "changedDate") == 0 || strcasecmp(key, "CHANGED_DATE") == 0) {
+      if (strcmp(json.text(), watermark) > 0) {
+        strncpy(watermark, json.text(), sizeof(watermark) - 1);
+      }
+    }
+  }
+  return token == JSON_END;
+}
+
+// Run a (possibly multi-page) list query
+static bool fetchTaskPages(B24TaskPageFetch fetch, const char* baseParams, uint32_t userId) {
+  char buffer[384];
+  int start = 0;
+  for (uint8_t page = 0; page < TASK_MAX_PAGES; page++) {
+    QueryBuilder params(buffer, sizeof(buffer));
+    params.raw(baseParams).raw(TASK_SELECT);
+    if (start > 0) {
+      params.param("start", (uint32_t)start);
+    }
+    if (params.overflowed()) return false;
+    int next;
+    if (!fetch(params.c_str(), userId, &next)) return false;
+    if (next <= start || next < TASK_PAGE_SIZE) return true;
+    start = next;
+  }
+  return false;  // Too many pages; counters fall back to count queries
+}
+
+bool b24TaskIndexSync(B24TaskPageFetch fetch, uint32_t userId, const char* portalNow,
+                      unsigned long now) {
+  if (userId == 0) return false;
+
+  bool reseed = !seeded || overflowed || userId != seededUserId ||
+                (now - seededAt) >= BITRIX24_TASK_INDEX_RESEED;
+  if (reseed) {
+    b24TaskIndexClear();
+    // Seed: all open tasks where the user is responsible
+    char buffer[64];
+    QueryBuilder params(buffer, sizeof(buffer));
+    params.param("filter[RESPONSIBLE_ID]", userId).param("filter[!STATUS]", "5");
+    if (!fetchTaskPages(fetch, params.c_str(), userId)) {
+      Serial.println("Bitrix24: task index seed failed");
+      return false;
+    }
+    // Deltas start where the seed did. Not at the newest change among the user's own
+    // tasks: that can be weeks old, and the unfiltered delta would replay the whole
+    // portal's changes since then.
+    strncpy(watermark, portalNow, sizeof(watermark) - 1);
+    watermark[sizeof(watermark) - 1] = '\0';
+    seeded = true;
+    seededUserId = userId;
+    seededAt = now;
+    Serial.print("Bitrix24: task index seeded, tasks: ");
+    Serial.println(taskCount);
+    return true;
+  }
+
+  // Delta: everything changed since the newest change seen (>= so same-second edits
+  // are not lost; re-applying a task is idempotent). Not filtered by responsible,
+  // so tasks reassigned away from the user or completed drop out of the index.
+  // Encoded: the timezone offset's '+' would otherwise decode as a space
+  char buffer[96];
+  QueryBuilder params(buffer, sizeof(buffer));
+  params.param("filter[>=CHANGED_DATE]", watermark);
+  if (!fetchTaskPages(fetch, params.c_str(), userId)) {
+    Serial.println("Bitrix24: task index delta failed");
+    return false;
+  }
+  return true;
+}
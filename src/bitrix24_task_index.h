@@ -0,0 +1,56 @@
+// Local index of the current user's open tasks, kept in sync with CHANGED_DATE deltas
+
+#ifndef BITRIX24_TASK_INDEX_H
+#define BITRIX24_TASK_INDEX_H
+
+#include <Arduino.h>
+
+// Use the index for expired/active/group counters (falls back to count queries on failure)
+#ifndef BITRIX24_TASK_INDEX_ENABLED
+#define BITRIX24_TASK_INDEX_ENABLED 1
+#endif
+
+// Capacity (17 bytes per task); more open tasks than this disables the index until reseed
+#ifndef BITRIX24_TASK_INDEX_MAX
+#define BITRIX24_TASK_INDEX_MAX 256
+#endif
+
+// Full reseed interval (ms): catches deleted tasks, which never show up in deltas
+#ifndef BITRIX24_TASK_INDEX_RESEED
+#define BITRIX24_TASK_INDEX_RESEED 3600000UL
+#endif
+
+extern bool bitrix24UseTaskIndex;
+
+// Runs one tasks.task.list page with `params` and hands the body to b24TaskIndexReadPage()
+typedef bool (*B24TaskPageFetch)(const char* params, uint32_t userId, int* next);
+
+// Bring the index up to date: full seed when needed, otherwise one delta query
+// (filter[>=CHANGED_DATE] since the newest change seen). `portalNow` is the portal-local
+// time as the sync starts ("YYYY-MM-DDTHH:MM:SS+03:00"); a seed watches from there.
+// Returns false on failure.
+bool b24TaskIndexSync(B24TaskPageFetch fetch, uint32_t userId, const char* portalNow,
+                      unsigned long now);
+
+// Apply the tasks of one tasks.task.list response body; `next` gets the next page's
+// start (-1 if none). Returns false on a parse error or a full index.
+bool b24TaskIndexReadPage(Stream& body, uint32_t userId, int* next);
+
+// Drop everything; the next sync reseeds
+void b24TaskIndexClear();
+
+// Apply one task record (seed or delta): open tasks of `userId` are upserted,
+// completed or reassigned ones removed. Returns false if the index is full.
+bool b24TaskIndexApply(uint32_t id, uint8_t status, uint32_t deadline, uint32_t groupId,
+                       uint32_t responsibleId, uint32_t userId);
+
+// Counters computed from the index (groupId 0 = all groups, today as YYYYMMDD)
+// - expired: deadline set and before today, not completed
+// - active:  status new (1), waiting (2), in progress (3), waiting for control (4), postponed (6)
+uint16_t b24TaskIndexCountExpired(uint32_t groupId, uint32_t today);
+uint16_t b24TaskIndexCountActive(uint32_t groupId);
+
+// "YYYY-MM-DD..." -> YYYYMMDD (0 if not a date)
+uint32_t b24DateKey(const char* text);
+
+#endif // BITRIX24_TASK_INDEX_H
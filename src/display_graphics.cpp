@@ -5,6 +5,8 @@
 #include "pomodoro_config.h"
 #include "color_utils.h"
 #include "bitrix24.h"
+#include "bitrix24_group_cache.h"
+#include "bitrix24_history.h"
 #include "wifi_ap.h"
 #include "translations.h"
 #include "FreeSansBold24pt7b.h"
@@ -1064,9 +1066,42 @@ void drawMainFunctionality() {
   }
 }
 
+// Parts of a B24 section, so an update can repaint only what changed
+static const uint8_t B24_PART_TITLE = 0x01;
+static const uint8_t B24_PART_BADGE = 0x02;
+static const uint8_t B24_PART_SUBTITLE = 0x04;
+static const uint8_t B24_PART_SPARK = 0x08;
+static const uint8_t B24_PART_ALL = B24_PART_TITLE | B24_PART_BADGE | B24_PART_SUBTITLE | B24_PART_SPARK;
+
+// Sparkline under a counter badge: hourly peaks over the kept history
+static const uint8_t B24_SPARK_POINTS = BITRIX24_HISTORY_HOURS;
+
+// What one B24 section shows
+struct B24Section {
+  char title[BITRIX24_GROUP_NAME_LEN];
+  const char* label2;
+  char badge[16];
+  uint16_t totalUnreadCount;
+  uint16_t totalComments;
+  bool useCyrillic;
+  uint16_t spark[B24_SPARK_POINTS];
+  uint8_t sparkCount;      // 0 = no sparkline
+};
+
+// B24 screen as last drawn; updateB24Placeholder() compares against it
+static bool b24Drawn = false;
+static uint8_t b24DrawnRotation = 0;
+static uint8_t b24DrawnPage = 0;
+static uint8_t b24DrawnPageCount = 0;
+static bool b24DrawnStale = false;
+static bool b24DrawnRefreshing = false;
+static uint8_t b24DrawnSectionCount = 0;
+static B24Section b24DrawnSections[3];
+
 // --- Helper: draw loading spinner for B24 ---
 void drawB24LoadingSpinner() {
   gfx->fillScreen(COLOR_BLACK);
+  b24Drawn = false;
   
   int16_t screenWidth = gfx->width();
   int16_t screenHeight = gfx->height();
@@ -1137,116 +1172,104 @@ void drawB24LoadingSpinner() {
   drawCenteredText(TXT_LOADING, centerX, centerY + hourglassHeight / 2 + 30, COLOR_GRAY, 1);
 }
 
-// --- Helper: draw B24 placeholder screen ---
-void drawB24Placeholder() {
-  // Show loading spinner if manual refresh is in progress
-  if (b24ManualRefresh) {
-    drawB24LoadingSpinner();
-    return;
-  }
-  
-  gfx->fillScreen(COLOR_BLACK);
-  
-  int16_t screenWidth = gfx->width();
-  int16_t screenHeight = gfx->height();
-  bool isLandscape = (currentRotation == 1 || currentRotation == 3);
-  
-  // Header
-  int16_t headerHeight = 30;
-  gfx->fillRect(0, 0, screenWidth, headerHeight, COLOR_DARK_BLUE);
-  drawCenteredText(TXT_BITRIX24, screenWidth / 2, headerHeight / 2, COLOR_WHITE, 2);
-  
-  int16_t contentStartY = headerHeight;
-  int16_t contentHeight = screenHeight - headerHeight;
+// Badge (circle) diameter for a section cell
+static int16_t b24BadgeSize(int16_t w, int16_t h, bool isLandscape) {
+  // Calculate badge size - use most of available space with padding
+  // ADJUSTABLE PARAMETERS for circle size calculation:
+  int16_t padding = 10;                    // Padding around circle (decrease = bigger circle)
+  float landscapeWidthPercent = 0.75;      // Landscape: max % of cell width (increase = bigger)
+  float portraitHeightPercent = 0.5;       // Portrait: max % of cell height (increase = bigger)
   
-  // Cache group name if a group is selected (fetch only when needed to prevent freezes)
-  static uint32_t lastGroupId = 0;
-  static char cachedGroupName[128] = "";
-  static unsigned long lastGroupNameFetch = 0;
-  uint32_t currentGroupId = getBitrixSelectedGroupId();
+  int16_t badgeSize;
   
-  // Only fetch group name if group changed and cache is old (>5 minutes to prevent frequent refreshes)
-  // This prevents blocking/freezing during display updates
-  if (currentGroupId != 0) {
-    if (currentGroupId != lastGroupId || (lastGroupNameFetch == 0 || (millis() - lastGroupNameFetch > 300000))) {
-      // Fetch group name (this may be slow, but only happens on group change or every 5 minutes)
-      String groupName = bitrixGetGroupName(currentGroupId);
-      if (groupName.length() > 0) {
-        strncpy(cachedGroupName, groupName.c_str(), sizeof(cachedGroupName) - 1);
-        cachedGroupName[sizeof(cachedGroupName) - 1] = '\0';
-        lastGroupNameFetch = millis();
-      } else if (currentGroupId != lastGroupId) {
-        // Group changed but fetch failed, clear cache
-        cachedGroupName[0] = '\0';
-      }
-      lastGroupId = currentGroupId;
+  if (isLandscape) {
+    // HORIZONTAL MODE CALCULATION:
+    // Step 1: Try to use full height minus padding
+    badgeSize = h - padding * 2;
+    // Step 2: Limit to percentage of width (prevents circle from being too wide)
+    // Formula: badgeSize = min(h - padding*2, w * landscapeWidthPercent)
+    if (badgeSize > w * landscapeWidthPercent) {
+      badgeSize = w * landscapeWidthPercent;
+    }
+  } else {
+    // VERTICAL MODE CALCULATION:
+    // Step 1: Try to use full width minus padding
+    badgeSize = w - padding * 2;
+    // Step 2: Limit to percentage of height (prevents circle from being too tall)
+    // Formula: badgeSize = min(w - padding*2, h * portraitHeightPercent)
+    if (badgeSize > h * portraitHeightPercent) {
+      badgeSize = h * portraitHeightPercent;
     }
+  }
+  return badgeSize;
+}
+
+// Sparkline area of a section: under the badge in landscape, right of it in portrait.
+// Returns false when the cell has no room for one.
+static bool b24SparkRect(int16_t x, int16_t y, int16_t w, int16_t h, bool isLandscape,
+                         int16_t& sx, int16_t& sy, int16_t& sw, int16_t& sh) {
+  int16_t badgeRadius = b24BadgeSize(w, h, isLandscape) / 2;
+  int16_t centerX = x + w / 2;
+  int16_t centerY = y + h / 2;
+  if (isLandscape) {
+    // Between the circle and the subtitle strip
+    sx = x + 8;
+    sw = w - 16;
+    sy = centerY + badgeRadius + 2;
+    sh = (y + h - 23) - sy;
   } else {
-    // No group selected, clear cache
-    cachedGroupName[0] = '\0';
-    lastGroupId = 0;
-    lastGroupNameFetch = 0;
+    sx = centerX + badgeRadius + 8;
+    sw = (x + w - 8) - sx;
+    sy = centerY - 10;
+    sh = 20;
   }
-  
-  // Helper function to draw a section (just circle with number, no text)
-  // If totalUnreadCount > 0, label2 is ignored and subtitle shows "All msgs: [totalUnreadCount]" with number in red
-  // If totalComments > 0, label2 is ignored and subtitle shows "All tasks: [totalComments]" with number in red
-  // If useCyrillic is true, label1 is drawn with Cyrillic font and truncated to fit width
-  auto drawSection = [&](int16_t x, int16_t y, int16_t w, int16_t h, 
-                         const char* label1, const char* label2, const char* badgeText, 
-                         uint16_t totalUnreadCount = 0, uint16_t totalComments = 0, bool useCyrillic = false) {
-    int16_t centerX = x + w / 2;
-    int16_t centerY = y + h / 2;
-    
+  return sw >= 16 && sh >= 4;
+}
+
+// Helper function to draw a section (just circle with number, no text)
+// If totalUnreadCount > 0, label2 is ignored and subtitle shows "All msgs: [totalUnreadCount]" with number in red
+// If totalComments > 0, label2 is ignored and subtitle shows "All tasks: [totalComments]" with number in red
+// If useCyrillic is true, the title is drawn with Cyrillic font and truncated to fit width
+// Only `parts` are drawn; with `clear` their area is blanked first (partial update over an old frame)
+static void drawB24Section(const B24Section& s, int16_t x, int16_t y, int16_t w, int16_t h,
+                           bool isLandscape, uint8_t parts, bool clear) {
+  int16_t centerX = x + w / 2;
+  int16_t centerY = y + h / 2;
+  
+  if (parts & B24_PART_TITLE) {
+    if (clear) {
+      gfx->fillRect(x + 1, y + 2, w - 2, 20, COLOR_BLACK);
+    }
     // Draw title at top of cell
     // ADJUSTABLE PARAMETER for title position:
     int16_t titleTopOffset = 12;  // Distance from top border to title (increase = move down)
     
     int16_t titleY = y + titleTopOffset;
-    if (useCyrillic) {
+    if (s.useCyrillic) {
       // Use Cyrillic font with truncation
       // In landscape mode, sections are wider, so use less padding to fit more text
       int16_t padding = isLandscape ? 4 : 8;  // Less padding in landscape (2px each side vs 4px)
       int16_t maxTitleWidth = w - padding;
-      drawCenteredTextCyrillic(label1, centerX, titleY, COLOR_WHITE, 1, maxTitleWidth);
+      drawCenteredTextCyrillic(s.title, centerX, titleY, COLOR_WHITE, 1, maxTitleWidth);
     } else {
-      drawCenteredText(label1, centerX, titleY, COLOR_WHITE, 1);
+      drawCenteredText(s.title, centerX, titleY, COLOR_WHITE, 1);
     }
-    
-    // Calculate badge size - use most of available space with padding
-    // ADJUSTABLE PARAMETERS for circle size calculation:
-    int16_t padding = 10;                    // Padding around circle (decrease = bigger circle)
-    float landscapeWidthPercent = 0.75;      // Landscape: max % of cell width (increase = bigger)
-    float portraitHeightPercent = 0.5;       // Portrait: max % of cell height (increase = bigger)
-    
-    int16_t badgeSize;
-    
-    if (isLandscape) {
-      // HORIZONTAL MODE CALCULATION:
-      // Step 1: Try to use full height minus padding
-      badgeSize = h - padding * 2;
-      // Step 2: Limit to percentage of width (prevents circle from being too wide)
-      // Formula: badgeSize = min(h - padding*2, w * landscapeWidthPercent)
-      if (badgeSize > w * landscapeWidthPercent) {
-        badgeSize = w * landscapeWidthPercent;
-      }
-    } else {
-      // VERTICAL MODE CALCULATION:
-      // Step 1: Try to use full width minus padding
-      badgeSize = w - padding * 2;
-      // Step 2: Limit to percentage of height (prevents circle from being too tall)
-      // Formula: badgeSize = min(w - padding*2, h * portraitHeightPercent)
-      if (badgeSize > h * portraitHeightPercent) {
-        badgeSize = h * portraitHeightPercent;
-      }
-    }
-    
+  }
+  
+  if (parts & B24_PART_BADGE) {
+    int16_t badgeSize = b24BadgeSize(w, h, isLandscape);
     int16_t badgeRadius = badgeSize / 2;
     
     // Circle is perfectly centered in the cell
     int16_t badgeX = centerX;
     int16_t badgeY = centerY;
     
+    // Glyph corners may stick out of the circle, so clear its bounding square
+    if (clear) {
+      gfx->fillRect(badgeX - badgeRadius - 1, badgeY - badgeRadius - 1,
+                    badgeRadius * 2 + 3, badgeRadius * 2 + 3, COLOR_BLACK);
+    }
+    
     // Draw circle centered
     gfx->fillCircle(badgeX, badgeY, badgeRadius, selectedWorkColor);
     gfx->drawCircle(badgeX, badgeY, badgeRadius, COLOR_WHITE);
@@ -1265,7 +1288,7 @@ void drawB24Placeholder() {
     // Use default GFX font (ASCII) for numbers inside circles
     gfx->setFont((const GFXfont*)nullptr);
     gfx->setTextSize(textSize, textSize, 0);
-    gfx->getTextBounds(badgeText, 0, 0, &x1, &y1, &textW, &textH);
+    gfx->getTextBounds(s.badge, 0, 0, &x1, &y1, &textW, &textH);
     
     // Scale down text size if it doesn't fit in circle (with some margin)
     // Allow text to use ~80% of circle diameter (radius * 1.6 = 0.8 * diameter)
@@ -1274,7 +1297,7 @@ void drawB24Placeholder() {
     while ((textW > maxTextWidth || textH > maxTextHeight) && textSize > 1) {
       textSize--;
       gfx->setTextSize(textSize, textSize, 0);
-      gfx->getTextBounds(badgeText, 0, 0, &x1, &y1, &textW, &textH);
+      gfx->getTextBounds(s.badge, 0, 0, &x1, &y1, &textW, &textH);
     }
     
     // Calculate text position: center of circle minus half text dimensions + offset
@@ -1286,14 +1309,19 @@ void drawB24Placeholder() {
     
     gfx->setCursor(textX, textY);
     gfx->setTextColor(COLOR_WHITE);
-    gfx->print(badgeText);
-    
+    gfx->print(s.badge);
+  }
+  
+  if (parts & B24_PART_SUBTITLE) {
+    if (clear) {
+      gfx->fillRect(x + 1, y + h - 22, w - 2, 20, COLOR_BLACK);
+    }
     // Draw subtitle at bottom of cell
     // ADJUSTABLE PARAMETER for subtitle position:
     int16_t subtitleBottomOffset = 12;  // Distance from bottom border to subtitle (increase = move up)
     
     int16_t subtitleY = y + h - subtitleBottomOffset;
-    if (totalUnreadCount > 0) {
+    if (s.totalUnreadCount > 0) {
       // Special case: show "All msgs: [NUMBER]" with number in red
       char subtitleText[32];
       snprintf(subtitleText, sizeof(subtitleText), "%s", TXT_ALL_MSGS);
@@ -1317,7 +1345,7 @@ void drawB24Placeholder() {
       
       // Draw number in red - get bounds for number text too
       char numberText[16];
-      snprintf(numberText, sizeof(numberText), "%u", totalUnreadCount);
+      snprintf(numberText, sizeof(numberText), "%u", s.totalUnreadCount);
       int16_t numX1, numY1;
       uint16_t numW, numH;
       gfx->getTextBounds(numberText, 0, 0, &numX1, &numY1, &numW, &numH);
@@ -1361,11 +1389,11 @@ void drawB24Placeholder() {
       gfx->print(numberText);
       // Reset font after use
       gfx->setFont((const GFXfont*)nullptr);
-    } else if (label2 == nullptr || (totalComments > 0)) {
-      // Special case: Show "All tasks: [NUMBER]" when label2 is null (section 3 mode)
-      // or when totalComments > 0
+    } else if (s.label2 == nullptr || (s.totalComments > 0)) {
+      // Special case: Show "All tasks: [NUMBER]" when s.label2 is null (section 3 mode)
+      // or when s.totalComments > 0
       // This is used for section 3 to show all active tasks count
-      // Always show when label2 is null (section 3 mode), even if count is 0
+      // Always show when s.label2 is null (section 3 mode), even if count is 0
       char subtitleText[32];
       snprintf(subtitleText, sizeof(subtitleText), "%s", TXT_ALL_TASKS);
       
@@ -1388,7 +1416,7 @@ void drawB24Placeholder() {
       
       // Draw number in red - get bounds for number text too
       char numberText[16];
-      snprintf(numberText, sizeof(numberText), "%u", totalComments);
+      snprintf(numberText, sizeof(numberText), "%u", s.totalComments);
       int16_t numX1, numY1;
       uint16_t numW, numH;
       gfx->getTextBounds(numberText, 0, 0, &numX1, &numY1, &numW, &numH);
@@ -1432,106 +1460,281 @@ void drawB24Placeholder() {
       gfx->print(numberText);
       // Reset font after use
       gfx->setFont((const GFXfont*)nullptr);
-    } else if (label2) {
-      drawCenteredText(label2, centerX, subtitleY, COLOR_GRAY, 1);
+    } else if (s.label2) {
+      drawCenteredText(s.label2, centerX, subtitleY, COLOR_GRAY, 1);
     }
-  };
-  
+  }
+
+  int16_t sx, sy, sw, sh;
+  if ((parts & B24_PART_SPARK) && b24SparkRect(x, y, w, h, isLandscape, sx, sy, sw, sh)) {
+    if (clear) {
+      gfx->fillRect(sx, sy, sw, sh, COLOR_BLACK);
+    }
+    if (s.sparkCount >= 2) {
+      uint16_t lo = s.spark[0];
+      uint16_t hi = s.spark[0];
+      for (uint8_t i = 1; i < s.sparkCount; i++) {
+        if (s.spark[i] < lo) lo = s.spark[i];
+        if (s.spark[i] > hi) hi = s.spark[i];
+      }
+      // Flat history sits on the baseline
+      int16_t prevX = 0;
+      int16_t prevY = 0;
+      for (uint8_t i = 0; i < s.sparkCount; i++) {
+        int16_t px = sx + (int32_t)(sw - 1) * i / (s.sparkCount - 1);
+        int16_t py = sy + sh - 1;
+        if (hi > lo) {
+          py -= (int32_t)(sh - 1) * (s.spark[i] - lo) / (hi - lo);
+        }
+        if (i > 0) {
+          gfx->drawLine(prevX, prevY, px, py, COLOR_GRAY);
+        }
+        prevX = px;
+        prevY = py;
+      }
+    }
+  }
+}
+
+// Cell of section `slot` (0..2): three columns in landscape, three rows in portrait
+static void b24SectionRect(uint8_t slot, bool isLandscape, int16_t& x, int16_t& y, int16_t& w, int16_t& h) {
+  int16_t headerHeight = 30;
+  int16_t contentHeight = gfx->height() - headerHeight;
+  if (isLandscape) {
+    w = gfx->width() / 3;
+    h = contentHeight;
+    x = w * slot;
+    y = headerHeight;
+  } else {
+    w = gfx->width();
+    h = contentHeight / 3;
+    x = 0;
+    y = headerHeight + h * slot;
+  }
+}
+
+// Header markers: "~" while the numbers are restored from the last session,
+// a dot while a refresh asked for by the user is in flight
+static void drawB24HeaderMarkers(bool stale, bool refreshing, bool clear) {
+  int16_t headerHeight = 30;
+  if (clear) {
+    gfx->fillRect(0, 0, 36, headerHeight, COLOR_DARK_BLUE);
+  }
+  if (stale) {
+    drawCenteredText("~", 12, headerHeight / 2, COLOR_GRAY, 2);
+  }
+  if (refreshing) {
+    gfx->fillCircle(28, headerHeight / 2, 3, COLOR_WHITE);
+  }
+}
+
+// Fill `out` with the sections of the current page; returns how many there are
+static uint8_t collectB24Sections(B24Section* out, uint8_t& pageCount) {
+  // Watched groups add pages (tap the header to flip)
+  Bitrix24GroupStats watched[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t watchedCount = getBitrixWatchedGroupStats(watched, BITRIX24_MAX_WATCHED_GROUPS);
+  pageCount = 1 + (watchedCount + 2) / 3;
+  if (b24ScreenPage >= pageCount) {
+    b24ScreenPage = 0;
+  }
+
+  // Watched group page: three groups in the same layout as the counters
+  // (title = group name, big number = delayed, subtitle = all tasks)
+  if (b24ScreenPage > 0) {
+    uint8_t count = 0;
+    for (uint8_t slot = 0; slot < 3; slot++) {
+      uint8_t i = (b24ScreenPage - 1) * 3 + slot;
+      if (i >= watchedCount) break;
+
+      B24Section& s = out[count++];
+      if (!bitrixGetCachedGroupName(watched[i].groupId, s.title, sizeof(s.title))) {
+        snprintf(s.title, sizeof(s.title), "Группа %lu", (unsigned long)watched[i].groupId);
+      }
+      if (watched[i].valid) {
+        snprintf(s.badge, sizeof(s.badge), "%u", watched[i].delayed);
+      } else {
+        strcpy(s.badge, "-");
+      }
+      s.label2 = nullptr;
+      s.totalUnreadCount = 0;
+      s.totalComments = watched[i].valid ? watched[i].allTasks : 0;
+      s.useCyrillic = true;
+      s.sparkCount = 0;
+    }
+    return count;
+  }
+
   // Get Bitrix24 counts
   Bitrix24Counts counts = getBitrix24Counts();
-  
-  // Convert counts to strings
-  char msgCount[16];
-  char taskCount[16];
-  char expiredCount[16];
-  char thirdCount[16];
-  
+  uint32_t currentGroupId = getBitrixSelectedGroupId();
+
+  // Section 1: Unread Messages (show total unread in subtitle)
+  B24Section& msgs = out[0];
+  strcpy(msgs.title, "Непрочитанные");
+  msgs.label2 = "(Диалоги)";
+  msgs.totalUnreadCount = counts.totalUnreadMessages;
+  msgs.totalComments = 0;
+  msgs.useCyrillic = false;
+
+  // Section 2: Undone Tasks
+  B24Section& tasks = out[1];
+  strcpy(tasks.title, "Задачи БП");
+  tasks.label2 = "Автом. и БП";
+  tasks.totalUnreadCount = 0;
+  tasks.totalComments = 0;
+  tasks.useCyrillic = false;
+
+  // Section 3: Selected group or Expired Tasks
+  // Group name from the group cache only (never a network call while drawing;
+  // a missing name is fetched by the Bitrix24 task and triggers a redraw)
+  // Subtitle always shows "All tasks: [NUMBER]": all tasks in the group when one is selected,
+  // otherwise all active tasks where the user is responsible
+  B24Section& third = out[2];
+  char cachedGroupName[BITRIX24_GROUP_NAME_LEN] = "";
+  if (currentGroupId != 0) {
+    bitrixGetCachedGroupName(currentGroupId, cachedGroupName, sizeof(cachedGroupName));
+  }
+  strcpy(third.title, (currentGroupId != 0) ?
+    (cachedGroupName[0] != '\0' ? cachedGroupName : "Выбранная группа") :
+    "Просроченные");
+  third.label2 = nullptr;
+  third.totalUnreadCount = 0;
+  third.totalComments = (currentGroupId != 0) ? counts.groupComments : counts.totalComments;
+  third.useCyrillic = (currentGroupId != 0 && cachedGroupName[0] != '\0');
+
+  // Trend of each badge number
+  uint32_t sparkSpan = (uint32_t)BITRIX24_HISTORY_HOURS * 60;
+  msgs.sparkCount = b24HistoryRead(B24_SERIES_UNREAD, sparkSpan, msgs.spark, B24_SPARK_POINTS);
+  tasks.sparkCount = b24HistoryRead(B24_SERIES_TASKS, sparkSpan, tasks.spark, B24_SPARK_POINTS);
+  third.sparkCount = b24HistoryRead((currentGroupId != 0) ? B24_SERIES_GROUP : B24_SERIES_EXPIRED,
+                                    sparkSpan, third.spark, B24_SPARK_POINTS);
+
   if (counts.valid) {
-    snprintf(msgCount, sizeof(msgCount), "%u", counts.unreadMessages);
-    snprintf(taskCount, sizeof(taskCount), "%u", counts.undoneTasks);
-    snprintf(expiredCount, sizeof(expiredCount), "%u", counts.expiredTasks);
-    snprintf(thirdCount, sizeof(thirdCount), "%u",
-             (getBitrixSelectedGroupId() != 0) ? counts.groupDelayedTasks : counts.expiredTasks);
+    snprintf(msgs.badge, sizeof(msgs.badge), "%u", counts.unreadMessages);
+    snprintf(tasks.badge, sizeof(tasks.badge), "%u", counts.undoneTasks);
+    snprintf(third.badge, sizeof(third.badge), "%u",
+             (currentGroupId != 0) ? counts.groupDelayedTasks : counts.expiredTasks);
   } else {
     // Use "0" if data not available yet
-    strcpy(msgCount, "0");
-    strcpy(taskCount, "0");
-    strcpy(expiredCount, "0");
-    strcpy(thirdCount, "0");
+    strcpy(msgs.badge, "0");
+    strcpy(tasks.badge, "0");
+    strcpy(third.badge, "0");
+  }
+  return 3;
+}
+
+// --- Helper: draw B24 placeholder screen ---
+void drawB24Placeholder() {
+  // Show loading spinner if manual refresh is in progress
+  if (b24ManualRefresh) {
+    drawB24LoadingSpinner();
+    return;
+  }
+  
+  gfx->fillScreen(COLOR_BLACK);
+  
+  int16_t screenWidth = gfx->width();
+  int16_t screenHeight = gfx->height();
+  bool isLandscape = (currentRotation == 1 || currentRotation == 3);
+  
+  // Header
+  int16_t headerHeight = 30;
+  gfx->fillRect(0, 0, screenWidth, headerHeight, COLOR_DARK_BLUE);
+  drawCenteredText(TXT_BITRIX24, screenWidth / 2, headerHeight / 2, COLOR_WHITE, 2);
+
+  B24Section sections[3];
+  uint8_t pageCount;
+  uint8_t sectionCount = collectB24Sections(sections, pageCount);
+
+  bool stale = getBitrix24Counts().stale;
+  drawB24HeaderMarkers(stale, b24Refreshing, false);
+  if (pageCount > 1) {
+    char pageText[8];
+    snprintf(pageText, sizeof(pageText), "%u/%u", b24ScreenPage + 1, pageCount);
+    drawCenteredText(pageText, screenWidth - 20, headerHeight / 2, COLOR_WHITE, 1);
+  }
+  
+  int16_t contentStartY = headerHeight;
+  int16_t contentHeight = screenHeight - headerHeight;
+  
+  for (uint8_t slot = 0; slot < sectionCount; slot++) {
+    int16_t x, y, w, h;
+    b24SectionRect(slot, isLandscape, x, y, w, h);
+    drawB24Section(sections[slot], x, y, w, h, isLandscape, B24_PART_ALL, false);
   }
   
   if (isLandscape) {
-    // Landscape: 3 columns, 1 row
-    int16_t sectionWidth = screenWidth / 3;
-    int16_t sectionHeight = contentHeight;
-    
-    // Section 1: Unread Messages (show total unread in subtitle)
-    drawSection(0, contentStartY, sectionWidth, sectionHeight, 
-                "Непрочитанные", "(Диалоги)", msgCount, counts.totalUnreadMessages);
-    
-    // Section 2: Undone Tasks
-    drawSection(sectionWidth, contentStartY, sectionWidth, sectionHeight,
-                "Задачи БП", "Автом. и БП", taskCount);
-    
-    // Section 3: Selected group or Expired Tasks
-    // When no group selected: subtitle shows "All tasks: [NUMBER]" with all active tasks count
-    // When group selected: subtitle shows "All tasks: [NUMBER]" with group tasks count
-    const char* thirdSubtitle = nullptr;  // Will be handled by totalComments logic
-    const char* thirdTitle = (getBitrixSelectedGroupId() != 0) ? 
-      (cachedGroupName[0] != '\0' ? cachedGroupName : "Выбранная группа") : 
-      "Просроченные";
-    bool useCyrillic = (getBitrixSelectedGroupId() != 0 && cachedGroupName[0] != '\0');
-    // For section 3, always pass totalComments to show "All tasks: [NUMBER]"
-    // When group selected: use groupComments (all tasks in group)
-    // When no group: use totalComments (all active tasks where user is responsible)
-    uint16_t section3Comments = (getBitrixSelectedGroupId() != 0) ? counts.groupComments : counts.totalComments;
-    drawSection(sectionWidth * 2, contentStartY, sectionWidth, sectionHeight, 
-                thirdTitle,
-                thirdSubtitle,
-                thirdCount,
-                0,
-                section3Comments,  // Always show "All tasks: [NUMBER]" subtitle
-                useCyrillic);
-    
     // Draw vertical dividers
-    gfx->drawFastVLine(sectionWidth, contentStartY, sectionHeight, COLOR_GRAY);
-    gfx->drawFastVLine(sectionWidth * 2, contentStartY, sectionHeight, COLOR_GRAY);
+    gfx->drawFastVLine(screenWidth / 3, contentStartY, contentHeight, COLOR_GRAY);
+    gfx->drawFastVLine((screenWidth / 3) * 2, contentStartY, contentHeight, COLOR_GRAY);
   } else {
-    // Portrait: 1 column, 3 rows
-    int16_t sectionWidth = screenWidth;
-    int16_t sectionHeight = contentHeight / 3;
-    
-    // Section 1: Unread Messages (show total unread in subtitle)
-    drawSection(0, contentStartY, sectionWidth, sectionHeight,
-                "Непрочитанные", "(Диалоги)", msgCount, counts.totalUnreadMessages);
-    
-    // Section 2: Undone Tasks
-    drawSection(0, contentStartY + sectionHeight, sectionWidth, sectionHeight,
-                "Задачи БП", "Автом. и БП", taskCount);
-    
-    // Section 3: Selected group or Expired Tasks
-    // When no group selected: subtitle shows "All tasks: [NUMBER]" with all active tasks count
-    // When group selected: subtitle shows "All tasks: [NUMBER]" with group tasks count
-    const char* thirdSubtitle = nullptr;  // Will be handled by totalComments logic
-    const char* thirdTitle = (getBitrixSelectedGroupId() != 0) ? 
-      (cachedGroupName[0] != '\0' ? cachedGroupName : "Выбранная группа") : 
-      "Просроченные";
-    bool useCyrillic = (getBitrixSelectedGroupId() != 0 && cachedGroupName[0] != '\0');
-    // For section 3, always pass totalComments to show "All tasks: [NUMBER]"
-    // When group selected: use groupComments (all tasks in group)
-    // When no group: use totalComments (all active tasks where user is responsible)
-    uint16_t section3Comments = (getBitrixSelectedGroupId() != 0) ? counts.groupComments : counts.totalComments;
-    drawSection(0, contentStartY + sectionHeight * 2, sectionWidth, sectionHeight,
-                thirdTitle,
-                thirdSubtitle,
-                thirdCount,
-                0,
-                section3Comments,  // Always show "All tasks: [NUMBER]" subtitle
-                useCyrillic);
-    
     // Draw horizontal dividers
-    gfx->drawFastHLine(0, contentStartY + sectionHeight, screenWidth, COLOR_GRAY);
-    gfx->drawFastHLine(0, contentStartY + sectionHeight * 2, screenWidth, COLOR_GRAY);
+    gfx->drawFastHLine(0, contentStartY + contentHeight / 3, screenWidth, COLOR_GRAY);
+    gfx->drawFastHLine(0, contentStartY + (contentHeight / 3) * 2, screenWidth, COLOR_GRAY);
+  }
+
+  b24Drawn = true;
+  b24DrawnRotation = currentRotation;
+  b24DrawnPage = b24ScreenPage;
+  b24DrawnPageCount = pageCount;
+  b24DrawnStale = stale;
+  b24DrawnRefreshing = b24Refreshing;
+  b24DrawnSectionCount = sectionCount;
+  memcpy(b24DrawnSections, sections, sizeof(sections[0]) * sectionCount);
+}
+
+// Bring the B24 screen up to date, repainting only the parts whose content changed
+// (falls back to a full redraw when the layout itself changed)
+void updateB24Placeholder() {
+  if (b24ManualRefresh) {
+    return;
+  }
+
+  B24Section sections[3];
+  uint8_t pageCount;
+  uint8_t sectionCount = collectB24Sections(sections, pageCount);
+  if (!b24Drawn || b24DrawnRotation != currentRotation || b24DrawnPage != b24ScreenPage ||
+      b24DrawnPageCount != pageCount || b24DrawnSectionCount != sectionCount) {
+    drawB24Placeholder();
+    return;
+  }
+
+  Bitrix24Counts counts = getBitrix24Counts();
+  if (counts.stale != b24DrawnStale || b24Refreshing != b24DrawnRefreshing) {
+    drawB24HeaderMarkers(counts.stale, b24Refreshing, true);
+    b24DrawnStale = counts.stale;
+    b24DrawnRefreshing = b24Refreshing;
+  }
+  // A failed refresh keeps the numbers already on screen
+  if (!counts.valid) {
+    return;
+  }
+
+  bool isLandscape = (currentRotation == 1 || currentRotation == 3);
+  for (uint8_t slot = 0; slot < sectionCount; slot++) {
+    const B24Section& now = sections[slot];
+    B24Section& was = b24DrawnSections[slot];
+    uint8_t parts = 0;
+    if (strcmp(now.title, was.title) != 0 || now.useCyrillic != was.useCyrillic) {
+      parts |= B24_PART_TITLE;
+    }
+    if (strcmp(now.badge, was.badge) != 0) {
+      parts |= B24_PART_BADGE;
+    }
+    if (now.label2 != was.label2 || now.totalUnreadCount != was.totalUnreadCount ||
+        now.totalComments != was.totalComments) {
+      parts |= B24_PART_SUBTITLE;
+    }
+    if (now.sparkCount != was.sparkCount ||
+        memcmp(now.spark, was.spark, sizeof(now.spark[0]) * now.sparkCount) != 0) {
+      parts |= B24_PART_SPARK;
+    }
+    if (parts == 0) continue;
+
+    int16_t x, y, w, h;
+    b24SectionRect(slot, isLandscape, x, y, w, h);
+    drawB24Section(now, x, y, w, h, isLandscape, parts, true);
+    was = now;
   }
 }
 
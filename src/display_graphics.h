@@ -12,6 +12,7 @@ void drawGrid();
 void drawColorPreview();
 void drawMainFunctionality();
 void drawB24Placeholder();
+void updateB24Placeholder();
 void drawB24LoadingSpinner();
 void drawTelegramPrompt();
 void drawAPPrompt();
@@ -0,0 +1,371 @@
+// HTTP response body stream implementation (gzip via the ROM tinfl inflater)
+
+#include "http_body.h"
+#include <HTTPClient.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#if HTTP_GZIP_ENABLED
+#include <rom/miniz.h>
+#endif
+
+static const size_t GZIP_IN_LEN = 512;
+
+// gzip member header flags (RFC 1952)
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+
+#if HTTP_GZIP_ENABLED
+// Decoder state, the 32 KB circular output window the inflated bytes are served from, and
+// a small input buffer (~43 KB)
+struct GzipInflater {
+  tinfl_decompressor decomp;
+  uint8_t dict[TINFL_LZ_DICT_SIZE];
+  uint8_t in[GZIP_IN_LEN];
+  size_t inPos;
+  size_t inLen;
+  size_t dictOfs;
+  bool inEof;
+};
+
+// The one inflater, allocated while a request holds gzipLock. gzipOwner and gzipInflater
+// are only written by the task holding it.
+static GzipInflater* gzipInflater = nullptr;
+static StaticSemaphore_t gzipLockBuffer;
+static HTTPClient* volatile gzipOwner = nullptr;
+
+static SemaphoreHandle_t gzipLock() {
+  static SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&gzipLockBuffer);
+  return lock;
+}
+#else
+struct GzipInflater {};
+#endif
+
+void httpCollectHeaders(HTTPClient& http) {
+  static const char* headerKeys[] = {"Content-Encoding", "Transfer-Encoding"};
+  http.collectHeaders(headerKeys, 2);
+}
+
+bool httpAcceptGzip(HTTPClient& http) {
+#if HTTP_GZIP_ENABLED
+  if (gzipOwner == &http) return true;
+  if (xSemaphoreTake(gzipLock(), 0) != pdTRUE) return false;
+  gzipInflater = (GzipInflater*)calloc(1, sizeof(GzipInflater));
+  if (gzipInflater == nullptr) {
+    Serial.println("HTTP: no heap for the gzip inflater");
+    xSemaphoreGive(gzipLock());
+    return false;
+  }
+  gzipOwner = &http;
+  http.addHeader("Accept-Encoding", "gzip");
+  return true;
+#else
+  (void)http;
+  return false;
+#endif
+}
+
+void httpReleaseGzip(HTTPClient& http) {
+#if HTTP_GZIP_ENABLED
+  if (gzipOwner != &http) return;
+  free(gzipInflater);
+  gzipInflater = nullptr;
+  gzipOwner = nullptr;
+  xSemaphoreGive(gzipLock());
+#else
+  (void)http;
+#endif
+}
+
+HttpBodyStream::HttpBodyStream(HTTPClient& http)
+  : raw(http.getStream()), inflater(nullptr), outPos(0), outEnd(0),
+    wireCount(0), bodyCount(0), headerDone(false), finished(false), error(false),
+    framing(FRAME_CLOSE), frameLeft(0), frameDone(false), frameError(false), chunkStarted(false) {
+  setTimeout(0);
+  if (http.header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+    framing = FRAME_CHUNKED;
+  } else if (http.getSize() >= 0) {
+    framing = FRAME_LENGTH;
+    frameLeft = (size_t)http.getSize();
+    frameDone = (frameLeft == 0);
+  }
+#if HTTP_GZIP_ENABLED
+  // Only the request that asked for gzip has the inflater to decode it with
+  if (gzipOwner == &http && http.header("Content-Encoding").equalsIgnoreCase("gzip")) {
+    inflater = gzipInflater;
+    tinfl_init(&inflater->decomp);
+    inflater->inPos = 0;
+    inflater->inLen = 0;
+    inflater->dictOfs = 0;
+    inflater->inEof = false;
+  }
+#endif
+}
+
+int HttpBodyStream::frameByte() {
+  uint8_t c;
+  return raw.readBytes(&c, 1) == 1 ? c : -1;
+}
+
+// Parse the next chunk-size line (after the CRLF closing the previous chunk).
+// The zero-size chunk and its trailer end the body.
+bool HttpBodyStream::nextChunk() {
+  if (chunkStarted && (frameByte() != '\r' || frameByte() != '\n')) {
+    frameError = true;
+    frameDone = true;
+    return false;
+  }
+  chunkStarted = true;
+
+  size_t size = 0;
+  bool digits = false;
+  bool extension = false;
+  int c;
+  while ((c = frameByte()) >= 0 && c != '\r') {
+    if (extension) continue;
+    int v = (c >= '0' && c <= '9') ? c - '0'
+          : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+          : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (v >= 0 && size < (SIZE_MAX >> 4)) {
+      size = (size << 4) | (size_t)v;
+      digits = true;
+    } else if (c == ';' || c == ' ') {
+      extension = true;
+    } else {
+      c = -1;
+      break;
+    }
+  }
+  if (c != '\r' || frameByte() != '\n' || !digits) {
+    frameError = true;
+    frameDone = true;
+    return false;
+  }
+  if (size > 0) {
+    frameLeft = size;
+    return true;
+  }
+
+  // Trailer fields (normally none), then an empty line
+  size_t lineLen = 0;
+  while ((c = frameByte()) >= 0) {
+    if (c == '\n') {
+      if (lineLen == 0) break;
+      lineLen = 0;
+    } else if (c != '\r') {
+      lineLen++;
+    }
+  }
+  frameError = (c < 0);
+  frameDone = true;
+  return false;
+}
+
+// Body bytes as framed on the wire (before inflating)
+size_t HttpBodyStream::wireRead(uint8_t* buffer, size_t length) {
+  if (frameDone || length == 0) return 0;
+  if (framing == FRAME_CHUNKED && frameLeft == 0 && !nextChunk()) return 0;
+  if (framing != FRAME_CLOSE && length > frameLeft) length = frameLeft;
+
+  size_t got = raw.readBytes(buffer, length);
+  if (got == 0) {
+    // Timed out or closed: the end of the body only when it is framed by the connection
+    frameDone = true;
+    frameError = (framing != FRAME_CLOSE);
+    return 0;
+  }
+  if (framing != FRAME_CLOSE) {
+    frameLeft -= got;
+    if (framing == FRAME_LENGTH && frameLeft == 0) frameDone = true;
+  }
+  return got;
+}
+
+bool HttpBodyStream::drain(size_t maxBytes) {
+  uint8_t scratch[64];
+  while (!frameDone && maxBytes > 0) {
+    size_t want = (maxBytes < sizeof(scratch)) ? maxBytes : sizeof(scratch);
+    size_t got = wireRead(scratch, want);
+    wireCount += got;
+    maxBytes -= got;
+  }
+  // A chunked body ends with the zero chunk, which wireRead only sees on the next call
+  if (!frameDone && framing == FRAME_CHUNKED && frameLeft == 0) {
+    nextChunk();
+  }
+  finished = true;
+  return complete();
+}
+
+#if HTTP_GZIP_ENABLED
+
+// Next chunk of compressed input (blocks up to the client timeout for the first byte)
+bool HttpBodyStream::refillInput() {
+  if (inflater->inEof) return false;
+  int avail = raw.available();
+  size_t want = (avail > 0) ? (size_t)avail : 1;
+  if (want > GZIP_IN_LEN) want = GZIP_IN_LEN;
+  size_t got = wireRead(inflater->in, want);
+  inflater->inPos = 0;
+  inflater->inLen = got;
+  wireCount += got;
+  if (got == 0) {
+    inflater->inEof = true;
+    return false;
+  }
+  return true;
+}
+
+int HttpBodyStream::rawByte() {
+  if (inflater->inPos >= inflater->inLen && !refillInput()) {
+    return -1;
+  }
+  return inflater->in[inflater->inPos++];
+}
+
+// Skip the gzip member header; the deflate data follows it directly
+bool HttpBodyStream::skipGzipHeader() {
+  uint8_t fixed[10];
+  for (uint8_t i = 0; i < sizeof(fixed); i++) {
+    int c = rawByte();
+    if (c < 0) return false;
+    fixed[i] = (uint8_t)c;
+  }
+  if (fixed[0] != 0x1f || fixed[1] != 0x8b || fixed[2] != 8) {
+    return false;
+  }
+  uint8_t flags = fixed[3];
+
+  if (flags & GZIP_FEXTRA) {
+    int lo = rawByte();
+    int hi = rawByte();
+    if (lo < 0 || hi < 0) return false;
+    for (uint16_t n = (uint16_t)(lo | (hi << 8)); n > 0; n--) {
+      if (rawByte() < 0) return false;
+    }
+  }
+  if (flags & GZIP_FNAME) {
+    int c;
+    while ((c = rawByte()) > 0) {}
+    if (c < 0) return false;
+  }
+  if (flags & GZIP_FCOMMENT) {
+    int c;
+    while ((c = rawByte()) > 0) {}
+    if (c < 0) return false;
+  }
+  if (flags & GZIP_FHCRC) {
+    if (rawByte() < 0 || rawByte() < 0) return false;
+  }
+  return true;
+}
+
+// Make at least one inflated byte available; false at the end of the body
+bool HttpBodyStream::fill() {
+  if (outPos < outEnd) return true;
+  if (finished) return false;
+
+  if (!headerDone) {
+    headerDone = true;
+    if (!skipGzipHeader()) {
+      Serial.println("HTTP: bad gzip header");
+      error = true;
+      finished = true;
+      return false;
+    }
+  }
+
+  while (outPos >= outEnd) {
+    if (inflater->inPos >= inflater->inLen) {
+      refillInput();
+    }
+    size_t inBytes = inflater->inLen - inflater->inPos;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - inflater->dictOfs;
+    mz_uint32 flags = inflater->inEof ? 0 : TINFL_FLAG_HAS_MORE_INPUT;
+    tinfl_status status = tinfl_decompress(&inflater->decomp, inflater->in + inflater->inPos, &inBytes,
+                                           inflater->dict, inflater->dict + inflater->dictOfs,
+                                           &outBytes, flags);
+    inflater->inPos += inBytes;
+    outPos = inflater->dictOfs;
+    outEnd = inflater->dictOfs + outBytes;
+    inflater->dictOfs = (inflater->dictOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) {
+      // The trailer (CRC32 + size) is not checked; a damaged body fails JSON parsing instead
+      finished = true;
+      break;
+    }
+    if (status < TINFL_STATUS_DONE ||
+        (status == TINFL_STATUS_NEEDS_MORE_INPUT && inflater->inEof)) {
+      Serial.println("HTTP: gzip body truncated or corrupt");
+      error = true;
+      finished = true;
+      break;
+    }
+  }
+  return outPos < outEnd;
+}
+
+#else
+
+bool HttpBodyStream::refillInput() { return false; }
+int HttpBodyStream::rawByte() { return -1; }
+bool HttpBodyStream::skipGzipHeader() { return false; }
+bool HttpBodyStream::fill() { return false; }
+
+#endif
+
+int HttpBodyStream::available() {
+  if (inflater == nullptr) {
+    if (finished || frameDone) return 0;
+    int avail = raw.available();
+    if (framing == FRAME_LENGTH && avail > 0 && (size_t)avail > frameLeft) avail = (int)frameLeft;
+    return avail;
+  }
+  if (outPos < outEnd) return (int)(outEnd - outPos);
+  return finished ? 0 : 1;
+}
+
+int HttpBodyStream::read() {
+  uint8_t c;
+  return readBytes((char*)&c, 1) == 1 ? c : -1;
+}
+
+int HttpBodyStream::peek() {
+  if (inflater == nullptr) {
+    if (finished) return -1;
+    if (frameDone) return -1;
+    if (framing == FRAME_CHUNKED && frameLeft == 0 && !nextChunk()) return -1;
+    return raw.peek();
+  }
+#if HTTP_GZIP_ENABLED
+  return fill() ? inflater->dict[outPos] : -1;
+#else
+  return -1;
+#endif
+}
+
+size_t HttpBodyStream::readBytes(char* buffer, size_t length) {
+  if (inflater == nullptr) {
+    if (finished) return 0;
+    size_t got = wireRead((uint8_t*)buffer, length);
+    wireCount += got;
+    bodyCount += got;
+    return got;
+  }
+#if HTTP_GZIP_ENABLED
+  if (length == 0 || !fill()) return 0;
+  size_t n = outEnd - outPos;
+  if (n > length) n = length;
+  memcpy(buffer, inflater->dict + outPos, n);
+  outPos += n;
+  bodyCount += n;
+  return n;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,89 @@
+// HTTP response body as a Stream, inflating gzip (Content-Encoding: gzip) on the fly
+// Bodies are framed by Content-Length, chunked encoding or the end of the connection, so
+// HTTP/1.1 keep-alive connections can be reused once the body was read to its end.
+
+#ifndef HTTP_BODY_H
+#define HTTP_BODY_H
+
+#include <Arduino.h>
+
+class HTTPClient;
+struct GzipInflater;
+
+// gzip needs the ROM inflater (tinfl); disable with -DHTTP_GZIP_ENABLED=0
+#ifndef HTTP_GZIP_ENABLED
+#if __has_include(<rom/miniz.h>)
+#define HTTP_GZIP_ENABLED 1
+#else
+#define HTTP_GZIP_ENABLED 0
+#endif
+#endif
+
+// Collect the response headers HttpBodyStream frames and decodes by (call between
+// http.begin() and GET/POST of every request; httpPoolBegin() does). Also clears the values
+// an earlier response on the same client left behind.
+void httpCollectHeaders(HTTPClient& http);
+
+// Ask for a gzip body (call between http.begin() and GET/POST). There is one inflater
+// (~43 KB, allocated here and freed by httpReleaseGzip()): the request holds it until then,
+// and while another request has it, or the heap has no block that large, this one goes
+// uncompressed. Returns true if asked. Not worth it for long polls, which would keep the
+// inflater from everyone else for the whole hold time.
+bool httpAcceptGzip(HTTPClient& http);
+// Request over: free the inflater if `http` holds it (httpPoolEnd() does this)
+void httpReleaseGzip(HTTPClient& http);
+
+// Reads the body of a response whose GET/POST already returned. Compressed bodies are
+// inflated through a 32 KB window (deflate back-references reach that far), so neither
+// the compressed nor the inflated body is ever held in full.
+// Framing follows Transfer-Encoding / Content-Length as collected by httpCollectHeaders();
+// with neither, the body runs until the server closes the connection.
+class HttpBodyStream : public Stream {
+public:
+  explicit HttpBodyStream(HTTPClient& http);
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t readBytes(char* buffer, size_t length) override;
+  size_t readBytes(uint8_t* buffer, size_t length) override { return readBytes((char*)buffer, length); }
+  size_t write(uint8_t) override { return 0; }
+
+  bool compressed() const { return inflater != nullptr; }
+  bool failed() const { return error || frameError; }
+  // The whole body was received as framed: the connection may carry the next request
+  bool complete() const { return frameDone && !frameError && framing != FRAME_CLOSE; }
+  // Skip up to maxBytes of unread body (e.g. after a count-only read); returns complete()
+  bool drain(size_t maxBytes);
+  // Bytes taken off the socket / handed to the reader so far
+  size_t wireBytes() const { return wireCount; }
+  size_t bodyBytes() const { return bodyCount; }
+
+private:
+  enum Framing : uint8_t { FRAME_CLOSE, FRAME_LENGTH, FRAME_CHUNKED };
+
+  Stream& raw;
+  GzipInflater* inflater;
+  size_t outPos;
+  size_t outEnd;
+  size_t wireCount;
+  size_t bodyCount;
+  bool headerDone;
+  bool finished;
+  bool error;
+  Framing framing;
+  size_t frameLeft;     // Bytes left in the body (FRAME_LENGTH) or current chunk
+  bool frameDone;
+  bool frameError;
+  bool chunkStarted;
+
+  size_t wireRead(uint8_t* buffer, size_t length);
+  int frameByte();
+  bool nextChunk();
+  int rawByte();
+  bool refillInput();
+  bool skipGzipHeader();
+  bool fill();
+};
+
+#endif // HTTP_BODY_H
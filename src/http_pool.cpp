@@ -0,0 +1,417 @@
+// Shared HTTPS connection pool implementation
+// Slots 0..HTTP_POOL_MAX_TLS-1 own an HTTPClient with its connection (kept between requests),
+// the next HTTP_POOL_LONG_POLLS do the same for long polls. `open` marks a live TLS context
+// and is what the cap counts (outside the long-poll slots); a slot is only touched by the
+// task holding its lease.
+
+#include "http_pool.h"
+#include "http_body.h"
+#include "net_perf.h"
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+static const uint8_t LONG_POLL_FIRST = HTTP_POOL_MAX_TLS;
+static const uint8_t SLOTS = HTTP_POOL_MAX_TLS + HTTP_POOL_LONG_POLLS;
+static const unsigned long POLL_MS = 20;
+static const size_t HOST_LEN = 64;
+
+struct HostStats {
+  char host[HOST_LEN];
+  uint32_t requests;
+  uint32_t reused;       // Sent on a kept-alive connection
+  uint32_t handshakes;   // Sent on a new connection
+  uint32_t responses;    // Requests that got response headers
+  uint32_t rttSum;       // ms, over `responses`
+  uint32_t rttMax;
+  uint32_t heapMin;      // Lowest free heap seen during a request
+  uint32_t heapUseMax;   // Largest drop in free heap during one request
+};
+
+struct PoolSlot {
+  HTTPClient* http;
+  WiFiClientSecure* tls;
+  WiFiClient* tcp;         // For plain http:// URLs
+  char host[HOST_LEN];
+  uint16_t port;
+  int8_t stats;            // HostStats index, -1 = not reported
+  bool leased;
+  bool open;               // Live TLS context (or being connected by the lessee)
+  bool secure;             // Current request uses `tls`
+  bool reused;
+  unsigned long lastUsed;
+  unsigned long calledAt;      // httpPoolBegin() entered (includes waiting for the slot)
+  unsigned long startedAt;
+  unsigned long sentAt;        // Connection ready, request about to go out
+  unsigned long respondedAt;   // 0 until response headers arrived
+  uint32_t heapBefore;
+  uint32_t heapLow;
+  NetPerfSample perf;          // Telemetry of the current request
+};
+
+static portMUX_TYPE poolMux = portMUX_INITIALIZER_UNLOCKED;
+
+static HTTPClient slotHttp[SLOTS];
+static WiFiClientSecure slotTls[SLOTS];
+static WiFiClient slotTcp[SLOTS];
+static PoolSlot slots[SLOTS];
+static bool slotsReady = false;
+
+static HostStats hostStats[HTTP_POOL_MAX_HOSTS];
+static uint8_t hostCount = 0;
+
+static bool isLongPollSlot(uint8_t i) {
+  return i >= LONG_POLL_FIRST;
+}
+
+// Callers hold poolMux
+static void initSlots() {
+  if (slotsReady) return;
+  for (uint8_t i = 0; i < SLOTS; i++) {
+    slots[i] = {};
+    slots[i].stats = -1;
+    slots[i].http = &slotHttp[i];
+    slots[i].tls = &slotTls[i];
+    slots[i].tcp = &slotTcp[i];
+  }
+  slotsReady = true;
+}
+
+// Callers hold poolMux
+static int8_t statsFor(const char* host) {
+  for (uint8_t i = 0; i < hostCount; i++) {
+    if (strcmp(hostStats[i].host, host) == 0) return (int8_t)i;
+  }
+  if (hostCount >= HTTP_POOL_MAX_HOSTS) return -1;
+  HostStats& s = hostStats[hostCount];
+  s = {};
+  strncpy(s.host, host, HOST_LEN - 1);
+  s.heapMin = UINT32_MAX;
+  return (int8_t)hostCount++;
+}
+
+// "https://host[:port]/..." -> host, port, secure
+static bool parseUrl(const char* url, char* host, uint16_t* port, bool* secure) {
+  const char* p;
+  if (strncmp(url, "https://", 8) == 0) {
+    p = url + 8;
+    *secure = true;
+    *port = 443;
+  } else if (strncmp(url, "http://", 7) == 0) {
+    p = url + 7;
+    *secure = false;
+    *port = 80;
+  } else {
+    return false;
+  }
+  size_t n = strcspn(p, ":/?");
+  if (n == 0 || n >= HOST_LEN) return false;
+  memcpy(host, p, n);
+  host[n] = '\0';
+  if (p[n] == ':') {
+    *port = (uint16_t)atoi(p + n + 1);
+  }
+  return true;
+}
+
+static void sampleHeap(PoolSlot& slot) {
+  uint32_t free = ESP.getFreeHeap();
+  if (free < slot.heapLow) slot.heapLow = free;
+}
+
+// Take a slot for host:port: an idle connection to it, else a closed slot. Stale idle
+// connections are closed first; at the TLS cap the least recently used idle one goes. Long
+// polls only look at their own slots, short requests at the rest.
+static int8_t leaseSlot(const char* host, uint16_t port, bool secure, bool longPoll,
+                        unsigned long waitMs) {
+  unsigned long start = millis();
+  while (true) {
+    unsigned long now = millis();
+    int8_t chosen = -1;
+    int8_t victim = -1;
+    portENTER_CRITICAL(&poolMux);
+    initSlots();
+    uint8_t open = 0;
+    unsigned long victimIdle = 0;
+    for (uint8_t i = 0; i < SLOTS; i++) {
+      PoolSlot& s = slots[i];
+      if (!s.open || isLongPollSlot(i) != longPoll) continue;
+      open++;
+      if (s.leased) continue;
+      unsigned long idle = now - s.lastUsed;
+      bool sameHost = s.secure == secure && s.port == port && strcmp(s.host, host) == 0;
+      if (sameHost && idle < HTTP_POOL_IDLE_TIMEOUT && chosen < 0) {
+        chosen = (int8_t)i;
+      } else if (victim < 0 || idle > victimIdle) {
+        victim = (int8_t)i;
+        victimIdle = idle;
+      }
+    }
+    if (chosen < 0) {
+      // Long polls are held to their slot count instead of the cap
+      bool roomForTls = !secure || longPoll || open < HTTP_POOL_MAX_TLS;
+      bool staleVictim = victim >= 0 && victimIdle >= HTTP_POOL_IDLE_TIMEOUT;
+      if (roomForTls && !staleVictim) {
+        uint8_t first = longPoll ? LONG_POLL_FIRST : 0;
+        uint8_t last = longPoll ? SLOTS : LONG_POLL_FIRST;
+        for (uint8_t i = first; i < last; i++) {
+          if (!slots[i].leased && !slots[i].open) {
+            chosen = (int8_t)i;
+            victim = -1;
+            break;
+          }
+        }
+      }
+    } else {
+      victim = -1;
+    }
+    if (chosen >= 0) slots[chosen].leased = true;
+    if (victim >= 0) slots[victim].leased = true;
+    portEXIT_CRITICAL(&poolMux);
+
+    if (chosen >= 0) return chosen;
+    if (victim >= 0) {
+      // Frees its TLS context
+      slots[victim].tls->stop();
+      portENTER_CRITICAL(&poolMux);
+      slots[victim].open = false;
+      slots[victim].leased = false;
+      portEXIT_CRITICAL(&poolMux);
+      continue;
+    }
+    if (millis() - start >= waitMs) return -1;
+    vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+  }
+}
+
+static int8_t slotOf(HTTPClient* http) {
+  for (uint8_t i = 0; i < SLOTS; i++) {
+    if (slots[i].leased && slots[i].http == http) return (int8_t)i;
+  }
+  return -1;
+}
+
+// Request on the leased slot starts: reuse bookkeeping and stats
+static void startRequest(PoolSlot& slot, bool connected) {
+  slot.reused = connected;
+  slot.startedAt = millis();
+  slot.heapBefore = ESP.getFreeHeap();
+  slot.heapLow = slot.heapBefore;
+  portENTER_CRITICAL(&poolMux);
+  if (slot.secure) slot.open = true;
+  if (slot.stats >= 0) {
+    HostStats& s = hostStats[slot.stats];
+    s.requests++;
+    if (connected) s.reused++;
+    else s.handshakes++;
+  }
+  portEXIT_CRITICAL(&poolMux);
+}
+
+// Resolve and connect a fresh slot before HTTPClient sees it, so lookup and TLS
+// handshake are timed apart (HTTPClient finds the client connected and sends right away)
+static bool connectSlot(PoolSlot& slot, const char* host, uint16_t port) {
+  IPAddress ip;
+  unsigned long t = millis();
+  bool resolved = WiFi.hostByName(host, ip) == 1;
+  slot.perf.ms[NET_PHASE_DNS] = millis() - t;
+  if (!resolved) return false;
+  t = millis();
+  bool ok;
+  if (slot.secure) {
+    slot.tls->setInsecure();  // Skip certificate verification (as before pooling)
+    ok = slot.tls->connect(ip, port, host, nullptr, nullptr, nullptr) == 1;
+  } else {
+    ok = slot.tcp->connect(ip, port) == 1;
+  }
+  slot.perf.ms[NET_PHASE_TLS] = millis() - t;
+  sampleHeap(slot);
+  return ok;
+}
+
+// Request on the leased slot is over: heap stats, keep or close, give the slot back
+static void finishRequest(PoolSlot& slot, bool keep) {
+  sampleHeap(slot);
+  portENTER_CRITICAL(&poolMux);
+  if (slot.stats >= 0) {
+    HostStats& s = hostStats[slot.stats];
+    uint32_t used = slot.heapBefore - slot.heapLow;
+    if (slot.heapLow < s.heapMin) s.heapMin = slot.heapLow;
+    if (used > s.heapUseMax) s.heapUseMax = used;
+  }
+  slot.open = slot.secure && keep;
+  slot.lastUsed = millis();
+  slot.leased = false;
+  portEXIT_CRITICAL(&poolMux);
+}
+
+static HTTPClient* beginOn(const char* url, bool longPoll, unsigned long waitMs) {
+  unsigned long calledAt = millis();
+  char host[HOST_LEN];
+  uint16_t port;
+  bool secure;
+  if (!parseUrl(url, host, &port, &secure)) {
+    Serial.println("HTTP pool: unsupported URL");
+    return nullptr;
+  }
+  int8_t i = leaseSlot(host, port, secure, longPoll, waitMs);
+  if (i < 0) {
+    Serial.print("HTTP pool: no free connection for ");
+    Serial.println(host);
+    return nullptr;
+  }
+
+  PoolSlot& slot = slots[i];
+  bool connected = slot.open;
+  if (!connected) {
+    // Fresh connection: (re)label the slot; a plain client left over from http:// is closed
+    slot.tcp->stop();
+    portENTER_CRITICAL(&poolMux);
+    strncpy(slot.host, host, HOST_LEN - 1);
+    slot.host[HOST_LEN - 1] = '\0';
+    slot.port = port;
+    slot.secure = secure;
+    slot.stats = statsFor(host);
+    portEXIT_CRITICAL(&poolMux);
+  } else if (!slot.tls->connected()) {
+    // Closed by the server while idle
+    slot.tls->stop();
+    connected = false;
+  }
+  startRequest(slot, connected);
+  netPerfBegin(&slot.perf, nullptr);
+  slot.calledAt = calledAt;
+  slot.respondedAt = 0;
+  if (!connected && !connectSlot(slot, host, port)) {
+    Serial.print("HTTP pool: connect failed to ");
+    Serial.println(host);
+    slot.tls->stop();
+    slot.tcp->stop();
+    finishRequest(slot, false);
+    return nullptr;
+  }
+  slot.sentAt = millis();
+
+  HTTPClient& http = *slot.http;
+  http.setReuse(true);
+  http.useHTTP10(false);
+  bool ok;
+  if (secure) {
+    ok = http.begin(*slot.tls, url);
+  } else {
+    ok = http.begin(*slot.tcp, url);
+  }
+  if (!ok) {
+    httpPoolEnd(&http, false);
+    return nullptr;
+  }
+  httpCollectHeaders(http);
+  return &http;
+}
+
+HTTPClient* httpPoolBegin(const char* url, unsigned long waitMs) {
+  return beginOn(url, false, waitMs);
+}
+
+HTTPClient* httpPoolBeginLongPoll(const char* url, unsigned long waitMs) {
+  return beginOn(url, true, waitMs);
+}
+
+void httpPoolResponded(HTTPClient* http) {
+  int8_t i = slotOf(http);
+  if (i < 0) return;
+  PoolSlot& slot = slots[i];
+  sampleHeap(slot);
+  slot.respondedAt = millis();
+  slot.perf.ms[NET_PHASE_TTFB] = slot.respondedAt - slot.sentAt;
+  uint32_t rtt = slot.respondedAt - slot.startedAt;
+  portENTER_CRITICAL(&poolMux);
+  if (slot.stats >= 0) {
+    HostStats& s = hostStats[slot.stats];
+    s.responses++;
+    s.rttSum += rtt;
+    if (rtt > s.rttMax) s.rttMax = rtt;
+  }
+  portEXIT_CRITICAL(&poolMux);
+}
+
+bool httpPoolReused(HTTPClient* http) {
+  int8_t i = slotOf(http);
+  return i >= 0 && slots[i].reused;
+}
+
+void httpPoolEnd(HTTPClient* http, bool reusable) {
+  httpReleaseGzip(*http);
+  int8_t i = slotOf(http);
+  if (i < 0) return;
+  PoolSlot& slot = slots[i];
+  WiFiClient& client = slot.secure ? *slot.tls : *slot.tcp;
+  sampleHeap(slot);
+  // Keeps the socket when the server allowed keep-alive
+  http->end();
+  bool keep = reusable && client.connected();
+  if (!keep) client.stop();
+
+  // Telemetry of a labelled request (see httpPoolSample)
+  unsigned long now = millis();
+  NetPerfSample perf = slot.perf;
+  if (slot.respondedAt != 0) perf.ms[NET_PHASE_BODY] = now - slot.respondedAt;
+  perf.ms[NET_PHASE_TOTAL] = now - slot.calledAt;
+  perf.heapLow = slot.heapLow;
+  finishRequest(slot, keep);
+  netPerfRecord(perf);
+}
+
+NetPerfSample* httpPoolSample(HTTPClient* http) {
+  int8_t i = slotOf(http);
+  return i >= 0 ? &slots[i].perf : nullptr;
+}
+
+String httpPoolReport() {
+  HostStats copy[HTTP_POOL_MAX_HOSTS];
+  uint8_t count;
+  uint8_t open = 0;
+  uint8_t longPolls = 0;
+  portENTER_CRITICAL(&poolMux);
+  count = hostCount;
+  memcpy(copy, hostStats, sizeof(HostStats) * count);
+  for (uint8_t i = 0; i < SLOTS; i++) {
+    if (!slots[i].open) continue;
+    if (isLongPollSlot(i)) longPolls++;
+    else open++;
+  }
+  portEXIT_CRITICAL(&poolMux);
+
+  String out = "TLS contexts: " + String(open) + "/" + String(HTTP_POOL_MAX_TLS) +
+               " + " + String(longPolls) + " long poll";
+  for (uint8_t i = 0; i < count; i++) {
+    const HostStats& s = copy[i];
+    out += "\n";
+    out += s.host;
+    out += "\n  ";
+    out += String(s.requests);
+    out += " req, ";
+    out += String(s.reused);
+    out += " reused, ";
+    out += String(s.handshakes);
+    out += " new";
+    if (s.responses > 0) {
+      out += "\n  rtt avg ";
+      out += String(s.rttSum / s.responses);
+      out += " ms, max ";
+      out += String(s.rttMax);
+      out += " ms";
+    }
+    if (s.heapMin != UINT32_MAX) {
+      out += "\n  heap min ";
+      out += String(s.heapMin / 1024);
+      out += " KB, peak use ";
+      out += String(s.heapUseMax / 1024);
+      out += " KB";
+    }
+  }
+  return out;
+}
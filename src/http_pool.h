@@ -0,0 +1,74 @@
+// Shared HTTPS connections: HTTP/1.1 keep-alive per host and a cap on live TLS contexts
+// Bitrix24 REST, Pull and the Telegram bot draw from one pool, so back-to-back requests to a
+// host skip the TLS handshake and the number of TLS contexts in RAM at once stays bounded.
+
+#ifndef HTTP_POOL_H
+#define HTTP_POOL_H
+
+#include <Arduino.h>
+
+class HTTPClient;
+struct NetPerfSample;
+
+// TLS contexts alive at once for ordinary requests (each holds ~40 KB of heap while
+// connected). Bitrix24 REST and Telegram sends need one each, so with fewer they take turns.
+#ifndef HTTP_POOL_MAX_TLS
+#define HTTP_POOL_MAX_TLS 2
+#endif
+
+// Connections for long polls (Telegram getUpdates, Bitrix24 Pull), outside HTTP_POOL_MAX_TLS.
+// A long poll holds its connection for up to a minute; on a slot of its own it never makes a
+// short request wait for it.
+#ifndef HTTP_POOL_LONG_POLLS
+#define HTTP_POOL_LONG_POLLS 2
+#endif
+
+// Idle connections older than this are closed instead of reused (the server has likely
+// dropped them by then), ms
+#ifndef HTTP_POOL_IDLE_TIMEOUT
+#define HTTP_POOL_IDLE_TIMEOUT 15000UL
+#endif
+
+// Longest a request waits for a free connection, ms
+#ifndef HTTP_POOL_WAIT
+#define HTTP_POOL_WAIT 15000UL
+#endif
+
+// Hosts with statistics (further hosts are pooled but not reported)
+#define HTTP_POOL_MAX_HOSTS 4
+
+// Unread body worth skipping to keep a connection (cheaper than a new TLS handshake), bytes
+#ifndef HTTP_POOL_DRAIN_MAX
+#define HTTP_POOL_DRAIN_MAX 4096
+#endif
+
+// Start a request on a pooled connection to the URL's host (http.begin with keep-alive).
+// Waits up to waitMs for a free connection; nullptr when none became free. The client
+// belongs to the pool: always hand it back with httpPoolEnd(). http:// URLs get a connection
+// too but are never kept alive.
+HTTPClient* httpPoolBegin(const char* url, unsigned long waitMs = HTTP_POOL_WAIT);
+
+// The same for a request the server holds open (long poll): it takes one of the
+// HTTP_POOL_LONG_POLLS slots, so it neither counts against nor waits on the TLS cap
+HTTPClient* httpPoolBeginLongPoll(const char* url, unsigned long waitMs = HTTP_POOL_WAIT);
+
+// Response headers arrived: records the round trip (including any handshake) for the host
+void httpPoolResponded(HTTPClient* http);
+
+// The request went out on a connection kept from an earlier one. If it failed without a
+// response, the server probably closed it while idle: end it and retry once.
+bool httpPoolReused(HTTPClient* http);
+
+// Finish the request (calls http->end()). The connection stays open for the next request to
+// the same host only when `reusable` (body read to its end, see HttpBodyStream::complete()).
+void httpPoolEnd(HTTPClient* http, bool reusable);
+
+// Telemetry of the request in progress (net_perf.h): set `name` to have httpPoolEnd()
+// record it, plus whatever only the caller knows (status, bytes, retries). Connect, TTFB,
+// body and heap are filled in by the pool.
+NetPerfSample* httpPoolSample(HTTPClient* http);
+
+// Per-host report: requests, connection reuse, round-trip time and heap use
+String httpPoolReport();
+
+#endif // HTTP_POOL_H
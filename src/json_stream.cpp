@@ -0,0 +1,278 @@
+// Incremental JSON tokenizer implementation
+
+#include "json_stream.h"
+#include <string.h>
+
+JsonStreamReader::JsonStreamReader(Stream& stream)
+  : in(stream), bufPos(0), bufLen(0), consumed(0), arrayMask(0),
+    depth(0), tokenLevel(0), done(false), error(false), ended(false) {
+  value[0] = '\0';
+  for (uint8_t i = 0; i < MAX_DEPTH; i++) {
+    keys[i][0] = '\0';
+  }
+}
+
+// Read one byte (refills the small buffer from the stream, honoring stream timeout)
+int JsonStreamReader::readChar() {
+  int c = peekChar();
+  if (c >= 0) {
+    bufPos++;
+    consumed++;
+  }
+  return c;
+}
+
+int JsonStreamReader::peekChar() {
+  if (bufPos >= bufLen) {
+    int avail = in.available();
+    size_t want = (avail > 0) ? (size_t)avail : 1;
+    if (want > BUF_LEN) want = BUF_LEN;
+    bufLen = (uint8_t)in.readBytes(buf, want);
+    bufPos = 0;
+    if (bufLen == 0) {
+      ended = true;
+      return -1;  // Stream closed or timed out
+    }
+  }
+  return buf[bufPos];
+}
+
+int JsonStreamReader::skipWhitespace() {
+  while (true) {
+    int c = readChar();
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+      return c;
+    }
+  }
+}
+
+JsonToken JsonStreamReader::fail() {
+  error = true;
+  value[0] = '\0';
+  return JSON_ERROR;
+}
+
+// Append a Unicode code point as UTF-8 (truncating at cap)
+static void appendUtf8(char* out, uint8_t& len, uint8_t cap, uint32_t cp) {
+  char tmp[4];
+  uint8_t n;
+  if (cp < 0x80) {
+    tmp[0] = (char)cp; n = 1;
+  } else if (cp < 0x800) {
+    tmp[0] = (char)(0xC0 | (cp >> 6));
+    tmp[1] = (char)(0x80 | (cp & 0x3F)); n = 2;
+  } else if (cp < 0x10000) {
+    tmp[0] = (char)(0xE0 | (cp >> 12));
+    tmp[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    tmp[2] = (char)(0x80 | (cp & 0x3F)); n = 3;
+  } else {
+    tmp[0] = (char)(0xF0 | (cp >> 18));
+    tmp[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    tmp[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    tmp[3] = (char)(0x80 | (cp & 0x3F)); n = 4;
+  }
+  // Don't split a multi-byte sequence when truncating
+  if (len + n < cap) {
+    memcpy(out + len, tmp, n);
+    len += n;
+  }
+}
+
+static int hexValue(int c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Read string body (opening quote already consumed); decodes escapes
+bool JsonStreamReader::readString(char* out, uint8_t cap) {
+  uint8_t len = 0;
+  uint32_t pendingHigh = 0;  // High surrogate waiting for its pair
+  bool truncated = false;
+  while (true) {
+    int c = readChar();
+    if (c < 0) return false;
+    if (c == '"') break;
+    if (c != '\\') {
+      if (len + 1 < cap) out[len++] = (char)c;
+      else truncated = true;
+      continue;
+    }
+    c = readChar();
+    switch (c) {
+      case '"': case '\\': case '/':
+        if (len + 1 < cap) out[len++] = (char)c;
+        break;
+      case 'b': if (len + 1 < cap) out[len++] = '\b'; break;
+      case 'f': if (len + 1 < cap) out[len++] = '\f'; break;
+      case 'n': if (len + 1 < cap) out[len++] = '\n'; break;
+      case 'r': if (len + 1 < cap) out[len++] = '\r'; break;
+      case 't': if (len + 1 < cap) out[len++] = '\t'; break;
+      case 'u': {
+        uint32_t cp = 0;
+        for (uint8_t i = 0; i < 4; i++) {
+          int h = hexValue(readChar());
+          if (h < 0) return false;
+          cp = (cp << 4) | (uint32_t)h;
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+          pendingHigh = cp;
+          continue;
+        }
+        if (cp >= 0xDC00 && cp <= 0xDFFF && pendingHigh != 0) {
+          cp = 0x10000 + ((pendingHigh - 0xD800) << 10) + (cp - 0xDC00);
+        }
+        appendUtf8(out, len, cap, cp);
+        break;
+      }
+      default:
+        return false;
+    }
+    pendingHigh = 0;
+  }
+  // Raw UTF-8 may have been cut mid-character: drop the incomplete tail
+  if (truncated) {
+    uint8_t start = len;
+    while (start > 0 && ((uint8_t)out[start - 1] & 0xC0) == 0x80) start--;
+    if (start > 0) {
+      uint8_t lead = (uint8_t)out[start - 1];
+      uint8_t need = (lead >= 0xF0) ? 4 : (lead >= 0xE0) ? 3 : (lead >= 0xC0) ? 2 : 1;
+      if (len - (start - 1) < need) len = start - 1;
+    }
+  }
+  out[len] = '\0';
+  return true;
+}
+
+bool JsonStreamReader::readNumber(int first) {
+  uint8_t len = 0;
+  value[len++] = (char)first;
+  while (true) {
+    int c = peekChar();
+    bool numeric = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    if (!numeric) break;
+    readChar();
+    if (len + 1 < VALUE_LEN) value[len++] = (char)c;
+  }
+  value[len] = '\0';
+  return true;
+}
+
+bool JsonStreamReader::readLiteral(int first) {
+  const char* expected = (first == 't') ? "true" : (first == 'f') ? "false" : "null";
+  for (uint8_t i = 1; expected[i] != '\0'; i++) {
+    if (readChar() != expected[i]) return false;
+  }
+  strcpy(value, expected);
+  return true;
+}
+
+JsonToken JsonStreamReader::next() {
+  if (error) return JSON_ERROR;
+  if (done) return JSON_END;
+
+  int c = skipWhitespace();
+  if (c == ',') {
+    c = skipWhitespace();
+  }
+  if (c < 0) return fail();
+
+  // Close container
+  if (c == '}' || c == ']') {
+    if (depth == 0) return fail();
+    bool wasArray = (arrayMask >> (depth - 1)) & 1;
+    if (wasArray != (c == ']')) return fail();
+    depth--;
+    tokenLevel = depth;
+    value[0] = '\0';
+    if (depth == 0) done = true;
+    return wasArray ? JSON_ARRAY_END : JSON_OBJECT_END;
+  }
+
+  // Member key (inside object) or array element
+  if (depth > 0) {
+    uint8_t container = depth - 1;
+    if ((arrayMask >> container) & 1) {
+      keys[container][0] = '\0';
+    } else {
+      if (c != '"' || !readString(keys[container], KEY_LEN)) return fail();
+      if (skipWhitespace() != ':') return fail();
+      c = skipWhitespace();
+      if (c < 0) return fail();
+    }
+  }
+
+  tokenLevel = depth;
+  value[0] = '\0';
+
+  if (c == '{' || c == '[') {
+    if (depth >= MAX_DEPTH) return fail();
+    if (c == '[') {
+      arrayMask |= (uint16_t)(1u << depth);
+    } else {
+      arrayMask &= (uint16_t)~(1u << depth);
+    }
+    keys[depth][0] = '\0';
+    depth++;
+    return (c == '[') ? JSON_ARRAY_START : JSON_OBJECT_START;
+  }
+
+  JsonToken token;
+  if (c == '"') {
+    if (!readString(value, VALUE_LEN)) return fail();
+    token = JSON_STRING;
+  } else if (c == '-' || (c >= '0' && c <= '9')) {
+    readNumber(c);
+    token = JSON_NUMBER;
+  } else if (c == 't' || c == 'f' || c == 'n') {
+    if (!readLiteral(c)) return fail();
+    token = (c == 'n') ? JSON_NULL : JSON_BOOL;
+  } else {
+    return fail();
+  }
+
+  if (depth == 0) done = true;  // Scalar root
+  return token;
+}
+
+bool JsonStreamReader::skipValue() {
+  if (depth == 0) return !error;
+  uint8_t target = depth - 1;
+  while (true) {
+    JsonToken t = next();
+    if (t == JSON_ERROR) return false;
+    if ((t == JSON_OBJECT_END || t == JSON_ARRAY_END) && depth == target) return true;
+    if (t == JSON_END) return true;
+  }
+}
+
+const char* JsonStreamReader::keyAt(uint8_t lvl) const {
+  if (lvl >= tokenLevel || lvl >= MAX_DEPTH) return "";
+  return keys[lvl];
+}
+
+bool JsonStreamReader::matchesFrom(uint8_t base, const char* path) const {
+  uint8_t lvl = base;
+  const char* p = path;
+  while (*p != '\0') {
+    if (lvl >= tokenLevel) return false;
+    const char* end = strchr(p, '.');
+    size_t segLen = end ? (size_t)(end - p) : strlen(p);
+    bool isArrayLevel = (arrayMask >> lvl) & 1;
+    if (segLen == 1 && p[0] == '#') {
+      if (!isArrayLevel) return false;
+    } else if (!(segLen == 1 && p[0] == '*')) {
+      if (isArrayLevel) return false;
+      if (strlen(keys[lvl]) != segLen || strncmp(keys[lvl], p, segLen) != 0) return false;
+    }
+    lvl++;
+    p = end ? end + 1 : p + segLen;
+  }
+  return lvl == tokenLevel;
+}
+
+long JsonStreamReader::asInt() const {
+  // Bitrix often sends numbers as strings ("17"), so both are accepted
+  return strtol(value, nullptr, 10);
+}
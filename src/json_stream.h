@@ -0,0 +1,89 @@
+// Incremental JSON tokenizer (pull parser) reading directly from a Stream
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+
+// Tokens returned by JsonStreamReader::next()
+enum JsonToken : uint8_t {
+  JSON_NONE = 0,
+  JSON_OBJECT_START,
+  JSON_OBJECT_END,
+  JSON_ARRAY_START,
+  JSON_ARRAY_END,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_BOOL,
+  JSON_NULL,
+  JSON_END,    // Root value complete
+  JSON_ERROR   // Syntax error, nesting too deep or stream ended early
+};
+
+// Fixed-memory pull parser: no document is built, only the path of the current
+// token (object keys / array levels) and the text of the current scalar are kept.
+// Keys longer than KEY_LEN-1 and values longer than VALUE_LEN-1 are truncated.
+//
+// Path of a token = keys of the containers it is nested in plus its own key, e.g.
+// in {"result":{"TYPE":{"DIALOG":3}}} the number 3 has path "result.TYPE.DIALOG"
+// (level 3). Array elements use "#" as their path segment: "result.#.USER_ID".
+// *_START / *_END tokens carry the path of the container itself.
+class JsonStreamReader {
+public:
+  static const uint8_t MAX_DEPTH = 10;
+  static const uint8_t KEY_LEN = 24;
+  static const uint8_t VALUE_LEN = 128;  // Fits a ~60 char Cyrillic group name
+  static const uint8_t BUF_LEN = 64;
+
+  explicit JsonStreamReader(Stream& stream);
+
+  // Read next token
+  JsonToken next();
+
+  // After a *_START token: consume the whole container (returns false on error)
+  bool skipValue();
+
+  // Path of the current token
+  uint8_t level() const { return tokenLevel; }
+  const char* keyAt(uint8_t lvl) const;
+  // Match full path ("result.TYPE.DIALOG"); "#" = array element, "*" = any key
+  bool matches(const char* path) const { return matchesFrom(0, path); }
+  // Match path relative to level `base` ("" matches the token at level `base` itself)
+  bool matchesFrom(uint8_t base, const char* path) const;
+
+  // Current scalar value
+  const char* text() const { return value; }
+  long asInt() const;
+  bool asBool() const { return value[0] == 't'; }
+
+  size_t bytesRead() const { return consumed; }
+  bool failed() const { return error; }
+  // Failed because the stream ran out (closed or timed out), not on bad or too deep JSON
+  bool truncated() const { return error && ended; }
+
+private:
+  int readChar();
+  int peekChar();
+  int skipWhitespace();
+  bool readString(char* out, uint8_t cap);
+  bool readLiteral(int first);
+  bool readNumber(int first);
+  JsonToken fail();
+
+  Stream& in;
+  uint8_t buf[BUF_LEN];
+  uint8_t bufPos;
+  uint8_t bufLen;
+  size_t consumed;
+
+  char keys[MAX_DEPTH][KEY_LEN];  // keys[i] = key of current member of container i
+  uint16_t arrayMask;             // bit i set = container i is an array
+  uint8_t depth;                  // Number of open containers
+  uint8_t tokenLevel;
+  char value[VALUE_LEN];
+  bool done;
+  bool error;
+  bool ended;                     // The stream had no more bytes
+};
+
+#endif // JSON_STREAM_H
@@ -25,6 +25,9 @@
 #include "display_updates.h"
 #include "auto_rotation.h"
 #include "bitrix24.h"
+#include "bitrix24_pull.h"
+#include "bitrix24_fleet.h"
+#include "time_service.h"
 #include "wifi_ap.h"
 
 // Suppress core dump error messages early (before setup runs)
@@ -105,8 +108,14 @@ void setup(void) {
   // Start Telegram task on separate core
   startTelegramTask();
   
-  // Initialize Bitrix24
+  // Wall clock (SNTP) for Bitrix24 date filters
+  initTimeService();
+
+  // Initialize Bitrix24 and start polling in background
   initBitrix24();
+  startBitrix24Task();
+  startBitrix24PullTask();  // Only runs when Pull mode is enabled
+  startBitrix24FleetTask(); // Only runs when fleet mode is enabled
 
   displayStoppedState();
 }
@@ -125,20 +134,22 @@ void loop() {
   // Handle AP web server requests if AP is active
   handleAPWebServer();
   
-  // Update Bitrix24 counts periodically (non-blocking)
-  // Skip updates when AP is active OR WiFi is not connected (prevents infinite retry loop)
-  if (!isAPActive() && WiFi.status() == WL_CONNECTED && shouldUpdateBitrix24()) {
-    // Don't block - update in background
-    Bitrix24Counts counts;
-    bool wasManualRefresh = b24ManualRefresh;  // Remember if this was a manual refresh
-    bool success = fetchBitrix24Counts(&counts);
+  // Pick up Bitrix24 counts published by the background task (never blocks on network)
+  static uint32_t lastB24Seq = 0;
+  uint32_t b24Seq = getBitrix24CountsSeq();
+  if (b24Seq != lastB24Seq) {
+    lastB24Seq = b24Seq;
+    bool success = getBitrix24Counts().valid;
+    b24Refreshing = false;
     // If manual refresh was active, clear the flag and show normal screen
-    if (wasManualRefresh) {
+    if (b24ManualRefresh) {
       b24ManualRefresh = false;
-    }
-    // If we're on B24 screen, redraw it with new data
-    if (currentViewMode == VIEW_MODE_B24 && success) {
-      drawB24Placeholder();
+      if (currentViewMode == VIEW_MODE_B24 && success) {
+        drawB24Placeholder();
+      }
+    } else if (currentViewMode == VIEW_MODE_B24) {
+      // Only the badges whose numbers changed are repainted
+      updateB24Placeholder();
     }
   }
 
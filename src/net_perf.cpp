@@ -0,0 +1,256 @@
+// Network call telemetry implementation
+// Latencies go into log-spaced buckets; percentiles are reported as the bucket's upper
+// bound, which is plenty to see which method dominates a refresh.
+
+#include "net_perf.h"
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+
+static const uint32_t BUCKET_BOUNDS[NET_PERF_BUCKETS - 1] = {
+  10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000
+};
+static const char* const PHASE_NAMES[NET_PHASE_COUNT] = {"dns", "tls", "ttfb", "body", "total"};
+static const size_t NAME_LEN = 28;
+static const size_t REPORT_MAX = 3800;  // Below Telegram's 4096-character message limit
+
+enum StatusClass : uint8_t {
+  STATUS_2XX = 0,
+  STATUS_3XX,
+  STATUS_4XX,
+  STATUS_5XX,
+  STATUS_ERROR,
+  STATUS_CLASSES
+};
+
+struct MethodStats {
+  char name[NAME_LEN];
+  uint32_t calls;
+  uint32_t timeSum;        // ms of NET_PHASE_TOTAL
+  uint32_t bytesOut;
+  uint32_t bytesIn;
+  uint32_t status[STATUS_CLASSES];
+  uint32_t retries;
+  uint32_t heapLow;
+  uint32_t heapUseMax;     // Largest drop in free heap during one call
+  uint16_t hist[NET_PHASE_COUNT][NET_PERF_BUCKETS];
+};
+
+static portMUX_TYPE perfMux = portMUX_INITIALIZER_UNLOCKED;
+static MethodStats methods[NET_PERF_MAX_METHODS];
+static uint8_t methodCount = 0;
+static unsigned long statsSince = 0;
+static unsigned long lastLog = 0;
+static bool logDue = false;
+
+static uint8_t bucketOf(uint32_t ms) {
+  uint8_t b = 0;
+  while (b < NET_PERF_BUCKETS - 1 && ms > BUCKET_BOUNDS[b]) b++;
+  return b;
+}
+
+// Callers hold perfMux. The last row collects methods that didn't get one.
+static MethodStats& rowFor(const char* name) {
+  for (uint8_t i = 0; i < methodCount; i++) {
+    if (strcmp(methods[i].name, name) == 0) return methods[i];
+  }
+  if (methodCount < NET_PERF_MAX_METHODS - 1) {
+    MethodStats& row = methods[methodCount++];
+    memset(&row, 0, sizeof(row));
+    strncpy(row.name, name, NAME_LEN - 1);
+    row.heapLow = UINT32_MAX;
+    return row;
+  }
+  MethodStats& other = methods[NET_PERF_MAX_METHODS - 1];
+  if (methodCount < NET_PERF_MAX_METHODS) {
+    memset(&other, 0, sizeof(other));
+    strncpy(other.name, "other", NAME_LEN - 1);
+    other.heapLow = UINT32_MAX;
+    methodCount = NET_PERF_MAX_METHODS;
+  }
+  return other;
+}
+
+// A full bucket halves the whole phase, so old calls fade instead of the counts sticking
+static void addToHistogram(uint16_t* hist, uint32_t ms) {
+  uint8_t b = bucketOf(ms);
+  if (hist[b] == UINT16_MAX) {
+    for (uint8_t i = 0; i < NET_PERF_BUCKETS; i++) hist[i] /= 2;
+  }
+  hist[b]++;
+}
+
+void netPerfBegin(NetPerfSample* sample, const char* name) {
+  sample->name = name;
+  for (uint8_t p = 0; p < NET_PHASE_COUNT; p++) sample->ms[p] = NET_PERF_NONE;
+  sample->bytesOut = 0;
+  sample->bytesIn = 0;
+  sample->status = 0;
+  sample->retries = 0;
+  sample->heapBefore = ESP.getFreeHeap();
+  sample->heapLow = sample->heapBefore;
+}
+
+void netPerfRecord(const NetPerfSample& sample) {
+  if (sample.name == nullptr) return;
+  uint8_t statusClass = STATUS_ERROR;
+  if (sample.status >= 200 && sample.status < 600) {
+    statusClass = (uint8_t)(sample.status / 100 - 2);
+  }
+
+  unsigned long now = millis();
+  portENTER_CRITICAL(&perfMux);
+  MethodStats& row = rowFor(sample.name);
+  row.calls++;
+  for (uint8_t p = 0; p < NET_PHASE_COUNT; p++) {
+    if (sample.ms[p] != NET_PERF_NONE) addToHistogram(row.hist[p], sample.ms[p]);
+  }
+  if (sample.ms[NET_PHASE_TOTAL] != NET_PERF_NONE) row.timeSum += sample.ms[NET_PHASE_TOTAL];
+  row.bytesOut += sample.bytesOut;
+  row.bytesIn += sample.bytesIn;
+  row.status[statusClass]++;
+  row.retries += sample.retries;
+  if (sample.heapLow < row.heapLow) row.heapLow = sample.heapLow;
+  if (sample.heapBefore > sample.heapLow && sample.heapBefore - sample.heapLow > row.heapUseMax) {
+    row.heapUseMax = sample.heapBefore - sample.heapLow;
+  }
+  if (NET_PERF_LOG_INTERVAL > 0 && now - lastLog >= NET_PERF_LOG_INTERVAL) {
+    lastLog = now;
+    logDue = true;
+  }
+  portEXIT_CRITICAL(&perfMux);
+}
+
+// Bucket holding the p-th percentile (p in percent)
+static uint8_t percentileBucket(const uint16_t* hist, uint32_t total, uint8_t p) {
+  uint32_t target = (total * p + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < NET_PERF_BUCKETS; b++) {
+    seen += hist[b];
+    if (seen >= target) return b;
+  }
+  return NET_PERF_BUCKETS - 1;
+}
+
+static String bucketLabel(uint8_t b) {
+  if (b >= NET_PERF_BUCKETS - 1) {
+    return String(BUCKET_BOUNDS[NET_PERF_BUCKETS - 2] / 1000) + "s+";
+  }
+  uint32_t bound = BUCKET_BOUNDS[b];
+  if (bound >= 1000) return "≤" + String(bound / 1000) + "s";
+  return "≤" + String(bound) + "ms";
+}
+
+static String phaseLine(const MethodStats& row, uint8_t phase) {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < NET_PERF_BUCKETS; b++) total += row.hist[phase][b];
+  if (total == 0) return "";
+  String line = "\n  ";
+  line += PHASE_NAMES[phase];
+  line += " p50 " + bucketLabel(percentileBucket(row.hist[phase], total, 50));
+  line += " p90 " + bucketLabel(percentileBucket(row.hist[phase], total, 90));
+  line += " p99 " + bucketLabel(percentileBucket(row.hist[phase], total, 99));
+  if (phase == NET_PHASE_DNS || phase == NET_PHASE_TLS) {
+    line += " (" + String(total) + " new)";
+  }
+  return line;
+}
+
+static String rowReport(const MethodStats& row, uint32_t allTime) {
+  String out = "\n";
+  out += row.name;
+  out += ": ";
+  out += String(row.calls);
+  out += " calls, ";
+  out += String(row.timeSum / 1000.0f, 1);
+  out += " s";
+  if (allTime > 0) {
+    out += " (" + String((uint32_t)((uint64_t)row.timeSum * 100 / allTime)) + "%)";
+  }
+
+  out += "\n  ok " + String(row.status[STATUS_2XX]);
+  if (row.status[STATUS_3XX]) out += " · 3xx " + String(row.status[STATUS_3XX]);
+  if (row.status[STATUS_4XX]) out += " · 4xx " + String(row.status[STATUS_4XX]);
+  if (row.status[STATUS_5XX]) out += " · 5xx " + String(row.status[STATUS_5XX]);
+  if (row.status[STATUS_ERROR]) out += " · err " + String(row.status[STATUS_ERROR]);
+  if (row.retries) out += " · retry " + String(row.retries);
+
+  for (uint8_t p = NET_PHASE_TTFB; p <= NET_PHASE_BODY; p++) out += phaseLine(row, p);
+  out += phaseLine(row, NET_PHASE_TLS);
+  out += phaseLine(row, NET_PHASE_DNS);
+  // Calls timed only as a whole have no ttfb/body split
+  if (phaseLine(row, NET_PHASE_TTFB).length() == 0) {
+    out += phaseLine(row, NET_PHASE_TOTAL);
+  }
+
+  if (row.bytesIn || row.bytesOut) {
+    out += "\n  in " + String(row.bytesIn / 1024) + " KB, out " + String(row.bytesOut / 1024) + " KB";
+  }
+  if (row.heapLow != UINT32_MAX) {
+    out += "\n  heap low " + String(row.heapLow / 1024) + " KB, use " +
+           String(row.heapUseMax / 1024) + " KB";
+  }
+  return out;
+}
+
+String netPerfReport() {
+  // Order rows by time spent without copying the whole table at once
+  uint8_t order[NET_PERF_MAX_METHODS];
+  uint32_t times[NET_PERF_MAX_METHODS];
+  uint8_t count;
+  uint32_t allTime = 0;
+  unsigned long since;
+  portENTER_CRITICAL(&perfMux);
+  count = methodCount;
+  since = statsSince;
+  for (uint8_t i = 0; i < count; i++) {
+    order[i] = i;
+    times[i] = methods[i].timeSum;
+    allTime += times[i];
+  }
+  portEXIT_CRITICAL(&perfMux);
+  for (uint8_t i = 1; i < count; i++) {
+    for (uint8_t j = i; j > 0 && times[order[j]] > times[order[j - 1]]; j--) {
+      uint8_t t = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = t;
+    }
+  }
+
+  String out = "Network calls, last " + String((millis() - since) / 60000) + " min";
+  if (count == 0) {
+    out += "\nNo calls yet";
+    return out;
+  }
+  MethodStats row;
+  for (uint8_t i = 0; i < count; i++) {
+    portENTER_CRITICAL(&perfMux);
+    row = methods[order[i]];
+    portEXIT_CRITICAL(&perfMux);
+    String part = rowReport(row, allTime);
+    if (out.length() + part.length() > REPORT_MAX) {
+      out += "\n…";
+      break;
+    }
+    out += part;
+  }
+  return out;
+}
+
+void netPerfLog() {
+  Serial.println("[PERF] " + netPerfReport());
+}
+
+void netPerfLogIfDue() {
+  portENTER_CRITICAL(&perfMux);
+  bool due = logDue;
+  logDue = false;
+  portEXIT_CRITICAL(&perfMux);
+  if (due) netPerfLog();
+}
+
+void netPerfClear() {
+  portENTER_CRITICAL(&perfMux);
+  methodCount = 0;
+  statsSince = millis();
+  portEXIT_CRITICAL(&perfMux);
+}
@@ -0,0 +1,65 @@
+// Network call telemetry: per-method latency histograms, bytes, HTTP status and heap use
+// Filled by the HTTP pool (Bitrix24 REST) and the Telegram task; read by /perf and the
+// serial log. Everything lives in fixed-size tables, so recording never allocates.
+
+#ifndef NET_PERF_H
+#define NET_PERF_H
+
+#include <Arduino.h>
+
+// Methods with their own row; further methods share the last one ("other")
+#ifndef NET_PERF_MAX_METHODS
+#define NET_PERF_MAX_METHODS 12
+#endif
+
+// Print the report to the serial console this often (ms, 0 = only on /perf)
+#ifndef NET_PERF_LOG_INTERVAL
+#define NET_PERF_LOG_INTERVAL 900000UL
+#endif
+
+// Histogram buckets per phase (upper bounds 10 ms .. 20 s, the last one open-ended)
+#define NET_PERF_BUCKETS 12
+
+enum NetPerfPhase : uint8_t {
+  NET_PHASE_DNS = 0,   // Host lookup (new connections only)
+  NET_PHASE_TLS,       // TCP connect + TLS handshake (new connections only)
+  NET_PHASE_TTFB,      // Request sent until response headers
+  NET_PHASE_BODY,      // Response headers until the body was read
+  NET_PHASE_TOTAL,     // Whole call, including waiting for a connection
+  NET_PHASE_COUNT
+};
+
+// One finished call. Phases that didn't happen stay NET_PERF_NONE.
+#define NET_PERF_NONE UINT32_MAX
+
+struct NetPerfSample {
+  const char* name;        // Method (static string, e.g. "tasks.task.list"); nullptr = not recorded
+  uint32_t ms[NET_PHASE_COUNT];
+  uint32_t bytesOut;       // Request line target + body (headers excluded)
+  uint32_t bytesIn;        // Response body as received (before gzip inflation)
+  int16_t status;          // HTTP status, <= 0 when no response arrived
+  uint8_t retries;         // Repeated on a fresh connection after a dead kept-alive one
+  uint32_t heapLow;        // Lowest free heap seen during the call
+  uint32_t heapBefore;
+};
+
+// Reset `sample` for a new call
+void netPerfBegin(NetPerfSample* sample, const char* name);
+
+// Add a finished call to its method's row (thread-safe). Only marks the periodic log due:
+// the report is built by netPerfLogIfDue(), not on the caller's stack.
+void netPerfRecord(const NetPerfSample& sample);
+
+// Per-method table, slowest methods (by total time spent) first
+String netPerfReport();
+
+// Print netPerfReport() to the serial console
+void netPerfLog();
+
+// Print it when NET_PERF_LOG_INTERVAL has passed (polled by the Bitrix24 task loop)
+void netPerfLogIfDue();
+
+// Drop all statistics
+void netPerfClear();
+
+#endif // NET_PERF_H
@@ -109,3 +109,7 @@ unsigned long tgPromptUntilMs = 0;
 unsigned long apPromptUntilMs = 0;
 // B24 manual refresh flag (show spinner when user clicks B24 button)
 bool b24ManualRefresh = false;
+// B24 screen shows the last known counts while a refresh asked for by the user is in flight
+bool b24Refreshing = false;
+// B24 screen page (0 = counters, 1.. = watched groups, three per page)
+uint8_t b24ScreenPage = 0;
@@ -108,5 +108,9 @@ extern unsigned long tgPromptUntilMs;
 extern unsigned long apPromptUntilMs;
 // B24 manual refresh flag (show spinner when user clicks B24 button)
 extern bool b24ManualRefresh;
+// B24 screen shows the last known counts while a refresh asked for by the user is in flight
+extern bool b24Refreshing;
+// B24 screen page (0 = counters, 1.. = watched groups, three per page)
+extern uint8_t b24ScreenPage;
 
 #endif // POMODORO_GLOBALS_H
@@ -0,0 +1,103 @@
+// Allocation-free REST request building implementation
+
+#include "rest_query.h"
+#include <string.h>
+
+static const size_t ARENA_ALIGN = sizeof(void*);
+
+void* Arena::alloc(size_t size) {
+  size_t start = (used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if (start > cap || size > cap - start) {
+    return nullptr;
+  }
+  used = start + size;
+  if (used > peak) peak = used;
+  return base + start;
+}
+
+char* Arena::allocRest(size_t* capacity) {
+  size_t start = (used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if (start >= cap) {
+    *capacity = 0;
+    return nullptr;
+  }
+  *capacity = cap - start;
+  return (char*)alloc(cap - start);
+}
+
+void Arena::shrink(const void* block, size_t keep) {
+  const uint8_t* p = (const uint8_t*)block;
+  if (p < base || p > base + used) return;
+  size_t end = (size_t)(p - base) + keep;
+  if (end < used) used = end;
+}
+
+char* Arena::copy(const char* text) {
+  size_t n = strlen(text) + 1;
+  char* out = (char*)alloc(n);
+  if (out != nullptr) memcpy(out, text, n);
+  return out;
+}
+
+QueryBuilder::QueryBuilder(char* buffer, size_t capacity)
+  : buf(buffer), cap(capacity), len(0), overflow(buffer == nullptr || capacity == 0) {
+  if (!overflow) buf[0] = '\0';
+}
+
+void QueryBuilder::clear() {
+  len = 0;
+  overflow = (buf == nullptr || cap == 0);
+  if (!overflow) buf[0] = '\0';
+}
+
+QueryBuilder& QueryBuilder::raw(char c) {
+  if (overflow) return *this;
+  if (len + 1 >= cap) {
+    overflow = true;
+    return *this;
+  }
+  buf[len++] = c;
+  buf[len] = '\0';
+  return *this;
+}
+
+QueryBuilder& QueryBuilder::raw(const char* text) {
+  if (overflow) return *this;
+  size_t n = strlen(text);
+  if (len + n >= cap) {
+    overflow = true;
+    return *this;
+  }
+  memcpy(buf + len, text, n + 1);
+  len += n;
+  return *this;
+}
+
+QueryBuilder& QueryBuilder::encoded(const char* text) {
+  static const char hex[] = "0123456789ABCDEF";
+  for (const char* p = text; *p && !overflow; p++) {
+    char c = *p;
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+        c == '-' || c == '_' || c == '.' || c == '~') {
+      raw(c);
+    } else {
+      raw('%');
+      raw(hex[((uint8_t)c) >> 4]);
+      raw(hex[((uint8_t)c) & 0x0F]);
+    }
+  }
+  return *this;
+}
+
+QueryBuilder& QueryBuilder::param(const char* key, const char* value) {
+  if (len > 0 && buf[len - 1] != '?' && buf[len - 1] != '&') {
+    raw('&');
+  }
+  return raw(key).raw('=').encoded(value);
+}
+
+QueryBuilder& QueryBuilder::param(const char* key, uint32_t value) {
+  char digits[11];
+  snprintf(digits, sizeof(digits), "%lu", (unsigned long)value);
+  return param(key, digits);
+}
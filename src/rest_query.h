@@ -0,0 +1,66 @@
+// Allocation-free REST request building: fixed-capacity query/URL writer and a bump arena
+// Both write into caller-owned memory (stack or static), so building requests never touches
+// the heap and long uptimes don't fragment it.
+
+#ifndef REST_QUERY_H
+#define REST_QUERY_H
+
+#include <Arduino.h>
+
+// Bump-pointer arena over a fixed buffer: allocations are O(1) and only released all at
+// once by reset(). Meant for the temporary buffers of one refresh cycle.
+class Arena {
+public:
+  Arena(uint8_t* buffer, size_t capacity) : base(buffer), cap(capacity), used(0), peak(0) {}
+
+  // nullptr when the arena is full (nothing is allocated then)
+  void* alloc(size_t size);
+  // Everything left, for a builder whose final size isn't known; give back with shrink()
+  char* allocRest(size_t* capacity);
+  // Return the unused tail of the most recent allocation
+  void shrink(const void* block, size_t keep);
+  char* copy(const char* text);
+
+  void reset() { used = 0; }
+  size_t size() const { return used; }
+  size_t capacity() const { return cap; }
+  size_t highWater() const { return peak; }
+
+private:
+  uint8_t* base;
+  size_t cap;
+  size_t used;
+  size_t peak;
+};
+
+// Query string / URL writer over a fixed buffer. Text that doesn't fit is dropped and the
+// builder is marked overflowed (the request must not be sent then); the buffer always
+// stays NUL-terminated.
+class QueryBuilder {
+public:
+  QueryBuilder(char* buffer, size_t capacity);
+
+  // Append verbatim
+  QueryBuilder& raw(const char* text);
+  QueryBuilder& raw(char c);
+  // Append URL-encoded (unreserved characters are kept as-is)
+  QueryBuilder& encoded(const char* text);
+  // "key=value" with '&' before it unless the query is empty or ends in '?' / '&'.
+  // Keys are appended verbatim (e.g. "filter[<DEADLINE]"), values URL-encoded.
+  QueryBuilder& param(const char* key, const char* value);
+  QueryBuilder& param(const char* key, uint32_t value);
+
+  const char* c_str() const { return buf; }
+  size_t length() const { return len; }
+  bool overflowed() const { return overflow; }
+  bool ok() const { return !overflow; }
+  void clear();
+
+private:
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool overflow;
+};
+
+#endif // REST_QUERY_H
@@ -95,6 +95,30 @@ bool loadTelegramCredentials(char* botToken, size_t tokenLen, char* chatId, size
   return false;
 }
 
+// Save the live dashboard message id (written from the Telegram task, hence a local handle)
+void saveTelegramDashboard(const char* chatId, int32_t messageId) {
+  Preferences prefs;
+  if (!prefs.begin("telegram", false)) return;
+  if (messageId == 0) {
+    prefs.remove("dashMsg");
+    prefs.remove("dashChat");
+  } else {
+    prefs.putInt("dashMsg", messageId);
+    prefs.putString("dashChat", chatId);
+  }
+  prefs.end();
+}
+
+// Load the live dashboard message id
+int32_t loadTelegramDashboard(const char* chatId) {
+  Preferences prefs;
+  if (!prefs.begin("telegram", true)) return 0;
+  int32_t messageId = prefs.getInt("dashMsg", 0);
+  String savedChat = prefs.getString("dashChat", "");
+  prefs.end();
+  return (savedChat == chatId) ? messageId : 0;
+}
+
 // Save Bitrix24 credentials to NVS
 void saveBitrix24Credentials(const char* hostname, const char* restEndpoint) {
   preferences.begin("bitrix24", false);
@@ -124,3 +148,69 @@ bool loadBitrix24Credentials(char* hostname, size_t hostnameLen, char* restEndpo
   }
   return false;
 }
+
+// Save Bitrix24 group metadata cache to NVS
+// Own Preferences instance: called from the Bitrix24 task, not the UI loop
+void saveBitrix24GroupCache(const void* data, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("b24groups", false)) return;
+  prefs.putBytes("lru", data, len);
+  prefs.end();
+}
+
+// Load Bitrix24 group metadata cache from NVS
+size_t loadBitrix24GroupCache(void* data, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("b24groups", true)) {
+    // Namespace doesn't exist yet (first boot) - this is normal
+    return 0;
+  }
+  size_t stored = prefs.getBytesLength("lru");
+  size_t got = (stored == len) ? prefs.getBytes("lru", data, len) : 0;
+  prefs.end();
+  return got;
+}
+
+// Save Bitrix24 watched group IDs to NVS
+void saveBitrix24WatchedGroups(const uint32_t* groupIds, uint8_t count) {
+  Preferences prefs;
+  if (!prefs.begin("bitrix24", false)) return;
+  if (count == 0) {
+    prefs.remove("watch");
+  } else {
+    prefs.putBytes("watch", groupIds, count * sizeof(uint32_t));
+  }
+  prefs.end();
+}
+
+// Load Bitrix24 watched group IDs from NVS
+uint8_t loadBitrix24WatchedGroups(uint32_t* groupIds, uint8_t maxCount) {
+  Preferences prefs;
+  if (!prefs.begin("bitrix24", true)) {
+    return 0;
+  }
+  size_t bytes = prefs.getBytesLength("watch");
+  if (bytes > maxCount * sizeof(uint32_t)) bytes = maxCount * sizeof(uint32_t);
+  size_t got = (bytes > 0) ? prefs.getBytes("watch", groupIds, bytes) : 0;
+  prefs.end();
+  return (uint8_t)(got / sizeof(uint32_t));
+}
+
+// Save Bitrix24 counts snapshot to NVS (rate-limited by the caller)
+void saveBitrix24Snapshot(const void* data, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("bitrix24", false)) return;
+  prefs.putBytes("snap", data, len);
+  prefs.end();
+}
+
+// Load Bitrix24 counts snapshot from NVS
+size_t loadBitrix24Snapshot(void* data, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin("bitrix24", true)) {
+    return 0;
+  }
+  size_t got = (prefs.getBytesLength("snap") == len) ? prefs.getBytes("snap", data, len) : 0;
+  prefs.end();
+  return got;
+}
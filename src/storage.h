@@ -24,10 +24,34 @@ void saveTelegramCredentials(const char* botToken, const char* chatId);
 // Load Telegram credentials from NVS (returns true if found)
 bool loadTelegramCredentials(char* botToken, size_t tokenLen, char* chatId, size_t chatIdLen);
 
+// Save the live dashboard message of a chat (0 forgets it)
+void saveTelegramDashboard(const char* chatId, int32_t messageId);
+
+// Load the live dashboard message of a chat (0 if none, or saved for another chat)
+int32_t loadTelegramDashboard(const char* chatId);
+
 // Save Bitrix24 credentials to NVS
 void saveBitrix24Credentials(const char* hostname, const char* restEndpoint);
 
 // Load Bitrix24 credentials from NVS (returns true if found)
 bool loadBitrix24Credentials(char* hostname, size_t hostnameLen, char* restEndpoint, size_t endpointLen);
 
+// Save Bitrix24 group metadata cache (raw entry array, see bitrix24_group_cache.h)
+void saveBitrix24GroupCache(const void* data, size_t len);
+
+// Load Bitrix24 group metadata cache (returns bytes read, 0 if none)
+size_t loadBitrix24GroupCache(void* data, size_t len);
+
+// Save Bitrix24 watched group IDs to NVS
+void saveBitrix24WatchedGroups(const uint32_t* groupIds, uint8_t count);
+
+// Load Bitrix24 watched group IDs from NVS (returns count, 0 if none)
+uint8_t loadBitrix24WatchedGroups(uint32_t* groupIds, uint8_t maxCount);
+
+// Save Bitrix24 counts snapshot (raw struct, see bitrix24.cpp)
+void saveBitrix24Snapshot(const void* data, size_t len);
+
+// Load Bitrix24 counts snapshot (returns bytes read, 0 if none or size mismatch)
+size_t loadBitrix24Snapshot(void* data, size_t len);
+
 #endif // STORAGE_H
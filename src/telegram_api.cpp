@@ -0,0 +1,151 @@
+// Telegram Bot API wire format implementation
+
+#include "telegram_api.h"
+#include "json_stream.h"
+#include <string.h>
+#include <stdio.h>
+
+static void copyText(char* out, size_t cap, const char* text) {
+  strncpy(out, text, cap - 1);
+  out[cap - 1] = '\0';
+}
+
+uint8_t telegramPollSeconds(uint8_t timeoutSec) {
+  return timeoutSec > TELEGRAM_POLL_MAX_SEC ? TELEGRAM_POLL_MAX_SEC : timeoutSec;
+}
+
+bool telegramUpdatesQuery(QueryBuilder& url, int32_t lastUpdateId, uint8_t timeoutSec,
+                          const char* allowedUpdates) {
+  url.param("offset", (uint32_t)(lastUpdateId + 1));
+  url.param("limit", (uint32_t)TELEGRAM_UPDATES_MAX);
+  url.param("timeout", (uint32_t)telegramPollSeconds(timeoutSec));
+  url.param("allowed_updates", allowedUpdates);
+  return url.ok();
+}
+
+// Append `text` as a JSON string literal
+static void jsonString(QueryBuilder& q, const char* text) {
+  static const char hex[] = "0123456789abcdef";
+  q.raw('"');
+  for (const char* p = text; *p; p++) {
+    char c = *p;
+    if (c == '"' || c == '\\') {
+      q.raw('\\').raw(c);
+    } else if (c == '\n') {
+      q.raw("\\n");
+    } else if ((uint8_t)c < 0x20) {
+      q.raw("\\u00").raw(hex[(uint8_t)c >> 4]).raw(hex[c & 0x0F]);
+    } else {
+      q.raw(c);
+    }
+  }
+  q.raw('"');
+}
+
+static void jsonNumber(QueryBuilder& q, int32_t value) {
+  char digits[12];
+  snprintf(digits, sizeof(digits), "%ld", (long)value);
+  q.raw(digits);
+}
+
+// {"chat_id":"<id>" (and ,"message_id":<n>) -- the object is left open
+static void chatTarget(QueryBuilder& q, const char* chatId, int32_t messageId) {
+  q.raw("{\"chat_id\":");
+  jsonString(q, chatId);
+  if (messageId != 0) {
+    q.raw(",\"message_id\":");
+    jsonNumber(q, messageId);
+  }
+}
+
+static void htmlText(QueryBuilder& q, const char* text, const char* replyMarkup) {
+  q.raw(",\"parse_mode\":\"HTML\",\"text\":");
+  jsonString(q, text);
+  if (replyMarkup != nullptr) q.raw(",\"reply_markup\":").raw(replyMarkup);
+}
+
+
+bool telegramMessageBody(QueryBuilder& body, const char* chatId, int32_t messageId,
+                         const char* text, const char* replyMarkup, bool silent) {
+  chatTarget(body, chatId, messageId);
+  if (text != nullptr) htmlText(body, text, replyMarkup);
+  if (silent) body.raw(",\"disable_notification\":true");
+  body.raw('}');
+  return body.ok();
+}
+
+bool telegramCallbackBody(QueryBuilder& body, const char* callbackId) {
+  body.raw("{\"callback_query_id\":");
+  jsonString(body, callbackId);
+  body.raw('}');
+  return body.ok();
+}
+
+uint8_t telegramParseUpdates(Stream& body, TelegramUpdate* out, uint8_t max,
+                             int32_t* lastUpdateId, bool* ok) {
+  JsonStreamReader json(body);
+  TelegramUpdate update;
+  bool inUpdate = false;
+  bool full = false;       // An update didn't fit: it and everything after are fetched again
+  bool saidOk = false;
+  uint8_t count = 0;
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_BOOL && json.matches("ok")) {
+      saidOk = json.asBool();
+    } else if (token == JSON_OBJECT_START && json.matches("result.#")) {
+      memset(&update, 0, sizeof(update));
+      inUpdate = true;
+    } else if (token == JSON_OBJECT_END && json.matches("result.#")) {
+      if (update.type != TG_UPDATE_OTHER) {
+        if (count < max && !full) {
+          out[count++] = update;
+        } else {
+          full = true;
+        }
+      }
+      if (!full && update.updateId > *lastUpdateId) *lastUpdateId = update.updateId;
+      inUpdate = false;
+    } else if (!inUpdate || json.level() < 3) {
+      continue;
+    } else if (token == JSON_NUMBER && json.matches("result.#.update_id")) {
+      update.updateId = (int32_t)json.asInt();
+    } else if (token == JSON_NUMBER && (json.matches("result.#.message.chat.id") ||
+                                        json.matches("result.#.callback_query.message.chat.id"))) {
+      copyText(update.chatId, sizeof(update.chatId), json.text());
+    } else if (token == JSON_STRING && json.matches("result.#.message.text")) {
+      copyText(update.text, sizeof(update.text), json.text());
+      update.type = TG_UPDATE_MESSAGE;
+    } else if (token == JSON_STRING && json.matches("result.#.callback_query.id")) {
+      copyText(update.callbackId, sizeof(update.callbackId), json.text());
+      update.type = TG_UPDATE_CALLBACK;
+    } else if (token == JSON_STRING && json.matches("result.#.callback_query.data")) {
+      copyText(update.text, sizeof(update.text), json.text());
+    }
+  }
+  // An update the tokenizer can't read (e.g. nested too deep) would break every later poll
+  // the same way: skip it. A body cut short (connection lost, timeout) is just fetched again.
+  if (token == JSON_ERROR && !json.truncated() && inUpdate && !full &&
+      update.updateId > *lastUpdateId) {
+    *lastUpdateId = update.updateId;
+  }
+  *ok = saidOk && token == JSON_END;
+  return count;
+}
+
+void telegramParseReply(Stream& body, TelegramReply* reply) {
+  reply->ok = false;
+  reply->messageId = 0;
+  reply->description[0] = '\0';
+  JsonStreamReader json(body);
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_BOOL && json.matches("ok")) {
+      reply->ok = json.asBool();
+    } else if (token == JSON_NUMBER && json.matches("result.message_id")) {
+      reply->messageId = (int32_t)json.asInt();
+    } else if (token == JSON_STRING && json.matches("description")) {
+      copyText(reply->description, sizeof(reply->description), json.text());
+    }
+  }
+}
@@ -0,0 +1,74 @@
+// Telegram Bot API wire format: getUpdates queries, method bodies and response parsing
+// Pure (any Stream, a QueryBuilder for output), so recorded responses can be fed on a host;
+// telegram_client.cpp sends the requests over the HTTPS pool.
+
+#ifndef TELEGRAM_API_H
+#define TELEGRAM_API_H
+
+#include <Arduino.h>
+#include "rest_query.h"
+
+// Text kept per update (JsonStreamReader's value length; longer text is cut, our commands
+// are short)
+#define TELEGRAM_TEXT_LEN 128
+// Chat ids and callback query ids, kept as decimal text (chat ids exceed 32 bits)
+#define TELEGRAM_ID_LEN 24
+
+// Updates taken per getUpdates (the rest come with the next poll)
+#ifndef TELEGRAM_UPDATES_MAX
+#define TELEGRAM_UPDATES_MAX 4
+#endif
+
+enum TelegramUpdateType : uint8_t {
+  TG_UPDATE_OTHER = 0,   // Anything without text (photos, stickers, ...): only advances the offset
+  TG_UPDATE_MESSAGE,
+  TG_UPDATE_CALLBACK     // Inline keyboard button: `text` is its callback data
+};
+
+struct TelegramUpdate {
+  int32_t updateId;
+  TelegramUpdateType type;
+  char chatId[TELEGRAM_ID_LEN];
+  char callbackId[TELEGRAM_ID_LEN];  // TG_UPDATE_CALLBACK: query to answer
+  char text[TELEGRAM_TEXT_LEN];
+};
+
+// Outcome of a Bot API method call
+struct TelegramReply {
+  int16_t status;                    // HTTP status, <= 0 when no response arrived
+  bool ok;                           // "ok": true in the body
+  int32_t messageId;                 // result.message_id (sendMessage), 0 if none
+  char description[64];              // Error text, e.g. "Bad Request: message is not modified"
+};
+
+// HTTPClient's read timeout is 16-bit milliseconds, so a poll can't be held much longer
+#define TELEGRAM_POLL_MAX_SEC 55
+
+// Hold time actually asked of the server for a requested long-poll timeout
+uint8_t telegramPollSeconds(uint8_t timeoutSec);
+
+// getUpdates parameters for updates after `lastUpdateId` (offset, limit, timeout and
+// `allowedUpdates`, a JSON array such as ["message"]), appended to the method URL's '?'.
+// False when they didn't fit.
+bool telegramUpdatesQuery(QueryBuilder& url, int32_t lastUpdateId, uint8_t timeoutSec,
+                          const char* allowedUpdates);
+
+// JSON body addressing `chatId` (and `messageId` unless 0): sendMessage and editMessageText
+// with a `text` (HTML, optional `replyMarkup` object), deleteMessage and pinChatMessage
+// without. False when the body didn't fit.
+bool telegramMessageBody(QueryBuilder& body, const char* chatId, int32_t messageId,
+                         const char* text, const char* replyMarkup, bool silent);
+// answerCallbackQuery body
+bool telegramCallbackBody(QueryBuilder& body, const char* callbackId);
+
+// Parse a getUpdates response. Updates with a text or button data are stored in `out`
+// (at most `max`). *lastUpdateId moves past every update handled or passed over (no text),
+// but not past one that didn't fit, so that one comes again with the next poll.
+// Returns the number stored; *ok = the body parsed and said "ok".
+uint8_t telegramParseUpdates(Stream& body, TelegramUpdate* out, uint8_t max,
+                             int32_t* lastUpdateId, bool* ok);
+
+// Parse a method response into ok / messageId / description (status is left alone)
+void telegramParseReply(Stream& body, TelegramReply* reply);
+
+#endif // TELEGRAM_API_H
@@ -0,0 +1,218 @@
+// Minimal Telegram Bot API client implementation
+
+#include "telegram_client.h"
+#include "rest_query.h"
+#include "http_pool.h"
+#include "http_body.h"
+#include "net_perf.h"
+#include <HTTPClient.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+static const char API_BASE[] = "https://api.telegram.org/bot";
+// Bot tokens are "<digits>:<35 chars>"
+static const size_t TOKEN_LEN = 64;
+static const uint16_t CALL_TIMEOUT = 10000;
+
+static char token[TOKEN_LEN] = "";
+static char requestBody[TELEGRAM_REQUEST_LEN];
+static SemaphoreHandle_t requestMutex = nullptr;
+
+static void copyText(char* out, size_t cap, const char* text) {
+  strncpy(out, text, cap - 1);
+  out[cap - 1] = '\0';
+}
+
+void telegramClientBegin(const char* botToken) {
+  if (requestMutex == nullptr) requestMutex = xSemaphoreCreateMutex();
+  copyText(token, sizeof(token), botToken);
+}
+
+static bool methodUrl(QueryBuilder& url, const char* method) {
+  url.raw(API_BASE).raw(token).raw('/').raw(method);
+  return url.ok();
+}
+
+// Start a request on a pooled connection and send it; one retry when a kept-alive connection
+// turns out dead (as for Bitrix24 REST). Returns the client (hand back with httpPoolEnd()),
+// or nullptr when no connection was free. `body` nullptr = GET. A long poll takes a long-poll
+// slot (http_pool.h) and goes without gzip: it would hold the one inflater (http_body.h) for
+// the whole hold time.
+static HTTPClient* request(const char* url, uint16_t timeoutMs, const char* body, size_t len,
+                           bool longPoll, const char* label, int* httpCode) {
+  HTTPClient* http = nullptr;
+  *httpCode = -1;
+  uint8_t attempt = 0;
+  for (; attempt < 2; attempt++) {
+    http = longPoll ? httpPoolBeginLongPoll(url) : httpPoolBegin(url);
+    if (http == nullptr) return nullptr;
+    http->setTimeout(timeoutMs);
+    if (!longPoll) httpAcceptGzip(*http);
+    if (body != nullptr) {
+      http->addHeader("Content-Type", "application/json");
+      *httpCode = http->POST((uint8_t*)body, len);
+    } else {
+      *httpCode = http->GET();
+    }
+    if (*httpCode > 0 || attempt > 0 || !httpPoolReused(http)) break;
+    httpPoolEnd(http, false);
+  }
+
+  NetPerfSample* perf = httpPoolSample(http);
+  if (perf != nullptr) {
+    perf->name = label;
+    perf->status = (int16_t)*httpCode;
+    perf->retries = attempt;
+    perf->bytesOut = strlen(url) + len;
+  }
+  if (*httpCode > 0) httpPoolResponded(http);
+  return http;
+}
+
+// Hand the connection back, keeping it when the body was read to its end
+static void finish(HTTPClient* http, HttpBodyStream& response) {
+  bool reusable = response.drain(HTTP_POOL_DRAIN_MAX);
+  NetPerfSample* perf = httpPoolSample(http);
+  if (perf != nullptr) perf->bytesIn = response.wireBytes();
+  httpPoolEnd(http, reusable);
+}
+
+int telegramGetUpdates(int32_t* lastUpdateId, uint8_t timeoutSec, const char* allowedUpdates,
+                       TelegramUpdate* out) {
+  timeoutSec = telegramPollSeconds(timeoutSec);
+  char urlBuf[256];
+  QueryBuilder url(urlBuf, sizeof(urlBuf));
+  methodUrl(url, "getUpdates");
+  url.raw('?');
+  if (!telegramUpdatesQuery(url, *lastUpdateId, timeoutSec, allowedUpdates)) return -1;
+
+  // Not in /perf (label nullptr): the duration is the server's hold time, not latency
+  int httpCode;
+  HTTPClient* http = request(url.c_str(), (timeoutSec + 10) * 1000U, nullptr, 0, true, nullptr,
+                              &httpCode);
+  if (http == nullptr) return -1;
+  if (httpCode <= 0) {
+    httpPoolEnd(http, false);
+    return -1;
+  }
+
+  HttpBodyStream response(*http);
+  int count = -1;
+  if (httpCode == 200) {
+    bool ok;
+    count = telegramParseUpdates(response, out, TELEGRAM_UPDATES_MAX, lastUpdateId, &ok);
+    // A broken body still delivers the updates read before the break
+    if (!ok && count == 0) count = -1;
+  } else {
+    Serial.print("[TG] getUpdates failed, HTTP ");
+    Serial.println(httpCode);
+  }
+  finish(http, response);
+  return count;
+}
+
+static void clearReply(TelegramReply* reply) {
+  if (reply == nullptr) return;
+  reply->status = 0;
+  reply->ok = false;
+  reply->messageId = 0;
+  reply->description[0] = '\0';
+}
+
+// POST the JSON in `body` to `method`. Callers hold requestMutex.
+static bool call(const char* method, const char* label, const QueryBuilder& body,
+                 TelegramReply* reply) {
+  TelegramReply scratch;
+  if (reply == nullptr) reply = &scratch;
+  clearReply(reply);
+
+  char urlBuf[128];
+  QueryBuilder url(urlBuf, sizeof(urlBuf));
+  if (!body.ok() || !methodUrl(url, method)) {
+    reply->status = 413;
+    Serial.print("[TG] ");
+    Serial.print(method);
+    Serial.println(" request too large");
+    return false;
+  }
+
+  int httpCode;
+  HTTPClient* http = request(url.c_str(), CALL_TIMEOUT, body.c_str(), body.length(), false, label,
+                              &httpCode);
+  if (http != nullptr && httpCode > 0) {
+    HttpBodyStream response(*http);
+    telegramParseReply(response, reply);
+    finish(http, response);
+  } else if (http != nullptr) {
+    httpPoolEnd(http, false);
+  }
+  reply->status = (int16_t)httpCode;
+
+  if (httpCode != 200) {
+    Serial.print("[TG] ");
+    Serial.print(method);
+    Serial.print(" failed, HTTP ");
+    Serial.print(httpCode);
+    Serial.print(" ");
+    Serial.println(reply->description);
+  }
+  return httpCode == 200;
+}
+
+// False before telegramClientBegin(); `reply` then reports no response
+static bool lock(TelegramReply* reply) {
+  clearReply(reply);
+  return requestMutex != nullptr && xSemaphoreTake(requestMutex, portMAX_DELAY) == pdTRUE;
+}
+
+static void unlock() {
+  xSemaphoreGive(requestMutex);
+}
+
+bool telegramSendMessage(const char* chatId, const char* text, const char* replyMarkup,
+                         bool silent, TelegramReply* reply) {
+  if (!lock(reply)) return false;
+  QueryBuilder body(requestBody, sizeof(requestBody));
+  telegramMessageBody(body, chatId, 0, text, replyMarkup, silent);
+  bool ok = call("sendMessage", "tg.sendMessage", body, reply);
+  unlock();
+  return ok;
+}
+
+bool telegramEditMessageText(const char* chatId, int32_t messageId, const char* text,
+                             const char* replyMarkup, TelegramReply* reply) {
+  if (!lock(reply)) return false;
+  QueryBuilder body(requestBody, sizeof(requestBody));
+  telegramMessageBody(body, chatId, messageId, text, replyMarkup, false);
+  bool ok = call("editMessageText", "tg.editMessageText", body, reply);
+  unlock();
+  return ok;
+}
+
+bool telegramDeleteMessage(const char* chatId, int32_t messageId) {
+  if (!lock(nullptr)) return false;
+  QueryBuilder body(requestBody, sizeof(requestBody));
+  telegramMessageBody(body, chatId, messageId, nullptr, nullptr, false);
+  bool ok = call("deleteMessage", "tg.deleteMessage", body, nullptr);
+  unlock();
+  return ok;
+}
+
+bool telegramPinMessage(const char* chatId, int32_t messageId, bool silent) {
+  if (!lock(nullptr)) return false;
+  QueryBuilder body(requestBody, sizeof(requestBody));
+  telegramMessageBody(body, chatId, messageId, nullptr, nullptr, silent);
+  bool ok = call("pinChatMessage", "tg.pinChatMessage", body, nullptr);
+  unlock();
+  return ok;
+}
+
+bool telegramAnswerCallback(const char* callbackId) {
+  if (!lock(nullptr)) return false;
+  QueryBuilder body(requestBody, sizeof(requestBody));
+  telegramCallbackBody(body, callbackId);
+  bool ok = call("answerCallbackQuery", "tg.answerCallbackQuery", body, nullptr);
+  unlock();
+  return ok;
+}
@@ -0,0 +1,37 @@
+// Minimal Telegram Bot API client over the shared HTTPS pool
+// Request bodies are written into one fixed buffer, and responses are streamed through
+// JsonStreamReader. getUpdates keeps only update_id, chat id and text (or button data) of
+// each update, as fixed-size records. No String is built and no document is held.
+
+#ifndef TELEGRAM_CLIENT_H
+#define TELEGRAM_CLIENT_H
+
+#include <Arduino.h>
+#include "telegram_api.h"
+
+// JSON request body buffer: a 4096-byte message plus escaping and options
+#ifndef TELEGRAM_REQUEST_LEN
+#define TELEGRAM_REQUEST_LEN 5120
+#endif
+
+// Token for all calls (copied; call again when it changes)
+void telegramClientBegin(const char* token);
+
+// Long poll for updates after `lastUpdateId`, holding the request up to timeoutSec (see
+// telegramUpdatesQuery). Returns the number of updates stored in `out`
+// (TELEGRAM_UPDATES_MAX records), -1 when the request failed.
+int telegramGetUpdates(int32_t* lastUpdateId, uint8_t timeoutSec, const char* allowedUpdates,
+                       TelegramUpdate* out);
+
+// Calls below share one request buffer (serialized between tasks). `replyMarkup` is an
+// optional JSON object, `reply` an optional result. Return true on HTTP 200. A body that
+// doesn't fit the buffer isn't sent and reports status 413.
+bool telegramSendMessage(const char* chatId, const char* text, const char* replyMarkup,
+                         bool silent, TelegramReply* reply);
+bool telegramEditMessageText(const char* chatId, int32_t messageId, const char* text,
+                             const char* replyMarkup, TelegramReply* reply);
+bool telegramDeleteMessage(const char* chatId, int32_t messageId);
+bool telegramPinMessage(const char* chatId, int32_t messageId, bool silent);
+bool telegramAnswerCallback(const char* callbackId);
+
+#endif // TELEGRAM_CLIENT_H
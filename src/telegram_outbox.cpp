@@ -0,0 +1,261 @@
+// Outgoing Telegram message queue implementation
+// Entries sit in queue order, header then text, each padded to 4 bytes. Removing one moves
+// the entries behind it down, so the free space is always one block at the end and no
+// fragmentation builds up; with a few KB of arena that memmove is cheaper than a send.
+// A mutex guards the arena, not a spinlock: pushes compare and copy whole messages, which
+// must not run with interrupts off.
+
+#include "telegram_outbox.h"
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+struct EntryHeader {
+  uint32_t id;
+  uint32_t hash;
+  uint32_t queuedAt;
+  uint32_t notBefore;    // Retry time (ms)
+  uint16_t len;          // Text bytes (no NUL)
+  uint8_t priority;
+  uint8_t attempts;
+};
+
+static StaticSemaphore_t outboxLockBuffer;
+static uint32_t arena[TELEGRAM_OUTBOX_BYTES / 4];
+static size_t used = 0;
+static uint32_t nextId = 1;
+static uint32_t inFlightId = 0;
+static TgOutboxStats stats;
+
+static SemaphoreHandle_t outboxLock() {
+  static SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&outboxLockBuffer);
+  return lock;
+}
+
+static void lock() {
+  xSemaphoreTake(outboxLock(), portMAX_DELAY);
+}
+
+static void unlock() {
+  xSemaphoreGive(outboxLock());
+}
+
+static inline uint8_t* arenaBytes() {
+  return (uint8_t*)arena;
+}
+
+static inline EntryHeader* entryAt(size_t offset) {
+  return (EntryHeader*)(arenaBytes() + offset);
+}
+
+static inline size_t entrySize(size_t len) {
+  return (sizeof(EntryHeader) + len + 3) & ~(size_t)3;
+}
+
+static inline const char* entryText(EntryHeader* e) {
+  return (const char*)(e + 1);
+}
+
+// FNV-1a
+static uint32_t textHash(const char* text, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)text[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// Longest prefix of at most `max` bytes that doesn't split a UTF-8 character
+static size_t utf8Prefix(const char* text, size_t len, size_t max) {
+  if (len <= max) return len;
+  size_t cut = max;
+  while (cut > 0 && ((uint8_t)text[cut] & 0xC0) == 0x80) cut--;
+  return cut;
+}
+
+// Callers hold the lock
+static void removeAt(size_t offset) {
+  size_t size = entrySize(entryAt(offset)->len);
+  memmove(arenaBytes() + offset, arenaBytes() + offset + size, used - offset - size);
+  used -= size;
+  stats.queued--;
+}
+
+static bool findId(uint32_t id, size_t* offset) {
+  for (size_t off = 0; off < used; off += entrySize(entryAt(off)->len)) {
+    if (entryAt(off)->id == id) {
+      *offset = off;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Oldest entry of the lowest priority not above `priority` (the one being sent is kept)
+static bool findVictim(uint8_t priority, size_t* offset) {
+  bool found = false;
+  uint8_t lowest = 0;
+  for (size_t off = 0; off < used; off += entrySize(entryAt(off)->len)) {
+    EntryHeader* e = entryAt(off);
+    if (e->id == inFlightId || e->priority > priority) continue;
+    if (!found || e->priority < lowest) {
+      found = true;
+      lowest = e->priority;
+      *offset = off;
+    }
+  }
+  return found;
+}
+
+TgPushResult tgOutboxPush(const char* text, size_t len, TelegramPriority priority, unsigned long now) {
+  size_t keep = utf8Prefix(text, len, TELEGRAM_MSG_MAX);
+  uint32_t hash = textHash(text, keep);
+  size_t size = entrySize(keep);
+  TgPushResult result = TG_PUSH_QUEUED;
+  uint32_t evicted = 0;
+
+  lock();
+  if (keep < len) stats.truncated++;
+  for (size_t off = 0; off < used; off += entrySize(entryAt(off)->len)) {
+    EntryHeader* e = entryAt(off);
+    if (e->hash == hash && e->len == keep && memcmp(entryText(e), text, keep) == 0) {
+      if (priority > e->priority) e->priority = priority;
+      stats.deduplicated++;
+      result = TG_PUSH_DUPLICATE;
+      break;
+    }
+  }
+  if (result == TG_PUSH_QUEUED) {
+    size_t victim;
+    while (used + size > sizeof(arena) && findVictim(priority, &victim)) {
+      removeAt(victim);
+      evicted++;
+    }
+    stats.evicted += evicted;
+    if (used + size > sizeof(arena)) {
+      stats.dropped++;
+      result = TG_PUSH_DROPPED;
+    } else {
+      EntryHeader* e = entryAt(used);
+      e->id = nextId++;
+      if (nextId == 0) nextId = 1;
+      e->hash = hash;
+      e->queuedAt = now;
+      e->notBefore = now;
+      e->len = (uint16_t)keep;
+      e->priority = priority;
+      e->attempts = 0;
+      memcpy((char*)(e + 1), text, keep);
+      used += size;
+      stats.queued++;
+    }
+  }
+  stats.bytes = (uint16_t)used;
+  unlock();
+
+  if (evicted > 0) {
+    Serial.print("[TG OUTBOX] Full, evicted ");
+    Serial.print(evicted);
+    Serial.println(" older message(s)");
+  }
+  if (result == TG_PUSH_DROPPED) {
+    Serial.println("[TG OUTBOX] Full, dropped new message");
+  }
+  return result;
+}
+
+uint32_t tgOutboxNext(char* out, unsigned long now) {
+  uint32_t id = 0;
+  uint32_t expired = 0;
+  lock();
+  size_t off = 0;
+  while (off < used) {
+    EntryHeader* e = entryAt(off);
+    if (e->id != inFlightId && now - e->queuedAt > TELEGRAM_OUTBOX_MAX_AGE) {
+      removeAt(off);
+      expired++;
+      continue;
+    }
+    off += entrySize(e->len);
+  }
+  stats.expired += expired;
+
+  size_t best = 0;
+  bool found = false;
+  for (off = 0; off < used; off += entrySize(entryAt(off)->len)) {
+    EntryHeader* e = entryAt(off);
+    if ((long)(now - e->notBefore) < 0) continue;
+    if (!found || e->priority > entryAt(best)->priority) {
+      found = true;
+      best = off;
+    }
+  }
+  if (found) {
+    EntryHeader* e = entryAt(best);
+    memcpy(out, entryText(e), e->len);
+    out[e->len] = '\0';
+    id = e->id;
+    inFlightId = id;
+  }
+  stats.bytes = (uint16_t)used;
+  unlock();
+
+  if (expired > 0) {
+    Serial.print("[TG OUTBOX] Expired ");
+    Serial.print(expired);
+    Serial.println(" unsent message(s)");
+  }
+  return id;
+}
+
+void tgOutboxFinish(uint32_t id, TgSendResult result, unsigned long now) {
+  bool gaveUp = false;
+  lock();
+  if (inFlightId == id) inFlightId = 0;
+  size_t off;
+  if (findId(id, &off)) {
+    EntryHeader* e = entryAt(off);
+    if (result == TG_SEND_OK) {
+      removeAt(off);
+      stats.sent++;
+    } else if (result == TG_SEND_REJECTED || e->attempts + 1 >= TELEGRAM_OUTBOX_ATTEMPTS) {
+      removeAt(off);
+      stats.failed++;
+      gaveUp = true;
+    } else {
+      unsigned long delay = TELEGRAM_OUTBOX_BACKOFF << e->attempts;
+      if (delay > TELEGRAM_OUTBOX_BACKOFF_MAX) delay = TELEGRAM_OUTBOX_BACKOFF_MAX;
+      e->attempts++;
+      e->notBefore = now + delay;
+      stats.retries++;
+    }
+  }
+  stats.bytes = (uint16_t)used;
+  unlock();
+
+  if (gaveUp) {
+    Serial.println("[TG OUTBOX] Gave up on a message");
+  }
+}
+
+void tgOutboxGetStats(TgOutboxStats* out) {
+  lock();
+  *out = stats;
+  unlock();
+}
+
+String tgOutboxReport() {
+  TgOutboxStats s;
+  tgOutboxGetStats(&s);
+  String out = "Outbox: " + String(s.queued) + " queued (" + String(s.bytes) + " B)";
+  out += " · sent " + String(s.sent);
+  if (s.deduplicated) out += " · dup " + String(s.deduplicated);
+  if (s.retries) out += " · retry " + String(s.retries);
+  if (s.evicted) out += " · evicted " + String(s.evicted);
+  if (s.dropped) out += " · dropped " + String(s.dropped);
+  if (s.truncated) out += " · cut " + String(s.truncated);
+  if (s.failed) out += " · failed " + String(s.failed);
+  if (s.expired) out += " · expired " + String(s.expired);
+  return out;
+}
@@ -0,0 +1,89 @@
+// Outgoing Telegram messages: a bounded, prioritized queue in a fixed arena
+// Messages of any length up to Telegram's limit are packed back to back, identical queued
+// messages are sent once, failed sends are retried with backoff, and when the arena is full
+// the oldest message of the lowest priority makes room. Nothing is lost without a counter.
+
+#ifndef TELEGRAM_OUTBOX_H
+#define TELEGRAM_OUTBOX_H
+
+#include <Arduino.h>
+
+// Arena for queued messages (bytes, including a 16-byte header per message)
+#ifndef TELEGRAM_OUTBOX_BYTES
+#define TELEGRAM_OUTBOX_BYTES 8192
+#endif
+
+// Longest message (bytes); Telegram takes 4096 characters, longer text is cut at a UTF-8
+// character boundary
+#ifndef TELEGRAM_MSG_MAX
+#define TELEGRAM_MSG_MAX 4096
+#endif
+
+// Sends tried per message before it is given up
+#ifndef TELEGRAM_OUTBOX_ATTEMPTS
+#define TELEGRAM_OUTBOX_ATTEMPTS 6
+#endif
+
+// First retry delay, doubled per failed attempt up to the maximum (ms)
+#ifndef TELEGRAM_OUTBOX_BACKOFF
+#define TELEGRAM_OUTBOX_BACKOFF 2000UL
+#endif
+#ifndef TELEGRAM_OUTBOX_BACKOFF_MAX
+#define TELEGRAM_OUTBOX_BACKOFF_MAX 60000UL
+#endif
+
+// Messages still unsent after this long are stale, e.g. "Work started!" 10 min late (ms)
+#ifndef TELEGRAM_OUTBOX_MAX_AGE
+#define TELEGRAM_OUTBOX_MAX_AGE 600000UL
+#endif
+
+// Higher goes first; the lowest is evicted first
+enum TelegramPriority : uint8_t {
+  TG_PRIO_COUNTERS = 0,  // Bitrix24 counter digests
+  TG_PRIO_NORMAL,        // Prompts and other device messages
+  TG_PRIO_TIMER          // Pomodoro timer events
+};
+
+enum TgPushResult : uint8_t {
+  TG_PUSH_QUEUED = 0,
+  TG_PUSH_DUPLICATE,     // Same text already waiting (its priority is raised if needed)
+  TG_PUSH_DROPPED        // No room even after evicting lower-priority messages
+};
+
+enum TgSendResult : uint8_t {
+  TG_SEND_OK = 0,
+  TG_SEND_RETRY,         // Network error, rate limit or server error
+  TG_SEND_REJECTED       // Telegram refused the message itself (e.g. bad HTML)
+};
+
+struct TgOutboxStats {
+  uint16_t queued;       // Messages waiting now
+  uint16_t bytes;        // Arena bytes in use
+  uint32_t sent;
+  uint32_t deduplicated;
+  uint32_t evicted;      // Queued messages removed to make room
+  uint32_t dropped;      // New messages that didn't fit
+  uint32_t truncated;
+  uint32_t retries;      // Failed sends that were retried later
+  uint32_t failed;       // Given up: rejected or out of attempts
+  uint32_t expired;
+};
+
+// Queue `len` bytes of `text` (thread-safe)
+TgPushResult tgOutboxPush(const char* text, size_t len, TelegramPriority priority, unsigned long now);
+
+// Next message to send: highest priority, oldest first, skipping those waiting for a retry.
+// Copies it NUL-terminated into `out` (at least TELEGRAM_MSG_MAX + 1 bytes) and returns its
+// id; 0 when nothing is due. The message stays queued (and can't be evicted) until
+// tgOutboxFinish().
+uint32_t tgOutboxNext(char* out, unsigned long now);
+
+// Report how sending message `id` went
+void tgOutboxFinish(uint32_t id, TgSendResult result, unsigned long now);
+
+void tgOutboxGetStats(TgOutboxStats* stats);
+
+// One-line summary for /perf
+String tgOutboxReport();
+
+#endif // TELEGRAM_OUTBOX_H
@@ -0,0 +1,172 @@
+// Wall clock implementation
+
+#include "time_service.h"
+#include <string.h>
+#include <stdio.h>
+
+// Anything before 2024-01-01 means SNTP hasn't synced yet
+static const time_t TIME_VALID_AFTER = 1704067200;
+// Re-read portal timezone (DST) every 6 hours; re-anchor the fallback clock hourly
+static const unsigned long TZ_REFRESH_MS = 6UL * 3600UL * 1000UL;
+static const unsigned long FALLBACK_REFRESH_MS = 3600UL * 1000UL;
+
+static bool tzKnown = false;
+static int32_t portalOffsetSec = 0;
+static unsigned long tzFetchedAt = 0;
+
+// Fallback clock: server.time epoch anchored to millis()
+static bool fallbackKnown = false;
+static time_t fallbackEpoch = 0;
+static unsigned long fallbackAt = 0;
+
+static char lastDate[11] = "";
+
+void initTimeService() {
+  // UTC system clock; the portal offset is applied when formatting dates
+  configTime(0, 0, TIME_NTP_SERVER1, TIME_NTP_SERVER2);
+}
+
+static bool sntpSynced() {
+  return time(nullptr) > TIME_VALID_AFTER;
+}
+
+bool timeNeedsServerTime(unsigned long nowMs) {
+  if (!tzKnown || nowMs - tzFetchedAt >= TZ_REFRESH_MS) return true;
+  return !sntpSynced() && (!fallbackKnown || nowMs - fallbackAt >= FALLBACK_REFRESH_MS);
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+static void civilFromDays(int32_t z, int32_t* y, uint32_t* m, uint32_t* d) {
+  z += 719468;
+  int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  *d = doy - (153 * mp + 2) / 5 + 1;
+  *m = mp < 10 ? mp + 3 : mp - 9;
+  *y = (int32_t)yoe + era * 400 + (*m <= 2);
+}
+
+static bool readDigits(const char* p, uint8_t count, int32_t* out) {
+  int32_t v = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (p[i] < '0' || p[i] > '9') return false;
+    v = v * 10 + (p[i] - '0');
+  }
+  *out = v;
+  return true;
+}
+
+bool parseIsoDateTime(const char* text, time_t* epochUtc, int32_t* offsetSec) {
+  int32_t y, mo, d, h, mi, s;
+  if (!text || strlen(text) < 19) return false;
+  if (!readDigits(text, 4, &y) || text[4] != '-' || !readDigits(text + 5, 2, &mo) || text[7] != '-' ||
+      !readDigits(text + 8, 2, &d) || (text[10] != 'T' && text[10] != ' ') ||
+      !readDigits(text + 11, 2, &h) || text[13] != ':' || !readDigits(text + 14, 2, &mi) ||
+      text[16] != ':' || !readDigits(text + 17, 2, &s)) {
+    return false;
+  }
+  if (mo < 1 || mo > 12 || d < 1 || d > 31) return false;
+
+  int32_t offset = 0;
+  const char* tz = text + 19;
+  if (*tz == '+' || *tz == '-') {
+    int32_t oh, om;
+    if (!readDigits(tz + 1, 2, &oh) || tz[3] != ':' || !readDigits(tz + 4, 2, &om)) return false;
+    offset = (oh * 3600 + om * 60) * (*tz == '-' ? -1 : 1);
+  }
+
+  int64_t local = (int64_t)daysFromCivil(y, (uint32_t)mo, (uint32_t)d) * 86400 + h * 3600 + mi * 60 + s;
+  *epochUtc = (time_t)(local - offset);
+  *offsetSec = offset;
+  return true;
+}
+
+void formatLocalDate(time_t epochUtc, int32_t offsetSec, char* out) {
+  int64_t local = (int64_t)epochUtc + offsetSec;
+  int32_t days = (int32_t)(local >= 0 ? local / 86400 : (local - 86399) / 86400);
+  int32_t y;
+  uint32_t m, d;
+  civilFromDays(days, &y, &m, &d);
+  snprintf(out, 11, "%04d-%02u-%02u", (int)y, (unsigned)m, (unsigned)d);
+}
+
+void formatLocalDateTime(time_t epochUtc, int32_t offsetSec, char* out) {
+  formatLocalDate(epochUtc, offsetSec, out);
+  int64_t local = (int64_t)epochUtc + offsetSec;
+  int32_t secOfDay = (int32_t)(((local % 86400) + 86400) % 86400);
+  int32_t offsetMin = (offsetSec < 0 ? -offsetSec : offsetSec) / 60;
+  snprintf(out + 10, 16, "T%02d:%02d:%02d%c%02d:%02d", (int)(secOfDay / 3600),
+           (int)(secOfDay / 60 % 60), (int)(secOfDay % 60), offsetSec < 0 ? '-' : '+',
+           (int)(offsetMin / 60), (int)(offsetMin % 60));
+}
+
+bool timeApplyServerTime(const char* isoDateTime, unsigned long nowMs) {
+  time_t epoch;
+  int32_t offset;
+  if (!parseIsoDateTime(isoDateTime, &epoch, &offset)) {
+    Serial.print("Time: server.time format not recognized: ");
+    Serial.println(isoDateTime);
+    return false;
+  }
+  portalOffsetSec = offset;
+  tzKnown = true;
+  tzFetchedAt = nowMs;
+  fallbackEpoch = epoch;
+  fallbackAt = nowMs;
+  fallbackKnown = true;
+  return true;
+}
+
+bool timeNowUtc(time_t* out) {
+  if (sntpSynced()) {
+    *out = time(nullptr);
+    return true;
+  }
+  if (fallbackKnown) {
+    *out = fallbackEpoch + (time_t)((millis() - fallbackAt) / 1000);
+    return true;
+  }
+  return false;
+}
+
+bool timeTodayString(char* out) {
+  time_t now;
+  if (!tzKnown || !timeNowUtc(&now)) return false;
+  formatLocalDate(now, portalOffsetSec, out);
+  return true;
+}
+
+bool timeLocalDateTime(int32_t deltaSec, char* out) {
+  time_t now;
+  if (!tzKnown || !timeNowUtc(&now)) return false;
+  formatLocalDateTime(now + deltaSec, portalOffsetSec, out);
+  return true;
+}
+
+bool timeLocalClock(unsigned long inMs, char* out) {
+  time_t now;
+  if (!tzKnown || !timeNowUtc(&now)) return false;
+  int64_t local = (int64_t)now + inMs / 1000 + portalOffsetSec;
+  int32_t secOfDay = (int32_t)(((local % 86400) + 86400) % 86400);
+  snprintf(out, 6, "%02d:%02d", (int)(secOfDay / 3600), (int)(secOfDay / 60 % 60));
+  return true;
+}
+
+bool timeDateRolledOver() {
+  char today[11];
+  if (!timeTodayString(today)) return false;
+  bool rolled = lastDate[0] != '\0' && strcmp(today, lastDate) != 0;
+  strcpy(lastDate, today);
+  return rolled;
+}
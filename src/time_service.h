@@ -0,0 +1,51 @@
+// Wall clock: SNTP with Bitrix24 server.time fallback, in the portal's timezone
+
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#ifndef TIME_NTP_SERVER1
+#define TIME_NTP_SERVER1 "pool.ntp.org"
+#endif
+#ifndef TIME_NTP_SERVER2
+#define TIME_NTP_SERVER2 "time.google.com"
+#endif
+
+// Start SNTP (runs in the background; safe to call before WiFi is connected)
+void initTimeService();
+
+// True when the portal timezone (or, without SNTP, the clock itself) should be
+// refreshed from server.time. The offset is re-read every few hours for DST changes.
+bool timeNeedsServerTime(unsigned long nowMs);
+
+// Feed a server.time result ("2026-01-19T15:58:59+03:00"): sets the portal timezone
+// and the fallback clock used until SNTP syncs. Returns false if not parseable.
+bool timeApplyServerTime(const char* isoDateTime, unsigned long nowMs);
+
+// Current UTC time (SNTP, or server.time + elapsed millis); false if unknown
+bool timeNowUtc(time_t* out);
+
+// Portal-local date as "YYYY-MM-DD" (out must hold 11 chars); false if unknown
+bool timeTodayString(char* out);
+
+// Portal-local time `deltaSec` from now as "YYYY-MM-DDTHH:MM:SS+HH:MM", the form Bitrix24
+// returns dates in (out must hold 26 chars); false if unknown
+bool timeLocalDateTime(int32_t deltaSec, char* out);
+
+// Portal-local time of day `inMs` from now as "HH:MM" (out must hold 6 chars); false if unknown
+bool timeLocalClock(unsigned long inMs, char* out);
+
+// Returns true once after the portal-local date changes (local midnight)
+bool timeDateRolledOver();
+
+// Parse "YYYY-MM-DDTHH:MM:SS+HH:MM" (also 'Z' or no offset) into UTC epoch + offset seconds
+bool parseIsoDateTime(const char* text, time_t* epochUtc, int32_t* offsetSec);
+
+// Format a UTC epoch shifted by offsetSec as "YYYY-MM-DD"
+void formatLocalDate(time_t epochUtc, int32_t offsetSec, char* out);
+// Format a UTC epoch in the zone offsetSec as "YYYY-MM-DDTHH:MM:SS+HH:MM"
+void formatLocalDateTime(time_t epochUtc, int32_t offsetSec, char* out);
+
+#endif // TIME_SERVICE_H
@@ -23,7 +23,7 @@ void startTimer() {
   forceCircleRedraw = true;
   if (millis() - lastTgSendTime > TG_SEND_DEBOUNCE) {
     lastTgSendTime = millis();
-    sendTelegramMessage("🍅 <b>Work started!</b>");
+    sendTelegramMessage("🍅 <b>Work started!</b>", TG_PRIO_TIMER);
   }
 }
 
@@ -37,7 +37,7 @@ void pauseTimer() {
   forceCircleRedraw = true;
   if (millis() - lastTgSendTime > TG_SEND_DEBOUNCE) {
     lastTgSendTime = millis();
-    sendTelegramMessage("⏸ <b>Timer paused</b>");
+    sendTelegramMessage("⏸ <b>Timer paused</b>", TG_PRIO_TIMER);
   }
 }
 
@@ -50,7 +50,7 @@ void resumeTimer() {
   forceCircleRedraw = true;
   if (millis() - lastTgSendTime > TG_SEND_DEBOUNCE) {
     lastTgSendTime = millis();
-    sendTelegramMessage("▶️ <b>Timer resumed</b>");
+    sendTelegramMessage("▶️ <b>Timer resumed</b>", TG_PRIO_TIMER);
   }
 }
 
@@ -61,7 +61,7 @@ void stopTimer() {
   displayInitialized = false;
   if (millis() - lastTgSendTime > TG_SEND_DEBOUNCE) {
     lastTgSendTime = millis();
-    sendTelegramMessage("⏹ <b>Timer stopped</b>");
+    sendTelegramMessage("⏹ <b>Timer stopped</b>", TG_PRIO_TIMER);
   }
   displayStoppedState();
 }
@@ -96,13 +96,13 @@ void updateTimer() {
         startTime = millis();
         displayInitialized = false;  // Force redraw to update colors
         // Send Telegram notification
-        sendTelegramMessage("☕ <b>Rest time!</b> Take a break.");
+        sendTelegramMessage("☕ <b>Rest time!</b> Take a break.", TG_PRIO_TIMER);
       } else {
         isWorkSession = true;
         startTime = millis();
         displayInitialized = false;  // Force redraw to update colors
         // Send Telegram notification
-        sendTelegramMessage("🍅 <b>Work time!</b> Focus on your task.");
+        sendTelegramMessage("🍅 <b>Work time!</b> Focus on your task.", TG_PRIO_TIMER);
       }
     }
   }
@@ -467,7 +467,8 @@ void handleTouchInput() {
         drawMainFunctionality();
       } else if (currentViewMode == VIEW_MODE_B24 && lastTouchValid && tx >= 0 && ty >= 0) {
         // On B24 screen:
-        // - Tap 3rd section -> show "Open TG bot" screen for 2 seconds + send TG prompt
+        // - Tap header -> next page (watched groups)
+        // - Tap 3rd section (counters page) -> show "Open TG bot" screen for 2 seconds + send TG prompt
         // - Tap elsewhere -> return to main menu
         const int16_t headerHeight = 30;
         int16_t screenWidth = gfx->width();
@@ -491,7 +492,11 @@ void handleTouchInput() {
           inThirdSection = (tx >= x0 && tx < x0 + sectionWidth && ty >= y0 && ty < y0 + sectionHeight);
         }
 
-        if (inThirdSection) {
+        if (ty < headerHeight) {
+          // Page count is checked when drawing (wraps back to the counters page)
+          b24ScreenPage++;
+          drawB24Placeholder();
+        } else if (inThirdSection && b24ScreenPage == 0) {
           Serial.println("*** B24 3RD SECTION TAPPED - OPEN TG PROMPT ***");
           // Show temporary screen for ~2 seconds
           currentViewMode = VIEW_MODE_TG_PROMPT;
@@ -520,13 +525,15 @@ void handleTouchInput() {
         // B24 button clicked - open B24 placeholder screen and force immediate update
         Serial.println("*** MAIN MENU B24 BUTTON CLICKED ***");
         currentViewMode = VIEW_MODE_B24;
-        // Set manual refresh flag to show spinner (fetch will happen in main loop)
-        b24ManualRefresh = true;
+        b24ScreenPage = 0;
+        // Known counts (cached or restored at boot) are shown right away with a refreshing
+        // marker; the spinner is only for the very first fetch (fetch happens in the B24 task)
+        b24ManualRefresh = !getBitrix24Counts().valid;
+        b24Refreshing = !b24ManualRefresh;
         // Force immediate Bitrix24 update when user clicks B24 button
         forceBitrix24Update();
-        // Draw loading spinner immediately
+        // Draw the cached counts (or the loading spinner) immediately
         drawB24Placeholder();
-        // Don't fetch here - let main loop handle it so spinner can animate
       } else if (inMainMenuTomatoBtn) {
         // Tomato button clicked - return to home/timer screen and start timer
         Serial.println("*** MAIN MENU TOMATO BUTTON CLICKED ***");
@@ -5,12 +5,16 @@
 #include "display_updates.h"
 #include "timer_logic.h"
 #include "bitrix24.h"
+#include "bitrix24_queue.h"
+#include "bitrix24_group_cache.h"
+#include "bitrix24_history.h"
 #include "wifi_ap.h"
+#include "http_pool.h"
+#include "net_perf.h"
+#include "telegram_client.h"
 #include "storage.h"
+#include "time_service.h"
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <UniversalTelegramBot.h>
-#include <ArduinoJson.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
@@ -94,15 +98,139 @@ static TelegramB24State b24State = B24_STATE_IDLE;
 static char b24SelectedIds[192] = ""; // space-separated ids
 static bool b24ShowDelayed = false;
 
+// /b24watch [ids...]: set the watched groups, or list them with their stats
+static void telegramB24Watch(const String& args) {
+  uint32_t ids[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t count = 0;
+  uint32_t value = 0;
+  bool inNumber = false;
+  bool clear = args.indexOf("off") >= 0;
+  for (uint16_t k = 0; k <= args.length(); k++) {
+    char c = (k < args.length()) ? args[k] : ' ';
+    if (c >= '0' && c <= '9') {
+      value = value * 10 + (c - '0');
+      inNumber = true;
+    } else if (inNumber) {
+      if (count < BITRIX24_MAX_WATCHED_GROUPS) ids[count++] = value;
+      value = 0;
+      inNumber = false;
+    }
+  }
+
+  if (count > 0 || clear) {
+    setBitrixWatchedGroups(ids, count);
+    String msg = clear ? "Watch list cleared." : "<b>Watching " + String(count) + " groups.</b>\nStats arrive with the next refresh.";
+    sendTelegramMessage(msg);
+    return;
+  }
+
+  Bitrix24GroupStats stats[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t n = getBitrixWatchedGroupStats(stats, BITRIX24_MAX_WATCHED_GROUPS);
+  if (n == 0) {
+    sendTelegramMessage(
+      "No watched groups.\n"
+      "Send <b>/b24watch 253 254</b> to watch up to " + String(BITRIX24_MAX_WATCHED_GROUPS) + " groups."
+    );
+    return;
+  }
+  String msg = "<b>Watched groups</b>\n";
+  for (uint8_t i = 0; i < n; i++) {
+    char name[BITRIX24_GROUP_NAME_LEN];
+    msg += "\n";
+    msg += bitrixGetCachedGroupName(stats[i].groupId, name, sizeof(name)) ? String(name) : String(stats[i].groupId);
+    if (stats[i].valid) {
+      msg += ": delayed <b>";
+      msg += String(stats[i].delayed);
+      msg += "</b>, all <b>";
+      msg += String(stats[i].allTasks);
+      msg += "</b>";
+    } else {
+      msg += ": ...";
+    }
+  }
+  msg += "\n\n<b>/b24watch off</b> clears the list.";
+  sendTelegramMessage(msg);
+}
+
+// "/trend [hours]": sparkline of each counter over the kept history, latest value and change
+static String telegramTrendLine(const char* label, B24Series series, uint32_t span) {
+  static const char* BARS[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+  uint16_t points[BITRIX24_HISTORY_HOURS];
+  uint16_t n = b24HistoryRead(series, span, points, BITRIX24_HISTORY_HOURS);
+  uint16_t lo = points[0];
+  uint16_t hi = points[0];
+  for (uint16_t i = 1; i < n; i++) {
+    if (points[i] < lo) lo = points[i];
+    if (points[i] > hi) hi = points[i];
+  }
+
+  String line = label;
+  line += " ";
+  for (uint16_t i = 0; i < n; i++) {
+    line += BARS[(hi > lo) ? (uint32_t)(points[i] - lo) * 7 / (hi - lo) : 0];
+  }
+  uint16_t latest = 0;
+  uint16_t oldest = 0;
+  b24HistoryAt(series, 0, &latest);
+  b24HistoryAt(series, span - 1, &oldest);
+  line += " <b>";
+  line += String(latest);
+  line += "</b> (";
+  if (latest >= oldest) line += "+";
+  line += String((int32_t)latest - oldest);
+  line += ")";
+  return line;
+}
+
+static void telegramTrend(const String& args) {
+  uint32_t hours = args.toInt();
+  if (hours == 0 || hours > BITRIX24_HISTORY_HOURS) hours = BITRIX24_HISTORY_HOURS;
+  uint32_t length = b24HistoryLength();
+  if (length < 2) {
+    sendTelegramMessage("No history yet: counters are sampled once a minute.");
+    return;
+  }
+  uint32_t span = hours * 60;
+  if (span > length) span = length;
+
+  String msg = "📈 <b>Trend, last ";
+  if (span >= 60) {
+    msg += String(span / 60);
+    msg += " h</b>";
+  } else {
+    msg += String(span);
+    msg += " min</b>";
+  }
+  msg += "\n";
+  msg += telegramTrendLine("📨", B24_SERIES_UNREAD, span);
+  msg += "\n";
+  msg += telegramTrendLine("📋", B24_SERIES_TASKS, span);
+  msg += "\n";
+  msg += telegramTrendLine("⏰", (getBitrixSelectedGroupId() != 0) ? B24_SERIES_GROUP : B24_SERIES_EXPIRED, span);
+  sendTelegramMessage(msg);
+}
+
 static void telegramB24SetSingleGroup(const String& numericText) {
   uint32_t gid = numericText.toInt();
   if (gid == 0) return;
   setBitrixSelectedGroupId(gid);
 
-  // Get current stats for this group (best-effort)
+  // Get current stats for this group: watched groups are already known, others are fetched
   uint16_t delayed = 0;
   uint16_t comments = 0;
-  bitrixGetGroupStats(gid, &delayed, &comments);
+  Bitrix24GroupStats watched[BITRIX24_MAX_WATCHED_GROUPS];
+  uint8_t watchedCount = getBitrixWatchedGroupStats(watched, BITRIX24_MAX_WATCHED_GROUPS);
+  bool known = false;
+  for (uint8_t i = 0; i < watchedCount; i++) {
+    if (watched[i].groupId == gid && watched[i].valid) {
+      delayed = watched[i].delayed;
+      comments = watched[i].allTasks;
+      known = true;
+    }
+  }
+  if (!known) {
+    bitrixGetGroupStats(gid, &delayed, &comments);
+  }
   // Fallback: if comments came back as 0, try cached counts
   if (comments == 0) {
     Bitrix24Counts c = getBitrix24Counts();
@@ -148,12 +276,219 @@ static void telegramB24SetSingleGroup(const String& numericText) {
   sendTelegramMessage(msg);
 }
 
-// WiFi client for Telegram
-WiFiClientSecure telegramClient;
-UniversalTelegramBot* bot = nullptr;
+// Set once the client has a token (initTelegramBot)
+static bool botReady = false;
+
+// Send to the configured chat. Returns the HTTP status (<= 0 when no response arrived).
+static int botSend(const char* text) {
+  if (!botReady) return 0;
+  TelegramReply reply;
+  telegramSendMessage(chatId, text, nullptr, false, &reply);
+  return reply.status;
+}
+
+static int botSend(const String& text) {
+  return botSend(text.c_str());
+}
+
+// --- Live dashboard ---
+
+bool telegramUseDashboard = TELEGRAM_DASHBOARD;
+// Message being edited (0 = none yet); read by sendTelegramMessage() on the main loop
+static volatile int32_t dashboardMessageId = 0;
+static String dashboardShown;           // Text + keyboard last accepted by Telegram
+static unsigned long dashboardEditedAt = 0;
+static volatile bool dashboardRepost = false;
+
+// Everything the dashboard shows depends on; it is only rendered again when this changes
+struct DashboardKey {
+  uint8_t state;
+  uint8_t mode;
+  bool work;
+  bool group;
+  uint32_t countsSeq;
+  char time[32];          // Time line as shown
+};
+static DashboardKey dashboardKeyShown;  // Key of dashboardShown
+static bool dashboardKeyValid = false;
+
+// The end time stays the same for the whole session, so a running timer needs no edits;
+// without a clock the minutes left are shown in 5-minute steps
+static void dashboardTimeLine(char* out, size_t cap) {
+  out[0] = '\0';
+  if (currentState == STOPPED) return;
+  unsigned long duration = getCurrentDuration();
+  unsigned long elapsed = (currentState == PAUSED) ? elapsedBeforePause : millis() - startTime;
+  unsigned long left = (elapsed < duration) ? duration - elapsed : 0;
+  char clock[6];
+  if (currentState == RUNNING && timeLocalClock(left, clock)) {
+    snprintf(out, cap, "Until <b>%s</b>", clock);
+  } else {
+    unsigned long minutes = (left + 59999UL) / 60000UL;
+    if (currentState == RUNNING) minutes = (minutes + 4) / 5 * 5;
+    snprintf(out, cap, "%lu min left", minutes);
+  }
+}
+
+static void dashboardKey(DashboardKey* key) {
+  memset(key, 0, sizeof(*key));
+  key->state = (uint8_t)currentState;
+  key->mode = (uint8_t)currentMode;
+  key->work = isWorkSession;
+  key->group = getBitrixSelectedGroupId() != 0;
+  key->countsSeq = getBitrix24CountsSeq();
+  dashboardTimeLine(key->time, sizeof(key->time));
+}
+
+static String dashboardText(const DashboardKey& key) {
+  String msg;
+  if (key.state == STOPPED) {
+    msg = "⏹ <b>Stopped</b>";
+  } else if (key.state == PAUSED) {
+    msg = "⏸ <b>Paused</b>";
+  } else {
+    msg = key.work ? "🍅 <b>Working</b>" : "☕ <b>Resting</b>";
+  }
+  msg += " · ";
+  switch ((PomodoroMode)key.mode) {
+    case MODE_1_1: msg += "1/1"; break;
+    case MODE_25_5: msg += "25/5"; break;
+    case MODE_50_10: msg += "50/10"; break;
+  }
+
+  if (key.time[0] != '\0') {
+    msg += "\n";
+    msg += key.time;
+  }
+
+  Bitrix24Counts c = getBitrix24Counts();
+  if (c.valid) {
+    msg += "\n\n📨 <b>";
+    msg += String(c.unreadMessages);
+    msg += "</b>  📋 <b>";
+    msg += String(c.undoneTasks);
+    msg += "</b>  ⏰ <b>";
+    msg += String(key.group ? c.groupDelayedTasks : c.expiredTasks);
+    msg += "</b>";
+    if (c.stale) msg += " (…)";
+  }
+  return msg;
+}
+
+// Timer buttons for the current state (callback data = the matching command)
+static String dashboardKeyboard() {
+  String kb = "{\"inline_keyboard\":[[";
+  if (currentState == STOPPED) {
+    kb += "{\"text\":\"🍅 Start\",\"callback_data\":\"work\"},"
+          "{\"text\":\"⏱ Mode\",\"callback_data\":\"mode\"}";
+  } else {
+    if (currentState == RUNNING) {
+      kb += "{\"text\":\"⏸ Pause\",\"callback_data\":\"pause\"},";
+    } else {
+      kb += "{\"text\":\"▶️ Resume\",\"callback_data\":\"resume\"},";
+    }
+    kb += "{\"text\":\"⏹ Stop\",\"callback_data\":\"stop\"}";
+  }
+  kb += "]]}";
+  return kb;
+}
+
+// Post a new dashboard and pin it (silently); the previous one is deleted
+static bool dashboardPost(const String& text, const String& keyboard) {
+  TelegramReply reply;
+  if (!telegramSendMessage(chatId, text.c_str(), keyboard.c_str(), true, &reply)) return false;
+  int32_t messageId = reply.messageId;
+  if (messageId == 0) return false;
 
-// FreeRTOS task handle for Telegram
+  int32_t previous = dashboardMessageId;
+  if (previous != 0) {
+    telegramDeleteMessage(chatId, previous);
+  }
+  telegramPinMessage(chatId, messageId, true);
+  dashboardMessageId = messageId;
+  saveTelegramDashboard(chatId, messageId);
+  Serial.print("[TG] Dashboard posted: ");
+  Serial.println(messageId);
+  return true;
+}
+
+// Edit the dashboard in place. False when it is gone (deleted in the chat) and needs
+// posting again; a failed request is simply tried at the next tick.
+static bool dashboardEdit(const String& text, const String& keyboard, bool* shown) {
+  TelegramReply reply;
+  telegramEditMessageText(chatId, dashboardMessageId, text.c_str(), keyboard.c_str(), &reply);
+  int httpCode = reply.status;
+  // "message is not modified": Telegram already shows this text (e.g. after a reboot)
+  *shown = httpCode == 200 || (httpCode == 400 && strstr(reply.description, "not modified") != nullptr);
+  return *shown || httpCode != 400;
+}
+
+// Called from the send task: render when the timer or the counts moved on, and edit only
+// when the rendered message changed
+static void dashboardTick() {
+  if (!telegramUseDashboard) return;
+  unsigned long now = millis();
+  if (now - dashboardEditedAt < TELEGRAM_DASHBOARD_MIN_INTERVAL) return;
+
+  DashboardKey key;
+  dashboardKey(&key);
+  bool repost = dashboardRepost || dashboardMessageId == 0;
+  if (!repost && dashboardKeyValid && memcmp(&key, &dashboardKeyShown, sizeof(key)) == 0) return;
+
+  String text = dashboardText(key);
+  String keyboard = dashboardKeyboard();
+  if (!repost && dashboardShown == text + keyboard) {
+    dashboardKeyShown = key;
+    dashboardKeyValid = true;
+    return;
+  }
+
+  dashboardEditedAt = now;
+  bool shown = false;
+  if (!repost && !dashboardEdit(text, keyboard, &shown)) {
+    Serial.println("[TG] Dashboard message gone, posting a new one");
+    repost = true;
+  }
+  if (repost) {
+    shown = dashboardPost(text, keyboard);
+    if (shown) dashboardRepost = false;
+  }
+  dashboardShown = shown ? text + keyboard : String();
+  dashboardKeyShown = key;
+  dashboardKeyValid = shown;
+}
+
+// Only text messages and dashboard button presses are needed
+static const char ALLOWED_UPDATES[] = "[\"message\",\"callback_query\"]";
+// Highest update handed to the send task (getUpdates asks for the ones after it)
+static int32_t lastUpdateId = 0;
+// Updates from the poll task to the send task, as fixed-size records
+static QueueHandle_t telegramUpdateQueue = nullptr;
+
+// FreeRTOS task handles for Telegram (sending / polling)
 TaskHandle_t telegramTaskHandle = nullptr;
+static TaskHandle_t telegramPollTaskHandle = nullptr;
+
+// Lowest stack headroom seen per task (bytes, 0 = not measured yet)
+static UBaseType_t telegramStackFree = 0;
+static UBaseType_t pollStackFree = 0;
+
+// Log when the calling task's stack high-water mark reaches a new low
+static void noteStackFree(const char* tag, UBaseType_t* lowest) {
+  UBaseType_t headroom = uxTaskGetStackHighWaterMark(nullptr);
+  if (*lowest != 0 && headroom >= *lowest) return;
+  *lowest = headroom;
+  Serial.print(tag);
+  Serial.print(" Stack headroom: ");
+  Serial.print((unsigned)headroom);
+  Serial.println(" bytes");
+}
+
+static String stackReport() {
+  return "Stack headroom: send " + String((unsigned)telegramStackFree) + "/" +
+         String(TELEGRAM_TASK_STACK) + " B, poll " + String((unsigned)pollStackFree) + "/" +
+         String(TELEGRAM_POLL_STACK) + " B";
+}
 
 // Thread-safe command queue from Telegram to main loop
 volatile bool telegramCmdStart = false;
@@ -162,15 +497,8 @@ volatile bool telegramCmdResume = false;
 volatile bool telegramCmdStop = false;
 volatile bool telegramCmdMode = false;
 
-// Outgoing message queue (main loop -> telegram task)
-QueueHandle_t telegramMsgQueue = nullptr;
-// Use a larger buffer to avoid truncating multi-line / UTF-8 messages
-struct TelegramMsg {
-  char text[256];
-};
-
-// Last queued message to prevent duplicates
-char lastQueuedMessage[256] = "";
+// Message being sent by the telegram task (taken out of the outbox)
+static char outboxText[TELEGRAM_MSG_MAX + 1];
 unsigned long lastSentTime = 0;
 
 // Mutex for telegram operations
@@ -275,207 +603,286 @@ void initTelegramBot() {
     return;
   }
   
-  if (bot != nullptr) {
-    delete bot;
-  }
-  
-  telegramClient.setInsecure();  // Skip certificate verification
-  telegramClient.setTimeout(10000);  // 10 second timeout to prevent retries
-  bot = new UniversalTelegramBot(botToken, telegramClient);
-  bot->waitForResponse = 5000;  // 5 second wait for response
+  // Update ids belong to the bot: a new token starts over
+  telegramClientBegin(botToken);
+  lastUpdateId = 0;
+  botReady = true;
+  dashboardMessageId = loadTelegramDashboard(chatId);
+  dashboardShown = String();
+  dashboardKeyValid = false;
+  // A dashboard kept from before the reboot was turned on with /dashboard
+  if (dashboardMessageId != 0) telegramUseDashboard = true;
   Serial.println("Telegram bot initialized");
   
   // Send startup message
-  bot->sendMessage(chatId, "@office_b24_bot connected", "HTML");
+  botSend("@office_b24_bot connected");
 }
 
 // Queue message to Telegram (non-blocking)
-void sendTelegramMessage(const String& message) {
-  if (!wifiConnected || !telegramConfigured || telegramMsgQueue == nullptr) {
+void sendTelegramMessage(const String& message, TelegramPriority priority) {
+  if (!wifiConnected || !telegramConfigured || telegramTaskHandle == nullptr) {
     return;
   }
-  
-  TelegramMsg msg;
-  message.toCharArray(msg.text, sizeof(msg.text));
-  
-  if (xQueueSend(telegramMsgQueue, &msg, 0) == pdTRUE) {
+  // Timer and counter news is what the dashboard shows; no separate message for it
+  if (telegramUseDashboard && dashboardMessageId != 0 &&
+      (priority == TG_PRIO_TIMER || priority == TG_PRIO_COUNTERS)) {
+    return;
+  }
+
+  TgPushResult result = tgOutboxPush(message.c_str(), message.length(), priority, millis());
+  if (result == TG_PUSH_QUEUED) {
     Serial.print("[TG] Queued: ");
     Serial.println(message);
+  } else if (result == TG_PUSH_DUPLICATE) {
+    Serial.print("[TG] Already queued: ");
+    Serial.println(message);
+  }
+}
+
+// Retry what may go through later; a message Telegram refuses will be refused again
+static TgSendResult sendResult(int httpCode) {
+  if (httpCode == 200) return TG_SEND_OK;
+  if (httpCode <= 0 || httpCode == 429 || httpCode >= 500) return TG_SEND_RETRY;
+  return TG_SEND_REJECTED;
+}
+
+// One update from the poll task, run on the send task (only the configured chat is served)
+static void handleTelegramMessage(const TelegramUpdate& message) {
+  if (strcmp(message.chatId, chatId) != 0) return;
+  String text = message.text;
+  String rawText = text;  // keep original for names / IDs
+  text.toLowerCase();
+
+  // Dashboard button: acknowledge (stops the button's spinner) and act without a reply;
+  // the dashboard itself shows the new state
+  if (message.type == TG_UPDATE_CALLBACK) {
+    telegramAnswerCallback(message.callbackId);
+    Serial.print("[TG] Button: ");
+    Serial.println(text);
+    if (text == "work") telegramCmdStart = true;
+    else if (text == "pause") telegramCmdPause = true;
+    else if (text == "resume") telegramCmdResume = true;
+    else if (text == "stop") telegramCmdStop = true;
+    else if (text == "mode") telegramCmdMode = true;
+    return;
+  }
+
+  Serial.print("[TG] Command: ");
+  Serial.println(text);
+
+  if (text == "/start" || text == "/help") {
+    String msg = "📊 @office_b24_bot\n\n";
+    msg += "Pomodoro:\n";
+    msg += "/status - Current status\n";
+    msg += "/work - Start work\n";
+    msg += "/pause - Pause\n";
+    msg += "/resume - Resume\n";
+    msg += "/stop - Stop\n";
+    msg += "/mode - Change mode\n";
+    msg += "/dashboard - Live status message (posts a new one)\n\n";
+    msg += "Bitrix24:\n";
+    msg += "/b24groups - Configure groups/projects IDs\n";
+    msg += "/b24watch [IDs] - Watch several groups\n";
+    msg += "/trend [hours] - Counter history\n";
+    msg += "/net - Connection stats\n";
+    msg += "/perf [reset] - Network call timings\n";
+    msg += "Notifications are sent when counts change";
+    botSend(msg);
+  }
+  else if (text == "/b24groups") {
+    b24State = B24_STATE_AWAIT_IDS;
+    botSend("Send group/project ID (single group).\n"
+            "Example: 253");
+  }
+  else if (text.startsWith("/b24watch")) {
+    telegramB24Watch(text.substring(9));
+  }
+  else if (text.startsWith("/trend")) {
+    telegramTrend(text.substring(6));
+  }
+  else if (text == "/dashboard") {
+    telegramUseDashboard = true;
+    dashboardRepost = true;
+  }
+  else if (text == "/net") {
+    botSend("🌐 " + httpPoolReport());
+  }
+  else if (text == "/perf reset") {
+    netPerfClear();
+    botSend("⏱ Network call stats cleared");
+  }
+  else if (text == "/perf") {
+    netPerfLog();
+    botSend("⏱ " + netPerfReport() + "\n\n📤 " + tgOutboxReport() + "\n\n🧵 " + stackReport());
+  }
+  else if (text == "/work") {
+    telegramCmdStart = true;
+    botSend("🍅 Starting...");
+  }
+  else if (text == "/pause") {
+    telegramCmdPause = true;
+    botSend("⏸ Pausing...");
+  }
+  else if (text == "/resume") {
+    telegramCmdResume = true;
+    botSend("▶️ Resuming...");
+  }
+  else if (text == "/stop") {
+    telegramCmdStop = true;
+    botSend("⏹ Stopping...");
+  }
+  else if (text == "/mode") {
+    telegramCmdMode = true;
+    String modeStr;
+    switch (currentMode) {
+      case MODE_1_1: modeStr = "25/5"; break;
+      case MODE_25_5: modeStr = "50/10"; break;
+      case MODE_50_10: modeStr = "1/1"; break;
+    }
+    botSend("⏱ Mode: " + modeStr);
+  }
+  else if (text == "/status") {
+    String msg = "🍅 ";
+    msg += (currentState == STOPPED) ? "Stopped" : 
+           (currentState == RUNNING) ? (isWorkSession ? "Working" : "Resting") : "Paused";
+    msg += " | ";
+    switch (currentMode) {
+      case MODE_1_1: msg += "1/1"; break;
+      case MODE_25_5: msg += "25/5"; break;
+      case MODE_50_10: msg += "50/10"; break;
+    }
+    botSend(msg);
+  }
+  else {
+    // Accept plain numeric ID even if user didn't run /b24groups
+    // (this matches your workflow: tap 3rd section -> send \"253\")
+    if (b24State == B24_STATE_IDLE) {
+      String digits;
+      digits.reserve(16);
+      for (uint16_t k = 0; k < rawText.length() && digits.length() < 16; k++) {
+        char c = rawText[k];
+        if (c >= '0' && c <= '9') digits += c;
+      }
+      digits.trim();
+      String trimmedRaw = rawText;
+      trimmedRaw.trim();
+      if (digits.length() > 0 && digits.length() == trimmedRaw.length()) {
+        digits.toCharArray(b24SelectedIds, sizeof(b24SelectedIds));
+        telegramB24SetSingleGroup(digits);
+        b24State = B24_STATE_AWAIT_NEXT_ACTION;
+        return;
+      }
+    }
+
+    // --- B24 group/project flow replies ---
+    if (b24State == B24_STATE_AWAIT_IDS) {
+      // Only numeric IDs supported
+      String cleaned = rawText;
+      cleaned.trim();
+      String digits;
+      digits.reserve(16);
+      for (uint16_t k = 0; k < cleaned.length() && digits.length() < 16; k++) {
+        char c = cleaned[k];
+        if (c >= '0' && c <= '9') digits += c;
+      }
+      digits.trim();
+
+      if (digits.length() > 0 && digits.length() == cleaned.length()) {
+        digits.toCharArray(b24SelectedIds, sizeof(b24SelectedIds));
+        telegramB24SetSingleGroup(digits);
+        b24State = B24_STATE_AWAIT_NEXT_ACTION;
+        botSend("Tap the 3rd section again to switch back to ALL delayed-by-me mode.\n"
+                "Or reply: ALL to switch back now.");
+      } else {
+        botSend("Only numeric group IDs are supported, e.g. 253.");
+      }
+    } else if (b24State == B24_STATE_AWAIT_NEXT_ACTION) {
+      if (text.indexOf("all") >= 0 || text.indexOf("ALL") >= 0) {
+        setBitrixSelectedGroupId(0);
+        b24State = B24_STATE_IDLE;
+        botSend("OK. Switched back to ALL delayed-by-me mode.");
+      } else {
+        // If user sends another number, treat as new group id
+        String digits;
+        digits.reserve(16);
+        for (uint16_t k = 0; k < text.length() && digits.length() < 16; k++) {
+          char c = text[k];
+          if (c >= '0' && c <= '9') digits += c;
+        }
+        digits.trim();
+        if (digits.length() > 0) {
+          telegramB24SetSingleGroup(digits);
+        } else {
+          botSend("Reply ALL to switch back, or send another group ID.");
+        }
+      }
+    }
+  }
+}
+
+// Telegram poll task: one getUpdates long poll at a time. It only receives: updates are
+// parsed into fixed records and queued for the send task, which runs the commands, so this
+// stack holds no more than the TLS handshake and the JSON tokenizer.
+static void telegramPollTask(void* parameter) {
+  Serial.println("[TG POLL] Started");
+  static TelegramUpdate updates[TELEGRAM_UPDATES_MAX];
+
+  while (true) {
+    if (isAPActive() || WiFi.status() != WL_CONNECTED || !botReady) {
+      vTaskDelay(pdMS_TO_TICKS(1000));
+      continue;
+    }
+
+    int count = telegramGetUpdates(&lastUpdateId, TELEGRAM_LONG_POLL, ALLOWED_UPDATES, updates);
+    if (count < 0) {
+      vTaskDelay(pdMS_TO_TICKS(BOT_RETRY_INTERVAL));
+      continue;
+    }
+    for (int i = 0; i < count; i++) {
+      // Waits while the send task is busy: the next poll only confirms what was queued
+      xQueueSend(telegramUpdateQueue, &updates[i], portMAX_DELAY);
+    }
+    noteStackFree("[TG POLL]", &pollStackFree);
   }
 }
 
 // Telegram task - sends queued messages in background
 void telegramTask(void* parameter) {
   Serial.println("[TG TASK] Started");
+  // Bitrix24 lookups for commands/notifications go ahead of background polling
+  b24QueueSetTaskPriority(B24_PRIO_NOTIFY);
   
   while (true) {
     // Skip Telegram operations when AP is active (no internet connection)
-    if (isAPActive()) {
+    if (isAPActive() || WiFi.status() != WL_CONNECTED || !botReady) {
       vTaskDelay(pdMS_TO_TICKS(1000));  // Wait 1 second before checking again
       continue;
     }
+
+    // Commands first: a reply shouldn't wait behind queued notifications
+    TelegramUpdate update;
+    while (xQueueReceive(telegramUpdateQueue, &update, 0) == pdTRUE) {
+      handleTelegramMessage(update);
+    }
     
-    // Send queued messages
-    TelegramMsg outMsg;
-    if (telegramMsgQueue != nullptr && xQueueReceive(telegramMsgQueue, &outMsg, 0) == pdTRUE) {
-      if (bot != nullptr) {
+    // Send queued messages (spaced by SEND_COOLDOWN; the rest wait in the outbox)
+    if (millis() - lastSentTime >= SEND_COOLDOWN) {
+      uint32_t id = tgOutboxNext(outboxText, millis());
+      if (id != 0) {
         Serial.print("[TG TASK] Sending: ");
-        Serial.println(outMsg.text);
+        Serial.println(outboxText);
         // send as HTML-formatted message (for bold parts)
-        bot->sendMessage(chatId, outMsg.text, "HTML");
-        Serial.println("[TG TASK] Done");
+        int httpCode = botSend(outboxText);
+        tgOutboxFinish(id, sendResult(httpCode), millis());
+        lastSentTime = millis();
+        Serial.println(httpCode == 200 ? "[TG TASK] Done" : "[TG TASK] Failed");
       }
     }
-    
-    // Check for incoming commands (less frequently)
-    static unsigned long lastCheck = 0;
-    if (millis() - lastCheck > BOT_CHECK_INTERVAL && bot != nullptr) {
-      lastCheck = millis();
-      int numNewMessages = bot->getUpdates(bot->last_message_received + 1);
-      
-      for (int i = 0; i < numNewMessages; i++) {
-        String text = bot->messages[i].text;
-        String rawText = text;  // keep original for names / IDs
-        String from_id = bot->messages[i].chat_id;
-        
-        if (from_id != String(chatId)) continue;
-        text.toLowerCase();
-        
-        Serial.print("[TG] Command: ");
-        Serial.println(text);
-        
-        if (text == "/start" || text == "/help") {
-          String msg = "📊 @office_b24_bot\n\n";
-          msg += "Pomodoro:\n";
-          msg += "/status - Current status\n";
-          msg += "/work - Start work\n";
-          msg += "/pause - Pause\n";
-          msg += "/resume - Resume\n";
-          msg += "/stop - Stop\n";
-          msg += "/mode - Change mode\n\n";
-          msg += "Bitrix24:\n";
-          msg += "/b24groups - Configure groups/projects IDs\n";
-          msg += "Notifications are sent when counts change";
-          bot->sendMessage(chatId, msg, "HTML");
-        }
-        else if (text == "/b24groups") {
-          b24State = B24_STATE_AWAIT_IDS;
-          bot->sendMessage(chatId,
-            "Send group/project ID (single group).\n"
-            "Example: 253",
-            "HTML"
-          );
-        }
-        else if (text == "/work") {
-          telegramCmdStart = true;
-          bot->sendMessage(chatId, "🍅 Starting...", "HTML");
-        }
-        else if (text == "/pause") {
-          telegramCmdPause = true;
-          bot->sendMessage(chatId, "⏸ Pausing...", "HTML");
-        }
-        else if (text == "/resume") {
-          telegramCmdResume = true;
-          bot->sendMessage(chatId, "▶️ Resuming...", "HTML");
-        }
-        else if (text == "/stop") {
-          telegramCmdStop = true;
-          bot->sendMessage(chatId, "⏹ Stopping...", "HTML");
-        }
-        else if (text == "/mode") {
-          telegramCmdMode = true;
-          String modeStr;
-          switch (currentMode) {
-            case MODE_1_1: modeStr = "25/5"; break;
-            case MODE_25_5: modeStr = "50/10"; break;
-            case MODE_50_10: modeStr = "1/1"; break;
-          }
-          bot->sendMessage(chatId, "⏱ Mode: " + modeStr, "HTML");
-        }
-        else if (text == "/status") {
-          String msg = "🍅 ";
-          msg += (currentState == STOPPED) ? "Stopped" : 
-                 (currentState == RUNNING) ? (isWorkSession ? "Working" : "Resting") : "Paused";
-          msg += " | ";
-          switch (currentMode) {
-            case MODE_1_1: msg += "1/1"; break;
-            case MODE_25_5: msg += "25/5"; break;
-            case MODE_50_10: msg += "50/10"; break;
-          }
-          bot->sendMessage(chatId, msg, "HTML");
-        }
-        else {
-          // Accept plain numeric ID even if user didn't run /b24groups
-          // (this matches your workflow: tap 3rd section -> send \"253\")
-          if (b24State == B24_STATE_IDLE) {
-            String digits;
-            digits.reserve(16);
-            for (uint16_t k = 0; k < rawText.length() && digits.length() < 16; k++) {
-              char c = rawText[k];
-              if (c >= '0' && c <= '9') digits += c;
-            }
-            digits.trim();
-            String trimmedRaw = rawText;
-            trimmedRaw.trim();
-            if (digits.length() > 0 && digits.length() == trimmedRaw.length()) {
-              digits.toCharArray(b24SelectedIds, sizeof(b24SelectedIds));
-              telegramB24SetSingleGroup(digits);
-              b24State = B24_STATE_AWAIT_NEXT_ACTION;
-              continue;
-            }
-          }
-
-          // --- B24 group/project flow replies ---
-          if (b24State == B24_STATE_AWAIT_IDS) {
-            // Only numeric IDs supported
-            String cleaned = rawText;
-            cleaned.trim();
-            String digits;
-            digits.reserve(16);
-            for (uint16_t k = 0; k < cleaned.length() && digits.length() < 16; k++) {
-              char c = cleaned[k];
-              if (c >= '0' && c <= '9') digits += c;
-            }
-            digits.trim();
-
-            if (digits.length() > 0 && digits.length() == cleaned.length()) {
-              digits.toCharArray(b24SelectedIds, sizeof(b24SelectedIds));
-              telegramB24SetSingleGroup(digits);
-              b24State = B24_STATE_AWAIT_NEXT_ACTION;
-              bot->sendMessage(chatId,
-                "Tap the 3rd section again to switch back to ALL delayed-by-me mode.\n"
-                "Or reply: ALL to switch back now.",
-                "HTML"
-              );
-            } else {
-              bot->sendMessage(chatId, "Only numeric group IDs are supported, e.g. 253.", "HTML");
-            }
-          } else if (b24State == B24_STATE_AWAIT_NEXT_ACTION) {
-            if (text.indexOf("all") >= 0 || text.indexOf("ALL") >= 0) {
-              setBitrixSelectedGroupId(0);
-              b24State = B24_STATE_IDLE;
-              bot->sendMessage(chatId, "OK. Switched back to ALL delayed-by-me mode.", "HTML");
-            } else {
-              // If user sends another number, treat as new group id
-              String digits;
-              digits.reserve(16);
-              for (uint16_t k = 0; k < text.length() && digits.length() < 16; k++) {
-                char c = text[k];
-                if (c >= '0' && c <= '9') digits += c;
-              }
-              digits.trim();
-              if (digits.length() > 0) {
-                telegramB24SetSingleGroup(digits);
-              } else {
-                bot->sendMessage(chatId, "Reply ALL to switch back, or send another group ID.", "HTML");
-              }
-            }
-          }
-        }
-      }
-    }
-    
-    vTaskDelay(pdMS_TO_TICKS(100));  // Check queue frequently
+    dashboardTick();
+    noteStackFree("[TG TASK]", &telegramStackFree);
+
+    // Wake early for an incoming command, else check the outbox again
+    if (xQueuePeek(telegramUpdateQueue, &update, pdMS_TO_TICKS(100)) == pdTRUE) continue;
   }
 }
 
@@ -528,19 +935,28 @@ void startTelegramTask() {
   
   // Create mutex for thread-safe telegram operations
   telegramMutex = xSemaphoreCreateMutex();
-  
-  // Create message queue for outgoing messages
-  telegramMsgQueue = xQueueCreate(MSG_QUEUE_SIZE, sizeof(TelegramMsg));
+
+  // Incoming updates (poll task -> send task)
+  telegramUpdateQueue = xQueueCreate(TELEGRAM_UPDATES_MAX, sizeof(TelegramUpdate));
   
   // Create task with low priority (but not lowest)
   xTaskCreatePinnedToCore(
     telegramTask,           // Task function
     "TelegramTask",         // Task name
-    8192,                   // Stack size
+    TELEGRAM_TASK_STACK,    // Stack size (see wifi_telegram.h)
     NULL,                   // Parameters
     1,                      // Priority (low but runs)
     &telegramTaskHandle,    // Task handle
     0                       // Core 0
   );
-  Serial.println("Telegram task created on core 0");
+  xTaskCreatePinnedToCore(
+    telegramPollTask,       // Task function
+    "TelegramPoll",         // Task name
+    TELEGRAM_POLL_STACK,    // Stack size (see wifi_telegram.h)
+    NULL,                   // Parameters
+    1,                      // Priority (blocks in the long poll almost all the time)
+    &telegramPollTaskHandle,// Task handle
+    0                       // Core 0
+  );
+  Serial.println("Telegram tasks created on core 0");
 }
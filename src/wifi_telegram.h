@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include "pomodoro_types.h"
+#include "telegram_outbox.h"
 
 // WiFi credentials from platformio.ini build flags
 #ifndef WIFI_SSID
@@ -20,10 +21,44 @@
   #define TELEGRAM_CHAT_ID ""
 #endif
 
-// Telegram bot polling interval
-#define MSG_QUEUE_SIZE 3
-const unsigned long BOT_CHECK_INTERVAL = 5000;  // Check every 5 seconds
-const unsigned long SEND_COOLDOWN = 3000;  // 3 second cooldown between sends
+// getUpdates long poll: the server holds the request until a message arrives or this many
+// seconds pass, so commands arrive within a round trip and an idle chat costs one request
+// per interval
+#ifndef TELEGRAM_LONG_POLL
+#define TELEGRAM_LONG_POLL 50
+#endif
+
+// Stack of the task that runs commands and sends (bytes). Its deepest path is a command
+// that queries Bitrix24 (about 3 KB of frames) plus a TLS handshake when a connection has
+// to be renewed. The lowest headroom seen is logged and shown by /perf; trim to that.
+#ifndef TELEGRAM_TASK_STACK
+#define TELEGRAM_TASK_STACK 6144
+#endif
+
+// Stack of the task holding the getUpdates long poll (bytes). It only receives: the poll
+// itself takes about 1.5 KB (URL, JSON tokenizer, one update record, HTTPClient), and the
+// rest is for the TLS handshake when the kept-alive connection has to be renewed.
+#ifndef TELEGRAM_POLL_STACK
+#define TELEGRAM_POLL_STACK 4096
+#endif
+
+// Live dashboard: one pinned message per chat shows the timer and Bitrix24 counters and is
+// edited in place when they change; timer events and counter digests are then not posted
+// as separate messages. An inline keyboard under it controls the timer. Off by default:
+// /dashboard turns it on (and it stays on while its message is kept).
+#ifndef TELEGRAM_DASHBOARD
+#define TELEGRAM_DASHBOARD 0
+#endif
+
+// Minimum time between dashboard edits (ms)
+#ifndef TELEGRAM_DASHBOARD_MIN_INTERVAL
+#define TELEGRAM_DASHBOARD_MIN_INTERVAL 5000UL
+#endif
+
+extern bool telegramUseDashboard;
+
+const unsigned long BOT_RETRY_INTERVAL = 5000;  // Pause after a failed poll
+const unsigned long SEND_COOLDOWN = 3000;  // 3 second cooldown between queued sends to the chat
 
 // Thread-safe command queue from Telegram to main loop
 extern volatile bool telegramCmdStart;
@@ -35,7 +70,8 @@ extern volatile bool telegramCmdMode;
 // Functions
 void connectWiFi();
 void initTelegramBot();
-void sendTelegramMessage(const String& message);
+// Queue a message for the chat (non-blocking; see telegram_outbox.h)
+void sendTelegramMessage(const String& message, TelegramPriority priority = TG_PRIO_NORMAL);
 void processTelegramCommands();
 void startTelegramTask();
 void reloadCredentials();  // Reload credentials from NVS (call after saving via web interface)
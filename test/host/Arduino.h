@@ -0,0 +1,198 @@
+// Host stand-in for the Arduino core, just enough for the modules built by [env:native]
+// String, Print/Stream and Serial behave like the ESP32 core's; time only moves when a
+// test sets hostMillis (or something calls delay()), so timing logic runs deterministically.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HEX 16
+#define DEC 10
+#define IRAM_ATTR
+#define PROGMEM
+#define F(x) x
+
+inline unsigned long hostMillis = 0;
+
+inline unsigned long millis() { return hostMillis; }
+inline unsigned long micros() { return hostMillis * 1000UL; }
+inline void delay(unsigned long ms) { hostMillis += ms; }
+inline void yield() {}
+
+class String {
+public:
+  String(const char* text = "") : s(text ? text : "") {}
+  String(const std::string& text) : s(text) {}
+  String(char c) : s(1, c) {}
+  String(int v, unsigned char base = 10) : s(format((long)v, base)) {}
+  String(unsigned int v, unsigned char base = 10) : s(formatU(v, base)) {}
+  String(long v, unsigned char base = 10) : s(format(v, base)) {}
+  String(unsigned long v, unsigned char base = 10) : s(formatU(v, base)) {}
+  String(float v, unsigned int decimals = 2) : s(formatF(v, decimals)) {}
+  String(double v, unsigned int decimals = 2) : s(formatF(v, decimals)) {}
+
+  unsigned int length() const { return (unsigned int)s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  bool isEmpty() const { return s.empty(); }
+  bool reserve(unsigned int size) { s.reserve(size); return true; }
+
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  bool concat(const char* text, unsigned int len) { s.append(text, len); return true; }
+  String& operator+=(int v) { s += format(v, 10); return *this; }
+  String& operator+=(unsigned int v) { s += formatU(v, 10); return *this; }
+  String& operator+=(long v) { s += format(v, 10); return *this; }
+  String& operator+=(unsigned long v) { s += formatU(v, 10); return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+  friend String operator+(const String& a, const char* b) { return String(a.s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b.s); }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : '\0'; }
+
+  bool equalsIgnoreCase(const String& o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const {
+    return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  int indexOf(const String& t, unsigned int from = 0) const { return pos(s.find(t.s, from)); }
+  String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (to > s.size()) to = (unsigned int)s.size();
+    return from < to ? String(s.substr(from, to - from)) : String();
+  }
+  long toInt() const { return atol(s.c_str()); }
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    size_t b = s.find_last_not_of(" \t\r\n");
+    s = (a == std::string::npos) ? std::string() : s.substr(a, b - a + 1);
+  }
+
+private:
+  std::string s;
+
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  static std::string formatU(unsigned long v, unsigned char base) {
+    char buf[40];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do {
+      unsigned d = (unsigned)(v % base);
+      *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+      v /= base;
+    } while (v != 0);
+    return p;
+  }
+  static std::string format(long v, unsigned char base) {
+    if (v < 0 && base == 10) return "-" + formatU((unsigned long)-v, base);
+    return formatU((unsigned long)v, base);
+  }
+  static std::string formatF(double v, unsigned int decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    return buf;
+  }
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (n < size && write(buffer[n])) n++;
+    return n;
+  }
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, (unsigned int)decimals)); }
+  template <typename T>
+  size_t println(const T& v) { return print(v) + println(); }
+  template <typename T>
+  size_t println(const T& v, int format) { return print(v, format) + println(); }
+  size_t println() { return write("\r\n"); }
+  size_t printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return write(buf);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  // No blocking on a host: a read that finds nothing ends like a timeout on the device
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t n = 0;
+    int c;
+    while (n < length && (c = read()) >= 0) buffer[n++] = (char)c;
+    return n;
+  }
+  virtual size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  void setTimeout(unsigned long ms) { timeout = ms; }
+
+protected:
+  unsigned long timeout = 1000;
+};
+
+// Serial output is dropped (set HOST_SERIAL=1 in the environment to see it)
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t c) override {
+    static const bool shown = getenv("HOST_SERIAL") != nullptr;
+    if (shown) putchar(c);
+    return 1;
+  }
+  using Print::write;
+  operator bool() const { return true; }
+};
+
+inline HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 256 * 1024; }
+  uint32_t getMinFreeHeap() { return 256 * 1024; }
+  uint32_t getMaxAllocHeap() { return 128 * 1024; }
+};
+
+inline EspClass ESP;
+
+#endif // HOST_ARDUINO_H
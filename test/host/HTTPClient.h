@@ -0,0 +1,62 @@
+// Host stand-in for the ESP32 core's HTTPClient, as far as HttpBodyStream and httpAcceptGzip
+// use it. A test hands in the response with respond(). As on the device, header() only
+// reports collected headers, and values stay from an earlier response until collectHeaders()
+// is called again.
+
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+class HTTPClient {
+public:
+  // Test side: the next response (size -1 = no Content-Length, "" = header absent)
+  void respond(Stream& body, int size = -1, const char* contentEncoding = "",
+               const char* transferEncoding = "") {
+    stream = &body;
+    length = size;
+    for (Header& h : collected) {
+      const char* value = strcasecmp(h.key.c_str(), "Content-Encoding") == 0 ? contentEncoding
+                        : strcasecmp(h.key.c_str(), "Transfer-Encoding") == 0 ? transferEncoding : "";
+      if (value[0] != '\0') h.value = value;
+    }
+  }
+  // Test side: what the request would have sent
+  String requestHeader(const char* name) const {
+    for (const Header& h : sent) {
+      if (strcasecmp(h.key.c_str(), name) == 0) return String(h.value);
+    }
+    return String();
+  }
+
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    collected.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) collected.push_back({headerKeys[i], ""});
+  }
+  String header(const char* name) {
+    for (const Header& h : collected) {
+      if (strcasecmp(h.key.c_str(), name) == 0) return String(h.value);
+    }
+    return String();
+  }
+  void addHeader(const String& name, const String& value, bool = false, bool = true) {
+    sent.push_back({name.c_str(), value.c_str()});
+  }
+  Stream& getStream() { return *stream; }
+  int getSize() { return length; }
+  void end() { sent.clear(); }
+
+private:
+  struct Header {
+    std::string key;
+    std::string value;
+  };
+  std::vector<Header> collected;
+  std::vector<Header> sent;
+  Stream* stream = nullptr;
+  int length = -1;
+};
+
+#endif // HOST_HTTPCLIENT_H
@@ -0,0 +1,25 @@
+// Host stand-in for FreeRTOS: a single thread, so critical sections have nothing to exclude
+// and ticks are milliseconds of hostMillis
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <Arduino.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct { int nesting; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((mux)->nesting++)
+#define portEXIT_CRITICAL(mux) ((mux)->nesting--)
+
+#endif // HOST_FREERTOS_H
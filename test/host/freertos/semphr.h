@@ -0,0 +1,33 @@
+// Host stand-in for FreeRTOS semaphores. Nothing else runs to give a taken semaphore back,
+// so a take that would block fails right away: tests see "busy" exactly as a zero timeout
+// would on the device.
+
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+struct StaticSemaphore_t {
+  int count;
+};
+typedef StaticSemaphore_t* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) {
+  buffer->count = 1;
+  return buffer;
+}
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return xSemaphoreCreateMutexStatic(new StaticSemaphore_t);
+}
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t) {
+  if (sem->count == 0) return pdFALSE;
+  sem->count--;
+  return pdTRUE;
+}
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  if (sem->count != 0) return pdFALSE;
+  sem->count++;
+  return pdTRUE;
+}
+
+#endif // HOST_FREERTOS_SEMPHR_H
@@ -0,0 +1,16 @@
+// Host stand-in for FreeRTOS tasks: there is only the test's own thread. Tests that need
+// several tasks switch hostCurrentTask to play each of them in turn.
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+inline void vTaskDelay(TickType_t ticks) { hostMillis += ticks; }
+inline TickType_t xTaskGetTickCount() { return (TickType_t)hostMillis; }
+inline TaskHandle_t hostCurrentTask = (TaskHandle_t)&hostMillis;
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostCurrentTask; }
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,42 @@
+// Recorded response bodies as a Stream for host tests
+// `chunk` caps what available() and one readBytes() hand out, like TLS records arriving a
+// few at a time, so readers are exercised across buffer refills.
+
+#ifndef MEMORY_STREAM_H
+#define MEMORY_STREAM_H
+
+#include <Arduino.h>
+
+class MemoryStream : public Stream {
+public:
+  MemoryStream(const void* data, size_t length, size_t chunk = 0)
+    : bytes((const uint8_t*)data), len(length), pos(0), chunkLen(chunk) {}
+  explicit MemoryStream(const char* text, size_t chunk = 0)
+    : MemoryStream(text, strlen(text), chunk) {}
+
+  int available() override {
+    size_t left = len - pos;
+    return (int)((chunkLen > 0 && left > chunkLen) ? chunkLen : left);
+  }
+  int read() override { return pos < len ? bytes[pos++] : -1; }
+  int peek() override { return pos < len ? bytes[pos] : -1; }
+  size_t readBytes(char* buffer, size_t length) override {
+    size_t n = (size_t)available();
+    if (n > length) n = length;
+    memcpy(buffer, bytes + pos, n);
+    pos += n;
+    return n;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) override { return readBytes((char*)buffer, length); }
+  size_t write(uint8_t) override { return 0; }
+
+  size_t position() const { return pos; }
+
+private:
+  const uint8_t* bytes;
+  size_t len;
+  size_t pos;
+  size_t chunkLen;
+};
+
+#endif // MEMORY_STREAM_H
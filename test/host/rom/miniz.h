@@ -0,0 +1,67 @@
+// Host stand-in for the ESP32 ROM's tinfl inflater, on top of zlib (link with -lz)
+// Same calling contract as the ROM: output goes to the caller's circular 32 KB window and
+// the sizes come back as the bytes consumed / produced. zlib keeps its own window.
+
+#ifndef HOST_ROM_MINIZ_H
+#define HOST_ROM_MINIZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4
+};
+
+typedef enum {
+  TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS = -4,
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor {
+  z_stream z;
+  bool live;
+};
+
+inline void tinfl_init(tinfl_decompressor* r) {
+  if (r->live) inflateEnd(&r->z);
+  r->z = z_stream();
+  r->live = (inflateInit2(&r->z, -15) == Z_OK);  // Raw deflate, as tinfl without zlib header
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const mz_uint8* in, size_t* inSize,
+                                     mz_uint8* outStart, mz_uint8* outNext, size_t* outSize,
+                                     const mz_uint32 flags) {
+  (void)outStart;
+  if (!r->live) return TINFL_STATUS_BAD_PARAM;
+  r->z.next_in = (Bytef*)in;
+  r->z.avail_in = (uInt)*inSize;
+  r->z.next_out = outNext;
+  r->z.avail_out = (uInt)*outSize;
+  int rc = inflate(&r->z, Z_SYNC_FLUSH);
+  *inSize -= r->z.avail_in;
+  *outSize -= r->z.avail_out;
+  // zlib's state goes with the stream, as the caller frees the decompressor without telling
+  if (rc == Z_STREAM_END || (rc != Z_OK && rc != Z_BUF_ERROR)) {
+    inflateEnd(&r->z);
+    r->live = false;
+    return rc == Z_STREAM_END ? TINFL_STATUS_DONE : TINFL_STATUS_FAILED;
+  }
+  if (r->z.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+  return (flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT
+                                             : TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS;
+}
+
+#endif // HOST_ROM_MINIZ_H
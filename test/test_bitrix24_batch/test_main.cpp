@@ -0,0 +1,148 @@
+// Batch body building and the split of recorded batch responses
+
+#include <unity.h>
+#include "bitrix24_batch.h"
+#include "memory_stream.h"
+
+// Keeps TYPE.DIALOG (im.counters.get) or the id of the first task (tasks.task.list)
+struct ProbeReader : Bitrix24ResultReader {
+  long dialogs = -1;
+  uint8_t firstId = 0;
+  uint8_t tokens = 0;
+  void feed(JsonStreamReader& json, JsonToken token, uint8_t base) override {
+    tokens++;
+    if (token == JSON_NUMBER && json.matchesFrom(base, "TYPE.DIALOG")) {
+      dialogs = json.asInt();
+    } else if (token == JSON_STRING && firstId == 0 && json.matchesFrom(base, "tasks.#.id")) {
+      firstId = (uint8_t)json.asInt();
+    }
+  }
+};
+
+// As recorded from a portal (result_time trimmed): three commands, one of them failed
+static const char BATCH_RESPONSE[] =
+  "{\"result\":{"
+    "\"result\":{"
+      "\"dialogs\":{\"TYPE\":{\"ALL\":5,\"DIALOG\":3,\"CHAT\":2}},"
+      "\"expired\":{\"tasks\":[{\"id\":\"41\",\"title\":\"Report\"},{\"id\":\"42\",\"title\":\"Call\"}]},"
+      "\"undone\":[{\"id\":\"7\"}]"
+    "},"
+    "\"result_error\":{\"wa0\":{\"error\":\"ACCESS_DENIED\",\"error_description\":\"Access denied\"}},"
+    "\"result_total\":{\"expired\":17,\"undone\":4},"
+    "\"result_next\":{\"expired\":50},"
+    "\"result_time\":{\"dialogs\":{\"start\":1768827539.1,\"duration\":0.01}}"
+  "},\"time\":{\"start\":1768827539.0,\"finish\":1768827539.2}}";
+
+static Bitrix24BatchCmd cmds[4];
+static ProbeReader dialogsReader;
+
+void setUp() {
+  dialogsReader = ProbeReader();
+  cmds[0] = {"dialogs", "im.counters.get", "", &dialogsReader};
+  cmds[1] = {"expired", "tasks.task.list", "filter[<DEADLINE]=2026-01-19", nullptr};
+  cmds[2] = {"undone", "tasks.task.list", "filter[REAL_STATUS]=2", nullptr};
+  cmds[3] = {"wa0", "tasks.task.list", "filter[GROUP_ID]=12", nullptr};
+}
+
+void tearDown() {}
+
+static JsonToken readBatch(const char* body, size_t chunk, bool* hasResults) {
+  MemoryStream stream(body, chunk);
+  JsonStreamReader json(stream);
+  return b24BatchRead(json, cmds, 4, hasResults);
+}
+
+void test_body_encodes_sub_queries() {
+  char buffer[256];
+  QueryBuilder body(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(b24BatchBuildBody(body, cmds, 2));
+  TEST_ASSERT_EQUAL_STRING(
+    "halt=0&cmd[dialogs]=im.counters.get"
+    "&cmd[expired]=tasks.task.list%3Ffilter%5B%3CDEADLINE%5D%3D2026-01-19",
+    body.c_str());
+}
+
+void test_body_overflow_is_reported() {
+  char buffer[48];
+  QueryBuilder body(buffer, sizeof(buffer));
+  TEST_ASSERT_FALSE(b24BatchBuildBody(body, cmds, 4));
+  TEST_ASSERT_TRUE(body.overflowed());
+  TEST_ASSERT_TRUE(strlen(body.c_str()) < sizeof(buffer));
+}
+
+void test_results_go_to_their_readers() {
+  bool hasResults;
+  TEST_ASSERT_EQUAL(JSON_END, readBatch(BATCH_RESPONSE, 0, &hasResults));
+  TEST_ASSERT_TRUE(hasResults);
+  TEST_ASSERT_EQUAL(3, dialogsReader.dialogs);
+  TEST_ASSERT_FALSE(cmds[0].failed);
+}
+
+void test_totals_and_errors_land_on_their_commands() {
+  bool hasResults;
+  readBatch(BATCH_RESPONSE, 0, &hasResults);
+  TEST_ASSERT_EQUAL(17, cmds[1].total);
+  TEST_ASSERT_EQUAL(4, cmds[2].total);
+  TEST_ASSERT_EQUAL(0, cmds[3].total);
+  TEST_ASSERT_FALSE(cmds[1].failed);
+  TEST_ASSERT_TRUE(cmds[3].failed);
+  TEST_ASSERT_EQUAL(0, b24BatchTotal(cmds, 4, "dialogs"));
+  TEST_ASSERT_EQUAL(17, b24BatchTotal(cmds, 4, "expired"));
+  TEST_ASSERT_EQUAL(0, b24BatchTotal(cmds, 4, "missing"));
+}
+
+void test_reader_sees_only_its_own_result() {
+  bool hasResults;
+  readBatch(BATCH_RESPONSE, 0, &hasResults);
+  // Object start, TYPE start, three numbers, TYPE end, object end
+  TEST_ASSERT_EQUAL(7, dialogsReader.tokens);
+}
+
+void test_list_results_reach_a_reader() {
+  ProbeReader expired;
+  cmds[1].reader = &expired;
+  bool hasResults;
+  TEST_ASSERT_EQUAL(JSON_END, readBatch(BATCH_RESPONSE, 0, &hasResults));
+  TEST_ASSERT_EQUAL(41, expired.firstId);
+  TEST_ASSERT_EQUAL(17, cmds[1].total);
+  TEST_ASSERT_EQUAL(-1, expired.dialogs);
+}
+
+void test_small_reads_split_the_same_way() {
+  bool hasResults;
+  TEST_ASSERT_EQUAL(JSON_END, readBatch(BATCH_RESPONSE, 7, &hasResults));
+  TEST_ASSERT_TRUE(hasResults);
+  TEST_ASSERT_EQUAL(3, dialogsReader.dialogs);
+  TEST_ASSERT_EQUAL(17, cmds[1].total);
+  TEST_ASSERT_TRUE(cmds[3].failed);
+}
+
+void test_error_response_has_no_results() {
+  bool hasResults;
+  const char* body = "{\"error\":\"QUERY_LIMIT_EXCEEDED\",\"error_description\":\"Too many requests\"}";
+  TEST_ASSERT_EQUAL(JSON_END, readBatch(body, 0, &hasResults));
+  TEST_ASSERT_FALSE(hasResults);
+  TEST_ASSERT_EQUAL(-1, dialogsReader.dialogs);
+}
+
+void test_truncated_response_is_an_error() {
+  char body[sizeof(BATCH_RESPONSE)];
+  memcpy(body, BATCH_RESPONSE, 120);
+  body[120] = '\0';
+  bool hasResults;
+  TEST_ASSERT_EQUAL(JSON_ERROR, readBatch(body, 0, &hasResults));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_body_encodes_sub_queries);
+  RUN_TEST(test_body_overflow_is_reported);
+  RUN_TEST(test_results_go_to_their_readers);
+  RUN_TEST(test_totals_and_errors_land_on_their_commands);
+  RUN_TEST(test_reader_sees_only_its_own_result);
+  RUN_TEST(test_list_results_reach_a_reader);
+  RUN_TEST(test_small_reads_split_the_same_way);
+  RUN_TEST(test_error_response_has_no_results);
+  RUN_TEST(test_truncated_response_is_an_error);
+  return UNITY_END();
+}
@@ -0,0 +1,301 @@
+// Fleet protocol: nodes on a simulated multicast LAN electing a leader, holding its lease,
+// sharing counts and recovering when the leader goes quiet
+
+#include <unity.h>
+#include "bitrix24_fleet_node.h"
+
+static const uint32_t KEY = 0x5EED1234;
+static const uint8_t ALL = B24_FLEET_SHARED;
+static const uint8_t DIALOGS = B24_MASK(B24_COUNTER_DIALOGS);
+static const unsigned long TICK = 50;  // As the fleet task
+static const unsigned long T0 = 1000000;
+
+static const uint8_t MAX_NODES = 4;
+static B24FleetNode nodes[MAX_NODES];
+static uint8_t nodeCount;
+static bool online[MAX_NODES];
+static bool linked[MAX_NODES][MAX_NODES];  // false = the two don't hear each other
+static unsigned long now;
+static uint32_t framesSent;
+
+static void addNode(uint32_t nodeId, uint8_t mask) {
+  uint8_t i = nodeCount++;
+  b24FleetNodeInit(nodes[i], KEY, nodeId, now);
+  B24FleetCounts counts = {};
+  counts.mask = mask;
+  counts.unreadMessages = (uint16_t)nodeId;
+  b24FleetNodeSetCounts(nodes[i], counts);
+  online[i] = true;
+}
+
+// One tick of every online node; each frame reaches every other linked online node
+static void step() {
+  now += TICK;
+  for (uint8_t i = 0; i < nodeCount; i++) {
+    if (!online[i]) continue;
+    uint8_t frame[B24_FLEET_FRAME_LEN];
+    size_t len = b24FleetNodeTick(nodes[i], now, frame);
+    if (len == 0) continue;
+    framesSent++;
+    for (uint8_t j = 0; j < nodeCount; j++) {
+      if (online[j] && linked[i][j]) b24FleetNodeReceive(nodes[j], frame, len, now);
+    }
+  }
+}
+
+static void run(unsigned long ms) {
+  for (unsigned long t = 0; t < ms; t += TICK) step();
+}
+
+static uint8_t leaders() {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < nodeCount; i++) {
+    if (online[i] && nodes[i].role == B24_FLEET_LEADER) n++;
+  }
+  return n;
+}
+
+// Every online node but the leader follows it
+static void assertLedBy(uint8_t leader) {
+  TEST_ASSERT_EQUAL(B24_FLEET_LEADER, nodes[leader].role);
+  TEST_ASSERT_EQUAL(1, leaders());
+  for (uint8_t i = 0; i < nodeCount; i++) {
+    if (i == leader || !online[i]) continue;
+    TEST_ASSERT_EQUAL(B24_FLEET_FOLLOWER, nodes[i].role);
+    TEST_ASSERT_EQUAL_HEX32(nodes[leader].nodeId, nodes[i].leaderId);
+  }
+}
+
+void setUp() {
+  nodeCount = 0;
+  now = T0;
+  framesSent = 0;
+  for (uint8_t i = 0; i < MAX_NODES; i++) {
+    for (uint8_t j = 0; j < MAX_NODES; j++) linked[i][j] = i != j;
+  }
+}
+
+void tearDown() {}
+
+void test_lone_node_takes_the_lead_after_listening() {
+  addNode(7, ALL);
+  run(BITRIX24_FLEET_TIMEOUT - TICK);
+  TEST_ASSERT_EQUAL(B24_FLEET_LISTEN, nodes[0].role);
+  TEST_ASSERT_EQUAL(0, framesSent);
+  // Holds every shared counter back while the election runs
+  TEST_ASSERT_EQUAL(ALL, b24FleetNodeCovered(nodes[0]));
+
+  step();
+  TEST_ASSERT_EQUAL(B24_FLEET_CANDIDATE, nodes[0].role);
+  run(2 * BITRIX24_FLEET_HEARTBEAT);
+  TEST_ASSERT_EQUAL(B24_FLEET_LEADER, nodes[0].role);
+  TEST_ASSERT_EQUAL(0, b24FleetNodeCovered(nodes[0]));
+}
+
+void test_fleet_booting_together_elects_the_best_node() {
+  addNode(0x30, ALL);
+  addNode(0x90, ALL);
+  addNode(0x60, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(1);
+  TEST_ASSERT_EQUAL(ALL, b24FleetNodeCovered(nodes[0]));
+}
+
+void test_rank_beats_node_id() {
+  addNode(0x90, DIALOGS);  // Knows one shared counter only
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(1);
+  TEST_ASSERT_EQUAL(ALL, b24FleetNodeCovered(nodes[0]));
+}
+
+void test_followers_receive_the_leaders_counts() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(0);
+  TEST_ASSERT_TRUE(nodes[1].sharedNew);
+  TEST_ASSERT_EQUAL(0x90, nodes[1].shared.unreadMessages);
+  nodes[1].sharedNew = false;
+
+  // Unchanged counts don't count as new; changed ones go out at once, with the next seq
+  B24FleetCounts counts = nodes[0].own;
+  uint32_t seq = counts.seq;
+  b24FleetNodeSetCounts(nodes[0], counts);
+  TEST_ASSERT_EQUAL(seq, nodes[0].own.seq);
+  run(BITRIX24_FLEET_HEARTBEAT);
+  TEST_ASSERT_FALSE(nodes[1].sharedNew);
+
+  counts.expiredTasks = 12;
+  b24FleetNodeSetCounts(nodes[0], counts);
+  TEST_ASSERT_EQUAL(seq + 1, nodes[0].own.seq);
+  step();
+  TEST_ASSERT_TRUE(nodes[1].sharedNew);
+  TEST_ASSERT_EQUAL(12, nodes[1].shared.expiredTasks);
+  TEST_ASSERT_EQUAL(seq + 1, nodes[1].shared.seq);
+}
+
+// The leader's heartbeats renew its lease for as long as they keep coming
+void test_heartbeats_keep_the_lease() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  uint32_t before = framesSent;
+  run(10 * 60 * 1000UL);
+  assertLedBy(0);
+  // One heartbeat per interval, nothing else
+  TEST_ASSERT_UINT32_WITHIN(2, 10 * 60 * 1000UL / BITRIX24_FLEET_HEARTBEAT, framesSent - before);
+}
+
+void test_lease_runs_out_when_the_leader_goes_quiet() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  addNode(0x60, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(0);
+
+  online[0] = false;
+  // Followers wait out the lease from the last heartbeat they heard
+  unsigned long lastHeard = nodes[1].lastLeaderFrame;
+  while (now + TICK - lastHeard < BITRIX24_FLEET_TIMEOUT) step();
+  TEST_ASSERT_EQUAL(B24_FLEET_FOLLOWER, nodes[1].role);
+  TEST_ASSERT_EQUAL(B24_FLEET_FOLLOWER, nodes[2].role);
+  // Both claim at once; the lower one hears the better claim and goes back to listening
+  step();
+  TEST_ASSERT_EQUAL(B24_FLEET_CANDIDATE, nodes[2].role);
+  TEST_ASSERT_EQUAL(B24_FLEET_LISTEN, nodes[1].role);
+  TEST_ASSERT_EQUAL(ALL, b24FleetNodeCovered(nodes[1]));
+  run(3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(2);
+  TEST_ASSERT_EQUAL(0, b24FleetNodeCovered(nodes[2]));
+}
+
+// A better node joining a running fleet follows instead of taking over, so nothing flaps
+void test_leader_keeps_its_role_against_a_better_newcomer() {
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  addNode(0x90, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(0);
+}
+
+// A candidate that claims while a leader exists is answered at once and follows
+void test_claim_is_answered_by_the_leader() {
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  addNode(0x90, ALL);
+  linked[0][1] = false;  // The newcomer misses the heartbeats for now
+  run(BITRIX24_FLEET_TIMEOUT + 2 * TICK);
+  TEST_ASSERT_EQUAL(B24_FLEET_CANDIDATE, nodes[1].role);
+  linked[0][1] = true;
+
+  // The next claim gets a heartbeat back on the leader's very next tick
+  while (nodes[1].lastSent + BITRIX24_FLEET_HEARTBEAT > now + TICK) step();
+  uint8_t frame[B24_FLEET_FRAME_LEN];
+  now += TICK;
+  TEST_ASSERT_EQUAL(0, b24FleetNodeTick(nodes[0], now, frame));
+  TEST_ASSERT_EQUAL(B24_FLEET_FRAME_LEN, b24FleetNodeTick(nodes[1], now, frame));
+  b24FleetNodeReceive(nodes[0], frame, sizeof(frame), now);
+  TEST_ASSERT_EQUAL(B24_FLEET_FRAME_LEN, b24FleetNodeTick(nodes[0], now, frame));
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  assertLedBy(0);
+}
+
+void test_two_leaders_meeting_leave_one() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  addNode(0x60, ALL);
+  // Network split: node 0 alone, nodes 1 and 2 together
+  linked[0][1] = linked[1][0] = linked[0][2] = linked[2][0] = false;
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT);
+  TEST_ASSERT_EQUAL(2, leaders());
+  TEST_ASSERT_EQUAL(B24_FLEET_LEADER, nodes[2].role);
+
+  linked[0][1] = linked[1][0] = linked[0][2] = linked[2][0] = true;
+  run(2 * BITRIX24_FLEET_HEARTBEAT);
+  assertLedBy(0);
+}
+
+void test_foreign_frames_echoes_and_garbage_are_ignored() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  B24FleetNode stranger;
+  b24FleetNodeInit(stranger, KEY + 1, 0xFF, now);
+  B24FleetCounts counts = {};
+  counts.mask = ALL;
+  b24FleetNodeSetCounts(stranger, counts);
+  now += BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT;
+  uint8_t frame[B24_FLEET_FRAME_LEN];
+  while (b24FleetNodeTick(stranger, now, frame) == 0 || stranger.role != B24_FLEET_LEADER) {
+    now += TICK;
+  }
+  // Another fleet's leader
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  TEST_ASSERT_EQUAL(B24_FLEET_LISTEN, nodes[1].role);
+  // Same fleet, but the node's own ID (its echo from the group)
+  stranger.fleetKey = KEY;
+  stranger.nodeId = nodes[1].nodeId;
+  stranger.sendNow = true;
+  TEST_ASSERT_EQUAL(B24_FLEET_FRAME_LEN, b24FleetNodeTick(stranger, now, frame));
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  TEST_ASSERT_EQUAL(B24_FLEET_LISTEN, nodes[1].role);
+  // Short, bad magic, unknown type
+  stranger.nodeId = 0xFF;
+  stranger.sendNow = true;
+  b24FleetNodeTick(stranger, now, frame);
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame) - 1, now);
+  frame[0] = 'X';
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  frame[0] = 'B';
+  frame[3] = 9;
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  TEST_ASSERT_EQUAL(B24_FLEET_LISTEN, nodes[1].role);
+  // The intact frame is taken
+  frame[3] = 1;
+  b24FleetNodeReceive(nodes[1], frame, sizeof(frame), now);
+  TEST_ASSERT_EQUAL(B24_FLEET_FOLLOWER, nodes[1].role);
+}
+
+void test_refresh_requests_are_rate_limited() {
+  addNode(0x90, ALL);
+  addNode(0x30, ALL);
+  run(BITRIX24_FLEET_TIMEOUT + 3 * BITRIX24_FLEET_HEARTBEAT + BITRIX24_FLEET_REFRESH_MIN);
+  assertLedBy(0);
+
+  nodes[1].refreshAsked = true;
+  step();
+  TEST_ASSERT_TRUE(nodes[0].refreshWanted);
+  nodes[0].refreshWanted = false;
+
+  nodes[1].refreshAsked = true;
+  run(BITRIX24_FLEET_REFRESH_MIN - 2 * TICK);
+  nodes[1].refreshAsked = true;
+  step();
+  TEST_ASSERT_FALSE(nodes[0].refreshWanted);
+  nodes[1].refreshAsked = true;
+  step();
+  TEST_ASSERT_TRUE(nodes[0].refreshWanted);
+
+  // Only followers ask
+  nodes[0].refreshWanted = false;
+  nodes[0].refreshAsked = true;
+  run(BITRIX24_FLEET_REFRESH_MIN);
+  TEST_ASSERT_FALSE(nodes[0].refreshWanted);
+  TEST_ASSERT_FALSE(nodes[0].refreshAsked);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_lone_node_takes_the_lead_after_listening);
+  RUN_TEST(test_fleet_booting_together_elects_the_best_node);
+  RUN_TEST(test_rank_beats_node_id);
+  RUN_TEST(test_followers_receive_the_leaders_counts);
+  RUN_TEST(test_heartbeats_keep_the_lease);
+  RUN_TEST(test_lease_runs_out_when_the_leader_goes_quiet);
+  RUN_TEST(test_leader_keeps_its_role_against_a_better_newcomer);
+  RUN_TEST(test_claim_is_answered_by_the_leader);
+  RUN_TEST(test_two_leaders_meeting_leave_one);
+  RUN_TEST(test_foreign_frames_echoes_and_garbage_are_ignored);
+  RUN_TEST(test_refresh_requests_are_rate_limited);
+  return UNITY_END();
+}
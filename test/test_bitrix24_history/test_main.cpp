@@ -0,0 +1,186 @@
+// Counter history: appends, gap fill, the ring wrapping, and downsampled reads
+
+#include <unity.h>
+#include "bitrix24_history.h"
+
+static const uint32_t RING = (BITRIX24_HISTORY_HOURS + 1) * B24_HISTORY_BLOCK_LEN;
+
+static void append(uint32_t minute, uint16_t unread, uint16_t tasks = 0) {
+  uint16_t values[B24_SERIES_COUNT] = {unread, tasks, (uint16_t)(unread / 2), 0};
+  b24HistoryAppend(values, minute);
+}
+
+static uint16_t at(uint32_t minutesAgo, B24Series series = B24_SERIES_UNREAD) {
+  uint16_t value = 0xFFFF;
+  TEST_ASSERT_TRUE(b24HistoryAt(series, minutesAgo, &value));
+  return value;
+}
+
+// Deterministic wiggly series with occasional jumps (some beyond one delta byte)
+static uint16_t sample(uint32_t minute) {
+  uint32_t h = minute * 2654435761u;
+  uint16_t base = (uint16_t)(minute % 500);
+  return (h >> 28) == 0 ? base + 400 : base + (uint16_t)((h >> 24) & 7);
+}
+
+void setUp() {
+  b24HistoryClear();
+}
+
+void tearDown() {}
+
+void test_empty_history() {
+  uint16_t out[4];
+  uint16_t value;
+  TEST_ASSERT_EQUAL(0, b24HistoryLength());
+  TEST_ASSERT_EQUAL(0, b24HistoryRead(B24_SERIES_UNREAD, 60, out, 4));
+  TEST_ASSERT_FALSE(b24HistoryAt(B24_SERIES_UNREAD, 0, &value));
+}
+
+void test_append_one_sample_per_minute() {
+  append(100, 3, 7);
+  append(101, 5, 6);
+  TEST_ASSERT_EQUAL(2, b24HistoryLength());
+  TEST_ASSERT_EQUAL(5, at(0));
+  TEST_ASSERT_EQUAL(3, at(1));
+  TEST_ASSERT_EQUAL(6, at(0, B24_SERIES_TASKS));
+  TEST_ASSERT_EQUAL(2, at(0, B24_SERIES_EXPIRED));
+
+  // The same or an earlier minute again is ignored
+  append(101, 9);
+  append(50, 9);
+  TEST_ASSERT_EQUAL(2, b24HistoryLength());
+  TEST_ASSERT_EQUAL(5, at(0));
+  uint16_t value;
+  TEST_ASSERT_FALSE(b24HistoryAt(B24_SERIES_UNREAD, 2, &value));
+  TEST_ASSERT_FALSE(b24HistoryAt(B24_SERIES_COUNT, 0, &value));
+}
+
+void test_gap_repeats_the_previous_sample() {
+  append(10, 3);
+  append(15, 8);
+  TEST_ASSERT_EQUAL(6, b24HistoryLength());
+  TEST_ASSERT_EQUAL(8, at(0));
+  for (uint32_t ago = 1; ago <= 5; ago++) TEST_ASSERT_EQUAL(3, at(ago));
+}
+
+void test_gap_longer_than_the_ring_starts_over() {
+  append(10, 3);
+  append(11, 4);
+  append(11 + RING + 1, 8);
+  TEST_ASSERT_EQUAL(1, b24HistoryLength());
+  TEST_ASSERT_EQUAL(8, at(0));
+
+  // Just short of that the ring is filled with the held value
+  b24HistoryClear();
+  append(10, 3);
+  append(10 + RING, 8);
+  TEST_ASSERT_TRUE(b24HistoryLength() > RING - B24_HISTORY_BLOCK_LEN);
+  TEST_ASSERT_EQUAL(8, at(0));
+  TEST_ASSERT_EQUAL(3, at(b24HistoryLength() - 1));
+}
+
+void test_big_jumps_are_spread_over_following_samples() {
+  append(0, 0);
+  append(1, 300);
+  TEST_ASSERT_EQUAL(127, at(0));
+  append(2, 300);
+  TEST_ASSERT_EQUAL(254, at(0));
+  append(3, 300);
+  TEST_ASSERT_EQUAL(300, at(0));
+  append(4, 0);
+  TEST_ASSERT_EQUAL(173, at(0));
+  // A new block starts from the absolute value
+  for (uint32_t m = 5; m <= B24_HISTORY_BLOCK_LEN; m++) append(m, 1000);
+  TEST_ASSERT_EQUAL(1000, at(0));
+}
+
+void test_ring_wraps_and_keeps_whole_hours() {
+  for (uint32_t m = 0; m < 3 * RING + 17; m++) append(m, sample(m));
+  uint32_t length = b24HistoryLength();
+  TEST_ASSERT_TRUE(length > RING - B24_HISTORY_BLOCK_LEN);
+  TEST_ASSERT_TRUE(length <= RING);
+  TEST_ASSERT_EQUAL(0, (3 * RING + 17 - length) % B24_HISTORY_BLOCK_LEN);
+
+  uint32_t last = 3 * RING + 16;
+  uint16_t value;
+  // Decoded values match where no jump was clipped (base resets at every block)
+  TEST_ASSERT_EQUAL(sample(last - length + 1), at(length - 1));
+  TEST_ASSERT_FALSE(b24HistoryAt(B24_SERIES_UNREAD, length, &value));
+}
+
+void test_read_takes_the_maximum_of_each_bucket() {
+  for (uint32_t m = 0; m < 120; m++) append(m, (uint16_t)m);
+  uint16_t out[8];
+  TEST_ASSERT_EQUAL(4, b24HistoryRead(B24_SERIES_UNREAD, 120, out, 4));
+  TEST_ASSERT_EQUAL(29, out[0]);
+  TEST_ASSERT_EQUAL(59, out[1]);
+  TEST_ASSERT_EQUAL(89, out[2]);
+  TEST_ASSERT_EQUAL(119, out[3]);
+  // Whole blocks per bucket (the stored peaks)
+  TEST_ASSERT_EQUAL(2, b24HistoryRead(B24_SERIES_UNREAD, 120, out, 2));
+  TEST_ASSERT_EQUAL(59, out[0]);
+  TEST_ASSERT_EQUAL(119, out[1]);
+}
+
+void test_read_is_capped_by_what_is_held() {
+  for (uint32_t m = 0; m < 5; m++) append(m, (uint16_t)(10 - m));
+  uint16_t out[8];
+  TEST_ASSERT_EQUAL(5, b24HistoryRead(B24_SERIES_UNREAD, 60, out, 8));
+  TEST_ASSERT_EQUAL(10, out[0]);
+  TEST_ASSERT_EQUAL(6, out[4]);
+  TEST_ASSERT_EQUAL(2, b24HistoryRead(B24_SERIES_UNREAD, 2, out, 8));
+  TEST_ASSERT_EQUAL(7, out[0]);
+  TEST_ASSERT_EQUAL(0, b24HistoryRead(B24_SERIES_UNREAD, 0, out, 8));
+  TEST_ASSERT_EQUAL(0, b24HistoryRead(B24_SERIES_UNREAD, 60, out, 0));
+}
+
+// Every read against the maximum over the decoded samples, bucket by bucket
+void test_downsampling_matches_sample_by_sample() {
+  for (uint32_t m = 0; m < RING + 250; m++) append(m, sample(m));
+  uint32_t length = b24HistoryLength();
+  const uint32_t spans[] = {1, 7, 59, 60, 61, 90, 360, 1000, length};
+  const uint16_t pointCounts[] = {1, 3, 24, 60, 97};
+  uint16_t out[100];
+  for (uint32_t span : spans) {
+    for (uint16_t points : pointCounts) {
+      uint16_t n = b24HistoryRead(B24_SERIES_UNREAD, span, out, points);
+      TEST_ASSERT_EQUAL(points < span ? points : span, n);
+      for (uint16_t k = 0; k < n; k++) {
+        uint32_t from = (uint32_t)((uint64_t)span * k / n);
+        uint32_t to = (uint32_t)((uint64_t)span * (k + 1) / n);
+        uint16_t peak = 0;
+        for (uint32_t i = from; i < to; i++) {
+          uint16_t v = at(span - 1 - i);
+          if (v > peak) peak = v;
+        }
+        TEST_ASSERT_EQUAL_MESSAGE(peak, out[k], "bucket peak");
+      }
+    }
+  }
+}
+
+void test_clear_forgets_everything() {
+  append(100, 3);
+  b24HistoryClear();
+  TEST_ASSERT_EQUAL(0, b24HistoryLength());
+  // Minute numbering starts over too
+  append(5, 4);
+  TEST_ASSERT_EQUAL(1, b24HistoryLength());
+  TEST_ASSERT_EQUAL(4, at(0));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_history);
+  RUN_TEST(test_append_one_sample_per_minute);
+  RUN_TEST(test_gap_repeats_the_previous_sample);
+  RUN_TEST(test_gap_longer_than_the_ring_starts_over);
+  RUN_TEST(test_big_jumps_are_spread_over_following_samples);
+  RUN_TEST(test_ring_wraps_and_keeps_whole_hours);
+  RUN_TEST(test_read_takes_the_maximum_of_each_bucket);
+  RUN_TEST(test_read_is_capped_by_what_is_held);
+  RUN_TEST(test_downsampling_matches_sample_by_sample);
+  RUN_TEST(test_clear_forgets_everything);
+  return UNITY_END();
+}
@@ -0,0 +1,372 @@
+// Pull long-poll bodies (frame splitting, event -> counter mapping, mid and config expiry)
+// and the client against a long-poll server stand-in
+
+#include <unity.h>
+#include "bitrix24_pull_events.h"
+#include "bitrix24_pull_client.h"
+#include "bitrix24_scheduler.h"
+#include "memory_stream.h"
+#include <string>
+#include <vector>
+
+static const uint8_t DIALOGS = B24_MASK(B24_COUNTER_DIALOGS);
+static const uint8_t RPA = B24_MASK(B24_COUNTER_RPA);
+static const uint8_t TASKS = B24_MASK(B24_COUNTER_EXPIRED) | B24_MASK(B24_COUNTER_GROUP);
+
+// As recorded from a portal's long-poll server (params trimmed)
+#define FRAME_IM_MESSAGE \
+  "#!NGINXNMS!#{\"id\":2204,\"mid\":\"d3f1c3a0f5e011ee8a0b0242ac120002\",\"channel\":\"a1b2c3\"," \
+  "\"tag\":\"\",\"time\":\"Mon, 19 Jan 2026 12:58:59 GMT\",\"text\":{\"module_id\":\"im\"," \
+  "\"command\":\"message\",\"params\":{\"chatId\":12,\"message\":{\"id\":991," \
+  "\"text\":\"\\u041f\\u0440\\u0438\\u0432\\u0435\\u0442\"}},\"extra\":{\"revision_web\":19}}}" \
+  "#!NGINXNME!#"
+#define FRAME_TASK_UPDATE \
+  "#!NGINXNMS!#{\"id\":2205,\"mid\":\"e0a7b1c2f5e011ee8a0b0242ac120002\",\"text\":{" \
+  "\"module_id\":\"tasks\",\"command\":\"task_update\",\"params\":{\"TASK_ID\":41," \
+  "\"AFTER\":{\"STATUS\":3,\"DEADLINE\":\"2026-01-20T19:00:00+03:00\"}}}}#!NGINXNME!#"
+#define FRAME_BIZPROC \
+  "#!NGINXNMS!#{\"id\":2206,\"mid\":\"f19c0d11f5e011ee8a0b0242ac120002\",\"text\":{" \
+  "\"module_id\":\"bizproc\",\"command\":\"taskAdd\",\"params\":{}}}#!NGINXNME!#"
+#define FRAME_CHANNEL_EXPIRE \
+  "#!NGINXNMS!#{\"id\":2207,\"mid\":\"0a1b2c3df5e111ee8a0b0242ac120002\",\"text\":{" \
+  "\"module_id\":\"pull\",\"command\":\"channel_expire\",\"params\":{\"action\":\"reconnect\"}}}" \
+  "#!NGINXNME!#"
+#define FRAME_ONLINE \
+  "#!NGINXNMS!#{\"id\":2208,\"mid\":\"1b2c3d4ef5e111ee8a0b0242ac120002\",\"text\":{" \
+  "\"module_id\":\"online\",\"command\":\"list\",\"params\":{\"users\":[1,356]}}}#!NGINXNME!#"
+
+static char lastMid[B24_PULL_MID_LEN];
+static bool configExpired;
+
+void setUp() {
+  strcpy(lastMid, "previous");
+  configExpired = false;
+}
+
+void tearDown() {}
+
+static uint8_t readFrames(const char* body) {
+  MemoryStream stream(body);
+  return b24PullReadFrames(stream, lastMid, &configExpired);
+}
+
+void test_event_counter_map() {
+  TEST_ASSERT_EQUAL(DIALOGS, b24PullEventCounters("im", "messageChat"));
+  TEST_ASSERT_EQUAL(DIALOGS, b24PullEventCounters("im", "readMessage"));
+  TEST_ASSERT_EQUAL(0, b24PullEventCounters("im", "startWriting"));
+  TEST_ASSERT_EQUAL(0, b24PullEventCounters("im", "inputActionNotify"));
+  TEST_ASSERT_EQUAL(TASKS, b24PullEventCounters("tasks", "comment_add"));
+  TEST_ASSERT_EQUAL(RPA, b24PullEventCounters("bizproc", "taskAdd"));
+  TEST_ASSERT_EQUAL(RPA, b24PullEventCounters("rpa", "itemUpdated"));
+  TEST_ASSERT_EQUAL(0, b24PullEventCounters("online", "list"));
+  TEST_ASSERT_EQUAL(0, b24PullEventCounters("", ""));
+}
+
+void test_single_frame() {
+  TEST_ASSERT_EQUAL(DIALOGS, readFrames(FRAME_IM_MESSAGE));
+  TEST_ASSERT_EQUAL_STRING("d3f1c3a0f5e011ee8a0b0242ac120002", lastMid);
+  TEST_ASSERT_FALSE(configExpired);
+}
+
+void test_several_frames_add_up() {
+  TEST_ASSERT_EQUAL(DIALOGS | TASKS | RPA,
+                    readFrames(FRAME_IM_MESSAGE FRAME_TASK_UPDATE FRAME_BIZPROC FRAME_ONLINE));
+  TEST_ASSERT_EQUAL_STRING("1b2c3d4ef5e111ee8a0b0242ac120002", lastMid);
+}
+
+void test_unrelated_events_only_move_the_mid() {
+  TEST_ASSERT_EQUAL(0, readFrames(FRAME_ONLINE));
+  TEST_ASSERT_EQUAL_STRING("1b2c3d4ef5e111ee8a0b0242ac120002", lastMid);
+}
+
+void test_channel_expiry_asks_for_a_new_config() {
+  TEST_ASSERT_EQUAL(TASKS, readFrames(FRAME_CHANNEL_EXPIRE FRAME_TASK_UPDATE));
+  TEST_ASSERT_TRUE(configExpired);
+}
+
+void test_broken_frame_is_skipped_but_its_mid_kept() {
+  const char* body =
+    "#!NGINXNMS!#{\"mid\":\"broken1\",\"text\":{\"module_id\":\"im\",\"command\":}}#!NGINXNME!#"
+    FRAME_BIZPROC;
+  TEST_ASSERT_EQUAL(RPA, readFrames(body));
+  TEST_ASSERT_EQUAL_STRING("f19c0d11f5e011ee8a0b0242ac120002", lastMid);
+
+  setUp();
+  TEST_ASSERT_EQUAL(0, readFrames("#!NGINXNMS!#{\"mid\":\"broken2\",\"text\":{\"module_id\":\"im\"#!NGINXNME!#"));
+  TEST_ASSERT_EQUAL_STRING("broken2", lastMid);
+}
+
+void test_body_cut_off_mid_frame() {
+  char body[] = FRAME_TASK_UPDATE FRAME_IM_MESSAGE;
+  body[strlen(FRAME_TASK_UPDATE) + 60] = '\0';
+  TEST_ASSERT_EQUAL(TASKS, readFrames(body));
+}
+
+void test_text_between_frames_is_ignored() {
+  // Marker look-alikes and stray bytes before and between frames
+  TEST_ASSERT_EQUAL(DIALOGS | RPA,
+                    readFrames("\r\n#!NGINX#!NGINXNM" FRAME_IM_MESSAGE "\n#" FRAME_BIZPROC "\r\n"));
+}
+
+void test_empty_body() {
+  TEST_ASSERT_EQUAL(0, readFrames(""));
+  TEST_ASSERT_EQUAL_STRING("previous", lastMid);
+}
+
+void test_long_mid_is_cut_to_fit() {
+  char body[256];
+  snprintf(body, sizeof(body), "#!NGINXNMS!#{\"mid\":\"%064d\",\"text\":{\"module_id\":\"im\"}}", 7);
+  TEST_ASSERT_EQUAL(DIALOGS, readFrames(body));
+  TEST_ASSERT_EQUAL(B24_PULL_MID_LEN - 1, strlen(lastMid));
+}
+
+// --- Long-poll server stand-in ---
+// Holds events by mid; a poll gets those newer than its `mid` (200) or nothing (304).
+
+struct PullEvent {
+  std::string mid;
+  std::string frame;
+};
+
+static std::vector<PullEvent> events;
+static std::string configBody;
+static bool configDown;
+static int failWith;              // Status of the next polls instead of an answer
+static unsigned configRequests;
+static unsigned polls;
+static std::string lastUrl;
+static B24PullClient client;
+static unsigned long now;
+
+static const char CONFIG_TEMPLATE[] =
+  "{\"result\":{\"server\":{\"version\":4,\"server_enabled\":true,"
+  "\"long_polling\":\"http://rt.bitrix24.ru/sub/\","
+  "\"long_pooling_secure\":\"https://rt.bitrix24.ru/sub/\","
+  "\"websocket\":\"ws://rt.bitrix24.ru/subws/\",\"hostname\":\"portal.bitrix24.ru\"},"
+  "\"channels\":{\"shared\":{\"id\":\"5cd1f0e7.shared\",\"start\":\"2026-01-19T09:00:00+03:00\","
+  "\"end\":\"2026-01-20T09:00:00+03:00\",\"type\":\"shared\"},"
+  "\"private\":{\"id\":\"%s\",\"start\":\"2026-01-19T09:00:00+03:00\","
+  "\"end\":\"2026-01-20T09:00:00+03:00\",\"type\":\"private\"}},"
+  "\"publicChannels\":[],\"api\":{\"revision_web\":19},\"clientId\":\"d0b5\"},"
+  "\"time\":{\"start\":1768809600.1,\"finish\":1768809600.2}}";
+
+static void setPrivateChannel(const char* id) {
+  char body[sizeof(CONFIG_TEMPLATE) + 80];
+  snprintf(body, sizeof(body), CONFIG_TEMPLATE, id);
+  configBody = body;
+}
+
+static void pushEvent(const char* mid, const char* moduleId, const char* command) {
+  char frame[256];
+  snprintf(frame, sizeof(frame),
+           "#!NGINXNMS!#{\"id\":1,\"mid\":\"%s\",\"text\":{\"module_id\":\"%s\","
+           "\"command\":\"%s\",\"params\":{}}}#!NGINXNME!#", mid, moduleId, command);
+  events.push_back({mid, frame});
+}
+
+static bool standInConfig(B24PullConfig* config) {
+  configRequests++;
+  if (configDown) return false;
+  MemoryStream body(configBody.data(), configBody.size(), 64);
+  return b24PullParseConfig(body, "", config);
+}
+
+static int standInGet(const char* url, B24PullClient& c) {
+  polls++;
+  lastUrl = url;
+  if (failWith != 0) return failWith;
+  const char* midParam = strstr(url, "&mid=");
+  std::string since = midParam != nullptr ? std::string(midParam + 5) : "";
+  std::string body;
+  for (const PullEvent& e : events) {
+    if (e.mid > since) body += e.frame;
+  }
+  // Nothing newer: the server holds the request for its timeout
+  if (body.empty()) return 304;
+  MemoryStream stream(body.data(), body.size(), 64);
+  b24PullClientReadEvents(c, stream);
+  return 200;
+}
+
+static unsigned long step(uint8_t* due) {
+  unsigned long wait = b24PullClientStep(client, standInConfig, standInGet, now, 0, due);
+  now += wait + 1000;
+  return wait;
+}
+
+static void resetStandIn() {
+  events.clear();
+  setPrivateChannel("a1b2c3d4.private");
+  configDown = false;
+  failWith = 0;
+  configRequests = 0;
+  polls = 0;
+  lastUrl.clear();
+  now = 1000;
+  b24PullClientInit(client);
+}
+
+void test_config_is_read_from_the_portal_answer() {
+  setPrivateChannel("a1b2c3d4.private");
+  B24PullConfig config;
+  MemoryStream body(configBody.data(), configBody.size(), 64);
+  TEST_ASSERT_TRUE(b24PullParseConfig(body, "", &config));
+  TEST_ASSERT_EQUAL_STRING("https://rt.bitrix24.ru/sub/", config.server);
+  TEST_ASSERT_EQUAL_STRING("a1b2c3d4.private", config.channelPrivate);
+  TEST_ASSERT_EQUAL_STRING("5cd1f0e7.shared", config.channelShared);
+
+  // Local stand-in URL replaces the portal's server
+  MemoryStream again(configBody.data(), configBody.size());
+  TEST_ASSERT_TRUE(b24PullParseConfig(again, "http://192.168.1.10:8080/sub/", &config));
+  TEST_ASSERT_EQUAL_STRING("http://192.168.1.10:8080/sub/", config.server);
+
+  // Pull switched off on the portal: no channels
+  MemoryStream off("{\"error\":\"ACCESS_DENIED\",\"error_description\":\"Pull is disabled\"}");
+  TEST_ASSERT_FALSE(b24PullParseConfig(off, "", &config));
+}
+
+void test_first_poll_connects_and_resyncs_once() {
+  resetStandIn();
+  uint8_t due;
+  TEST_ASSERT_EQUAL(0, step(&due));
+  TEST_ASSERT_EQUAL(1, configRequests);
+  TEST_ASSERT_EQUAL(1, polls);
+  TEST_ASSERT_EQUAL_STRING("https://rt.bitrix24.ru/sub/?CHANNEL_ID=a1b2c3d4.private/5cd1f0e7.shared",
+                           lastUrl.c_str());
+  TEST_ASSERT_EQUAL(B24_MASK_ALL, due);
+  TEST_ASSERT_TRUE(client.connected);
+
+  // Quiet channel: 304, nothing due, the config is kept
+  TEST_ASSERT_EQUAL(0, step(&due));
+  TEST_ASSERT_EQUAL(0, due);
+  TEST_ASSERT_EQUAL(1, configRequests);
+  TEST_ASSERT_TRUE(client.connected);
+}
+
+void test_events_mark_counters_and_the_mid_is_carried() {
+  resetStandIn();
+  uint8_t due;
+  step(&due);
+  pushEvent("0001", "im", "messageChat");
+  pushEvent("0002", "tasks", "task_update");
+  TEST_ASSERT_EQUAL(0, step(&due));
+  TEST_ASSERT_EQUAL(DIALOGS | TASKS, due);
+  TEST_ASSERT_EQUAL_STRING("0002", client.lastMid);
+
+  // The next poll confirms them: nothing is delivered twice
+  TEST_ASSERT_EQUAL(0, step(&due));
+  TEST_ASSERT_EQUAL(0, due);
+  TEST_ASSERT_TRUE(lastUrl.find("&mid=0002") != std::string::npos);
+
+  pushEvent("0003", "im", "startWriting");
+  pushEvent("0004", "bizproc", "taskAdd");
+  step(&due);
+  TEST_ASSERT_EQUAL(RPA, due);
+  TEST_ASSERT_EQUAL_STRING("0004", client.lastMid);
+}
+
+void test_channel_expire_fetches_a_new_config() {
+  resetStandIn();
+  uint8_t due;
+  step(&due);
+  pushEvent("0001", "pull", "channel_expire");
+  setPrivateChannel("e5f6a7b8.private");
+  step(&due);
+  TEST_ASSERT_EQUAL(0, due);
+  TEST_ASSERT_FALSE(client.configValid);
+  TEST_ASSERT_EQUAL(1, configRequests);
+
+  step(&due);
+  TEST_ASSERT_EQUAL(2, configRequests);
+  TEST_ASSERT_TRUE(lastUrl.find("CHANNEL_ID=e5f6a7b8.private/") != std::string::npos);
+  TEST_ASSERT_TRUE(lastUrl.find("&mid=0001") != std::string::npos);
+  // Still the same healthy channel: no full resync
+  TEST_ASSERT_EQUAL(0, due);
+}
+
+void test_config_is_refreshed_after_its_ttl() {
+  resetStandIn();
+  uint8_t due;
+  step(&due);
+  step(&due);
+  TEST_ASSERT_EQUAL(1, configRequests);
+  now += BITRIX24_PULL_CONFIG_TTL;
+  step(&due);
+  TEST_ASSERT_EQUAL(2, configRequests);
+}
+
+void test_failures_back_off_and_drop_the_channel() {
+  resetStandIn();
+  uint8_t due;
+  step(&due);
+  TEST_ASSERT_TRUE(client.connected);
+
+  failWith = -1;
+  unsigned long first = step(&due);
+  TEST_ASSERT_EQUAL(0, due);
+  TEST_ASSERT_FALSE(client.connected);
+  TEST_ASSERT_EQUAL(b24BackoffDelay(1, 0), first);
+  failWith = 502;
+  unsigned long second = step(&due);
+  TEST_ASSERT_TRUE(second > first);
+  TEST_ASSERT_EQUAL(2, client.failures);
+  // The retry started over with a fresh config
+  TEST_ASSERT_EQUAL(2, configRequests);
+
+  // Back up: everything is resynced once, the backoff resets
+  failWith = 0;
+  TEST_ASSERT_EQUAL(0, step(&due));
+  TEST_ASSERT_EQUAL(B24_MASK_ALL, due);
+  TEST_ASSERT_TRUE(client.connected);
+  TEST_ASSERT_EQUAL(0, client.failures);
+}
+
+void test_no_config_means_no_poll() {
+  resetStandIn();
+  configDown = true;
+  uint8_t due;
+  TEST_ASSERT_EQUAL(b24BackoffDelay(1, 0), step(&due));
+  TEST_ASSERT_EQUAL(0, polls);
+  TEST_ASSERT_FALSE(client.connected);
+  TEST_ASSERT_TRUE(step(&due) > b24BackoffDelay(1, 0));
+
+  configDown = false;
+  step(&due);
+  TEST_ASSERT_EQUAL(1, polls);
+  TEST_ASSERT_TRUE(client.connected);
+}
+
+void test_disconnect_resyncs_on_return() {
+  resetStandIn();
+  uint8_t due;
+  step(&due);
+  b24PullClientDisconnect(client);
+  TEST_ASSERT_FALSE(client.connected);
+  step(&due);
+  TEST_ASSERT_EQUAL(B24_MASK_ALL, due);
+  // The channel itself was fine: the config is kept
+  TEST_ASSERT_EQUAL(1, configRequests);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_event_counter_map);
+  RUN_TEST(test_single_frame);
+  RUN_TEST(test_several_frames_add_up);
+  RUN_TEST(test_unrelated_events_only_move_the_mid);
+  RUN_TEST(test_channel_expiry_asks_for_a_new_config);
+  RUN_TEST(test_broken_frame_is_skipped_but_its_mid_kept);
+  RUN_TEST(test_body_cut_off_mid_frame);
+  RUN_TEST(test_text_between_frames_is_ignored);
+  RUN_TEST(test_empty_body);
+  RUN_TEST(test_long_mid_is_cut_to_fit);
+  RUN_TEST(test_config_is_read_from_the_portal_answer);
+  RUN_TEST(test_first_poll_connects_and_resyncs_once);
+  RUN_TEST(test_events_mark_counters_and_the_mid_is_carried);
+  RUN_TEST(test_channel_expire_fetches_a_new_config);
+  RUN_TEST(test_config_is_refreshed_after_its_ttl);
+  RUN_TEST(test_failures_back_off_and_drop_the_channel);
+  RUN_TEST(test_no_config_means_no_poll);
+  RUN_TEST(test_disconnect_resyncs_on_return);
+  return UNITY_END();
+}
@@ -0,0 +1,231 @@
+// Request governor: token bucket, waiting line, admission and count query sharing
+
+#include <unity.h>
+#include "bitrix24_queue.h"
+#include <freertos/task.h>
+
+static const unsigned long T0 = 1000000;
+
+static int taskA, taskB;
+
+void setUp() {
+  // The module's bucket is full again after a quiet minute
+  hostMillis += 60000;
+  hostCurrentTask = &taskA;
+}
+
+void tearDown() {
+  b24QueueRelease();
+}
+
+static uint8_t takeAll(B24TokenBucket& bucket, B24Priority prio, unsigned long now) {
+  uint8_t n = 0;
+  while (n < 255 && b24BucketTryTake(bucket, prio, now)) n++;
+  return n;
+}
+
+void test_bucket_keeps_a_reserve_for_higher_classes() {
+  B24TokenBucket bucket;
+  b24BucketInit(bucket, T0);
+  TEST_ASSERT_EQUAL(BITRIX24_RATE_BURST - BITRIX24_RATE_RESERVE_BACKGROUND,
+                    takeAll(bucket, B24_PRIO_BACKGROUND, T0));
+  TEST_ASSERT_EQUAL(BITRIX24_RATE_RESERVE_BACKGROUND - BITRIX24_RATE_RESERVE_NOTIFY,
+                    takeAll(bucket, B24_PRIO_NOTIFY, T0));
+  TEST_ASSERT_EQUAL(BITRIX24_RATE_RESERVE_NOTIFY, takeAll(bucket, B24_PRIO_INTERACTIVE, T0));
+}
+
+void test_bucket_refills_at_the_rate_up_to_the_burst() {
+  B24TokenBucket bucket;
+  b24BucketInit(bucket, T0);
+  takeAll(bucket, B24_PRIO_INTERACTIVE, T0);
+  const unsigned long perToken = 1000 / BITRIX24_RATE_PER_SEC;
+  TEST_ASSERT_FALSE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, T0 + perToken - 1));
+  TEST_ASSERT_TRUE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, T0 + perToken));
+  // Partial tokens carry over between refills
+  TEST_ASSERT_FALSE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, T0 + perToken + perToken / 2));
+  TEST_ASSERT_TRUE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, T0 + 2 * perToken));
+
+  TEST_ASSERT_EQUAL(BITRIX24_RATE_BURST, takeAll(bucket, B24_PRIO_INTERACTIVE, T0 + 3600000));
+}
+
+void test_drained_bucket_holds_background_back_longest() {
+  B24TokenBucket bucket;
+  b24BucketInit(bucket, T0);
+  b24BucketDrain(bucket, T0);
+  const unsigned long perToken = 1000 / BITRIX24_RATE_PER_SEC;
+  unsigned long background = T0 + (BITRIX24_RATE_RESERVE_BACKGROUND + 1) * perToken;
+  TEST_ASSERT_FALSE(b24BucketTryTake(bucket, B24_PRIO_BACKGROUND, background - 1));
+  TEST_ASSERT_TRUE(b24BucketTryTake(bucket, B24_PRIO_BACKGROUND, background));
+}
+
+void test_bucket_across_millis_wraparound() {
+  B24TokenBucket bucket;
+  unsigned long beforeWrap = (unsigned long)0 - 200;
+  b24BucketInit(bucket, beforeWrap);
+  b24BucketDrain(bucket, beforeWrap);
+  TEST_ASSERT_FALSE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, beforeWrap + 499));
+  TEST_ASSERT_TRUE(b24BucketTryTake(bucket, B24_PRIO_INTERACTIVE, beforeWrap + 500));
+}
+
+void test_line_orders_by_class_then_arrival() {
+  B24WaitLine line = {};
+  int8_t bg1 = b24LineJoin(line, B24_PRIO_BACKGROUND);
+  int8_t notify = b24LineJoin(line, B24_PRIO_NOTIFY);
+  int8_t bg2 = b24LineJoin(line, B24_PRIO_BACKGROUND);
+  int8_t ui = b24LineJoin(line, B24_PRIO_INTERACTIVE);
+
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, ui));
+  TEST_ASSERT_FALSE(b24LineIsFirst(line, notify));
+  b24LineLeave(line, ui);
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, notify));
+  b24LineLeave(line, notify);
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, bg1));
+  TEST_ASSERT_FALSE(b24LineIsFirst(line, bg2));
+  b24LineLeave(line, bg1);
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, bg2));
+}
+
+void test_line_reuses_slots_and_reports_full() {
+  B24WaitLine line = {};
+  for (uint8_t i = 0; i < B24WaitLine::MAX_WAITERS; i++) {
+    TEST_ASSERT_EQUAL(i, b24LineJoin(line, B24_PRIO_BACKGROUND));
+  }
+  TEST_ASSERT_EQUAL(-1, b24LineJoin(line, B24_PRIO_INTERACTIVE));
+  b24LineLeave(line, 0);
+  // A late arrival in a freed low slot still queues behind the older waiters
+  TEST_ASSERT_EQUAL(0, b24LineJoin(line, B24_PRIO_BACKGROUND));
+  TEST_ASSERT_FALSE(b24LineIsFirst(line, 0));
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, 1));
+}
+
+void test_line_fifo_across_ticket_wraparound() {
+  B24WaitLine line = {};
+  line.nextTicket = 0xFFFFFFFFu;
+  int8_t older = b24LineJoin(line, B24_PRIO_NOTIFY);
+  int8_t newer = b24LineJoin(line, B24_PRIO_NOTIFY);
+  TEST_ASSERT_EQUAL(0, line.waiters[newer].ticket);
+  TEST_ASSERT_TRUE(b24LineIsFirst(line, older));
+  TEST_ASSERT_FALSE(b24LineIsFirst(line, newer));
+}
+
+void test_one_request_at_a_time() {
+  TEST_ASSERT_TRUE(b24QueueAcquire(1000));
+  unsigned long start = hostMillis;
+  TEST_ASSERT_FALSE(b24QueueAcquire(1000));
+  TEST_ASSERT_TRUE(hostMillis - start > 1000);
+  b24QueueRelease();
+  start = hostMillis;
+  TEST_ASSERT_TRUE(b24QueueAcquire(1000));
+  TEST_ASSERT_EQUAL(start, hostMillis);
+}
+
+void test_class_is_per_task() {
+  TEST_ASSERT_EQUAL(B24_PRIO_BACKGROUND, b24QueueTaskPriority());
+  b24QueueSetTaskPriority(B24_PRIO_INTERACTIVE);
+  TEST_ASSERT_EQUAL(B24_PRIO_INTERACTIVE, b24QueueTaskPriority());
+  hostCurrentTask = &taskB;
+  TEST_ASSERT_EQUAL(B24_PRIO_BACKGROUND, b24QueueTaskPriority());
+  b24QueueSetTaskPriority(B24_PRIO_NOTIFY);
+  hostCurrentTask = &taskA;
+  TEST_ASSERT_EQUAL(B24_PRIO_INTERACTIVE, b24QueueTaskPriority());
+  b24QueueSetTaskPriority(B24_PRIO_BACKGROUND);
+}
+
+// Time an acquire takes after QUERY_LIMIT_EXCEEDED emptied the bucket
+static unsigned long waitAfterLimit(B24Priority prio) {
+  b24QueueSetTaskPriority(prio);
+  b24QueueOnLimitExceeded();
+  unsigned long start = hostMillis;
+  TEST_ASSERT_TRUE(b24QueueAcquire(BITRIX24_QUEUE_TIMEOUT));
+  b24QueueRelease();
+  b24QueueSetTaskPriority(B24_PRIO_BACKGROUND);
+  return hostMillis - start;
+}
+
+void test_limit_exceeded_slows_background_most() {
+  const unsigned long perToken = 1000 / BITRIX24_RATE_PER_SEC;
+  unsigned long ui = waitAfterLimit(B24_PRIO_INTERACTIVE);
+  TEST_ASSERT_TRUE(ui >= perToken && ui < perToken + 100);
+  hostMillis += 60000;
+  unsigned long background = waitAfterLimit(B24_PRIO_BACKGROUND);
+  TEST_ASSERT_TRUE(background >= (BITRIX24_RATE_RESERVE_BACKGROUND + 1) * perToken);
+}
+
+void test_request_key() {
+  TEST_ASSERT_EQUAL(b24RequestKey("tasks.task.list", "filter[GROUP_ID]=12"),
+                    b24RequestKey("tasks.task.list", "filter[GROUP_ID]=12"));
+  TEST_ASSERT_NOT_EQUAL(b24RequestKey("tasks.task.list", "filter[GROUP_ID]=12"),
+                        b24RequestKey("tasks.task.list", "filter[GROUP_ID]=13"));
+  // The separator keeps method/params boundaries apart
+  TEST_ASSERT_NOT_EQUAL(b24RequestKey("ab", "c"), b24RequestKey("a", "bc"));
+}
+
+void test_finished_count_is_shared_briefly() {
+  uint32_t key = b24RequestKey("tasks.task.list", "shared");
+  uint16_t total = 0;
+  bool ok = false;
+  TEST_ASSERT_FALSE(b24DedupBegin(key, &total, &ok));
+  b24DedupFinish(key, 17, true);
+
+  hostCurrentTask = &taskB;
+  hostMillis += 1999;
+  TEST_ASSERT_TRUE(b24DedupBegin(key, &total, &ok));
+  TEST_ASSERT_EQUAL(17, total);
+  TEST_ASSERT_TRUE(ok);
+
+  hostMillis += 1;
+  TEST_ASSERT_FALSE(b24DedupBegin(key, &total, &ok));
+  b24DedupFinish(key, 0, false);
+  TEST_ASSERT_TRUE(b24DedupBegin(key, &total, &ok));
+  TEST_ASSERT_FALSE(ok);
+}
+
+void test_in_flight_query_is_waited_for_until_the_timeout() {
+  uint32_t key = b24RequestKey("tasks.task.list", "in-flight");
+  uint16_t total;
+  bool ok;
+  TEST_ASSERT_FALSE(b24DedupBegin(key, &total, &ok));
+  // Nobody finishes it here: the second caller gives up waiting and runs it itself
+  hostCurrentTask = &taskB;
+  unsigned long start = hostMillis;
+  TEST_ASSERT_FALSE(b24DedupBegin(key, &total, &ok));
+  TEST_ASSERT_TRUE(hostMillis - start >= BITRIX24_QUEUE_TIMEOUT);
+  b24DedupFinish(key, 3, true);
+}
+
+void test_more_queries_than_slots_still_run() {
+  uint16_t total;
+  bool ok;
+  uint32_t keys[6];
+  for (uint8_t i = 0; i < 6; i++) {
+    char params[8];
+    snprintf(params, sizeof(params), "q%u", i);
+    keys[i] = b24RequestKey("tasks.task.list", params);
+    TEST_ASSERT_FALSE(b24DedupBegin(keys[i], &total, &ok));
+  }
+  for (uint8_t i = 0; i < 6; i++) b24DedupFinish(keys[i], i, true);
+  // Only the ones that got a slot are shared
+  TEST_ASSERT_TRUE(b24DedupBegin(keys[0], &total, &ok));
+  TEST_ASSERT_EQUAL(0, total);
+  TEST_ASSERT_FALSE(b24DedupBegin(keys[5], &total, &ok));
+  b24DedupFinish(keys[5], 5, true);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_keeps_a_reserve_for_higher_classes);
+  RUN_TEST(test_bucket_refills_at_the_rate_up_to_the_burst);
+  RUN_TEST(test_drained_bucket_holds_background_back_longest);
+  RUN_TEST(test_bucket_across_millis_wraparound);
+  RUN_TEST(test_line_orders_by_class_then_arrival);
+  RUN_TEST(test_line_reuses_slots_and_reports_full);
+  RUN_TEST(test_line_fifo_across_ticket_wraparound);
+  RUN_TEST(test_one_request_at_a_time);
+  RUN_TEST(test_class_is_per_task);
+  RUN_TEST(test_limit_exceeded_slows_background_most);
+  RUN_TEST(test_request_key);
+  RUN_TEST(test_finished_count_is_shared_briefly);
+  RUN_TEST(test_in_flight_query_is_waited_for_until_the_timeout);
+  RUN_TEST(test_more_queries_than_slots_still_run);
+  return UNITY_END();
+}
@@ -0,0 +1,148 @@
+// Poll scheduler: interval and backoff policy, and the due mask driven by a simulated clock
+
+#include <unity.h>
+#include "bitrix24_scheduler.h"
+
+static const uint8_t DIALOGS = B24_MASK(B24_COUNTER_DIALOGS);
+static const uint8_t RPA = B24_MASK(B24_COUNTER_RPA);
+static const uint8_t EXPIRED = B24_MASK(B24_COUNTER_EXPIRED);
+static const uint8_t GROUP = B24_MASK(B24_COUNTER_GROUP);
+
+static const unsigned long T0 = 1000000;
+
+void setUp() {
+  b24SchedulerReset();
+}
+
+void tearDown() {}
+
+void test_poll_interval_policy() {
+  TEST_ASSERT_EQUAL(BITRIX24_DIALOGS_INTERVAL, b24PollInterval(B24_COUNTER_DIALOGS, false, false));
+  TEST_ASSERT_EQUAL(BITRIX24_EXPIRED_INTERVAL, b24PollInterval(B24_COUNTER_EXPIRED, false, false));
+  TEST_ASSERT_EQUAL(BITRIX24_DIALOGS_INTERVAL / 2, b24PollInterval(B24_COUNTER_DIALOGS, true, false));
+  TEST_ASSERT_EQUAL(BITRIX24_RPA_INTERVAL * BITRIX24_RELAX_FACTOR,
+                    b24PollInterval(B24_COUNTER_RPA, false, true));
+  TEST_ASSERT_EQUAL(BITRIX24_GROUP_INTERVAL * BITRIX24_RELAX_FACTOR / 2,
+                    b24PollInterval(B24_COUNTER_GROUP, true, true));
+}
+
+void test_backoff_doubles_up_to_the_cap() {
+  // rnd = delay / 4 lands exactly on the unjittered delay
+  TEST_ASSERT_EQUAL(0, b24BackoffDelay(0, 0));
+  TEST_ASSERT_EQUAL(30000, b24BackoffDelay(1, 7500));
+  TEST_ASSERT_EQUAL(60000, b24BackoffDelay(2, 15000));
+  TEST_ASSERT_EQUAL(120000, b24BackoffDelay(3, 30000));
+  TEST_ASSERT_EQUAL(BITRIX24_BACKOFF_MAX, b24BackoffDelay(6, BITRIX24_BACKOFF_MAX / 4));
+  TEST_ASSERT_EQUAL(BITRIX24_BACKOFF_MAX, b24BackoffDelay(255, BITRIX24_BACKOFF_MAX / 4));
+}
+
+void test_backoff_jitter_stays_within_a_quarter() {
+  for (uint8_t failures = 1; failures < 12; failures++) {
+    unsigned long nominal = b24BackoffDelay(failures, 0) * 4 / 3;
+    for (uint32_t rnd = 0; rnd < 4000000000u; rnd += 99991777u) {
+      unsigned long d = b24BackoffDelay(failures, rnd);
+      TEST_ASSERT_TRUE(d >= nominal - nominal / 4);
+      TEST_ASSERT_TRUE(d <= nominal + nominal / 4);
+    }
+  }
+}
+
+void test_everything_is_due_after_reset() {
+  TEST_ASSERT_EQUAL(B24_MASK_ALL, b24SchedulerDueMask(T0, false));
+  b24SchedulerOnFetched(DIALOGS | RPA, 0, 0, T0, 0);
+  TEST_ASSERT_EQUAL(EXPIRED | GROUP, b24SchedulerDueMask(T0, false));
+}
+
+void test_counters_come_due_on_their_own_cadence() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(T0 + BITRIX24_DIALOGS_INTERVAL - 1, false));
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(T0 + BITRIX24_DIALOGS_INTERVAL, false));
+  TEST_ASSERT_EQUAL(DIALOGS | RPA | GROUP, b24SchedulerDueMask(T0 + BITRIX24_RPA_INTERVAL, false));
+  TEST_ASSERT_EQUAL(B24_MASK_ALL, b24SchedulerDueMask(T0 + BITRIX24_EXPIRED_INTERVAL, false));
+}
+
+void test_relaxed_polling_stretches_intervals() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(T0 + BITRIX24_DIALOGS_INTERVAL, true));
+  TEST_ASSERT_EQUAL(DIALOGS,
+                    b24SchedulerDueMask(T0 + BITRIX24_DIALOGS_INTERVAL * BITRIX24_RELAX_FACTOR, true));
+}
+
+void test_recent_change_halves_the_interval_for_a_while() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, DIALOGS, T0, 0);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(T0 + BITRIX24_DIALOGS_INTERVAL / 2, false));
+
+  // No further change: once the window has passed the normal interval applies again
+  unsigned long later = T0 + BITRIX24_CHANGE_WINDOW;
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, later, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(later + BITRIX24_DIALOGS_INTERVAL / 2, false));
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(later + BITRIX24_DIALOGS_INTERVAL, false));
+}
+
+void test_failures_back_off_and_recover() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  unsigned long now = T0 + BITRIX24_DIALOGS_INTERVAL;
+  b24SchedulerOnFetched(DIALOGS, DIALOGS, 0, now, 7500);  // 30 s
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(now + 29999, false) & DIALOGS);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(now + 30000, false) & DIALOGS);
+
+  now += 30000;
+  b24SchedulerOnFetched(DIALOGS, DIALOGS, 0, now, 15000);  // 60 s
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(now + 59999, false) & DIALOGS);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(now + 60000, false) & DIALOGS);
+
+  // Success resets the backoff: back to the normal cadence
+  now += 60000;
+  b24SchedulerOnFetched(DIALOGS, 0, 0, now, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(now + BITRIX24_DIALOGS_INTERVAL - 1, false) & DIALOGS);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(now + BITRIX24_DIALOGS_INTERVAL, false) & DIALOGS);
+}
+
+void test_failing_counter_waits_for_backoff_not_interval() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  // 30 s backoff, although the relaxed interval would be 9 min
+  b24SchedulerOnFetched(EXPIRED, EXPIRED, 0, T0, 7500);
+  TEST_ASSERT_EQUAL(EXPIRED, b24SchedulerDueMask(T0 + 30000, true) & EXPIRED);
+}
+
+void test_marked_counters_are_due_until_fetched() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  b24SchedulerMarkDue(GROUP);
+  TEST_ASSERT_EQUAL(GROUP, b24SchedulerDueMask(T0 + 1, false));
+  // A failed fetch still clears the mark; the backoff takes over
+  b24SchedulerOnFetched(GROUP, GROUP, 0, T0 + 1, 7500);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(T0 + 2, false));
+}
+
+void test_pushed_counters_are_only_swept() {
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, T0, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(T0 + BITRIX24_SWEEP_INTERVAL - 1, false, DIALOGS) & DIALOGS);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(T0 + BITRIX24_SWEEP_INTERVAL, false, DIALOGS) & DIALOGS);
+  // A push event marks the counter due at once
+  b24SchedulerMarkDue(DIALOGS);
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(T0 + 1, false, DIALOGS));
+}
+
+void test_millis_wraparound() {
+  unsigned long beforeWrap = (unsigned long)0 - 1000;
+  b24SchedulerOnFetched(B24_MASK_ALL, 0, 0, beforeWrap, 0);
+  TEST_ASSERT_EQUAL(0, b24SchedulerDueMask(beforeWrap + 500, false));
+  TEST_ASSERT_EQUAL(DIALOGS, b24SchedulerDueMask(beforeWrap + BITRIX24_DIALOGS_INTERVAL, false));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_poll_interval_policy);
+  RUN_TEST(test_backoff_doubles_up_to_the_cap);
+  RUN_TEST(test_backoff_jitter_stays_within_a_quarter);
+  RUN_TEST(test_everything_is_due_after_reset);
+  RUN_TEST(test_counters_come_due_on_their_own_cadence);
+  RUN_TEST(test_relaxed_polling_stretches_intervals);
+  RUN_TEST(test_recent_change_halves_the_interval_for_a_while);
+  RUN_TEST(test_failures_back_off_and_recover);
+  RUN_TEST(test_failing_counter_waits_for_backoff_not_interval);
+  RUN_TEST(test_marked_counters_are_due_until_fetched);
+  RUN_TEST(test_pushed_counters_are_only_swept);
+  RUN_TEST(test_millis_wraparound);
+  return UNITY_END();
+}
@@ -0,0 +1,339 @@
+// Task index: seed and delta syncs replayed against a stand-in for tasks.task.list
+
+#include <unity.h>
+#include "bitrix24_task_index.h"
+#include "memory_stream.h"
+
+static const uint32_t USER = 7;
+static const char TODAY[] = "2026-01-19";
+
+// What the portal holds: one record per task, as tasks.task.list returns them
+struct TaskRecord {
+  uint32_t id;
+  uint8_t status;
+  const char* deadline;
+  uint32_t group;
+  uint32_t responsible;
+  char changed[32];
+};
+
+static TaskRecord portal[1024];
+static uint16_t portalCount;
+static uint32_t clock;  // seconds since 10:00, for CHANGED_DATE
+
+static String requests[32];
+static uint8_t requestCount;
+
+// Portal time at `clock`
+static const char* portalTime() {
+  static char text[32];
+  snprintf(text, sizeof(text), "2026-01-19T%02u:%02u:%02u+03:00",
+           (unsigned)(10 + clock / 3600), (unsigned)(clock / 60 % 60), (unsigned)(clock % 60));
+  return text;
+}
+
+static void stamp(TaskRecord& task) {
+  strcpy(task.changed, portalTime());
+  clock++;
+}
+
+static TaskRecord& change(uint32_t id, uint8_t status, const char* deadline, uint32_t group,
+                          uint32_t responsible) {
+  TaskRecord* task = nullptr;
+  for (uint16_t i = 0; i < portalCount; i++) {
+    if (portal[i].id == id) task = &portal[i];
+  }
+  if (task == nullptr) task = &portal[portalCount++];
+  task->id = id;
+  task->status = status;
+  task->deadline = deadline;
+  task->group = group;
+  task->responsible = responsible;
+  stamp(*task);
+  return *task;
+}
+
+// Value of `key` in a query string, %XX decoded ("" if missing)
+static String queryValue(const String& query, const char* key) {
+  String needle = String(key) + "=";
+  int at = query.indexOf(needle);
+  if (at < 0) return "";
+  if (at > 0 && query[at - 1] != '&') return "";
+  String value;
+  for (unsigned i = at + needle.length(); i < query.length() && query[i] != '&'; i++) {
+    if (query[i] == '%' && i + 2 < query.length()) {
+      value += (char)strtol(query.substring(i + 1, i + 3).c_str(), nullptr, 16);
+      i += 2;
+    } else {
+      value += query[i];
+    }
+  }
+  return value;
+}
+
+static bool matchesFilter(const TaskRecord& task, const String& params) {
+  String since = queryValue(params, "filter[>=CHANGED_DATE]");
+  if (since.length() > 0) return strcmp(task.changed, since.c_str()) >= 0;
+  String responsible = queryValue(params, "filter[RESPONSIBLE_ID]");
+  return task.responsible == (uint32_t)responsible.toInt() && task.status != 5;
+}
+
+// tasks.task.list: filter, order[CHANGED_DATE]=asc, 50 per page from `start`
+static String listResponse(const String& params) {
+  const TaskRecord* match[1024];
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < portalCount; i++) {
+    if (matchesFilter(portal[i], params)) match[n++] = &portal[i];
+  }
+  for (uint16_t i = 1; i < n; i++) {
+    for (uint16_t j = i; j > 0 && strcmp(match[j - 1]->changed, match[j]->changed) > 0; j--) {
+      const TaskRecord* t = match[j];
+      match[j] = match[j - 1];
+      match[j - 1] = t;
+    }
+  }
+  int start = queryValue(params, "start").toInt();
+  String body = "{\"result\":{\"tasks\":[";
+  for (int i = start; i < n && i < start + 50; i++) {
+    const TaskRecord& t = *match[i];
+    char task[256];
+    snprintf(task, sizeof(task),
+             "%s{\"id\":\"%u\",\"status\":\"%u\",\"deadline\":%s%s%s,\"groupId\":\"%u\","
+             "\"responsibleId\":\"%u\",\"changedDate\":\"%s\"}",
+             i > start ? "," : "", (unsigned)t.id, t.status, t.deadline ? "\"" : "",
+             t.deadline ? t.deadline : "null", t.deadline ? "\"" : "", (unsigned)t.group,
+             (unsigned)t.responsible, t.changed);
+    body += task;
+  }
+  body += "]}";
+  if (start + 50 < n) {
+    body += ",\"next\":";
+    body += String(start + 50);
+  }
+  body += ",\"total\":";
+  body += String(n);
+  body += ",\"time\":{\"start\":1768827539.0,\"finish\":1768827539.2}}";
+  return body;
+}
+
+static const char* brokenBody = nullptr;
+
+static bool fakeFetch(const char* params, uint32_t userId, int* next) {
+  if (requestCount < 32) requests[requestCount++] = params;
+  String body = brokenBody != nullptr ? String(brokenBody) : listResponse(params);
+  MemoryStream stream(body.c_str(), 13);
+  return b24TaskIndexReadPage(stream, userId, next);
+}
+
+static uint8_t countRequests(const char* key) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < requestCount; i++) {
+    if (queryValue(requests[i], key).length() > 0) n++;
+  }
+  return n;
+}
+
+static bool sync(unsigned long now = 1000) {
+  requestCount = 0;
+  return b24TaskIndexSync(fakeFetch, USER, portalTime(), now);
+}
+
+void setUp() {
+  b24TaskIndexClear();
+  portalCount = 0;
+  clock = 0;
+  brokenBody = nullptr;
+  requestCount = 0;
+}
+
+void tearDown() {}
+
+// Five open tasks of the user plus noise the seed must not pick up
+static void seedPortal() {
+  change(41, 3, "2026-01-18T19:00:00+03:00", 12, USER);  // expired, group 12
+  change(42, 2, "2026-01-25T19:00:00+03:00", 12, USER);
+  change(43, 4, nullptr, 0, USER);
+  change(44, 6, "2026-01-10T19:00:00+03:00", 0, USER);   // expired, postponed
+  change(45, 1, "2026-01-19T12:00:00+03:00", 30, USER);  // due today: not expired yet
+  change(50, 3, "2026-01-01T19:00:00+03:00", 12, 9);     // someone else's
+  change(51, 5, "2026-01-01T19:00:00+03:00", 12, USER);  // completed
+}
+
+void test_date_key() {
+  TEST_ASSERT_EQUAL(20260119, b24DateKey("2026-01-19T15:58:59+03:00"));
+  TEST_ASSERT_EQUAL(20260119, b24DateKey(TODAY));
+  TEST_ASSERT_EQUAL(0, b24DateKey("2026/01/19"));
+  TEST_ASSERT_EQUAL(0, b24DateKey("19.01.2026"));
+  TEST_ASSERT_EQUAL(0, b24DateKey(""));
+}
+
+void test_seed_counts_open_tasks() {
+  seedPortal();
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(1, requestCount);
+  TEST_ASSERT_EQUAL_STRING("7", queryValue(requests[0], "filter[RESPONSIBLE_ID]").c_str());
+  TEST_ASSERT_EQUAL_STRING("5", queryValue(requests[0], "filter[!STATUS]").c_str());
+  TEST_ASSERT_EQUAL_STRING("asc", queryValue(requests[0], "order[CHANGED_DATE]").c_str());
+
+  TEST_ASSERT_EQUAL(2, b24TaskIndexCountExpired(0, 20260119));
+  TEST_ASSERT_EQUAL(1, b24TaskIndexCountExpired(12, 20260119));
+  TEST_ASSERT_EQUAL(0, b24TaskIndexCountExpired(30, 20260119));
+  TEST_ASSERT_EQUAL(1, b24TaskIndexCountExpired(30, 20260120));
+  TEST_ASSERT_EQUAL(5, b24TaskIndexCountActive(0));
+  TEST_ASSERT_EQUAL(2, b24TaskIndexCountActive(12));
+}
+
+void test_delta_starts_where_the_seed_started() {
+  seedPortal();
+  String seededAt = portalTime();
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(1, requestCount);
+  TEST_ASSERT_EQUAL(0, countRequests("filter[RESPONSIBLE_ID]"));
+  TEST_ASSERT_EQUAL_STRING(seededAt.c_str(), queryValue(requests[0], "filter[>=CHANGED_DATE]").c_str());
+  // The '+' of the offset is sent encoded, or the portal would read a space
+  TEST_ASSERT_TRUE(requests[0].indexOf("%2B03%3A00") > 0);
+  TEST_ASSERT_EQUAL(5, b24TaskIndexCountActive(0));
+  TEST_ASSERT_EQUAL(2, b24TaskIndexCountExpired(0, 20260119));
+}
+
+void test_delta_keeps_same_second_edits() {
+  seedPortal();
+  TEST_ASSERT_TRUE(sync());
+  // An edit within the second the seed started
+  change(46, 2, "2026-01-02T19:00:00+03:00", 0, USER);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(6, b24TaskIndexCountActive(0));
+  TEST_ASSERT_EQUAL(3, b24TaskIndexCountExpired(0, 20260119));
+  // ... and within the second of the newest change the delta saw (task 46)
+  clock--;
+  change(47, 2, nullptr, 0, USER);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(7, b24TaskIndexCountActive(0));
+}
+
+void test_seed_skips_the_portals_older_changes() {
+  seedPortal();
+  // The user's tasks are old; since then the rest of the portal changed a lot
+  for (uint32_t i = 0; i < 700; i++) change(1000 + i, 2, nullptr, 0, 9);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_TRUE(sync());
+  // One delta page with nothing in it, not twelve pages of other people's edits
+  TEST_ASSERT_EQUAL(1, requestCount);
+  TEST_ASSERT_EQUAL(5, b24TaskIndexCountActive(0));
+}
+
+void test_delta_drops_reassigned_and_completed_tasks() {
+  seedPortal();
+  TEST_ASSERT_TRUE(sync());
+  change(41, 3, "2026-01-18T19:00:00+03:00", 12, 9);  // handed over to user 9
+  change(44, 5, "2026-01-10T19:00:00+03:00", 0, USER);
+  change(52, 2, nullptr, 12, USER);                   // newly assigned
+  change(53, 2, nullptr, 12, 9);                      // never ours
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(0, b24TaskIndexCountExpired(0, 20260119));
+  TEST_ASSERT_EQUAL(4, b24TaskIndexCountActive(0));
+  TEST_ASSERT_EQUAL(2, b24TaskIndexCountActive(12));
+
+  // Handed back: it returns
+  change(41, 3, "2026-01-18T19:00:00+03:00", 12, USER);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(1, b24TaskIndexCountExpired(12, 20260119));
+  TEST_ASSERT_EQUAL(3, b24TaskIndexCountActive(12));
+}
+
+void test_seed_pages_through_the_list() {
+  for (uint32_t id = 100; id < 220; id++) change(id, 2, nullptr, 0, USER);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(3, requestCount);
+  TEST_ASSERT_EQUAL_STRING("", queryValue(requests[0], "start").c_str());
+  TEST_ASSERT_EQUAL_STRING("50", queryValue(requests[1], "start").c_str());
+  TEST_ASSERT_EQUAL_STRING("100", queryValue(requests[2], "start").c_str());
+  TEST_ASSERT_EQUAL(120, b24TaskIndexCountActive(0));
+}
+
+void test_page_cap_catches_up_on_the_next_sync() {
+  seedPortal();
+  TEST_ASSERT_TRUE(sync());
+  // A bulk edit: 700 changes, every tenth one an open task of the user
+  for (uint32_t i = 0; i < 700; i++) {
+    change(1000 + i, i % 10 == 0 ? 2 : 5, nullptr, 0, i % 20 == 0 ? USER : 9);
+  }
+  TEST_ASSERT_FALSE(sync());
+  TEST_ASSERT_EQUAL(12, requestCount);
+  // Twelve pages applied and the watermark moved with them
+  TEST_ASSERT_EQUAL(5 + 30, b24TaskIndexCountActive(0));
+
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(3, requestCount);
+  TEST_ASSERT_EQUAL_STRING(portal[7 + 599].changed,
+                           queryValue(requests[0], "filter[>=CHANGED_DATE]").c_str());
+  TEST_ASSERT_EQUAL(5 + 35, b24TaskIndexCountActive(0));
+
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(1, requestCount);
+}
+
+void test_empty_seed_watches_from_the_seed() {
+  clock = 3600;
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(0, b24TaskIndexCountActive(0));
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL_STRING("2026-01-19T11:00:00+03:00",
+                           queryValue(requests[0], "filter[>=CHANGED_DATE]").c_str());
+}
+
+void test_reseed_after_interval_or_user_change() {
+  seedPortal();
+  TEST_ASSERT_TRUE(sync(1000));
+  TEST_ASSERT_TRUE(sync(1000 + BITRIX24_TASK_INDEX_RESEED - 1));
+  TEST_ASSERT_EQUAL(1, countRequests("filter[>=CHANGED_DATE]"));
+  TEST_ASSERT_TRUE(sync(1000 + BITRIX24_TASK_INDEX_RESEED));
+  TEST_ASSERT_EQUAL(1, countRequests("filter[RESPONSIBLE_ID]"));
+
+  requestCount = 0;
+  TEST_ASSERT_TRUE(b24TaskIndexSync(fakeFetch, 9, portalTime(), 1000));
+  TEST_ASSERT_EQUAL_STRING("9", queryValue(requests[0], "filter[RESPONSIBLE_ID]").c_str());
+  TEST_ASSERT_EQUAL(1, b24TaskIndexCountActive(0));
+  TEST_ASSERT_FALSE(b24TaskIndexSync(fakeFetch, 0, portalTime(), 1000));
+}
+
+void test_broken_page_fails_the_sync() {
+  seedPortal();
+  brokenBody = "{\"result\":{\"tasks\":[{\"id\":\"41\",\"status\":";
+  TEST_ASSERT_FALSE(sync());
+  // Not seeded: the next sync seeds again
+  brokenBody = nullptr;
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(1, countRequests("filter[RESPONSIBLE_ID]"));
+
+  brokenBody = "{\"error\":\"QUERY_LIMIT_EXCEEDED\"";
+  TEST_ASSERT_FALSE(sync());
+  TEST_ASSERT_EQUAL(5, b24TaskIndexCountActive(0));
+}
+
+void test_full_index_fails_and_reseeds() {
+  for (uint32_t id = 1; id <= BITRIX24_TASK_INDEX_MAX + 1; id++) change(id, 2, nullptr, 0, USER);
+  TEST_ASSERT_FALSE(sync());
+  change(1, 5, nullptr, 0, USER);
+  TEST_ASSERT_TRUE(sync());
+  TEST_ASSERT_EQUAL(6, countRequests("filter[RESPONSIBLE_ID]"));  // a full reseed
+  TEST_ASSERT_EQUAL(BITRIX24_TASK_INDEX_MAX, b24TaskIndexCountActive(0));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_date_key);
+  RUN_TEST(test_seed_counts_open_tasks);
+  RUN_TEST(test_delta_starts_where_the_seed_started);
+  RUN_TEST(test_delta_keeps_same_second_edits);
+  RUN_TEST(test_seed_skips_the_portals_older_changes);
+  RUN_TEST(test_delta_drops_reassigned_and_completed_tasks);
+  RUN_TEST(test_seed_pages_through_the_list);
+  RUN_TEST(test_page_cap_catches_up_on_the_next_sync);
+  RUN_TEST(test_empty_seed_watches_from_the_seed);
+  RUN_TEST(test_reseed_after_interval_or_user_change);
+  RUN_TEST(test_broken_page_fails_the_sync);
+  RUN_TEST(test_full_index_fails_and_reseeds);
+  return UNITY_END();
+}
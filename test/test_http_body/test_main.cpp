@@ -0,0 +1,324 @@
+// Response bodies: gzip round trips, framing, and sharing the one inflater
+
+#include <unity.h>
+#include "http_body.h"
+#include "json_stream.h"
+#include "memory_stream.h"
+#include <HTTPClient.h>
+#include <zlib.h>
+#include <string>
+
+// tasks.task.list page as a portal sends it
+static const char PLAIN[] =
+  "{\"result\":{\"tasks\":[{\"id\":\"41\",\"title\":\"\\u041e\\u0442\\u0447\\u0451\\u0442 \\u"
+  "0437\\u0430 \\u043a\\u0432\\u0430\\u0440\\u0442\\u0430\\u043b\",\"status\":\"3\",\"deadl"
+  "ine\":\"2026-01-18T19:00:00+03:00\",\"groupId\":\"12\",\"responsibleId\":\"7\",\"changed"
+  "Date\":\"2026-01-19T10:00:00+03:00\"},{\"id\":\"42\",\"title\":\"Call the supplier\",\"s"
+  "tatus\":\"2\",\"deadline\":\"2026-01-25T19:00:00+03:00\",\"groupId\":\"12\",\"responsibl"
+  "eId\":\"7\",\"changedDate\":\"2026-01-19T10:00:01+03:00\"},{\"id\":\"43\",\"title\":\"Re"
+  "view the contract\",\"status\":\"4\",\"deadline\":null,\"groupId\":\"0\",\"responsibleId"
+  "\":\"7\",\"changedDate\":\"2026-01-19T10:00:02+03:00\"}]},\"total\":3,\"time\":{\"start\""
+  ":1768827539.0123,\"finish\":1768827539.0581,\"duration\":0.0458,\"processing\":0.0312,\""
+  "date_start\":\"2026-01-19T15:58:59+03:00\",\"date_finish\":\"2026-01-19T15:58:59+03:00\""
+  ",\"operating\":0}}";
+
+// The same body as recorded with Content-Encoding: gzip
+static const uint8_t GZIPPED[] = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xb5, 0x92, 0xcb, 0x4e, 0xc3, 0x30,
+  0x10, 0x45, 0x7f, 0xa5, 0xf2, 0x96, 0xb6, 0xf2, 0x23, 0x6e, 0x12, 0x6f, 0x61, 0xc3, 0x16, 0x75,
+  0x07, 0x08, 0x99, 0xc4, 0xb4, 0x16, 0xc6, 0x8e, 0xfc, 0x80, 0x45, 0x95, 0x7f, 0x67, 0xec, 0x50,
+  0x48, 0x04, 0x62, 0x81, 0x84, 0x64, 0x8d, 0x35, 0xd7, 0x93, 0xb9, 0x67, 0xa2, 0x39, 0x21, 0xaf,
+  0x42, 0x32, 0x11, 0x89, 0x13, 0x8a, 0x32, 0x3c, 0x07, 0x24, 0x6e, 0x4f, 0x48, 0xf7, 0x48, 0xa0,
+  0x8a, 0xa0, 0x35, 0x8a, 0x3a, 0x1a, 0x05, 0xc9, 0x5d, 0xc2, 0x15, 0x51, 0x39, 0x56, 0xb4, 0xc4,
+  0x3a, 0x47, 0x4e, 0x26, 0x65, 0x95, 0x2f, 0x56, 0x24, 0x86, 0xa7, 0x44, 0x96, 0x48, 0x27, 0xa9,
+  0x54, 0xe1, 0xaf, 0xaf, 0x27, 0x85, 0x3d, 0x82, 0x41, 0x88, 0x32, 0x26, 0x70, 0x45, 0x0c, 0x92,
+  0x5e, 0xc9, 0xde, 0x68, 0x9b, 0x0d, 0x29, 0xa6, 0xbb, 0x0d, 0x26, 0x1b, 0xd2, 0xec, 0x49, 0x2b,
+  0x30, 0x86, 0x73, 0x81, 0x19, 0x44, 0x28, 0x3b, 0x78, 0x97, 0x86, 0xeb, 0xcc, 0x48, 0x28, 0xa4,
+  0x30, 0xc1, 0xe0, 0x6c, 0xd0, 0x8f, 0x46, 0x15, 0xb1, 0x06, 0xad, 0x3b, 0x4a, 0x7b, 0x50, 0xfd,
+  0x95, 0x8c, 0x8b, 0x66, 0xed, 0x9e, 0xe0, 0x45, 0xb3, 0x71, 0x7d, 0x9e, 0x96, 0xce, 0xa6, 0xbd,
+  0x94, 0xc6, 0xac, 0xe2, 0x51, 0xad, 0x42, 0x1a, 0x06, 0xa3, 0x95, 0x9f, 0x83, 0xd2, 0x9f, 0x41,
+  0x29, 0xff, 0x17, 0x50, 0xf2, 0x0d, 0x94, 0xcd, 0x40, 0x6f, 0xd4, 0xab, 0x56, 0x6f, 0x05, 0xb5,
+  0x73, 0x36, 0x7a, 0xd9, 0xc5, 0x39, 0x6a, 0xb5, 0x40, 0xb5, 0xc9, 0x98, 0x39, 0x13, 0xfe, 0x23,
+  0x12, 0x3d, 0x23, 0xdd, 0x8f, 0x40, 0xe2, 0xa2, 0x34, 0x48, 0xb0, 0xcc, 0xf4, 0xa2, 0xf2, 0x1a,
+  0x81, 0xbb, 0x87, 0x7d, 0x22, 0xf5, 0xae, 0x69, 0x68, 0xcd, 0x59, 0xbb, 0xc5, 0x84, 0xc2, 0xfb,
+  0x93, 0xb6, 0x3a, 0x1c, 0x97, 0x0f, 0xbc, 0x21, 0x40, 0x98, 0xbc, 0x8c, 0xda, 0x59, 0x24, 0xf0,
+  0x16, 0x76, 0xaa, 0x59, 0xa3, 0xc1, 0xbb, 0x4e, 0x85, 0xa0, 0xed, 0xa1, 0x68, 0x8c, 0x50, 0xa8,
+  0x02, 0x9c, 0x87, 0x8f, 0xde, 0x0b, 0x28, 0x2e, 0x78, 0x23, 0x78, 0xfb, 0xf9, 0xd3, 0x4b, 0xe1,
+  0xd9, 0xec, 0xd7, 0x4a, 0x37, 0xa8, 0xec, 0x5c, 0x5c, 0xc6, 0xf1, 0x1d, 0xf3, 0xd2, 0xe8, 0x78,
+  0x0b, 0x03, 0x00, 0x00,
+};
+
+static HTTPClient http;
+static HTTPClient other;
+
+void setUp() {}
+
+void tearDown() {
+  httpReleaseGzip(http);
+  httpReleaseGzip(other);
+}
+
+// Everything the stream hands out, in reads of `chunk` bytes
+static std::string readAll(HttpBodyStream& body, size_t chunk) {
+  std::string out;
+  char buffer[1024];
+  size_t got;
+  while ((got = body.readBytes(buffer, chunk)) > 0) out.append(buffer, got);
+  return out;
+}
+
+// Transfer-Encoding: chunked framing of `data`, `size` bytes per chunk
+static std::string chunked(const std::string& data, size_t size) {
+  std::string out;
+  char line[16];
+  for (size_t at = 0; at < data.size(); at += size) {
+    size_t n = std::min(size, data.size() - at);
+    snprintf(line, sizeof(line), "%zx\r\n", n);
+    out += line;
+    out.append(data, at, n);
+    out += "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+// gzip member around raw deflate data, with optional header fields (RFC 1952)
+static std::string gzipMember(const std::string& text, uint8_t flags) {
+  z_stream z = z_stream();
+  deflateInit2(&z, 9, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
+  std::string deflated(deflateBound(&z, text.size()), '\0');
+  z.next_in = (Bytef*)text.data();
+  z.avail_in = text.size();
+  z.next_out = (Bytef*)&deflated[0];
+  z.avail_out = deflated.size();
+  deflate(&z, Z_FINISH);
+  deflated.resize(z.total_out);
+  deflateEnd(&z);
+
+  std::string out("\x1f\x8b\x08", 3);
+  out += (char)flags;
+  out.append("\0\0\0\0\0\x03", 6);
+  if (flags & 0x04) out.append("\x03\0abc", 5);
+  if (flags & 0x08) out.append("body.json", 10);
+  if (flags & 0x10) out.append("comment", 8);
+  if (flags & 0x02) out.append("\x12\x34", 2);
+  out += deflated;
+  uint32_t crc = crc32(0, (const Bytef*)text.data(), text.size());
+  uint32_t len = text.size();
+  out.append((const char*)&crc, 4);
+  out.append((const char*)&len, 4);
+  return out;
+}
+
+// A long list body (well over the 32 KB window)
+static std::string bigBody() {
+  std::string text = "{\"result\":[";
+  for (int i = 0; i < 3000; i++) {
+    text += i > 0 ? "," : "";
+    text += "{\"id\":\"" + std::to_string(i) + "\",\"title\":\"Task " + std::to_string(i % 17) +
+            " with a reasonably long title\"}";
+  }
+  return text + "],\"total\":3000}";
+}
+
+void test_gzip_is_asked_for_by_one_request_at_a_time() {
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  TEST_ASSERT_EQUAL_STRING("gzip", http.requestHeader("Accept-Encoding").c_str());
+  // Asking again for the same request (a retry) keeps it
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+
+  // Meanwhile another request goes uncompressed
+  TEST_ASSERT_FALSE(httpAcceptGzip(other));
+  TEST_ASSERT_EQUAL_STRING("", other.requestHeader("Accept-Encoding").c_str());
+
+  httpReleaseGzip(other);  // Not the holder: no effect
+  TEST_ASSERT_FALSE(httpAcceptGzip(other));
+  httpReleaseGzip(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(other));
+}
+
+void test_recorded_gzip_body_inflates() {
+  MemoryStream wire(GZIPPED, sizeof(GZIPPED), 64);
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(wire, sizeof(GZIPPED), "gzip");
+  HttpBodyStream body(http);
+  TEST_ASSERT_TRUE(body.compressed());
+  TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 100).c_str());
+  TEST_ASSERT_FALSE(body.failed());
+  TEST_ASSERT_TRUE(body.complete());
+  TEST_ASSERT_EQUAL(sizeof(GZIPPED), body.wireBytes());
+  TEST_ASSERT_EQUAL(strlen(PLAIN), body.bodyBytes());
+}
+
+void test_recorded_gzip_body_parses_in_chunked_framing() {
+  std::string framed = chunked(std::string((const char*)GZIPPED, sizeof(GZIPPED)), 37);
+  MemoryStream wire(framed.data(), framed.size(), 5);
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(wire, -1, "gzip", "chunked");
+  HttpBodyStream body(http);
+  JsonStreamReader json(body);
+  JsonToken token;
+  uint8_t ids = 0;
+  long total = 0;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_STRING && json.matches("result.tasks.#.id")) ids++;
+    if (token == JSON_NUMBER && json.matches("total")) total = json.asInt();
+  }
+  TEST_ASSERT_EQUAL(JSON_END, token);
+  TEST_ASSERT_EQUAL(3, ids);
+  TEST_ASSERT_EQUAL(3, total);
+  // The parser stops at the root's end; the rest of the frame is drained for keep-alive
+  TEST_ASSERT_TRUE(body.drain(4096));
+}
+
+void test_long_body_wraps_the_window() {
+  std::string text = bigBody();
+  std::string gz = gzipMember(text, 0);
+  MemoryStream wire(gz.data(), gz.size(), 700);
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(wire, gz.size(), "gzip");
+  HttpBodyStream body(http);
+  TEST_ASSERT_TRUE(readAll(body, 999) == text);
+  TEST_ASSERT_TRUE(body.complete());
+}
+
+void test_optional_gzip_header_fields_are_skipped() {
+  const uint8_t flagSets[] = {0x08, 0x04 | 0x10, 0x02 | 0x04 | 0x08 | 0x10};
+  for (uint8_t flags : flagSets) {
+    std::string gz = gzipMember(PLAIN, flags);
+    MemoryStream wire(gz.data(), gz.size(), 3);
+    httpCollectHeaders(http);
+    TEST_ASSERT_TRUE(httpAcceptGzip(http));
+    http.respond(wire, gz.size(), "gzip");
+    HttpBodyStream body(http);
+    TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 64).c_str());
+    httpReleaseGzip(http);
+  }
+}
+
+void test_truncated_or_mislabelled_gzip_fails() {
+  MemoryStream cut(GZIPPED, sizeof(GZIPPED) / 2);
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(cut, sizeof(GZIPPED), "gzip");
+  {
+    HttpBodyStream body(http);
+    readAll(body, 100);
+    TEST_ASSERT_TRUE(body.failed());
+    TEST_ASSERT_FALSE(body.complete());
+  }
+
+  MemoryStream notGzip("{\"ok\":true}");
+  httpCollectHeaders(http);
+  http.respond(notGzip, 11, "gzip");
+  HttpBodyStream body(http);
+  TEST_ASSERT_EQUAL(0, readAll(body, 100).size());
+  TEST_ASSERT_TRUE(body.failed());
+}
+
+void test_uncompressed_answer_to_a_gzip_request() {
+  MemoryStream wire(PLAIN, 9);
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(wire, strlen(PLAIN));
+  HttpBodyStream body(http);
+  TEST_ASSERT_FALSE(body.compressed());
+  TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 50).c_str());
+  TEST_ASSERT_TRUE(body.complete());
+}
+
+void test_framing_follows_transfer_encoding() {
+  std::string framed = chunked(PLAIN, 100);
+  MemoryStream wire(framed.data(), framed.size(), 7);
+  httpCollectHeaders(http);
+  http.respond(wire, -1, "", "chunked");
+  {
+    HttpBodyStream body(http);
+    TEST_ASSERT_EQUAL('{', body.peek());
+    TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 33).c_str());
+    TEST_ASSERT_TRUE(body.complete());
+    TEST_ASSERT_EQUAL(strlen(PLAIN), body.wireBytes());  // Payload, without the chunk lines
+  }
+
+  // Delimited by the connection closing: fine to read, not to reuse
+  MemoryStream closing(PLAIN, 7);
+  httpCollectHeaders(http);
+  http.respond(closing);
+  {
+    HttpBodyStream body(http);
+    TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 33).c_str());
+    TEST_ASSERT_FALSE(body.failed());
+    TEST_ASSERT_FALSE(body.complete());
+  }
+
+  // Neither length nor chunked, and opening with a hex digit: still read verbatim
+  static const char PAGE[] = "Bad Gateway\r\n";
+  MemoryStream page(PAGE, 4);
+  httpCollectHeaders(http);
+  http.respond(page);
+  {
+    HttpBodyStream body(http);
+    TEST_ASSERT_EQUAL('B', body.peek());
+    TEST_ASSERT_EQUAL_STRING(PAGE, readAll(body, 33).c_str());
+    TEST_ASSERT_FALSE(body.failed());
+  }
+
+  MemoryStream empty("");
+  httpCollectHeaders(http);
+  http.respond(empty);
+  HttpBodyStream body(http);
+  TEST_ASSERT_EQUAL(-1, body.peek());
+  TEST_ASSERT_EQUAL(0, body.available());
+}
+
+void test_headers_of_an_earlier_response_are_cleared() {
+  // The client collected "gzip" / "chunked" on its last request ...
+  MemoryStream first(GZIPPED, sizeof(GZIPPED));
+  httpCollectHeaders(http);
+  TEST_ASSERT_TRUE(httpAcceptGzip(http));
+  http.respond(first, -1, "gzip", "chunked");
+  httpReleaseGzip(http);
+
+  // ... and this one went out uncompressed while another request held the inflater
+  TEST_ASSERT_TRUE(httpAcceptGzip(other));
+  httpCollectHeaders(http);
+  TEST_ASSERT_FALSE(httpAcceptGzip(http));
+  MemoryStream wire(PLAIN);
+  http.respond(wire, strlen(PLAIN));
+  TEST_ASSERT_EQUAL_STRING("", http.header("Content-Encoding").c_str());
+  TEST_ASSERT_EQUAL_STRING("", http.header("Transfer-Encoding").c_str());
+  HttpBodyStream body(http);
+  TEST_ASSERT_FALSE(body.compressed());
+  TEST_ASSERT_EQUAL_STRING(PLAIN, readAll(body, 100).c_str());
+  TEST_ASSERT_TRUE(body.complete());
+}
+
+void test_partial_read_drains_for_reuse() {
+  std::string framed = chunked(PLAIN, 64);
+  MemoryStream wire(framed.data(), framed.size());
+  httpCollectHeaders(http);
+  http.respond(wire, -1, "", "chunked");
+  HttpBodyStream body(http);
+  char head[20];
+  TEST_ASSERT_EQUAL(sizeof(head), body.readBytes(head, sizeof(head)));
+  TEST_ASSERT_FALSE(body.drain(100));
+  TEST_ASSERT_TRUE(body.drain(4096));
+  TEST_ASSERT_EQUAL(strlen(PLAIN), body.wireBytes());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gzip_is_asked_for_by_one_request_at_a_time);
+  RUN_TEST(test_recorded_gzip_body_inflates);
+  RUN_TEST(test_recorded_gzip_body_parses_in_chunked_framing);
+  RUN_TEST(test_long_body_wraps_the_window);
+  RUN_TEST(test_optional_gzip_header_fields_are_skipped);
+  RUN_TEST(test_truncated_or_mislabelled_gzip_fails);
+  RUN_TEST(test_uncompressed_answer_to_a_gzip_request);
+  RUN_TEST(test_framing_follows_transfer_encoding);
+  RUN_TEST(test_headers_of_an_earlier_response_are_cleared);
+  RUN_TEST(test_partial_read_drains_for_reuse);
+  return UNITY_END();
+}
@@ -0,0 +1,314 @@
+// Benchmark: full-page bizproc.task.list and tasks.task.list bodies (90-150 KB, records as
+// the portal returns them, ids varied per row) read the old way (whole body in one String;
+// the JSON document parsed from it came on top and isn't counted) and streamed through
+// JsonStreamReader. Prints time and peak heap per body.
+
+#include <unity.h>
+#include <malloc.h>
+#include <chrono>
+#include <string>
+#include "json_stream.h"
+#include "memory_stream.h"
+
+// Live heap bytes of this process while `counting` (glibc's allocator underneath)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* block, size_t size);
+extern "C" void __libc_free(void* block);
+static bool counting = false;
+static size_t heapLive = 0;
+static size_t heapPeak = 0;
+
+static void heapAdd(void* block) {
+  if (!counting || block == nullptr) return;
+  heapLive += malloc_usable_size(block);
+  if (heapLive > heapPeak) heapPeak = heapLive;
+}
+static void heapRemove(void* block) {
+  if (!counting || block == nullptr) return;
+  size_t size = malloc_usable_size(block);
+  heapLive = size < heapLive ? heapLive - size : 0;
+}
+
+extern "C" void* malloc(size_t size) {
+  void* block = __libc_malloc(size);
+  heapAdd(block);
+  return block;
+}
+extern "C" void* calloc(size_t count, size_t size) {
+  void* block = __libc_calloc(count, size);
+  heapAdd(block);
+  return block;
+}
+extern "C" void* realloc(void* block, size_t size) {
+  heapRemove(block);
+  void* moved = __libc_realloc(block, size);
+  heapAdd(moved);
+  return moved;
+}
+extern "C" void free(void* block) {
+  heapRemove(block);
+  __libc_free(block);
+}
+
+static void heapStart() {
+  heapLive = 0;
+  heapPeak = 0;
+  counting = true;
+}
+static size_t heapStop() {
+  counting = false;
+  return heapPeak;
+}
+
+// --- Bodies ---
+
+static const uint32_t USER_ID = 356;
+static const int PAGE = 50;
+
+// bizproc.task.list, all fields (RPA approval tasks with their parameters)
+static std::string bizprocBody() {
+  std::string body = "{\"result\":[";
+  char row[2048];
+  for (int i = 0; i < PAGE; i++) {
+    snprintf(row, sizeof(row),
+      "%s{\"ID\":\"%d\",\"WORKFLOW_ID\":\"65a9%04dc3e1b7.%08d\","
+      "\"DOCUMENT_NAME\":\"\\u0417\\u0430\\u044f\\u0432\\u043a\\u0430 \\u2116%d\","
+      "\"DESCRIPTION\":\"\\u041f\\u0440\\u043e\\u0432\\u0435\\u0440\\u044c\\u0442\\u0435 "
+      "\\u0441\\u0447\\u0451\\u0442 \\u0438 \\u043f\\u043e\\u0434\\u0442\\u0432\\u0435\\u0440"
+      "\\u0434\\u0438\\u0442\\u0435 \\u043e\\u043f\\u043b\\u0430\\u0442\\u0443 "
+      "\\u043f\\u043e \\u0434\\u043e\\u0433\\u043e\\u0432\\u043e\\u0440\\u0443 "
+      "\\u2116 %d \\u043e\\u0442 19.01.2026\","
+      "\"NAME\":\"\\u0423\\u0442\\u0432\\u0435\\u0440\\u0434\\u0438\\u0442\\u044c "
+      "\\u0441\\u0447\\u0451\\u0442\",\"MODIFIED\":\"2026-01-%02dT10:%02d:00+03:00\","
+      "\"WORKFLOW_STARTED\":\"2026-01-%02dT09:%02d:00+03:00\",\"WORKFLOW_STARTED_BY\":\"1\","
+      "\"OVERDUE_DATE\":null,\"WORKFLOW_TEMPLATE_ID\":\"12\","
+      "\"WORKFLOW_TEMPLATE_NAME\":\"\\u0421\\u043e\\u0433\\u043b\\u0430\\u0441\\u043e"
+      "\\u0432\\u0430\\u043d\\u0438\\u0435 \\u0441\\u0447\\u0435\\u0442\\u043e\\u0432\","
+      "\"WORKFLOW_STATE\":\"\\u041d\\u0430 \\u0441\\u043e\\u0433\\u043b\\u0430\\u0441"
+      "\\u043e\\u0432\\u0430\\u043d\\u0438\\u0438\",\"STATUS\":\"%d\",\"USER_ID\":\"%u\","
+      "\"USER_STATUS\":\"0\",\"MODULE_ID\":\"rpa\","
+      "\"ENTITY\":\"Bitrix\\\\Rpa\\\\Integration\\\\Bizproc\\\\Document\\\\Item\","
+      "\"DOCUMENT_ID\":\"RPA_1:%d\",\"ACTIVITY\":\"RpaApproveActivity\","
+      "\"ACTIVITY_NAME\":\"A%05d_%05d_%05d_%05d\",\"PARAMETERS\":{\"AccessControl\":\"N\","
+      "\"ShowComment\":\"Y\",\"CommentRequired\":\"N\",\"CommentLabel\":\"\\u041a\\u043e"
+      "\\u043c\\u043c\\u0435\\u043d\\u0442\\u0430\\u0440\\u0438\\u0439\","
+      "\"TaskButton1Message\":\"\\u0423\\u0442\\u0432\\u0435\\u0440\\u0434\\u0438\\u0442"
+      "\\u044c\",\"TaskButton2Message\":\"\\u041e\\u0442\\u043a\\u043b\\u043e\\u043d\\u0438"
+      "\\u0442\\u044c\",\"StatusTimeout\":null,\"ApproveType\":\"any\","
+      "\"Users\":[\"user_%u\",\"user_1\",\"user_%d\"],\"FieldsToShow\":[\"UF_RPA_1_NAME\","
+      "\"UF_RPA_1_SUM\",\"UF_RPA_1_CONTRACT\",\"UF_RPA_1_FILE\"]},"
+      "\"DOCUMENT_URL\":\"/rpa/item/1/%d/\",\"USERS\":[{\"USER_ID\":\"%u\",\"STATUS\":\"0\","
+      "\"DATE_UPDATE\":null},{\"USER_ID\":\"1\",\"STATUS\":\"1\","
+      "\"DATE_UPDATE\":\"2026-01-%02dT11:00:00+03:00\"}]}",
+      i == 0 ? "" : ",", 8800 + i, i, 40000000 + i * 7, 1200 + i, 3300 + i,
+      1 + i % 19, i % 60, 1 + i % 19, i % 60, i % 3 == 0 ? 1 : 0,
+      i % 4 == 0 ? 1u : USER_ID, 1200 + i, 60000 + i, 71000 + i, 82000 + i, 93000 + i,
+      USER_ID, 14 + i % 9, 1200 + i, USER_ID, 1 + i % 19);
+    body += row;
+  }
+  body += "],\"total\":50,\"time\":{\"start\":1768809600.1,\"finish\":1768809600.4,"
+          "\"duration\":0.31,\"processing\":0.29}}";
+  return body;
+}
+
+// tasks.task.list, default select (tasks of one group with creator/responsible/group data)
+static std::string tasksBody() {
+  std::string body = "{\"result\":{\"tasks\":[";
+  char row[4096];
+  for (int i = 0; i < PAGE; i++) {
+    snprintf(row, sizeof(row),
+      "%s{\"id\":\"%d\",\"parentId\":null,\"title\":\"\\u041f\\u043e\\u0434\\u0433\\u043e"
+      "\\u0442\\u043e\\u0432\\u0438\\u0442\\u044c \\u043e\\u0442\\u0447\\u0451\\u0442 "
+      "\\u2116%d \\u0437\\u0430 \\u044f\\u043d\\u0432\\u0430\\u0440\\u044c\","
+      "\"description\":\"[B]\\u0421\\u0440\\u043e\\u043a:[/B] \\u0434\\u043e "
+      "\\u043f\\u044f\\u0442\\u043d\\u0438\\u0446\\u044b. [URL=https://portal.bitrix24.ru/"
+      "docs/file/%d/]\\u0428\\u0430\\u0431\\u043b\\u043e\\u043d[/URL]\\r\\n"
+      "\\u0421\\u0432\\u0435\\u0440\\u0438\\u0442\\u044c \\u0441 \\u0431\\u0443\\u0445"
+      "\\u0433\\u0430\\u043b\\u0442\\u0435\\u0440\\u0438\\u0435\\u0439.\","
+      "\"mark\":null,\"priority\":\"%d\",\"multitask\":\"N\",\"notViewed\":\"N\","
+      "\"replicate\":\"N\",\"groupId\":\"253\",\"stageId\":\"0\",\"createdBy\":\"1\","
+      "\"createdDate\":\"2026-01-%02dT09:15:00+03:00\",\"responsibleId\":\"%u\","
+      "\"changedBy\":\"%u\",\"changedDate\":\"2026-01-%02dT16:%02d:41+03:00\","
+      "\"statusChangedBy\":\"%u\",\"closedBy\":null,\"closedDate\":null,"
+      "\"activityDate\":\"2026-01-%02dT16:%02d:41+03:00\",\"dateStart\":null,"
+      "\"deadline\":\"2026-01-%02dT19:00:00+03:00\",\"startDatePlan\":null,"
+      "\"endDatePlan\":null,\"guid\":\"{6f1c%04x-2b7e-4d0a-9c51-0a4e%08x}\",\"xmlId\":null,"
+      "\"commentsCount\":\"%d\",\"serviceCommentsCount\":\"%d\",\"allowChangeDeadline\":\"Y\","
+      "\"allowTimeTracking\":\"N\",\"taskControl\":\"N\",\"addInReport\":\"N\","
+      "\"forkedByTemplateId\":null,\"timeEstimate\":\"0\",\"timeSpentInLogs\":null,"
+      "\"matchWorkTime\":\"N\",\"forumTopicId\":\"%d\",\"forumId\":\"11\",\"siteId\":\"s1\","
+      "\"subordinate\":\"N\",\"exchangeModified\":null,\"exchangeId\":null,"
+      "\"outlookVersion\":\"%d\",\"viewedDate\":\"2026-01-%02dT16:%02d:43+03:00\","
+      "\"sorting\":null,\"durationFact\":null,\"isMuted\":\"N\",\"isPinned\":\"N\","
+      "\"isPinnedInGroup\":\"N\",\"flowId\":null,\"descriptionInBbcode\":\"Y\","
+      "\"status\":\"%d\",\"statusChangedDate\":\"2026-01-%02dT10:00:00+03:00\","
+      "\"durationPlan\":null,\"durationType\":\"days\",\"favorite\":\"N\","
+      "\"group\":{\"id\":\"253\",\"name\":\"\\u0411\\u0443\\u0445\\u0433\\u0430\\u043b"
+      "\\u0442\\u0435\\u0440\\u0438\\u044f\",\"opened\":false,\"membersCount\":9,"
+      "\"image\":\"\",\"additionalData\":[]},\"creator\":{\"id\":\"1\","
+      "\"name\":\"\\u0418\\u0432\\u0430\\u043d \\u041f\\u0435\\u0442\\u0440\\u043e\\u0432\","
+      "\"link\":\"/company/personal/user/1/\",\"icon\":\"/bitrix/images/tasks/"
+      "default_avatar.png\",\"workPosition\":\"\\u0414\\u0438\\u0440\\u0435\\u043a\\u0442"
+      "\\u043e\\u0440\"},\"responsible\":{\"id\":\"%u\",\"name\":\"\\u041c\\u0430\\u0440"
+      "\\u0438\\u044f \\u0421\\u0438\\u0434\\u043e\\u0440\\u043e\\u0432\\u0430\","
+      "\"link\":\"/company/personal/user/%u/\",\"icon\":\"/upload/resize_cache/main/"
+      "a1b/100_100_2/photo_%d.jpg\",\"workPosition\":\"\\u0411\\u0443\\u0445\\u0433\\u0430"
+      "\\u043b\\u0442\\u0435\\u0440\"},\"accomplicesData\":[],\"auditorsData\":[],"
+      "\"newCommentsCount\":%d,\"action\":{\"accept\":false,\"decline\":false,"
+      "\"complete\":true,\"approve\":false,\"disapprove\":false,\"start\":true,"
+      "\"pause\":false,\"delegate\":true,\"remove\":false,\"edit\":true,\"defer\":true,"
+      "\"renew\":false,\"create\":true,\"changeDeadline\":true,\"checklistAddItems\":true,"
+      "\"addFavorite\":true,\"deleteFavorite\":false,\"rate\":true,\"edit.originator\":false,"
+      "\"checklist.reorder\":true,\"elapsedtime.add\":true,\"dayplan.timer.toggle\":false,"
+      "\"edit.plan\":true,\"checklist.add\":true,\"favorite.add\":true,"
+      "\"favorite.delete\":false}}",
+      i == 0 ? "" : ",", 4500 + i, 100 + i, 9000 + i, i % 3, 2 + i % 17, USER_ID, USER_ID,
+      5 + i % 14, i % 60, USER_ID, 5 + i % 14, i % 60, 10 + i % 20, 4500 + i,
+      0x1000 + i, i % 25, i % 4, 800 + i, 1 + i % 5, 5 + i % 14, i % 60,
+      i % 5 == 0 ? 5 : 2, 3 + i % 15, USER_ID, USER_ID, 3000 + i, i % 3);
+    body += row;
+  }
+  body += "]},\"total\":187,\"next\":50,\"time\":{\"start\":1768809600.1,"
+          "\"finish\":1768809600.6,\"duration\":0.52,\"processing\":0.49}}";
+  return body;
+}
+
+// --- Readers (what the refresh takes from each body) ---
+
+// Undone RPA tasks of USER_ID, as UndoneTasksReader counts them
+static int countUndone(Stream& stream) {
+  JsonStreamReader json(stream);
+  JsonToken token;
+  int count = 0;
+  bool isUser = false;
+  int status = -1;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (json.matches("result.#")) {
+      if (token == JSON_OBJECT_START) {
+        isUser = false;
+        status = -1;
+      } else if (token == JSON_OBJECT_END && isUser && status == 0) {
+        count++;
+      }
+    } else if (json.matches("result.#.USER_ID")) {
+      isUser = (uint32_t)json.asInt() == USER_ID;
+    } else if (json.matches("result.#.STATUS")) {
+      status = (int)json.asInt();
+    }
+  }
+  return token == JSON_END ? count : -1;
+}
+
+// Top-level `total` and the comment sum over the page
+static int readTasks(Stream& stream, int* comments) {
+  JsonStreamReader json(stream);
+  JsonToken token;
+  int total = -1;
+  *comments = 0;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_NUMBER && json.matches("total")) {
+      total = (int)json.asInt();
+    } else if (token == JSON_STRING && json.matches("result.tasks.#.commentsCount")) {
+      *comments += (int)json.asInt();
+    }
+  }
+  return token == JSON_END ? total : -1;
+}
+
+// --- Runs ---
+
+static const int ROUNDS = 40;
+// Typical TLS record payload handed out per read
+static const size_t RECORD = 1400;
+
+struct BenchResult {
+  double usPerBody;
+  size_t peakHeap;
+};
+
+static void report(const char* name, size_t bodyLen, const BenchResult& whole,
+                   const BenchResult& streamed) {
+  printf("[bench] %s: %u B body | whole String %.0f us, peak heap %u B | "
+         "streamed %.0f us, peak heap %u B + %u B reader on the stack\n",
+         name, (unsigned)bodyLen, whole.usPerBody, (unsigned)whole.peakHeap,
+         streamed.usPerBody, (unsigned)streamed.peakHeap, (unsigned)sizeof(JsonStreamReader));
+}
+
+// The old path: the whole body in one String (getString) before anything is parsed
+template <typename Parse>
+static BenchResult runWhole(const std::string& body, Parse parse) {
+  auto start = std::chrono::steady_clock::now();
+  heapStart();
+  for (int r = 0; r < ROUNDS; r++) {
+    MemoryStream wire(body.data(), body.size(), RECORD);
+    String payload;
+    char chunk[RECORD];
+    while (wire.available() > 0) {
+      size_t got = wire.readBytes(chunk, sizeof(chunk));
+      payload.concat(chunk, got);
+    }
+    MemoryStream held(payload.c_str(), payload.length());
+    TEST_ASSERT_TRUE(parse(held) >= 0);
+  }
+  size_t peak = heapStop();
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  return {us / ROUNDS, peak};
+}
+
+template <typename Parse>
+static BenchResult runStreamed(const std::string& body, Parse parse) {
+  auto start = std::chrono::steady_clock::now();
+  heapStart();
+  for (int r = 0; r < ROUNDS; r++) {
+    MemoryStream wire(body.data(), body.size(), RECORD);
+    TEST_ASSERT_TRUE(parse(wire) >= 0);
+  }
+  size_t peak = heapStop();
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  return {us / ROUNDS, peak};
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_bizproc_task_list() {
+  std::string body = bizprocBody();
+  TEST_ASSERT_TRUE(body.size() > 80000);
+  MemoryStream check(body.data(), body.size(), RECORD);
+  TEST_ASSERT_EQUAL(25, countUndone(check));
+
+  auto parse = [](Stream& s) { return countUndone(s); };
+  BenchResult whole = runWhole(body, parse);
+  BenchResult streamed = runStreamed(body, parse);
+  report("bizproc.task.list", body.size(), whole, streamed);
+
+  TEST_ASSERT_TRUE(whole.peakHeap >= body.size());
+  TEST_ASSERT_EQUAL(0, streamed.peakHeap);
+  TEST_ASSERT_TRUE(sizeof(JsonStreamReader) < 4096);
+}
+
+void test_tasks_task_list() {
+  std::string body = tasksBody();
+  TEST_ASSERT_TRUE(body.size() > 80000);
+  int comments;
+  MemoryStream check(body.data(), body.size(), RECORD);
+  TEST_ASSERT_EQUAL(187, readTasks(check, &comments));
+  TEST_ASSERT_EQUAL(600, comments);
+
+  auto parse = [](Stream& s) { int c; return readTasks(s, &c); };
+  BenchResult whole = runWhole(body, parse);
+  BenchResult streamed = runStreamed(body, parse);
+  report("tasks.task.list", body.size(), whole, streamed);
+
+  TEST_ASSERT_TRUE(whole.peakHeap >= body.size());
+  TEST_ASSERT_EQUAL(0, streamed.peakHeap);
+  TEST_ASSERT_TRUE(sizeof(JsonStreamReader) < 4096);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bizproc_task_list);
+  RUN_TEST(test_tasks_task_list);
+  return UNITY_END();
+}
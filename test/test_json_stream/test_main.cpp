@@ -0,0 +1,235 @@
+// JsonStreamReader: tokens, paths, string decoding, truncation and errors
+
+#include <unity.h>
+#include "json_stream.h"
+#include "memory_stream.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const char DOC[] =
+  "{\"result\":{\"TYPE\":{\"DIALOG\":3,\"CHAT\":\"12\"}},"
+  " \"list\":[{\"USER_ID\":\"7\"},{\"USER_ID\":8}],\n"
+  " \"ok\":true,\"next\":null,\"time\":-1.5e3}";
+
+// Every token of DOC with its path level, in order
+static const JsonToken DOC_TOKENS[] = {
+  JSON_OBJECT_START, JSON_OBJECT_START, JSON_OBJECT_START, JSON_NUMBER, JSON_STRING,
+  JSON_OBJECT_END, JSON_OBJECT_END, JSON_ARRAY_START, JSON_OBJECT_START, JSON_STRING,
+  JSON_OBJECT_END, JSON_OBJECT_START, JSON_NUMBER, JSON_OBJECT_END, JSON_ARRAY_END,
+  JSON_BOOL, JSON_NULL, JSON_NUMBER, JSON_OBJECT_END
+};
+static const uint8_t DOC_LEVELS[] = {0, 1, 2, 3, 3, 2, 1, 1, 2, 3, 2, 2, 3, 2, 1, 1, 1, 1, 0};
+
+static void checkDocTokens(size_t chunk) {
+  MemoryStream stream(DOC, chunk);
+  JsonStreamReader json(stream);
+  for (size_t i = 0; i < sizeof(DOC_TOKENS) / sizeof(DOC_TOKENS[0]); i++) {
+    TEST_ASSERT_EQUAL_MESSAGE(DOC_TOKENS[i], json.next(), "token");
+    TEST_ASSERT_EQUAL_MESSAGE(DOC_LEVELS[i], json.level(), "level");
+  }
+  TEST_ASSERT_EQUAL(JSON_END, json.next());
+  TEST_ASSERT_EQUAL(JSON_END, json.next());
+  TEST_ASSERT_FALSE(json.failed());
+  TEST_ASSERT_EQUAL(strlen(DOC), json.bytesRead());
+}
+
+void test_tokens_and_levels() {
+  checkDocTokens(0);
+}
+
+void test_tokens_across_small_reads() {
+  checkDocTokens(1);
+  checkDocTokens(5);
+}
+
+void test_paths_match_keys_array_elements_and_wildcards() {
+  MemoryStream stream(DOC);
+  JsonStreamReader json(stream);
+  JsonToken token;
+  uint8_t matched = 0;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {
+    if (token == JSON_NUMBER && json.matches("result.TYPE.DIALOG")) {
+      TEST_ASSERT_EQUAL(3, json.asInt());
+      TEST_ASSERT_EQUAL_STRING("TYPE", json.keyAt(1));
+      TEST_ASSERT_EQUAL_STRING("", json.keyAt(3));
+      TEST_ASSERT_TRUE(json.matchesFrom(1, "TYPE.DIALOG"));
+      TEST_ASSERT_TRUE(json.matchesFrom(3, ""));
+      TEST_ASSERT_TRUE(json.matches("result.*.DIALOG"));
+      TEST_ASSERT_FALSE(json.matches("result.TYPE"));
+      TEST_ASSERT_FALSE(json.matches("result.#.DIALOG"));
+      matched++;
+    } else if (json.matches("list.#.USER_ID")) {
+      // Bitrix24 sends ids as strings or numbers; asInt() takes both
+      TEST_ASSERT_EQUAL(matched == 1 ? 7 : 8, json.asInt());
+      TEST_ASSERT_TRUE(json.matches("list.*.USER_ID"));  // "*" takes array levels too
+      TEST_ASSERT_FALSE(json.matches("list.#"));
+      matched++;
+    } else if (token == JSON_BOOL) {
+      TEST_ASSERT_TRUE(json.matches("ok"));
+      TEST_ASSERT_TRUE(json.asBool());
+      matched++;
+    } else if (token == JSON_NUMBER && json.matches("time")) {
+      TEST_ASSERT_EQUAL_STRING("-1.5e3", json.text());
+      matched++;
+    }
+  }
+  TEST_ASSERT_EQUAL(JSON_END, token);
+  TEST_ASSERT_EQUAL(5, matched);
+}
+
+void test_container_tokens_carry_their_own_path() {
+  MemoryStream stream(DOC);
+  JsonStreamReader json(stream);
+  json.next();
+  TEST_ASSERT_EQUAL(JSON_OBJECT_START, json.next());
+  TEST_ASSERT_TRUE(json.matches("result"));
+  json.next();
+  TEST_ASSERT_TRUE(json.matches("result.TYPE"));
+  json.next();
+  json.next();
+  TEST_ASSERT_EQUAL(JSON_OBJECT_END, json.next());
+  TEST_ASSERT_TRUE(json.matches("result.TYPE"));
+}
+
+void test_string_escapes_decode_to_utf8() {
+  MemoryStream stream("[\"a\\\"b\\\\c\\/d\\n\\t\", \"\\u0416\\u00e9\", \"\\ud83d\\ude00!\"]");
+  JsonStreamReader json(stream);
+  TEST_ASSERT_EQUAL(JSON_ARRAY_START, json.next());
+  TEST_ASSERT_EQUAL(JSON_STRING, json.next());
+  TEST_ASSERT_EQUAL_STRING("a\"b\\c/d\n\t", json.text());
+  TEST_ASSERT_EQUAL(JSON_STRING, json.next());
+  TEST_ASSERT_EQUAL_STRING("\xD0\x96\xC3\xA9", json.text());
+  TEST_ASSERT_EQUAL(JSON_STRING, json.next());
+  TEST_ASSERT_EQUAL_STRING("\xF0\x9F\x98\x80!", json.text());
+  TEST_ASSERT_EQUAL(JSON_ARRAY_END, json.next());
+  TEST_ASSERT_EQUAL(JSON_END, json.next());
+}
+
+void test_long_values_are_cut_on_character_boundaries() {
+  // 100 two-byte characters: only whole characters fit in VALUE_LEN - 1 bytes
+  String doc = "{\"name\":\"";
+  for (int i = 0; i < 100; i++) doc += "\xD0\x96";
+  doc += "\",\"a_key_longer_than_the_key_buffer\":1}";
+  MemoryStream stream(doc.c_str());
+  JsonStreamReader json(stream);
+  json.next();
+  TEST_ASSERT_EQUAL(JSON_STRING, json.next());
+  size_t len = strlen(json.text());
+  TEST_ASSERT_EQUAL((JsonStreamReader::VALUE_LEN - 1) / 2 * 2, len);
+  TEST_ASSERT_EQUAL_HEX8(0xD0, (uint8_t)json.text()[len - 2]);
+  TEST_ASSERT_EQUAL(JSON_NUMBER, json.next());
+  TEST_ASSERT_EQUAL(JsonStreamReader::KEY_LEN - 1, strlen(json.keyAt(0)));
+  TEST_ASSERT_TRUE(json.matches("a_key_longer_than_the_k"));
+  TEST_ASSERT_EQUAL(JSON_OBJECT_END, json.next());
+}
+
+void test_skip_value_resumes_after_the_container() {
+  MemoryStream stream("{\"skip\":{\"a\":[1,2,{\"b\":\"}\"}]},\"keep\":5}");
+  JsonStreamReader json(stream);
+  json.next();
+  TEST_ASSERT_EQUAL(JSON_OBJECT_START, json.next());
+  TEST_ASSERT_TRUE(json.skipValue());
+  TEST_ASSERT_EQUAL(JSON_NUMBER, json.next());
+  TEST_ASSERT_TRUE(json.matches("keep"));
+  TEST_ASSERT_EQUAL(5, json.asInt());
+  TEST_ASSERT_EQUAL(JSON_OBJECT_END, json.next());
+  TEST_ASSERT_EQUAL(JSON_END, json.next());
+}
+
+void test_scalar_root() {
+  MemoryStream stream(" \"ok\" ");
+  JsonStreamReader json(stream);
+  TEST_ASSERT_EQUAL(JSON_STRING, json.next());
+  TEST_ASSERT_EQUAL_STRING("ok", json.text());
+  TEST_ASSERT_EQUAL(JSON_END, json.next());
+}
+
+void test_stops_at_the_end_of_the_root_value() {
+  // One byte at a time (as the Pull frame reader does): nothing after the root is consumed
+  MemoryStream stream("{\"a\":[1]}#!NGINXNME!#", 1);
+  JsonStreamReader json(stream);
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {}
+  TEST_ASSERT_EQUAL(JSON_END, token);
+  TEST_ASSERT_EQUAL(9, stream.position());
+}
+
+static JsonToken lastToken(const char* doc) {
+  MemoryStream stream(doc);
+  JsonStreamReader json(stream);
+  JsonToken token;
+  while ((token = json.next()) != JSON_END && token != JSON_ERROR) {}
+  TEST_ASSERT_EQUAL(token == JSON_ERROR, json.failed());
+  return token;
+}
+
+void test_malformed_documents_fail() {
+  TEST_ASSERT_EQUAL(JSON_END, lastToken("{\"a\":[1,2]}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":[1,2}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\" 1}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":tru}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":\"\\x\"}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":\"\\u12g4\"}"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":1"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("{\"a\":\"open"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken("]"));
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken(""));
+}
+
+void test_nesting_deeper_than_max_depth_fails() {
+  char deep[2 * JsonStreamReader::MAX_DEPTH + 3];
+  size_t n = 0;
+  for (uint8_t i = 0; i < JsonStreamReader::MAX_DEPTH; i++) deep[n++] = '[';
+  for (uint8_t i = 0; i < JsonStreamReader::MAX_DEPTH; i++) deep[n++] = ']';
+  deep[n] = '\0';
+  TEST_ASSERT_EQUAL(JSON_END, lastToken(deep));
+
+  memmove(deep + 1, deep, n + 1);
+  deep[0] = '[';
+  TEST_ASSERT_EQUAL(JSON_ERROR, lastToken(deep));
+}
+
+void test_truncation_is_told_from_syntax_errors() {
+  const char* cut[] = {"{\"a\":1", "{\"a\":\"open", "{\"a\":[1,", "{\"a\":tr", ""};
+  for (const char* doc : cut) {
+    MemoryStream stream(doc);
+    JsonStreamReader json(stream);
+    while (json.next() != JSON_ERROR) {}
+    TEST_ASSERT_TRUE_MESSAGE(json.truncated(), doc);
+  }
+  const char* bad[] = {"{\"a\":[1,2}", "{\"a\":tru}", "[[[[[[[[[[[1]]]]]]]]]]]"};
+  for (const char* doc : bad) {
+    MemoryStream stream(doc);
+    JsonStreamReader json(stream);
+    while (json.next() != JSON_ERROR) {}
+    TEST_ASSERT_FALSE_MESSAGE(json.truncated(), doc);
+  }
+}
+
+void test_error_is_sticky() {
+  MemoryStream stream("{\"a\":x}");
+  JsonStreamReader json(stream);
+  json.next();
+  TEST_ASSERT_EQUAL(JSON_ERROR, json.next());
+  TEST_ASSERT_EQUAL(JSON_ERROR, json.next());
+  TEST_ASSERT_EQUAL_STRING("", json.text());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_tokens_and_levels);
+  RUN_TEST(test_tokens_across_small_reads);
+  RUN_TEST(test_paths_match_keys_array_elements_and_wildcards);
+  RUN_TEST(test_container_tokens_carry_their_own_path);
+  RUN_TEST(test_string_escapes_decode_to_utf8);
+  RUN_TEST(test_long_values_are_cut_on_character_boundaries);
+  RUN_TEST(test_skip_value_resumes_after_the_container);
+  RUN_TEST(test_scalar_root);
+  RUN_TEST(test_stops_at_the_end_of_the_root_value);
+  RUN_TEST(test_malformed_documents_fail);
+  RUN_TEST(test_nesting_deeper_than_max_depth_fails);
+  RUN_TEST(test_truncation_is_told_from_syntax_errors);
+  RUN_TEST(test_error_is_sticky);
+  return UNITY_END();
+}
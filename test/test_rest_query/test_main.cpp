@@ -0,0 +1,197 @@
+// Query building and the per-refresh arena: encoding, overflow, reset, and no heap use
+
+#include <unity.h>
+#include "rest_query.h"
+#include "bitrix24_batch.h"
+
+// Heap calls made by this process while `counting` (glibc's own allocator underneath)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* block, size_t size);
+static bool counting = false;
+static unsigned long heapCalls = 0;
+
+extern "C" void* malloc(size_t size) {
+  if (counting) heapCalls++;
+  return __libc_malloc(size);
+}
+extern "C" void* calloc(size_t count, size_t size) {
+  if (counting) heapCalls++;
+  return __libc_calloc(count, size);
+}
+extern "C" void* realloc(void* block, size_t size) {
+  if (counting) heapCalls++;
+  return __libc_realloc(block, size);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_params_are_joined_and_values_encoded() {
+  char buffer[160];
+  QueryBuilder q(buffer, sizeof(buffer));
+  q.raw("https://portal.bitrix24.ru/rest/1/abc/tasks.task.list?");
+  q.param("filter[<DEADLINE]", "2026-01-19T00:00:00+03:00").param("start", (uint32_t)50);
+  TEST_ASSERT_EQUAL_STRING(
+    "https://portal.bitrix24.ru/rest/1/abc/tasks.task.list?"
+    "filter[<DEADLINE]=2026-01-19T00%3A00%3A00%2B03%3A00&start=50",
+    q.c_str());
+  TEST_ASSERT_EQUAL(strlen(q.c_str()), q.length());
+  TEST_ASSERT_TRUE(q.ok());
+
+  // No separator after '&' or at the start
+  QueryBuilder p(buffer, sizeof(buffer));
+  p.param("a", "1").raw('&').param("b", "x y&z=\xD0\x96~._-");
+  TEST_ASSERT_EQUAL_STRING("a=1&b=x%20y%26z%3D%D0%96~._-", p.c_str());
+  p.clear();
+  p.param("max", (uint32_t)4294967295u);
+  TEST_ASSERT_EQUAL_STRING("max=4294967295", p.c_str());
+}
+
+void test_overflow_drops_the_rest_and_sticks() {
+  char buffer[16];
+  QueryBuilder q(buffer, sizeof(buffer));
+  q.raw("0123456789");
+  q.raw("abcdefgh");  // Doesn't fit: dropped whole, not cut
+  TEST_ASSERT_TRUE(q.overflowed());
+  TEST_ASSERT_FALSE(q.ok());
+  TEST_ASSERT_EQUAL_STRING("0123456789", q.c_str());
+  q.raw("x");  // Fits, but the query is already broken
+  TEST_ASSERT_EQUAL_STRING("0123456789", q.c_str());
+
+  // Encoding stops at the first character that doesn't fit; the buffer stays terminated
+  q.clear();
+  TEST_ASSERT_TRUE(q.ok());
+  q.param("k", "aaaaaaaaa:bbb");
+  TEST_ASSERT_TRUE(q.overflowed());
+  TEST_ASSERT_TRUE(q.length() < sizeof(buffer));
+  TEST_ASSERT_EQUAL(q.length(), strlen(q.c_str()));
+  TEST_ASSERT_EQUAL(0, strncmp(q.c_str(), "k=aaaaaaaaa", 11));
+
+  // Exactly full (15 characters + NUL) is still fine
+  q.clear();
+  q.raw("012345678901234");
+  TEST_ASSERT_TRUE(q.ok());
+  TEST_ASSERT_EQUAL(15, q.length());
+
+  QueryBuilder none(nullptr, 0);
+  TEST_ASSERT_TRUE(none.overflowed());
+  none.raw("a").param("b", "c");
+  none.clear();
+  TEST_ASSERT_TRUE(none.overflowed());
+}
+
+void test_arena_allocates_aligned_and_fails_cleanly() {
+  alignas(8) uint8_t buffer[64];
+  Arena arena(buffer, sizeof(buffer));
+  void* a = arena.alloc(3);
+  void* b = arena.alloc(5);
+  TEST_ASSERT_EQUAL_PTR(buffer, a);
+  TEST_ASSERT_EQUAL(0, ((uint8_t*)b - buffer) % sizeof(void*));
+  size_t used = arena.size();
+  TEST_ASSERT_NULL(arena.alloc(sizeof(buffer)));
+  TEST_ASSERT_EQUAL(used, arena.size());
+
+  char* text = arena.copy("filter[GROUP_ID]=12");
+  TEST_ASSERT_EQUAL_STRING("filter[GROUP_ID]=12", text);
+  TEST_ASSERT_NULL(arena.copy("a text too long for what is left of the arena ....."));
+}
+
+void test_arena_rest_shrinks_back_and_resets() {
+  alignas(8) uint8_t buffer[128];
+  Arena arena(buffer, sizeof(buffer));
+  arena.alloc(10);
+  size_t capacity;
+  char* rest = arena.allocRest(&capacity);
+  TEST_ASSERT_NOT_NULL(rest);
+  TEST_ASSERT_EQUAL(sizeof(buffer), arena.size());
+  QueryBuilder q(rest, capacity);
+  q.param("start", (uint32_t)50);
+  arena.shrink(rest, q.length() + 1);
+  TEST_ASSERT_EQUAL((size_t)(rest - (char*)buffer) + 9, arena.size());
+  // The next allocation starts after the kept query
+  char* next = arena.copy("x");
+  TEST_ASSERT_TRUE(next > rest + q.length());
+  TEST_ASSERT_EQUAL_STRING("start=50", rest);
+
+  // A block from elsewhere is ignored
+  uint8_t other[8];
+  size_t before = arena.size();
+  arena.shrink(other, 0);
+  TEST_ASSERT_EQUAL(before, arena.size());
+
+  arena.reset();
+  TEST_ASSERT_EQUAL(0, arena.size());
+  TEST_ASSERT_EQUAL(sizeof(buffer), arena.highWater());
+  TEST_ASSERT_EQUAL_PTR(buffer, arena.alloc(1));
+
+  arena.allocRest(&capacity);
+  TEST_ASSERT_NULL(arena.allocRest(&capacity));
+  TEST_ASSERT_EQUAL(0, capacity);
+}
+
+// One refresh cycle the way the Bitrix24 task builds it: sub-queries, then the batch body
+static bool buildCycle(Arena& arena, uint32_t cycle) {
+  static const char* const KEYS[] = {"dialogs", "expired", "undone", "wd0", "wa0", "wd1", "wa1"};
+  Bitrix24BatchCmd cmds[7];
+  arena.reset();
+  for (uint8_t i = 0; i < 7; i++) {
+    size_t capacity;
+    char* buffer = arena.allocRest(&capacity);
+    QueryBuilder q(buffer, capacity);
+    q.param("filter[RESPONSIBLE_ID]", (uint32_t)356)
+     .param("filter[<DEADLINE]", "2026-01-19T15:58:59+03:00")
+     .param("filter[GROUP_ID]", cycle % 1000 + i)
+     .param("select[]", "ID");
+    if (!q.ok()) return false;
+    arena.shrink(buffer, q.length() + 1);
+    cmds[i] = {KEYS[i], "tasks.task.list", buffer, nullptr};
+  }
+  size_t capacity;
+  char* bodyBuffer = arena.allocRest(&capacity);
+  QueryBuilder body(bodyBuffer, capacity);
+  if (!b24BatchBuildBody(body, cmds, 7)) return false;
+  arena.shrink(bodyBuffer, body.length() + 1);
+  return true;
+}
+
+// A day of refresh query building: the builder and arena make no heap calls at all, and the
+// arena's high-water mark settles after one cycle. (Other refresh paths, such as the digest
+// text, group names and the network report, still build Strings; they are not covered here.)
+void test_query_building_never_touches_the_heap() {
+  static uint8_t buffer[4096];
+  Arena arena(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(buildCycle(arena, 0));
+  size_t highWater = arena.highWater();
+
+  heapCalls = 0;
+  counting = true;
+  bool ok = true;
+  for (uint32_t cycle = 1; cycle <= 20000 && ok; cycle++) {
+    ok = buildCycle(arena, cycle);
+  }
+  counting = false;
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL(0, heapCalls);
+  TEST_ASSERT_TRUE(arena.highWater() <= highWater + 16);
+}
+
+void test_cycle_too_big_for_the_arena_is_refused() {
+  static uint8_t buffer[512];
+  Arena arena(buffer, sizeof(buffer));
+  TEST_ASSERT_FALSE(buildCycle(arena, 0));
+  // Refused cleanly: the next, smaller use of the arena works
+  arena.reset();
+  TEST_ASSERT_NOT_NULL(arena.copy("filter[GROUP_ID]=12"));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_params_are_joined_and_values_encoded);
+  RUN_TEST(test_overflow_drops_the_rest_and_sticks);
+  RUN_TEST(test_arena_allocates_aligned_and_fails_cleanly);
+  RUN_TEST(test_arena_rest_shrinks_back_and_resets);
+  RUN_TEST(test_query_building_never_touches_the_heap);
+  RUN_TEST(test_cycle_too_big_for_the_arena_is_refused);
+  return UNITY_END();
+}
@@ -0,0 +1,383 @@
+// Telegram Bot API wire format against a Bot API stand-in (getUpdates long polls and the
+// offset that confirms updates), recorded response bodies, and the method bodies we send
+
+#include <unity.h>
+#include "telegram_api.h"
+#include "json_stream.h"
+#include "memory_stream.h"
+#include <string>
+#include <vector>
+
+// --- Bot API stand-in: updates wait until a getUpdates offset passes them ---
+
+struct BotUpdate {
+  int32_t id;
+  std::string json;  // Update object without its update_id
+};
+
+static std::vector<BotUpdate> pending;
+static std::string replyBody;
+static int failWith = 0;         // Status of the next request instead of an answer
+static long lastOffset = -1;
+static long lastTimeout = -1;
+static long lastLimit = -1;
+static unsigned polls = 0;
+
+static long queryParam(const char* url, const char* name) {
+  std::string query = url;
+  std::string key = std::string(name) + "=";
+  size_t at = query.find("?" + key);
+  if (at == std::string::npos) at = query.find("&" + key);
+  return at == std::string::npos ? -1 : atol(url + at + key.size() + 1);
+}
+
+// Serves one getUpdates GET into replyBody; returns the HTTP status
+static int botApi(const char* url) {
+  if (failWith != 0) {
+    int status = failWith;
+    failWith = 0;
+    replyBody = "{\"ok\":false,\"error_code\":" + std::to_string(status) +
+                ",\"description\":\"Conflict: terminated by other getUpdates request\"}";
+    return status;
+  }
+  TEST_ASSERT_NOT_NULL(strstr(url, "/getUpdates?"));
+  polls++;
+  lastOffset = queryParam(url, "offset");
+  lastLimit = queryParam(url, "limit");
+  lastTimeout = queryParam(url, "timeout");
+
+  // As Telegram: an offset confirms every update before it, for good
+  while (!pending.empty() && pending.front().id < lastOffset) pending.erase(pending.begin());
+  // Nothing there: hold the request until the timeout
+  if (pending.empty()) hostMillis += (unsigned long)lastTimeout * 1000UL;
+  replyBody = "{\"ok\":true,\"result\":[";
+  for (size_t i = 0; i < pending.size() && (long)i < lastLimit; i++) {
+    if (i > 0) replyBody += ",";
+    replyBody += "{\"update_id\":" + std::to_string(pending[i].id) + "," + pending[i].json + "}";
+  }
+  replyBody += "]}";
+  return 200;
+}
+
+static void chatMessage(int32_t id, const char* text) {
+  pending.push_back({id, std::string("\"message\":{\"message_id\":") + std::to_string(id + 5000) +
+                         ",\"from\":{\"id\":77,\"is_bot\":false,\"first_name\":\"Anna\"},"
+                         "\"chat\":{\"id\":77,\"type\":\"private\"},\"date\":1768827539,"
+                         "\"text\":\"" + text + "\"}"});
+}
+
+// --- Poll side, as telegramGetUpdates() does it over the pool ---
+
+static TelegramUpdate updates[TELEGRAM_UPDATES_MAX];
+static const char ALLOWED[] = "[\"message\",\"callback_query\"]";
+static std::string lastUrl;
+
+static int poll(int32_t* lastUpdateId, uint8_t timeoutSec) {
+  char urlBuf[256];
+  QueryBuilder url(urlBuf, sizeof(urlBuf));
+  url.raw("https://api.telegram.org/bot123456:TEST-TOKEN/getUpdates?");
+  if (!telegramUpdatesQuery(url, *lastUpdateId, timeoutSec, ALLOWED)) return -1;
+  lastUrl = url.c_str();
+  if (botApi(url.c_str()) != 200) return -1;
+  MemoryStream body(replyBody.data(), replyBody.size(), 64);
+  bool ok;
+  int count = telegramParseUpdates(body, updates, TELEGRAM_UPDATES_MAX, lastUpdateId, &ok);
+  return (!ok && count == 0) ? -1 : count;
+}
+
+// --- Tests ---
+
+void setUp() {
+  pending.clear();
+  failWith = 0;
+  polls = 0;
+  hostMillis = 1000;
+}
+
+void tearDown() {}
+
+void test_offset_advances_past_what_was_received() {
+  chatMessage(400, "/status");
+  chatMessage(401, "/start");
+  int32_t last = 0;
+  TEST_ASSERT_EQUAL(2, poll(&last, 50));
+  TEST_ASSERT_EQUAL(1, lastOffset);
+  TEST_ASSERT_EQUAL(401, last);
+  TEST_ASSERT_EQUAL_STRING("/status", updates[0].text);
+  TEST_ASSERT_EQUAL_STRING("77", updates[1].chatId);
+
+  // The next poll confirms both: the server drops them and holds the request
+  chatMessage(402, "/stop");
+  TEST_ASSERT_EQUAL(1, poll(&last, 50));
+  TEST_ASSERT_EQUAL(402, lastOffset);
+  TEST_ASSERT_EQUAL(402, last);
+  TEST_ASSERT_EQUAL_STRING("/stop", updates[0].text);
+  TEST_ASSERT_EQUAL(1, pending.size());
+}
+
+void test_idle_chat_is_one_held_request_per_timeout() {
+  int32_t last = 700;
+  unsigned long start = hostMillis;
+  TEST_ASSERT_EQUAL(0, poll(&last, 50));
+  TEST_ASSERT_EQUAL(50, lastTimeout);
+  TEST_ASSERT_EQUAL(50000, hostMillis - start);
+  TEST_ASSERT_EQUAL(701, lastOffset);
+  TEST_ASSERT_EQUAL(700, last);
+  // A longer hold than HTTPClient can wait for is cut down
+  TEST_ASSERT_EQUAL(0, poll(&last, 120));
+  TEST_ASSERT_EQUAL(55, lastTimeout);
+}
+
+void test_query_names_what_the_bot_handles() {
+  int32_t last = 0;
+  poll(&last, 50);
+  TEST_ASSERT_NOT_EQUAL(std::string::npos,
+                        lastUrl.find("&allowed_updates=%5B%22message%22%2C%22callback_query%22%5D"));
+  TEST_ASSERT_EQUAL(TELEGRAM_UPDATES_MAX, lastLimit);
+  // The device's read timeout (hold + 10 s) still fits HTTPClient's 16-bit milliseconds
+  TEST_ASSERT_TRUE((telegramPollSeconds(255) + 10) * 1000UL <= UINT16_MAX);
+
+  // Update ids near the top of the range still make a valid offset
+  last = 2147483646;
+  TEST_ASSERT_EQUAL(0, poll(&last, 50));
+  TEST_ASSERT_EQUAL(2147483647L, lastOffset);
+
+  char tiny[40];
+  QueryBuilder url(tiny, sizeof(tiny));
+  TEST_ASSERT_FALSE(telegramUpdatesQuery(url, 0, 50, ALLOWED));
+}
+
+// A burst bigger than one poll takes: every update exactly once, in order
+void test_burst_comes_over_several_polls() {
+  const int32_t count = 3 * TELEGRAM_UPDATES_MAX - 1;
+  for (int32_t id = 10; id < 10 + count; id++) chatMessage(id, "/status");
+  int32_t last = 9;
+  int32_t expected = 10;
+  int n;
+  while ((n = poll(&last, 50)) > 0 && polls < 10) {
+    for (int i = 0; i < n; i++) TEST_ASSERT_EQUAL(expected++, updates[i].updateId);
+  }
+  TEST_ASSERT_EQUAL(0, n);
+  TEST_ASSERT_EQUAL(10 + count, expected);
+  // Three full or partial batches, then one held poll that confirms the last
+  TEST_ASSERT_EQUAL(4, polls);
+  TEST_ASSERT_TRUE(pending.empty());
+}
+
+// Updates without text are confirmed too, or they would block the offset forever
+void test_updates_without_text_still_advance_the_offset() {
+  pending.push_back({50, "\"message\":{\"message_id\":1,\"chat\":{\"id\":77},\"sticker\":{\"file_id\":\"x\"}}"});
+  chatMessage(51, "/status");
+  pending.push_back({52, "\"edited_message\":{\"message_id\":1,\"chat\":{\"id\":77},\"text\":\"x\"}"});
+  int32_t last = 49;
+  TEST_ASSERT_EQUAL(1, poll(&last, 50));
+  TEST_ASSERT_EQUAL(51, updates[0].updateId);
+  TEST_ASSERT_EQUAL(52, last);
+  TEST_ASSERT_EQUAL(0, poll(&last, 50));
+  TEST_ASSERT_TRUE(pending.empty());
+}
+
+void test_failed_poll_keeps_the_offset() {
+  chatMessage(90, "/status");
+  int32_t last = 89;
+  failWith = 409;
+  TEST_ASSERT_EQUAL(-1, poll(&last, 50));
+  TEST_ASSERT_EQUAL(89, last);
+  failWith = 502;
+  TEST_ASSERT_EQUAL(-1, poll(&last, 50));
+  TEST_ASSERT_EQUAL(89, last);
+  // The update still comes
+  TEST_ASSERT_EQUAL(1, poll(&last, 50));
+  TEST_ASSERT_EQUAL(90, last);
+}
+
+// A body cut off mid-update (connection dropped, read timed out) confirms nothing after the
+// last complete update: the cut one comes again with the next poll
+void test_truncated_body_keeps_the_cut_update() {
+  static const char CUT[] =
+    "{\"ok\":true,\"result\":[{\"update_id\":100,\"message\":{\"chat\":{\"id\":77},"
+    "\"text\":\"/status\"}},{\"update_id\":101,\"message\":{\"chat\":{\"id\":77},\"te";
+  MemoryStream body(CUT, strlen(CUT), 16);
+  int32_t last = 99;
+  bool ok;
+  TEST_ASSERT_EQUAL(1, telegramParseUpdates(body, updates, TELEGRAM_UPDATES_MAX, &last, &ok));
+  TEST_ASSERT_FALSE(ok);
+  TEST_ASSERT_EQUAL(100, updates[0].updateId);
+  TEST_ASSERT_EQUAL(100, last);
+}
+
+// An update the tokenizer can never read is skipped, or every later poll would stop on it
+void test_unreadable_update_is_skipped() {
+  std::string deep = "{\"ok\":true,\"result\":[{\"update_id\":102,\"message\":{\"chat\":{\"id\":77},\"x\":";
+  for (uint8_t i = 0; i < JsonStreamReader::MAX_DEPTH; i++) deep += "[";
+  for (uint8_t i = 0; i < JsonStreamReader::MAX_DEPTH; i++) deep += "]";
+  deep += "}}]}";
+  MemoryStream body(deep.data(), deep.size(), 16);
+  int32_t last = 101;
+  bool ok;
+  TEST_ASSERT_EQUAL(0, telegramParseUpdates(body, updates, TELEGRAM_UPDATES_MAX, &last, &ok));
+  TEST_ASSERT_FALSE(ok);
+  TEST_ASSERT_EQUAL(102, last);
+}
+
+// --- Recorded bodies (as api.telegram.org sends them, ids changed) ---
+
+static const char RECORDED_UPDATES[] =
+  "{\"ok\":true,\"result\":[{\"update_id\":731204518,\n"
+  "\"message\":{\"message_id\":2817,\"from\":{\"id\":5123456789,\"is_bot\":false,"
+  "\"first_name\":\"\\u0418\\u0432\\u0430\\u043d\",\"language_code\":\"ru\"},"
+  "\"chat\":{\"id\":5123456789,\"first_name\":\"\\u0418\\u0432\\u0430\\u043d\","
+  "\"type\":\"private\"},\"date\":1768812000,\"text\":\"/status\","
+  "\"entities\":[{\"offset\":0,\"length\":7,\"type\":\"bot_command\"}]}},"
+  "{\"update_id\":731204519,\n"
+  "\"callback_query\":{\"id\":\"2200451726539804126\",\"from\":{\"id\":5123456789,"
+  "\"is_bot\":false,\"first_name\":\"\\u0418\\u0432\\u0430\\u043d\"},"
+  "\"message\":{\"message_id\":2790,\"from\":{\"id\":7012345678,\"is_bot\":true,"
+  "\"first_name\":\"Bitrix24 Monitor\",\"username\":\"b24_monitor_bot\"},"
+  "\"chat\":{\"id\":-1001987654321,\"title\":\"\\u041e\\u0442\\u0434\\u0435\\u043b\","
+  "\"type\":\"supergroup\"},\"date\":1768811000,\"text\":\"\\ud83d\\udcca 3 \\u0437\\u0430\\u0434\\u0430\\u0447\","
+  "\"reply_markup\":{\"inline_keyboard\":[[{\"text\":\"\\u041e\\u0431\\u043d\\u043e\\u0432\\u0438\\u0442\\u044c\","
+  "\"callback_data\":\"refresh\"}]]}},\"chat_instance\":\"-4817263549182736451\","
+  "\"data\":\"refresh\"}},"
+  "{\"update_id\":731204520,\n"
+  "\"message\":{\"message_id\":2818,\"from\":{\"id\":5123456789,\"is_bot\":false,"
+  "\"first_name\":\"\\u0418\\u0432\\u0430\\u043d\"},\"chat\":{\"id\":5123456789,"
+  "\"type\":\"private\"},\"date\":1768812060,"
+  "\"text\":\"\\u041f\\u0440\\u0438\\u0432\\u0435\\u0442 \\ud83d\\udc4b\"}}]}";
+
+static const char RECORDED_SENT[] =
+  "{\"ok\":true,\"result\":{\"message_id\":2819,\"from\":{\"id\":7012345678,"
+  "\"is_bot\":true,\"first_name\":\"Bitrix24 Monitor\",\"username\":\"b24_monitor_bot\"},"
+  "\"chat\":{\"id\":5123456789,\"first_name\":\"\\u0418\\u0432\\u0430\\u043d\","
+  "\"type\":\"private\"},\"date\":1768812061,\"text\":\"\\u2705 \\u0413\\u043e\\u0442\\u043e\\u0432\\u043e\","
+  "\"entities\":[{\"offset\":2,\"length\":6,\"type\":\"bold\"}]}}";
+
+static void parseRecordedReply(const char* text, TelegramReply* reply) {
+  MemoryStream body(text, strlen(text), 64);
+  telegramParseReply(body, reply);
+}
+
+void test_recorded_updates_with_entities_callbacks_and_unicode() {
+  MemoryStream body(RECORDED_UPDATES, strlen(RECORDED_UPDATES), 64);
+  int32_t last = 731204517;
+  bool ok = false;
+  TEST_ASSERT_EQUAL(3, telegramParseUpdates(body, updates, TELEGRAM_UPDATES_MAX, &last, &ok));
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL(731204520, last);
+
+  TEST_ASSERT_EQUAL(TG_UPDATE_MESSAGE, updates[0].type);
+  TEST_ASSERT_EQUAL(731204518, updates[0].updateId);
+  TEST_ASSERT_EQUAL_STRING("5123456789", updates[0].chatId);
+  TEST_ASSERT_EQUAL_STRING("/status", updates[0].text);
+
+  // The button's data, the chat of the message it hangs on, and the query to answer; the
+  // message's own text doesn't overwrite the data
+  TEST_ASSERT_EQUAL(TG_UPDATE_CALLBACK, updates[1].type);
+  TEST_ASSERT_EQUAL_STRING("-1001987654321", updates[1].chatId);
+  TEST_ASSERT_EQUAL_STRING("2200451726539804126", updates[1].callbackId);
+  TEST_ASSERT_EQUAL_STRING("refresh", updates[1].text);
+
+  // \u escapes (a surrogate pair for the emoji) come out as UTF-8
+  TEST_ASSERT_EQUAL_STRING("\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82 \xF0\x9F\x91\x8B",
+                           updates[2].text);
+}
+
+void test_recorded_send_reply() {
+  TelegramReply reply;
+  parseRecordedReply(RECORDED_SENT, &reply);
+  TEST_ASSERT_TRUE(reply.ok);
+  TEST_ASSERT_EQUAL(2819, reply.messageId);
+  TEST_ASSERT_EQUAL_STRING("", reply.description);
+}
+
+void test_recorded_error_replies() {
+  TelegramReply reply;
+  parseRecordedReply("{\"ok\":false,\"error_code\":400,\"description\":"
+                     "\"Bad Request: message is not modified: specified new message content "
+                     "and reply markup are exactly the same as a current content and reply "
+                     "markup of the message\"}", &reply);
+  TEST_ASSERT_FALSE(reply.ok);
+  TEST_ASSERT_EQUAL(0, reply.messageId);
+  // Cut to fit, still terminated
+  TEST_ASSERT_EQUAL(sizeof(reply.description) - 1, strlen(reply.description));
+  TEST_ASSERT_EQUAL(0, strncmp(reply.description, "Bad Request: message is not modified", 36));
+
+  parseRecordedReply("{\"ok\":false,\"error_code\":429,\"description\":"
+                     "\"Too Many Requests: retry after 7\",\"parameters\":{\"retry_after\":7}}",
+                     &reply);
+  TEST_ASSERT_FALSE(reply.ok);
+  TEST_ASSERT_EQUAL_STRING("Too Many Requests: retry after 7", reply.description);
+
+  parseRecordedReply("{\"ok\":false,\"error_code\":403,"
+                     "\"description\":\"Forbidden: bot was blocked by the user\"}", &reply);
+  TEST_ASSERT_FALSE(reply.ok);
+  TEST_ASSERT_EQUAL_STRING("Forbidden: bot was blocked by the user", reply.description);
+
+  // A second poller on the same token: getUpdates fails and nothing moves
+  static const char CONFLICT[] =
+    "{\"ok\":false,\"error_code\":409,\"description\":\"Conflict: terminated by other "
+    "getUpdates request; make sure that only one bot instance is running\"}";
+  MemoryStream body(CONFLICT, strlen(CONFLICT), 64);
+  int32_t last = 731204517;
+  bool ok = true;
+  TEST_ASSERT_EQUAL(0, telegramParseUpdates(body, updates, TELEGRAM_UPDATES_MAX, &last, &ok));
+  TEST_ASSERT_FALSE(ok);
+  TEST_ASSERT_EQUAL(731204517, last);
+
+  // An HTML error page from a proxy is not a reply
+  parseRecordedReply("<html><head><title>502 Bad Gateway</title></head></html>", &reply);
+  TEST_ASSERT_FALSE(reply.ok);
+  TEST_ASSERT_EQUAL(0, reply.messageId);
+}
+
+void test_message_bodies() {
+  char buffer[256];
+  QueryBuilder body(buffer, sizeof(buffer));
+  TEST_ASSERT_TRUE(telegramMessageBody(body, "5123456789", 0, "<b>3</b> \"tasks\"\n\\\t", nullptr,
+                                       true));
+  TEST_ASSERT_EQUAL_STRING("{\"chat_id\":\"5123456789\",\"parse_mode\":\"HTML\","
+                           "\"text\":\"<b>3</b> \\\"tasks\\\"\\n\\\\\\u0009\","
+                           "\"disable_notification\":true}", body.c_str());
+
+  body.clear();
+  TEST_ASSERT_TRUE(telegramMessageBody(body, "-1001987654321", 2790, "\xD0\x9E\xD0\x9A",
+                                       "{\"inline_keyboard\":[[{\"text\":\"R\","
+                                       "\"callback_data\":\"refresh\"}]]}", false));
+  TEST_ASSERT_EQUAL_STRING("{\"chat_id\":\"-1001987654321\",\"message_id\":2790,"
+                           "\"parse_mode\":\"HTML\",\"text\":\"\xD0\x9E\xD0\x9A\","
+                           "\"reply_markup\":{\"inline_keyboard\":[[{\"text\":\"R\","
+                           "\"callback_data\":\"refresh\"}]]}}", body.c_str());
+
+  // deleteMessage / pinChatMessage: no text
+  body.clear();
+  TEST_ASSERT_TRUE(telegramMessageBody(body, "42", 7, nullptr, nullptr, true));
+  TEST_ASSERT_EQUAL_STRING("{\"chat_id\":\"42\",\"message_id\":7,"
+                           "\"disable_notification\":true}", body.c_str());
+
+  body.clear();
+  TEST_ASSERT_TRUE(telegramCallbackBody(body, "2200451726539804126"));
+  TEST_ASSERT_EQUAL_STRING("{\"callback_query_id\":\"2200451726539804126\"}", body.c_str());
+
+  // Too long for the buffer: refused rather than sent cut
+  char small[48];
+  QueryBuilder tight(small, sizeof(small));
+  TEST_ASSERT_FALSE(telegramMessageBody(tight, "5123456789", 0, "a status line longer than the rest",
+                                        nullptr, false));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_offset_advances_past_what_was_received);
+  RUN_TEST(test_idle_chat_is_one_held_request_per_timeout);
+  RUN_TEST(test_query_names_what_the_bot_handles);
+  RUN_TEST(test_burst_comes_over_several_polls);
+  RUN_TEST(test_updates_without_text_still_advance_the_offset);
+  RUN_TEST(test_failed_poll_keeps_the_offset);
+  RUN_TEST(test_truncated_body_keeps_the_cut_update);
+  RUN_TEST(test_unreadable_update_is_skipped);
+  RUN_TEST(test_recorded_updates_with_entities_callbacks_and_unicode);
+  RUN_TEST(test_recorded_send_reply);
+  RUN_TEST(test_recorded_error_replies);
+  RUN_TEST(test_message_bodies);
+  return UNITY_END();
+}